@@ -5,16 +5,137 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+// pack files, shared-memory pools, intern snapshots, `sl_frame_writev` and
+// `sl_lru_shared` are only built on POSIX systems
+#if defined(__unix__) || defined(__APPLE__)
+#define SL_HAVE_POSIX 1
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef char *sl_str; // opaque type
 
+/**
+ * Non-owning view of bytes (usually a part of an `sl_str`)
+ * It is not null-terminated.
+ */
+typedef struct {
+    const char *data;
+    size_t len;
+} sl_view;
+
 // === ERROR CODES ===
 typedef enum {
     SL_OK = 0,
     SL_ERR_ALLOC,
     SL_ERR_INVALID,
     SL_ERR_NULL,
+    SL_ERR_RANGE,
+    SL_ERR_FORMAT,
+    SL_ERR_READONLY,
+    SL_ERR_IO,
 } sl_err;
 
+// === BASE64 ALPHABETS ===
+typedef enum {
+    SL_BASE64_STD, // RFC 4648 '+' '/' with '=' padding
+    SL_BASE64_URL, // URL and filename safe '-' '_' without padding
+} sl_base64_alphabet;
+
+// === ARENA ===
+typedef struct sl_arena sl_arena; // opaque type
+
+// === ROPE ===
+typedef struct sl_rope sl_rope; // opaque type
+
+// === GAP BUFFER ===
+typedef struct sl_gapbuf sl_gapbuf; // opaque type
+
+// === PACK FILE ===
+typedef struct sl_pack sl_pack; // opaque type
+
+// === SHARED MEMORY POOL ===
+typedef struct sl_shm_pool sl_shm_pool; // opaque type
+
+// === INTERN TABLE ===
+typedef struct sl_intern sl_intern; // opaque type
+
+// === FRAMING ===
+typedef enum {
+    SL_FRAME_NETSTRING, // <len>:<bytes>,
+    SL_FRAME_RESP,      // $<len>\r\n<bytes>\r\n (RESP bulk string)
+} sl_frame_format;
+
+typedef struct sl_frame_decoder sl_frame_decoder; // opaque type
+struct iovec;
+
+// `max_frame` of `sl_frame_decoder_new`: 0 selects the default limit,
+// `SL_FRAME_UNLIMITED` accepts any length the peer announces
+#define SL_FRAME_DEFAULT_MAX ((size_t)64 << 20)
+#define SL_FRAME_UNLIMITED SIZE_MAX
+
+// buffer sizes for `sl_frame_encode_many` with `n` frames
+#define SL_FRAME_IOVECS(n) (2 * (n) + 1)
+#define SL_FRAME_SCRATCH(n) (32 * (n))
+
+// === FRONT-CODED SET ===
+typedef struct sl_fcset sl_fcset;           // opaque type
+typedef struct sl_fcset_iter sl_fcset_iter; // opaque type
+
+// === COMPRESSION ===
+typedef struct sl_symtab sl_symtab; // opaque type
+
+// === DICTIONARY COLUMN ===
+typedef struct sl_dict_column sl_dict_column; // opaque type
+
+// code returned when a value is not in the dictionary
+#define SL_DICT_NONE UINT32_MAX
+
+// === RADIX TREE ===
+typedef struct sl_radix sl_radix; // opaque type
+
+// callback of `sl_radix_each_prefix`, return false to stop
+typedef bool (*sl_radix_visit)(sl_view key, void *value, void *ctx);
+
+// === B-TREE ===
+typedef struct sl_btree sl_btree;           // opaque type
+typedef struct sl_btree_iter sl_btree_iter; // opaque type
+
+// === LRU CACHE ===
+typedef struct sl_lru sl_lru;               // opaque type
+typedef struct sl_lru_shared sl_lru_shared; // opaque type
+
+// called with each value dropped by a cache, which it takes over
+typedef void (*sl_lru_evict)(sl_view key, sl_str value, void *ctx);
+
+// === FILTERS ===
+typedef struct sl_bloom sl_bloom;   // opaque type
+typedef struct sl_cuckoo sl_cuckoo; // opaque type
+
+// === SKETCHES ===
+typedef struct sl_hll sl_hll; // opaque type
+typedef struct sl_cms sl_cms; // opaque type
+
+// heavy hitter reported by `sl_cms_top`
+typedef struct {
+    sl_view key;
+    uint64_t count;
+} sl_cms_item;
+
+// === ROLLING HASH ===
+typedef struct sl_rolling_hash sl_rolling_hash; // opaque type
+
+// callback of `sl_ngrams`, return false to stop
+typedef bool (*sl_ngram_visit)(sl_view gram, uint64_t hash, void *ctx);
+
+// offset returned by `sl_find_any` when no needle occurs
+#define SL_NOT_FOUND SIZE_MAX
+
+// === SIMILARITY SIGNATURES ===
+typedef struct sl_lsh sl_lsh; // opaque type
+
 
 sl_str sl_from_cstr(const char *init, sl_err *err);
 sl_str sl_from_bytes(const void *bytes, size_t len, sl_err *err);
@@ -24,10 +145,252 @@ void sl_free(sl_str *str, sl_err *err);
 size_t sl_len(sl_str str, sl_err *err);
 size_t sl_cap(sl_str str, sl_err *err);
 sl_str sl_append_cstr(sl_str str, const char *init, sl_err *err);
+sl_str sl_insert(sl_str str, size_t pos, const void *bytes, size_t len, sl_err *err);
+sl_str sl_erase(sl_str str, size_t pos, size_t len, sl_err *err);
+sl_str sl_replace_range(sl_str str, size_t pos, size_t len, const void *bytes, size_t bytes_len,
+                        sl_err *err);
+sl_str sl_replace_all(sl_str str, const void *needle, size_t needle_len, const void *repl, size_t repl_len,
+                      sl_err *err);
+sl_str sl_trim(sl_str str, sl_err *err);
+sl_str sl_ltrim(sl_str str, sl_err *err);
+sl_str sl_rtrim(sl_str str, sl_err *err);
+sl_str sl_collapse_ws(sl_str str, sl_err *err);
+sl_view sl_trim_view(sl_str str, sl_err *err);
+sl_view sl_ltrim_view(sl_str str, sl_err *err);
+sl_view sl_rtrim_view(sl_str str, sl_err *err);
 
 bool sl_eq(sl_str str1, sl_str str2, sl_err *err);
 uint64_t sl_compute_hash(const void *data, size_t len);
 uint64_t sl_compute_hash_cstr(const char *str);
 uint64_t sl_hash(sl_str str, sl_err *err);
 
-#endif // SL_STRING_H
\ No newline at end of file
+sl_arena *sl_arena_new(size_t block_size, sl_err *err);
+void *sl_arena_alloc(sl_arena *arena, size_t size, size_t align, sl_err *err);
+void sl_arena_reset(sl_arena *arena);
+void sl_arena_free(sl_arena **arena, sl_err *err);
+sl_str sl_from_cstr_in(sl_arena *arena, const char *init, sl_err *err);
+sl_str sl_from_bytes_in(sl_arena *arena, const void *bytes, size_t len, sl_err *err);
+
+sl_rope *sl_rope_new(sl_err *err);
+sl_rope *sl_rope_from_str(sl_str str, sl_err *err);
+void sl_rope_free(sl_rope **rope, sl_err *err);
+size_t sl_rope_len(const sl_rope *rope, sl_err *err);
+uint64_t sl_rope_hash(const sl_rope *rope, sl_err *err);
+char sl_rope_at(const sl_rope *rope, size_t pos, sl_err *err);
+void sl_rope_insert(sl_rope *rope, size_t pos, const void *bytes, size_t len, sl_err *err);
+void sl_rope_delete(sl_rope *rope, size_t pos, size_t len, sl_err *err);
+void sl_rope_concat(sl_rope *dst, sl_rope *src, sl_err *err);
+sl_str sl_rope_to_str(const sl_rope *rope, sl_err *err);
+uint64_t sl_compute_poly_hash(const void *data, size_t len);
+
+sl_gapbuf *sl_gapbuf_new(size_t cap, sl_err *err);
+sl_gapbuf *sl_gapbuf_from_str(sl_str str, sl_err *err);
+void sl_gapbuf_free(sl_gapbuf **gb, sl_err *err);
+size_t sl_gapbuf_len(const sl_gapbuf *gb, sl_err *err);
+size_t sl_gapbuf_cursor(const sl_gapbuf *gb, sl_err *err);
+void sl_gapbuf_move(sl_gapbuf *gb, size_t pos, sl_err *err);
+void sl_gapbuf_insert(sl_gapbuf *gb, const void *bytes, size_t len, sl_err *err);
+void sl_gapbuf_delete(sl_gapbuf *gb, size_t len, sl_err *err);
+void sl_gapbuf_backspace(sl_gapbuf *gb, size_t len, sl_err *err);
+const char *sl_gapbuf_view(sl_gapbuf *gb, size_t *out_len, sl_err *err);
+sl_str sl_gapbuf_to_str(sl_gapbuf *gb, sl_err *err);
+
+sl_str sl_hex_encode(sl_str str, sl_err *err);
+sl_str sl_hex_decode(sl_str str, sl_err *err);
+sl_str sl_base64_encode(sl_str str, sl_base64_alphabet alphabet, sl_err *err);
+sl_str sl_base64_decode(sl_str str, sl_base64_alphabet alphabet, sl_err *err);
+
+sl_str sl_json_escape(sl_str str, sl_err *err);
+sl_str sl_append_json_escaped(sl_str dst, sl_str src, sl_err *err);
+sl_str sl_json_unescape(sl_str str, sl_err *err);
+
+sl_str sl_url_encode(sl_str str, sl_err *err);
+sl_str sl_url_decode(sl_str str, sl_err *err);
+sl_str sl_html_escape(sl_str str, sl_err *err);
+
+uint32_t sl_compute_crc32c(const void *data, size_t len);
+uint32_t sl_crc32c(sl_str str, sl_err *err);
+sl_str sl_from_bytes_verified(const void *bytes, size_t len, uint32_t expected_crc, sl_err *err);
+
+#ifdef SL_HAVE_POSIX
+void sl_pack_write(int fd, const sl_str *strs, size_t n, sl_err *err);
+sl_pack *sl_pack_open(const char *path, sl_err *err);
+void sl_pack_close(sl_pack **pack, sl_err *err);
+size_t sl_pack_count(const sl_pack *pack, sl_err *err);
+sl_str sl_pack_get(const sl_pack *pack, size_t i, sl_err *err);
+
+sl_shm_pool *sl_shm_pool_new(size_t size, sl_err *err);
+sl_shm_pool *sl_shm_pool_attach(int fd, sl_err *err);
+void sl_shm_pool_refresh(sl_shm_pool *pool, sl_err *err);
+void sl_shm_pool_free(sl_shm_pool **pool, sl_err *err);
+int sl_shm_pool_fd(const sl_shm_pool *pool, sl_err *err);
+sl_str sl_shm_pool_add(sl_shm_pool *pool, const void *bytes, size_t len, sl_err *err);
+sl_str sl_shm_pool_find(const sl_shm_pool *pool, const void *bytes, size_t len, sl_err *err);
+size_t sl_shm_pool_count(const sl_shm_pool *pool, sl_err *err);
+#endif
+
+sl_intern *sl_intern_new(sl_err *err);
+void sl_intern_free(sl_intern **t, sl_err *err);
+sl_str sl_intern_bytes(sl_intern *t, const void *bytes, size_t len, sl_err *err);
+sl_str sl_intern_str(sl_intern *t, sl_str str, sl_err *err);
+sl_str sl_intern_find(const sl_intern *t, const void *bytes, size_t len, sl_err *err);
+size_t sl_intern_count(const sl_intern *t, sl_err *err);
+#ifdef SL_HAVE_POSIX
+void sl_intern_snapshot(const sl_intern *t, const char *path, sl_err *err);
+sl_intern *sl_intern_restore(const char *path, sl_err *err);
+#endif
+
+sl_frame_decoder *sl_frame_decoder_new(sl_frame_format fmt, size_t max_frame, sl_err *err);
+void sl_frame_decoder_free(sl_frame_decoder **dec, sl_err *err);
+void sl_frame_feed(sl_frame_decoder *dec, const void *data, size_t len, sl_err *err);
+sl_str sl_frame_next(sl_frame_decoder *dec, sl_err *err);
+#ifdef SL_HAVE_POSIX
+size_t sl_frame_encode_many(sl_frame_format fmt, const sl_str *strs, size_t n, struct iovec *iov, char *scratch,
+                            sl_err *err);
+void sl_frame_writev(int fd, sl_frame_format fmt, const sl_str *strs, size_t n, sl_err *err);
+#endif
+
+sl_str sl_append_varint_u64(sl_str str, uint64_t v, sl_err *err);
+sl_str sl_append_zigzag_i64(sl_str str, int64_t v, sl_err *err);
+sl_str sl_append_varints(sl_str str, const uint64_t *vals, size_t n, sl_err *err);
+uint64_t sl_read_varint_u64(sl_str str, size_t *pos, sl_err *err);
+int64_t sl_read_zigzag_i64(sl_str str, size_t *pos, sl_err *err);
+size_t sl_read_varints(sl_str str, size_t *pos, uint64_t *out, size_t n, sl_err *err);
+
+sl_fcset *sl_fcset_build(const sl_str *sorted, size_t n, size_t block_size, sl_err *err);
+void sl_fcset_free(sl_fcset **set, sl_err *err);
+size_t sl_fcset_count(const sl_fcset *set, sl_err *err);
+size_t sl_fcset_memory(const sl_fcset *set, sl_err *err);
+bool sl_fcset_contains(const sl_fcset *set, const void *bytes, size_t len, sl_err *err);
+size_t sl_fcset_lower_bound(const sl_fcset *set, const void *bytes, size_t len, sl_err *err);
+sl_fcset_iter *sl_fcset_iter_new(const sl_fcset *set, size_t start, sl_err *err);
+bool sl_fcset_iter_next(sl_fcset_iter *it, sl_view *out, sl_err *err);
+void sl_fcset_iter_free(sl_fcset_iter **it, sl_err *err);
+
+sl_str sl_compress(sl_str str, sl_err *err);
+sl_str sl_decompress(sl_str str, sl_err *err);
+bool sl_is_compressed(sl_str str, sl_err *err);
+sl_symtab *sl_symtab_train(const sl_str *sample, size_t n, sl_err *err);
+void sl_symtab_free(sl_symtab **tab, sl_err *err);
+sl_str sl_compress_with(const sl_symtab *tab, sl_str str, sl_err *err);
+sl_str sl_decompress_with(const sl_symtab *tab, sl_str str, sl_err *err);
+
+sl_dict_column *sl_dict_column_new(sl_err *err);
+void sl_dict_column_free(sl_dict_column **col, sl_err *err);
+uint32_t sl_dict_column_append(sl_dict_column *col, sl_str value, sl_err *err);
+size_t sl_dict_column_append_many(sl_dict_column *col, const sl_str *values, size_t n, sl_err *err);
+size_t sl_dict_column_rows(const sl_dict_column *col, sl_err *err);
+size_t sl_dict_column_cardinality(const sl_dict_column *col, sl_err *err);
+size_t sl_dict_column_memory(const sl_dict_column *col, sl_err *err);
+const uint32_t *sl_dict_column_codes(const sl_dict_column *col, size_t *n, sl_err *err);
+sl_view sl_dict_column_value(const sl_dict_column *col, uint32_t code, sl_err *err);
+sl_view sl_dict_column_get(const sl_dict_column *col, size_t row, sl_err *err);
+uint32_t sl_dict_column_code(const sl_dict_column *col, const void *bytes, size_t len, sl_err *err);
+size_t sl_dict_column_filter_eq(const sl_dict_column *col, const void *bytes, size_t len, size_t *out,
+                                sl_err *err);
+
+sl_radix *sl_radix_new(sl_err *err);
+void sl_radix_free(sl_radix **t, sl_err *err);
+void sl_radix_insert(sl_radix *t, const void *key, size_t len, void *value, sl_err *err);
+void sl_radix_insert_str(sl_radix *t, sl_str key, void *value, sl_err *err);
+bool sl_radix_get(const sl_radix *t, const void *key, size_t len, void **value, sl_err *err);
+bool sl_radix_get_str(const sl_radix *t, sl_str key, void **value, sl_err *err);
+bool sl_radix_longest_prefix(const sl_radix *t, const void *key, size_t len, size_t *match_len, void **value,
+                             sl_err *err);
+bool sl_radix_longest_prefix_str(const sl_radix *t, sl_str key, size_t *match_len, void **value, sl_err *err);
+size_t sl_radix_each_prefix(const sl_radix *t, const void *prefix, size_t len, sl_radix_visit fn, void *ctx,
+                            sl_err *err);
+size_t sl_radix_count(const sl_radix *t, sl_err *err);
+
+sl_btree *sl_btree_new(sl_err *err);
+sl_btree *sl_btree_build(const sl_str *sorted, void *const *values, size_t n, sl_err *err);
+void sl_btree_free(sl_btree **t, sl_err *err);
+void sl_btree_insert(sl_btree *t, sl_str key, void *value, sl_err *err);
+bool sl_btree_get(const sl_btree *t, const void *key, size_t len, void **value, sl_err *err);
+bool sl_btree_get_str(const sl_btree *t, sl_str key, void **value, sl_err *err);
+size_t sl_btree_count(const sl_btree *t, sl_err *err);
+size_t sl_btree_memory(const sl_btree *t, sl_err *err);
+sl_btree_iter *sl_btree_range(const sl_btree *t, const void *lo, size_t lo_len, const void *hi, size_t hi_len,
+                              sl_err *err);
+bool sl_btree_iter_next(sl_btree_iter *it, sl_view *key, void **value, sl_err *err);
+void sl_btree_iter_free(sl_btree_iter **it, sl_err *err);
+
+sl_lru *sl_lru_new(size_t max_entries, size_t max_bytes, sl_lru_evict on_evict, void *ctx, sl_err *err);
+void sl_lru_free(sl_lru **lru, sl_err *err);
+void sl_lru_put(sl_lru *lru, sl_str key, sl_str value, sl_err *err);
+sl_str sl_lru_get(sl_lru *lru, const void *key, size_t len, sl_err *err);
+sl_str sl_lru_get_str(sl_lru *lru, sl_str key, sl_err *err);
+bool sl_lru_remove(sl_lru *lru, const void *key, size_t len, sl_err *err);
+size_t sl_lru_count(const sl_lru *lru, sl_err *err);
+size_t sl_lru_bytes(const sl_lru *lru, sl_err *err);
+#ifdef SL_HAVE_POSIX
+sl_lru_shared *sl_lru_shared_new(size_t nshards, size_t max_entries, size_t max_bytes, sl_lru_evict on_evict,
+                                 void *ctx, sl_err *err);
+void sl_lru_shared_free(sl_lru_shared **c, sl_err *err);
+void sl_lru_shared_put(sl_lru_shared *c, sl_str key, sl_str value, sl_err *err);
+sl_str sl_lru_shared_get(sl_lru_shared *c, const void *key, size_t len, sl_err *err);
+sl_str sl_lru_shared_get_str(sl_lru_shared *c, sl_str key, sl_err *err);
+bool sl_lru_shared_remove(sl_lru_shared *c, const void *key, size_t len, sl_err *err);
+size_t sl_lru_shared_count(sl_lru_shared *c, sl_err *err);
+#endif
+
+sl_bloom *sl_bloom_new(size_t expected, double fp_rate, sl_err *err);
+void sl_bloom_free(sl_bloom **b, sl_err *err);
+void sl_bloom_add(sl_bloom *b, sl_str str, sl_err *err);
+void sl_bloom_add_hash(sl_bloom *b, uint64_t hash, sl_err *err);
+bool sl_bloom_contains(const sl_bloom *b, sl_str str, sl_err *err);
+bool sl_bloom_contains_hash(const sl_bloom *b, uint64_t hash, sl_err *err);
+size_t sl_bloom_memory(const sl_bloom *b, sl_err *err);
+
+sl_cuckoo *sl_cuckoo_new(size_t capacity, sl_err *err);
+void sl_cuckoo_free(sl_cuckoo **c, sl_err *err);
+void sl_cuckoo_add(sl_cuckoo *c, sl_str str, sl_err *err);
+void sl_cuckoo_add_hash(sl_cuckoo *c, uint64_t hash, sl_err *err);
+bool sl_cuckoo_contains(const sl_cuckoo *c, sl_str str, sl_err *err);
+bool sl_cuckoo_contains_hash(const sl_cuckoo *c, uint64_t hash, sl_err *err);
+bool sl_cuckoo_remove(sl_cuckoo *c, sl_str str, sl_err *err);
+bool sl_cuckoo_remove_hash(sl_cuckoo *c, uint64_t hash, sl_err *err);
+size_t sl_cuckoo_count(const sl_cuckoo *c, sl_err *err);
+size_t sl_cuckoo_memory(const sl_cuckoo *c, sl_err *err);
+
+sl_hll *sl_hll_new(unsigned precision, sl_err *err);
+void sl_hll_free(sl_hll **h, sl_err *err);
+void sl_hll_add(sl_hll *h, sl_str str, sl_err *err);
+void sl_hll_add_hash(sl_hll *h, uint64_t hash, sl_err *err);
+uint64_t sl_hll_count(sl_hll *h, sl_err *err);
+void sl_hll_merge(sl_hll *dst, sl_hll *src, sl_err *err);
+size_t sl_hll_memory(const sl_hll *h, sl_err *err);
+
+sl_cms *sl_cms_new(size_t width, size_t depth, size_t top_k, sl_err *err);
+void sl_cms_free(sl_cms **c, sl_err *err);
+uint64_t sl_cms_add(sl_cms *c, sl_str str, uint64_t n, sl_err *err);
+uint64_t sl_cms_add_hash(sl_cms *c, uint64_t hash, uint64_t n, sl_err *err);
+uint64_t sl_cms_estimate(const sl_cms *c, sl_str str, sl_err *err);
+uint64_t sl_cms_estimate_hash(const sl_cms *c, uint64_t hash, sl_err *err);
+uint64_t sl_cms_total(const sl_cms *c, sl_err *err);
+size_t sl_cms_top(const sl_cms *c, sl_cms_item *out, size_t max, sl_err *err);
+void sl_cms_merge(sl_cms *dst, const sl_cms *src, sl_err *err);
+size_t sl_cms_memory(const sl_cms *c, sl_err *err);
+
+sl_rolling_hash *sl_rolling_hash_new(sl_str str, size_t k, sl_err *err);
+bool sl_rolling_hash_next(sl_rolling_hash *rh, size_t *pos, uint64_t *hash, sl_err *err);
+void sl_rolling_hash_free(sl_rolling_hash **rh, sl_err *err);
+size_t sl_ngrams(sl_str str, size_t k, sl_ngram_visit fn, void *ctx, sl_err *err);
+size_t sl_find_any(sl_str haystack, size_t start, const sl_str *needles, size_t count, size_t *which, sl_err *err);
+
+void sl_minhash(sl_str str, size_t shingle_k, size_t num_perm, uint32_t *sig, sl_err *err);
+double sl_minhash_similarity(const uint32_t *a, const uint32_t *b, size_t num_perm, sl_err *err);
+uint64_t sl_simhash(sl_str str, sl_err *err);
+int sl_simhash_distance(uint64_t a, uint64_t b);
+
+sl_lsh *sl_lsh_new(size_t num_perm, size_t bands, sl_err *err);
+void sl_lsh_free(sl_lsh **lsh, sl_err *err);
+void sl_lsh_add(sl_lsh *lsh, const uint32_t *sig, uint64_t id, sl_err *err);
+size_t sl_lsh_query(const sl_lsh *lsh, const uint32_t *sig, uint64_t *out, size_t max, sl_err *err);
+size_t sl_lsh_count(const sl_lsh *lsh, sl_err *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SL_STRING_H
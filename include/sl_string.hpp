@@ -0,0 +1,183 @@
+#ifndef SL_STRING_HPP
+#define SL_STRING_HPP
+
+#include "sl_string.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <string_view>
+#include <utility>
+
+namespace sl {
+
+/**
+ * `std::pmr::memory_resource` backed by an `sl_arena`
+ *
+ * `std::pmr` containers and `sl_str` strings created with
+ * `sl_from_cstr_in(res.get(), ...)` draw from the same arena, so a whole
+ * request can be released with one `reset()`.
+ * Like `std::pmr::monotonic_buffer_resource`, deallocation is a no-op.
+ */
+class arena_resource : public std::pmr::memory_resource {
+  public:
+    explicit arena_resource(std::size_t block_size = 0) : arena_(sl_arena_new(block_size, nullptr)) {
+        if (!arena_)
+            throw std::bad_alloc();
+    }
+
+    ~arena_resource() override { sl_arena_free(&arena_, nullptr); }
+
+    arena_resource(const arena_resource &) = delete;
+    arena_resource &operator=(const arena_resource &) = delete;
+
+    /** Release every allocation (containers and strings) made from this resource */
+    void reset() noexcept { sl_arena_reset(arena_); }
+
+    /** The underlying arena, to be passed to `sl_from_cstr_in`/`sl_from_bytes_in` */
+    sl_arena *get() const noexcept { return arena_; }
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        void *ptr = sl_arena_alloc(arena_, bytes, alignment, nullptr);
+        if (!ptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+        return this == &other;
+    }
+
+    sl_arena *arena_;
+};
+
+/**
+ * Owning, move-only handle to an `sl_str`
+ *
+ * The string is freed with `sl_free` when the handle is destroyed.
+ * A default constructed handle is empty (it holds NULL).
+ */
+class string {
+  public:
+    string() noexcept = default;
+
+    explicit string(const char *init) : str_(sl_from_cstr(init, nullptr)) {
+        if (!str_)
+            throw std::bad_alloc();
+    }
+
+    explicit string(std::string_view bytes) : str_(sl_from_bytes(bytes.data(), bytes.size(), nullptr)) {
+        if (!str_)
+            throw std::bad_alloc();
+    }
+
+    /** Take ownership of a string created by the C API */
+    static string adopt(sl_str str) noexcept {
+        string s;
+        s.str_ = str;
+        return s;
+    }
+
+    string(string &&other) noexcept : str_(std::exchange(other.str_, nullptr)) {}
+
+    string &operator=(string &&other) noexcept {
+        if (this != &other) {
+            sl_free(&str_, nullptr);
+            str_ = std::exchange(other.str_, nullptr);
+        }
+        return *this;
+    }
+
+    string(const string &) = delete;
+    string &operator=(const string &) = delete;
+
+    ~string() { sl_free(&str_, nullptr); }
+
+    sl_str get() const noexcept { return str_; }
+
+    /** Give up ownership, the caller must `sl_free` the result */
+    sl_str release() noexcept { return std::exchange(str_, nullptr); }
+
+    const char *data() const noexcept { return str_; }
+    std::size_t size() const noexcept { return str_ ? sl_len(str_, nullptr) : 0; }
+
+    /** The cached FNV-1a hash (an empty handle hashes like an empty view) */
+    std::uint64_t hash() const noexcept { return str_ ? sl_hash(str_, nullptr) : sl_compute_hash("", 0); }
+
+    operator std::string_view() const noexcept { return {data(), size()}; }
+
+  private:
+    sl_str str_ = nullptr;
+};
+
+/**
+ * Transparent hash functor for unordered containers keyed by `sl::string`
+ * (or by raw `sl_str`)
+ *
+ * Library strings return their cached hash, views are hashed with the same
+ * FNV-1a as `sl_compute_hash`, so C++20 heterogeneous lookup with a
+ * `std::string_view` never allocates a temporary `sl_str`. A null `sl_str`
+ * hashes like the empty string, since `sl::equal` matches it with `""`.
+ *
+ * @note A `char *` is treated as an `sl_str`. Plain C strings must be passed
+ *       as `const char *` or `std::string_view`.
+ */
+struct hasher {
+    using is_transparent = void;
+
+    std::size_t operator()(const string &s) const noexcept { return static_cast<std::size_t>(s.hash()); }
+
+    std::size_t operator()(sl_str s) const noexcept {
+        return static_cast<std::size_t>(s ? sl_hash(s, nullptr) : sl_compute_hash("", 0));
+    }
+
+    std::size_t operator()(std::string_view sv) const noexcept {
+        return static_cast<std::size_t>(sl_compute_hash(sv.data(), sv.size()));
+    }
+};
+
+/**
+ * Transparent equality functor matching `sl::hasher`
+ *
+ * Two library strings are compared with `sl_eq` (hash and length first),
+ * a library string and a view are compared by length and then `memcmp`.
+ * A null `sl_str` equals every empty string.
+ */
+struct equal {
+    using is_transparent = void;
+
+    bool operator()(sl_str a, sl_str b) const noexcept {
+        if (!a || !b) // null is the empty string, as in `sl::hasher`
+            return (a ? sl_len(a, nullptr) : 0) == (b ? sl_len(b, nullptr) : 0);
+        return sl_eq(a, b, nullptr);
+    }
+
+    bool operator()(const string &a, const string &b) const noexcept { return (*this)(a.get(), b.get()); }
+
+    bool operator()(std::string_view a, std::string_view b) const noexcept {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size()) == 0);
+    }
+
+    bool operator()(const string &a, std::string_view b) const noexcept {
+        return (*this)(static_cast<std::string_view>(a), b);
+    }
+
+    bool operator()(std::string_view a, const string &b) const noexcept {
+        return (*this)(a, static_cast<std::string_view>(b));
+    }
+
+    bool operator()(sl_str a, std::string_view b) const noexcept {
+        return (*this)(std::string_view(a, a ? sl_len(a, nullptr) : 0), b);
+    }
+
+    bool operator()(std::string_view a, sl_str b) const noexcept { return (*this)(b, a); }
+};
+
+} // namespace sl
+
+#endif // SL_STRING_HPP
@@ -1,4 +1,11 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // memfd_create
+#elif !defined(_POSIX_C_SOURCE) && !defined(_GNU_SOURCE)
+#define _POSIX_C_SOURCE 200809L // fstat, mmap, shm_open
+#endif
+
 #include "sl_string.h"
+#include <errno.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -6,8 +13,24 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#ifdef SL_HAVE_POSIX
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 // this constant is used to verify if the string is valid
 #define SL_MAGIC 0x534C4942
+// header blocks owned by a gap buffer (not a valid `sl_str`)
+#define SL_GAP_MAGIC 0x534C4750
 
 #define FNV_PRIME 1099511628211ULL
 #define FNV_OFFSET 14695981039346656037ULL
@@ -21,12 +44,52 @@
  */
 typedef struct sl_hdr {
     uint32_t magic; /**< If set to SL_MAGIC, the string is valid */
+    uint32_t flags; /**< Bit set of SL_HDR_* flags */
     uint64_t hash;  /**< String hash number (FNV-1a) */
     size_t len;     /**< Length of the string (excluding null term) */
     size_t cap;     /**< Capacity of data buffer (including null term) */
     char data[];    /**< Flexible array member (the data buffer) */
 } sl_hdr;
 
+// header flags
+#define SL_HDR_ARENA 0x1u /**< The block is owned by an `sl_arena` */
+#define SL_HDR_CRC 0x2u   /**< The CRC32C is cached at the end of the buffer (cleared on every edit) */
+#define SL_HDR_STATIC 0x4u /**< Read-only string inside a mapping (never freed or modified) */
+#define SL_HDR_COMPRESSED 0x8u /**< Content is an `sl_compress` frame (read-only) */
+
+/**
+ * Arena block
+ *
+ * Arena memory is a linked list of blocks, newest first. Allocations
+ * bump `used` inside the head block until it is full.
+ */
+typedef struct sl_arena_block {
+    struct sl_arena_block *next;
+    size_t size;         /**< Usable bytes in `data` */
+    size_t used;         /**< Bytes already handed out */
+    max_align_t data[];  /**< Block memory (max_align_t keeps it aligned) */
+} sl_arena_block;
+
+/**
+ * Monotonic arena
+ *
+ * Individual allocations are never freed; `sl_arena_reset` releases
+ * everything at once.
+ */
+struct sl_arena {
+    sl_arena_block *head; /**< Current block (NULL before the first allocation) */
+    size_t block_size;    /**< Minimum size of a new block */
+};
+
+#define SL_ARENA_DEFAULT_BLOCK 4096
+
+/**
+ * Arena strings store the owning arena in a word just before the header,
+ * so the header keeps its size and `sl_append_cstr` can grow in the same arena.
+ */
+#define SL_ARENA_PREFIX \
+    ((sizeof(sl_arena *) + _Alignof(sl_hdr) - 1) & ~(_Alignof(sl_hdr) - 1))
+
 /* ===== INTERNAL FUNCTIONS ===== */
 
 /**
@@ -81,10 +144,33 @@ static inline sl_err sl__validate(sl_str str, sl_hdr **out_hdr) {
 }
 
 /**
- * Get the hash number from a series of bytes (fnv-1a)
+ * Validate a string that is about to be modified in place
+ *
+ * Like `sl__validate`, but read-only strings (for example the ones of an
+ * `sl_pack`, or compressed strings) are rejected with `SL_ERR_READONLY`.
  */
-static uint64_t sl__compute_hash(const void *bytes, size_t len) {
-    uint64_t hash = FNV_OFFSET;
+static inline sl_err sl__validate_mut(sl_str str, sl_hdr **out_hdr) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK)
+        return e;
+
+    if (hdr->flags & (SL_HDR_STATIC | SL_HDR_COMPRESSED))
+        return SL_ERR_READONLY;
+
+    if (out_hdr)
+        *out_hdr = hdr;
+
+    return SL_OK;
+}
+
+/**
+ * Continue an FNV-1a hash over more bytes
+ *
+ * FNV-1a is a streaming hash, so the hash of `a + b` is the hash of `a`
+ * continued over `b`: appends only need to hash the new bytes.
+ */
+static uint64_t sl__hash_continue(uint64_t hash, const void *bytes, size_t len) {
     const unsigned char *ptr = (const unsigned char *)bytes;
 
     for (size_t i = 0; i < len; i++) {
@@ -95,19 +181,163 @@ static uint64_t sl__compute_hash(const void *bytes, size_t len) {
     return hash;
 }
 
+/**
+ * Get the hash number from a series of bytes (fnv-1a)
+ */
+static uint64_t sl__compute_hash(const void *bytes, size_t len) {
+    return sl__hash_continue(FNV_OFFSET, bytes, len);
+}
+
+/**
+ * Allocate `size` bytes aligned to `align` from the head block of an arena
+ *
+ * @return The pointer, or NULL if the head block is missing or full
+ */
+static void *sl__arena_bump(sl_arena *arena, size_t size, size_t align) {
+    sl_arena_block *blk = arena->head;
+    if (!blk)
+        return NULL;
+
+    uintptr_t base = (uintptr_t)blk->data;
+    uintptr_t start = (base + blk->used + align - 1) & ~(uintptr_t)(align - 1);
+    size_t off = (size_t)(start - base);
+
+    if (off > blk->size || size > blk->size - off)
+        return NULL;
+
+    blk->used = off + size;
+    return (char *)blk->data + off;
+}
+
+/**
+ * Try to grow the most recent arena allocation in place
+ *
+ * @return `true` if `ptr` was the last allocation of the head block
+ *         and there was room to extend it to `new_size`
+ */
+static bool sl__arena_extend(sl_arena *arena, void *ptr, size_t old_size, size_t new_size) {
+    sl_arena_block *blk = arena->head;
+    if (!blk || (char *)ptr + old_size != (char *)blk->data + blk->used)
+        return false;
+
+    size_t start = blk->used - old_size;
+    if (new_size > blk->size - start)
+        return false;
+
+    blk->used = start + new_size;
+    return true;
+}
+
+/**
+ * Allocate the memory block of a string (header + `cap` bytes)
+ *
+ * If `arena` is NULL the block comes from malloc, otherwise from the arena
+ * (with the owner stored in front of the header).
+ */
+static sl_hdr *sl__hdr_alloc(sl_arena *arena, size_t cap, sl_err *err) {
+    if (cap > SIZE_MAX - offsetof(sl_hdr, data) - SL_ARENA_PREFIX) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    if (!arena) {
+        sl_hdr *hdr = malloc(offsetof(sl_hdr, data) + cap);
+        if (!hdr) {
+            sl__set_err(err, SL_ERR_ALLOC);
+            return NULL;
+        }
+        hdr->flags = 0;
+        return hdr;
+    }
+
+    char *block = sl_arena_alloc(arena, SL_ARENA_PREFIX + offsetof(sl_hdr, data) + cap,
+                                 _Alignof(sl_hdr), err);
+    if (!block)
+        return NULL;
+
+    memcpy(block, &arena, sizeof(arena));
+    sl_hdr *hdr = (sl_hdr *)(block + SL_ARENA_PREFIX);
+    hdr->flags = SL_HDR_ARENA;
+    return hdr;
+}
+
+/**
+ * Get the arena that owns an `SL_HDR_ARENA` string
+ */
+static inline sl_arena *sl__hdr_arena(const sl_hdr *hdr) {
+    sl_arena *arena;
+    memcpy(&arena, (const char *)hdr - SL_ARENA_PREFIX, sizeof(arena));
+    return arena;
+}
+
+/**
+ * Resize the memory block of a string so it can hold `new_cap` bytes
+ *
+ * Only the first `hdr->len` bytes (plus the header) are preserved.
+ * Arena strings are extended in place when they are the last allocation,
+ * otherwise they are copied to a new block of the same arena.
+ *
+ * @return The new header, or NULL on failure (the original block is untouched)
+ */
+static sl_hdr *sl__hdr_realloc(sl_hdr *hdr, size_t new_cap, sl_err *err) {
+    if (new_cap > SIZE_MAX - offsetof(sl_hdr, data) - SL_ARENA_PREFIX) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    if (!(hdr->flags & SL_HDR_ARENA)) {
+        sl_hdr *new_hdr = realloc(hdr, offsetof(sl_hdr, data) + new_cap);
+        if (!new_hdr) {
+            sl__set_err(err, SL_ERR_ALLOC);
+            return NULL;
+        }
+        new_hdr->flags &= ~SL_HDR_CRC; // the cached CRC sits at the end of the old block
+        return new_hdr;
+    }
+
+    sl_arena *arena = sl__hdr_arena(hdr);
+    char *block = (char *)hdr - SL_ARENA_PREFIX;
+    size_t old_size = SL_ARENA_PREFIX + offsetof(sl_hdr, data) + hdr->cap;
+    size_t new_size = SL_ARENA_PREFIX + offsetof(sl_hdr, data) + new_cap;
+
+    if (sl__arena_extend(arena, block, old_size, new_size)) {
+        hdr->flags &= ~SL_HDR_CRC;
+        return hdr;
+    }
+
+    sl_hdr *new_hdr = sl__hdr_alloc(arena, new_cap, err);
+    if (!new_hdr)
+        return NULL;
+
+    memcpy(new_hdr, hdr, offsetof(sl_hdr, data) + hdr->len);
+    new_hdr->flags &= ~SL_HDR_CRC;
+    hdr->magic = 0; // the old copy stays in the arena until reset
+    return new_hdr;
+}
+
+/**
+ * Release the memory block of a string
+ *
+ * Arena blocks are only reclaimed by `sl_arena_reset`.
+ */
+static void sl__hdr_release(sl_hdr *hdr) {
+    hdr->magic = 0; // invalidate the string
+    if (!(hdr->flags & SL_HDR_ARENA))
+        free(hdr);
+}
+
 /**
  * Create a string from a generic buffer (internal function)
  *
  * It returns the pointer to the data field
  */
-static sl_str sl__from_buffer(const void *data, size_t len, size_t extra_cap, sl_err *err) {
+static sl_str sl__from_buffer(sl_arena *arena, const void *data, size_t len, size_t extra_cap,
+                              sl_err *err) {
     size_t cap = len + extra_cap;
 
-    sl_hdr *hdr = malloc(offsetof(sl_hdr, data) + cap);
-    if (!hdr) {
-        sl__set_err(err, SL_ERR_ALLOC);
+    sl_hdr *hdr = sl__hdr_alloc(arena, cap, err);
+    if (!hdr)
         return NULL;
-    }
 
     hdr->magic = SL_MAGIC;
     hdr->len = len;
@@ -150,14 +380,15 @@ sl_str sl_from_cstr(const char *init, sl_err *err) {
         return NULL;
     }
 
-    return sl__from_buffer(init, strlen(init), 1, err);
+    return sl__from_buffer(NULL, init, strlen(init), 1, err);
 }
 
 /**
  * Create a new dynamic string (`sl_str`) from a generic buffer
  *
  * This function is useful when you want to store binary data which
- * can contain '\0' bytes.
+ * can contain '\0' bytes. A null terminator is still appended after
+ * the `len` bytes.
  *
  * @param bytes The pointer to the buffer
  * @param len The length of the buffer to store
@@ -169,7 +400,7 @@ sl_str sl_from_bytes(const void *bytes, size_t len, sl_err *err) {
         return NULL;
     }
 
-    return sl__from_buffer(bytes, len, 0, err);
+    return sl__from_buffer(NULL, bytes, len, 1, err);
 }
 
 /**
@@ -198,8 +429,9 @@ void sl_free(sl_str *str, sl_err *err) {
         return;
     }
 
-    hdr->magic = 0; // invalidate the string
-    free(hdr);
+    // read-only strings belong to their mapping
+    if (!(hdr->flags & SL_HDR_STATIC))
+        sl__hdr_release(hdr);
     *str = NULL; // prevent use after free
 
     sl__set_err(err, SL_OK);
@@ -268,7 +500,7 @@ sl_str sl_append_cstr(sl_str str, const char *init, sl_err *err) {
     }
 
     sl_hdr *hdr;
-    sl_err e = sl__validate(str, &hdr);
+    sl_err e = sl__validate_mut(str, &hdr);
 
     if (e != SL_OK) {
         sl__set_err(err, e);
@@ -282,120 +514,10581 @@ sl_str sl_append_cstr(sl_str str, const char *init, sl_err *err) {
 
     // if new capacity exceeds the current capacity, reallocate the memory
     if (new_cap > hdr->cap) {
-        sl_hdr *new_hdr = realloc(sl__get_hdr(str), offsetof(sl_hdr, data) + new_cap);
-        if (!new_hdr) {
-            sl__set_err(err, SL_ERR_ALLOC);
+        sl_hdr *new_hdr = sl__hdr_realloc(hdr, new_cap, err);
+        if (!new_hdr)
             return str;
-        }
         hdr = new_hdr;
     }
 
     // append the new string
     memcpy(hdr->data + hdr->len, init, init_len + 1);
 
-    // set new field values
+    // set new field values (only the appended bytes need hashing)
+    hdr->hash = sl__hash_continue(hdr->hash, hdr->data + hdr->len, init_len);
+    hdr->flags &= ~SL_HDR_CRC;
     hdr->len = new_len;
     hdr->cap = new_cap;
-    hdr->hash = sl__compute_hash(hdr->data, new_len);
 
     sl__set_err(err, SL_OK);
     return hdr->data;
 }
 
 /**
- * Compute FNV-1a hash of a generic buffer
+ * Find `needle` in `hay` starting from `start` (internal function)
  *
- * @param data Pointer to the data buffer
- * @param len Length of the buffer in bytes
+ * memchr jumps to the candidates for the first byte, memcmp checks the rest.
  *
- * @return 64-bit FNV-1a hash
+ * @return The offset of the first match, or SIZE_MAX if there is none
  */
-uint64_t sl_compute_hash(const void *data, size_t len) {
-    return sl__compute_hash(data, len);
+static size_t sl__find(const char *hay, size_t hay_len, const char *needle, size_t needle_len,
+                       size_t start) {
+    if (needle_len == 0 || hay_len < needle_len || start > hay_len - needle_len)
+        return SIZE_MAX;
+
+    const char *p = hay + start;
+    const char *last = hay + hay_len - needle_len;
+
+    while (p <= last) {
+        p = memchr(p, needle[0], (size_t)(last - p) + 1);
+        if (!p)
+            return SIZE_MAX;
+        if (memcmp(p + 1, needle + 1, needle_len - 1) == 0)
+            return (size_t)(p - hay);
+        p++;
+    }
+
+    return SIZE_MAX;
 }
 
 /**
- * Compute FNV-1a hash of a C string
+ * Replace `del_len` bytes at `pos` with `ins_len` bytes (internal function)
  *
- * @param str Pointer to the null-terminated C string
- * @return 64-bit FNV-1a hash
+ * The tail is moved with a single memmove and the block is reallocated
+ * (exactly) only if the new content does not fit. The hash is recomputed once.
+ * `bytes` may point inside the string itself.
+ *
+ * @return The (possibly reallocated) header, or NULL on failure (string unchanged)
  */
-uint64_t sl_compute_hash_cstr(const char *str) {
-    if (!str)
-        return 0;
-    return sl__compute_hash(str, strlen(str));
+static sl_hdr *sl__splice(sl_hdr *hdr, size_t pos, size_t del_len, const void *bytes, size_t ins_len,
+                          sl_err *err) {
+    size_t tail = hdr->len - pos - del_len;
+
+    if (ins_len > SIZE_MAX - 1 - (hdr->len - del_len)) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    size_t new_len = hdr->len - del_len + ins_len;
+
+    // the inserted bytes could be moved by memmove/realloc: keep a copy
+    void *tmp = NULL;
+    if (ins_len > 0 && (const char *)bytes < hdr->data + hdr->cap &&
+        (const char *)bytes + ins_len > hdr->data) {
+        tmp = malloc(ins_len);
+        if (!tmp) {
+            sl__set_err(err, SL_ERR_ALLOC);
+            return NULL;
+        }
+        memcpy(tmp, bytes, ins_len);
+        bytes = tmp;
+    }
+
+    // keep room for the null terminator, like sl_append_cstr
+    if (new_len + 1 > hdr->cap) {
+        sl_hdr *new_hdr = sl__hdr_realloc(hdr, new_len + 1, err);
+        if (!new_hdr) {
+            free(tmp);
+            return NULL;
+        }
+        hdr = new_hdr;
+        hdr->cap = new_len + 1;
+    }
+
+    memmove(hdr->data + pos + ins_len, hdr->data + pos + del_len, tail);
+    if (ins_len > 0)
+        memcpy(hdr->data + pos, bytes, ins_len);
+    free(tmp);
+
+    hdr->len = new_len;
+    hdr->data[new_len] = '\0';
+    hdr->hash = sl__compute_hash(hdr->data, new_len);
+    hdr->flags &= ~SL_HDR_CRC;
+
+    sl__set_err(err, SL_OK);
+    return hdr;
 }
 
 /**
- * Get the hash of a dynamic string
+ * Insert bytes in the middle of a `sl_str`
  *
- * @param str Pointer to the string buffer
+ * The tail is moved once and the memory is reallocated only if needed.
+ *
+ * @param str The dynamic string to modify. Must be a valid `sl_str`.
+ * @param pos Insert position (0 to length)
+ * @param bytes The bytes to insert (they can be part of `str`)
+ * @param len Number of bytes to insert
  * @param err Pointer to an `sl_err` variable, can be NULL.
  *
- * @return A `uint64_t` representing the hash. If an error occured, the function
- *         returns 0, so it is recommended to verify `err`
+ * @return The (possibly reallocated) string pointer.
+ *         If an error occurs, the original string is returned unchanged and `err` is set.
+ */
+sl_str sl_insert(sl_str str, size_t pos, const void *bytes, size_t len, sl_err *err) {
+    return sl_replace_range(str, pos, 0, bytes, len, err);
+}
+
+/**
+ * Remove `len` bytes starting at `pos`
  *
- * @note The returned hash change after the content is modified
+ * The tail is moved once and the capacity is kept (the memory is only
+ * reallocated to add the null terminator to a string from `sl_from_bytes`).
+ *
+ * @return The string pointer. If an error occurs, the string is unchanged and `err` is set.
  */
-uint64_t sl_hash(sl_str str, sl_err *err) {
+sl_str sl_erase(sl_str str, size_t pos, size_t len, sl_err *err) {
+    return sl_replace_range(str, pos, len, NULL, 0, err);
+}
+
+/**
+ * Replace `len` bytes starting at `pos` with other bytes
+ *
+ * @param str The dynamic string to modify. Must be a valid `sl_str`.
+ * @param pos Start of the range to replace
+ * @param len Length of the range to replace
+ * @param bytes The replacement bytes (they can be part of `str`)
+ * @param bytes_len Number of replacement bytes
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ *
+ * @return The (possibly reallocated) string pointer.
+ *         If an error occurs, the original string is returned unchanged and `err` is set.
+ */
+sl_str sl_replace_range(sl_str str, size_t pos, size_t len, const void *bytes, size_t bytes_len,
+                        sl_err *err) {
+    if (!bytes && bytes_len > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return str;
+    }
+
     sl_hdr *hdr;
-    sl_err e = sl__validate(str, &hdr);
+    sl_err e = sl__validate_mut(str, &hdr);
     if (e != SL_OK) {
         sl__set_err(err, e);
-        return 0;
+        return str;
     }
 
-    sl__set_err(err, SL_OK);
-    return hdr->hash;
+    if (pos > hdr->len || len > hdr->len - pos) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return str;
+    }
+
+    hdr = sl__splice(hdr, pos, len, bytes, bytes_len, err);
+    return hdr ? hdr->data : str;
 }
 
 /**
- * Check if two strings (`sl_str`) are equal
- *
- * This function first compares string hashes and lengths to quickly detect inequality.
- * Only if both hash and length are equal, it performs a byte-by-byte comparison to be
- * sure strings have the same content.
+ * Replace every (non-overlapping) occurrence of `needle` with `repl`
  *
- * Time complexity:
- * - Best case (hash/length mismatch or pointer equality) O(1)
- * - Worst case (hash and length match): O(n)
+ * All matches are found first, so the final length is known exactly:
+ * the memory is reallocated at most once, the content is rewritten in
+ * a single pass and the hash is recomputed once at the end.
  *
- * @param str1 The first `sl_str` to compare
- * @param str2 The second `sl_str` to compare
+ * @param str The dynamic string to modify. Must be a valid `sl_str`.
+ * @param needle The bytes to search (must not be empty)
+ * @param needle_len Length of `needle`
+ * @param repl The replacement bytes
+ * @param repl_len Length of `repl`
  * @param err Pointer to an `sl_err` variable, can be NULL.
  *
- * @return `true` if the two strings are equal and `false` otherwise
- *
- * @note Two strings are considered equal if they have the same length and content
- *       or if they point to the same string
+ * @return The (possibly reallocated) string pointer.
+ *         If an error occurs, the original string is returned unchanged and `err` is set.
  */
-bool sl_eq(sl_str str1, sl_str str2, sl_err *err) {
-    sl_hdr *h1, *h2;
+sl_str sl_replace_all(sl_str str, const void *needle, size_t needle_len, const void *repl, size_t repl_len,
+                      sl_err *err) {
+    if (!needle || (!repl && repl_len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return str;
+    }
 
-    sl_err e1 = sl__validate(str1, &h1);
-    sl_err e2 = sl__validate(str2, &h2);
+    sl_hdr *hdr;
+    sl_err e = sl__validate_mut(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return str;
+    }
 
-    if (e1 != SL_OK || e2 != SL_OK) {
-        sl__set_err(err, e1 != SL_OK ? e1 : e2);
-        return false;
+    if (needle_len == 0) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return str;
     }
 
-    if (str1 == str2) {
-        sl__set_err(err, SL_OK);
-        return true;
+    // find all the matches (a small local buffer covers the common case)
+    size_t local[64];
+    size_t *matches = local;
+    size_t count = 0, matches_cap = 64;
+
+    size_t pos = sl__find(hdr->data, hdr->len, needle, needle_len, 0);
+    while (pos != SIZE_MAX) {
+        if (count == matches_cap) {
+            size_t *grown = matches == local ? malloc(2 * matches_cap * sizeof(*grown))
+                                             : realloc(matches, 2 * matches_cap * sizeof(*grown));
+            if (!grown) {
+                if (matches != local)
+                    free(matches);
+                sl__set_err(err, SL_ERR_ALLOC);
+                return str;
+            }
+            if (matches == local)
+                memcpy(grown, local, sizeof(local));
+            matches = grown;
+            matches_cap *= 2;
+        }
+        matches[count++] = pos;
+        pos = sl__find(hdr->data, hdr->len, needle, needle_len, pos + needle_len);
     }
 
-    if (h1->hash != h2->hash) {
+    if (count == 0) {
         sl__set_err(err, SL_OK);
-        return false;
+        return str;
     }
 
-    if (h1->len != h2->len) {
-        sl__set_err(err, SL_OK);
-        return false;
+    // the replacement could live inside the string that is going to be rewritten
+    void *tmp = NULL;
+    if (repl_len > 0 && (const char *)repl < hdr->data + hdr->cap &&
+        (const char *)repl + repl_len > hdr->data) {
+        tmp = malloc(repl_len);
+        if (!tmp) {
+            if (matches != local)
+                free(matches);
+            sl__set_err(err, SL_ERR_ALLOC);
+            return str;
+        }
+        memcpy(tmp, repl, repl_len);
+        repl = tmp;
     }
 
-    bool eq = memcmp(h1->data, h2->data, h1->len) == 0;
+    size_t old_len = hdr->len;
+    size_t new_len;
+    if (repl_len >= needle_len) {
+        size_t grow = repl_len - needle_len;
+        if (grow > 0 && count > (SIZE_MAX - 1 - old_len) / grow) {
+            free(tmp);
+            if (matches != local)
+                free(matches);
+            sl__set_err(err, SL_ERR_ALLOC);
+            return str;
+        }
+        new_len = old_len + count * grow;
+    } else {
+        new_len = old_len - count * (needle_len - repl_len);
+    }
+
+    // keep room for the null terminator, like sl_append_cstr
+    if (new_len + 1 > hdr->cap) {
+        sl_hdr *new_hdr = sl__hdr_realloc(hdr, new_len + 1, err);
+        if (!new_hdr) {
+            free(tmp);
+            if (matches != local)
+                free(matches);
+            return str;
+        }
+        hdr = new_hdr;
+        hdr->cap = new_len + 1;
+    }
+
+    char *data = hdr->data;
+    if (repl_len <= needle_len) {
+        // the content shrinks: compact from left to right
+        size_t src = 0, dst = 0;
+        for (size_t i = 0; i < count; i++) {
+            size_t run = matches[i] - src;
+            memmove(data + dst, data + src, run);
+            dst += run;
+            memcpy(data + dst, repl, repl_len);
+            dst += repl_len;
+            src = matches[i] + needle_len;
+        }
+        memmove(data + dst, data + src, old_len - src);
+    } else {
+        // the content grows: fill from right to left
+        size_t src = old_len, dst = new_len;
+        for (size_t i = count; i-- > 0;) {
+            size_t run = src - (matches[i] + needle_len);
+            dst -= run;
+            memmove(data + dst, data + matches[i] + needle_len, run);
+            dst -= repl_len;
+            memcpy(data + dst, repl, repl_len);
+            src = matches[i];
+        }
+    }
+
+    free(tmp);
+    if (matches != local)
+        free(matches);
+
+    hdr->len = new_len;
+    data[new_len] = '\0';
+    hdr->hash = sl__compute_hash(data, new_len);
+    hdr->flags &= ~SL_HDR_CRC;
+
     sl__set_err(err, SL_OK);
-    return eq;
-}
\ No newline at end of file
+    return data;
+}
+
+// TRIMMING
+
+// whitespace is the "C" locale isspace() set: ' ', '\t', '\n', '\v', '\f', '\r'
+
+static inline bool sl__is_ws(unsigned char c) {
+    return c == ' ' || (unsigned char)(c - '\t') <= '\r' - '\t';
+}
+
+#if defined(__SSE2__)
+/**
+ * Bit mask of the whitespace bytes in a 16-byte block (bit i = byte i)
+ */
+static inline unsigned sl__ws_mask16(const char *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    // '\t'..'\r' is a range of 5: (c - '\t') <= 4 as unsigned bytes
+    __m128i off = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+    __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(off, _mm_set1_epi8(4)), off);
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(space, ctrl));
+}
+#endif
+
+/**
+ * Index of the first non-whitespace byte (or `len`)
+ */
+static size_t sl__skip_ws(const char *p, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        unsigned other = ~sl__ws_mask16(p + i) & 0xFFFFu;
+        if (other)
+            return i + (size_t)__builtin_ctz(other);
+    }
+#endif
+    while (i < len && sl__is_ws((unsigned char)p[i]))
+        i++;
+    return i;
+}
+
+/**
+ * Length of `p` without its trailing whitespace
+ */
+static size_t sl__skip_ws_back(const char *p, size_t len) {
+    size_t end = len;
+#if defined(__SSE2__)
+    for (; end >= 16; end -= 16) {
+        unsigned other = ~sl__ws_mask16(p + end - 16) & 0xFFFFu;
+        if (other)
+            return end - 16 + 32 - (size_t)__builtin_clz(other);
+    }
+#endif
+    while (end > 0 && sl__is_ws((unsigned char)p[end - 1]))
+        end--;
+    return end;
+}
+
+/**
+ * Index of the first whitespace byte (or `len`)
+ */
+static size_t sl__find_ws(const char *p, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        unsigned ws = sl__ws_mask16(p + i);
+        if (ws)
+            return i + (size_t)__builtin_ctz(ws);
+    }
+#endif
+    while (i < len && !sl__is_ws((unsigned char)p[i]))
+        i++;
+    return i;
+}
+
+/**
+ * Keep only the bytes [start, end) of a string (internal function)
+ *
+ * One memmove, no reallocation, the hash is recomputed once.
+ */
+static void sl__keep_range(sl_hdr *hdr, size_t start, size_t end) {
+    if (start == 0 && end == hdr->len)
+        return;
+
+    memmove(hdr->data, hdr->data + start, end - start);
+    hdr->len = end - start;
+    if (hdr->cap > hdr->len)
+        hdr->data[hdr->len] = '\0';
+    hdr->hash = sl__compute_hash(hdr->data, hdr->len);
+    hdr->flags &= ~SL_HDR_CRC;
+}
+
+/**
+ * Remove leading and trailing whitespace in place
+ *
+ * The boundaries are found 16 bytes at a time (SSE2 when available) and
+ * the content is moved with a single memmove. The memory is not reallocated.
+ *
+ * @param str The dynamic string to trim. Must be a valid `sl_str`.
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ * @return The string pointer (unchanged on error)
+ */
+sl_str sl_trim(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate_mut(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return str;
+    }
+
+    size_t end = sl__skip_ws_back(hdr->data, hdr->len);
+    size_t start = sl__skip_ws(hdr->data, end);
+    sl__keep_range(hdr, start, end);
+
+    sl__set_err(err, SL_OK);
+    return str;
+}
+
+/**
+ * Remove leading whitespace in place (see `sl_trim`)
+ */
+sl_str sl_ltrim(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate_mut(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return str;
+    }
+
+    sl__keep_range(hdr, sl__skip_ws(hdr->data, hdr->len), hdr->len);
+
+    sl__set_err(err, SL_OK);
+    return str;
+}
+
+/**
+ * Remove trailing whitespace in place (see `sl_trim`)
+ */
+sl_str sl_rtrim(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate_mut(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return str;
+    }
+
+    sl__keep_range(hdr, 0, sl__skip_ws_back(hdr->data, hdr->len));
+
+    sl__set_err(err, SL_OK);
+    return str;
+}
+
+/**
+ * Trim the string and replace every inner run of whitespace with one space
+ *
+ * ("  a \t\n b  " becomes "a b"). The string is compacted in a single pass:
+ * runs without whitespace are found 16 bytes at a time and moved with memmove.
+ * The memory is not reallocated and the hash is recomputed once.
+ *
+ * @param str The dynamic string to modify. Must be a valid `sl_str`.
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ * @return The string pointer (unchanged on error)
+ */
+sl_str sl_collapse_ws(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate_mut(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return str;
+    }
+
+    char *data = hdr->data;
+    size_t end = sl__skip_ws_back(data, hdr->len);
+    size_t src = sl__skip_ws(data, end);
+    size_t dst = 0;
+    bool changed = false; // bytes rewritten in place (a tab becoming a space)
+
+    while (src < end) {
+        size_t run = sl__find_ws(data + src, end - src);
+        if (dst != src)
+            memmove(data + dst, data + src, run);
+        dst += run;
+        src += run;
+
+        if (src < end) {
+            // `end` is not whitespace, so a word always follows this run
+            changed |= data[dst] != ' ';
+            data[dst++] = ' ';
+            src += sl__skip_ws(data + src, end - src);
+        }
+    }
+
+    if (changed || dst != hdr->len) {
+        hdr->len = dst;
+        if (hdr->cap > dst)
+            data[dst] = '\0';
+        hdr->hash = sl__compute_hash(data, dst);
+        hdr->flags &= ~SL_HDR_CRC;
+    }
+
+    sl__set_err(err, SL_OK);
+    return str;
+}
+
+/**
+ * Get a view of a string without leading and trailing whitespace
+ *
+ * Nothing is allocated or modified: the view points inside `str` and is
+ * valid as long as `str` is not modified or freed. It is not null-terminated.
+ *
+ * @return The view, or an empty view `{NULL, 0}` on error
+ */
+sl_view sl_trim_view(sl_str str, sl_err *err) {
+    sl_view view = {NULL, 0};
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return view;
+    }
+
+    size_t end = sl__skip_ws_back(hdr->data, hdr->len);
+    size_t start = sl__skip_ws(hdr->data, end);
+    view.data = hdr->data + start;
+    view.len = end - start;
+
+    sl__set_err(err, SL_OK);
+    return view;
+}
+
+/**
+ * Get a view of a string without leading whitespace (see `sl_trim_view`)
+ */
+sl_view sl_ltrim_view(sl_str str, sl_err *err) {
+    sl_view view = {NULL, 0};
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return view;
+    }
+
+    size_t start = sl__skip_ws(hdr->data, hdr->len);
+    view.data = hdr->data + start;
+    view.len = hdr->len - start;
+
+    sl__set_err(err, SL_OK);
+    return view;
+}
+
+/**
+ * Get a view of a string without trailing whitespace (see `sl_trim_view`)
+ */
+sl_view sl_rtrim_view(sl_str str, sl_err *err) {
+    sl_view view = {NULL, 0};
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return view;
+    }
+
+    view.data = hdr->data;
+    view.len = sl__skip_ws_back(hdr->data, hdr->len);
+
+    sl__set_err(err, SL_OK);
+    return view;
+}
+
+/**
+ * Compute FNV-1a hash of a generic buffer
+ *
+ * @param data Pointer to the data buffer
+ * @param len Length of the buffer in bytes
+ *
+ * @return 64-bit FNV-1a hash
+ */
+uint64_t sl_compute_hash(const void *data, size_t len) {
+    return sl__compute_hash(data, len);
+}
+
+/**
+ * Compute FNV-1a hash of a C string
+ *
+ * @param str Pointer to the null-terminated C string
+ * @return 64-bit FNV-1a hash
+ */
+uint64_t sl_compute_hash_cstr(const char *str) {
+    if (!str)
+        return 0;
+    return sl__compute_hash(str, strlen(str));
+}
+
+/**
+ * Get the hash of a dynamic string
+ *
+ * @param str Pointer to the string buffer
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ *
+ * @return A `uint64_t` representing the hash. If an error occured, the function
+ *         returns 0, so it is recommended to verify `err`
+ *
+ * @note The returned hash change after the content is modified
+ */
+uint64_t sl_hash(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+
+    sl__set_err(err, SL_OK);
+    return hdr->hash;
+}
+
+/**
+ * Check if two strings (`sl_str`) are equal
+ *
+ * This function first compares string hashes and lengths to quickly detect inequality.
+ * Only if both hash and length are equal, it performs a byte-by-byte comparison to be
+ * sure strings have the same content.
+ *
+ * Time complexity:
+ * - Best case (hash/length mismatch or pointer equality) O(1)
+ * - Worst case (hash and length match): O(n)
+ *
+ * @param str1 The first `sl_str` to compare
+ * @param str2 The second `sl_str` to compare
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ *
+ * @return `true` if the two strings are equal and `false` otherwise
+ *
+ * @note Two strings are considered equal if they have the same length and content
+ *       or if they point to the same string
+ */
+bool sl_eq(sl_str str1, sl_str str2, sl_err *err) {
+    sl_hdr *h1, *h2;
+
+    sl_err e1 = sl__validate(str1, &h1);
+    sl_err e2 = sl__validate(str2, &h2);
+
+    if (e1 != SL_OK || e2 != SL_OK) {
+        sl__set_err(err, e1 != SL_OK ? e1 : e2);
+        return false;
+    }
+
+    if (str1 == str2) {
+        sl__set_err(err, SL_OK);
+        return true;
+    }
+
+    if (h1->hash != h2->hash) {
+        sl__set_err(err, SL_OK);
+        return false;
+    }
+
+    if (h1->len != h2->len) {
+        sl__set_err(err, SL_OK);
+        return false;
+    }
+
+    bool eq = memcmp(h1->data, h2->data, h1->len) == 0;
+    sl__set_err(err, SL_OK);
+    return eq;
+}
+
+// ARENA
+
+/**
+ * Create a new monotonic arena
+ *
+ * Strings created with `sl_from_cstr_in`/`sl_from_bytes_in` and raw blocks
+ * from `sl_arena_alloc` are carved from large blocks and released together
+ * with `sl_arena_reset` or `sl_arena_free`.
+ *
+ * @param block_size Minimum size of each block (0 selects a default of 4096 bytes)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The new arena, or NULL on allocation failure
+ */
+sl_arena *sl_arena_new(size_t block_size, sl_err *err) {
+    sl_arena *arena = malloc(sizeof(*arena));
+    if (!arena) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    arena->head = NULL;
+    arena->block_size = block_size ? block_size : SL_ARENA_DEFAULT_BLOCK;
+
+    sl__set_err(err, SL_OK);
+    return arena;
+}
+
+/**
+ * Allocate raw memory from an arena
+ *
+ * When the current block is full a new one is allocated, at least twice
+ * as large as the previous one.
+ *
+ * @param arena The arena to allocate from
+ * @param size Number of bytes
+ * @param align Alignment of the returned pointer (must be a power of two)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The memory, or NULL on error. The memory must not be freed individually.
+ */
+void *sl_arena_alloc(sl_arena *arena, size_t size, size_t align, sl_err *err) {
+    if (!arena) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    if (align == 0 || (align & (align - 1)) != 0) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+
+    void *ptr = sl__arena_bump(arena, size, align);
+    if (ptr) {
+        sl__set_err(err, SL_OK);
+        return ptr;
+    }
+
+    // the head block is full: chain a bigger one
+    if (size > SIZE_MAX - align - sizeof(sl_arena_block)) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    size_t need = size + align - 1;
+    size_t block_size = arena->block_size;
+    if (arena->head && arena->head->size <= SIZE_MAX / 2 && arena->head->size * 2 > block_size)
+        block_size = arena->head->size * 2;
+    if (block_size < need)
+        block_size = need;
+    if (block_size > SIZE_MAX - sizeof(sl_arena_block))
+        block_size = SIZE_MAX - sizeof(sl_arena_block);
+
+    sl_arena_block *blk = malloc(sizeof(sl_arena_block) + block_size);
+    if (!blk) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    blk->next = arena->head;
+    blk->size = block_size;
+    blk->used = 0;
+    arena->head = blk;
+
+    ptr = sl__arena_bump(arena, size, align);
+    sl__set_err(err, SL_OK);
+    return ptr;
+}
+
+/**
+ * Release every allocation of an arena at once
+ *
+ * The largest (most recent) block is kept for reuse, all the others are freed.
+ *
+ * @param arena The arena to reset, can be NULL
+ * @warning Every string and raw block allocated from the arena becomes invalid.
+ */
+void sl_arena_reset(sl_arena *arena) {
+    if (!arena || !arena->head)
+        return;
+
+    sl_arena_block *blk = arena->head->next;
+    while (blk) {
+        sl_arena_block *next = blk->next;
+        free(blk);
+        blk = next;
+    }
+
+    arena->head->next = NULL;
+    arena->head->used = 0;
+}
+
+/**
+ * Free an arena and all the memory it owns
+ *
+ * @param arena Pointer to the arena variable, it is set to NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_arena_free(sl_arena **arena, sl_err *err) {
+    if (!arena || !*arena) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl_arena_block *blk = (*arena)->head;
+    while (blk) {
+        sl_arena_block *next = blk->next;
+        free(blk);
+        blk = next;
+    }
+
+    free(*arena);
+    *arena = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Create a new dynamic string from a null-terminated C string inside an arena
+ *
+ * Works like `sl_from_cstr`, but the memory comes from `arena`.
+ * Appending to the string keeps using the same arena and `sl_free`
+ * only invalidates it.
+ *
+ * @param arena The arena that owns the string
+ * @param init A pointer to a null-terminated C string
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+sl_str sl_from_cstr_in(sl_arena *arena, const char *init, sl_err *err) {
+    if (!arena || !init) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    return sl__from_buffer(arena, init, strlen(init), 1, err);
+}
+
+/**
+ * Create a new dynamic string from a generic buffer inside an arena
+ *
+ * Works like `sl_from_bytes`, but the memory comes from `arena`.
+ *
+ * @param arena The arena that owns the string
+ * @param bytes The pointer to the buffer
+ * @param len The length of the buffer to store
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+sl_str sl_from_bytes_in(sl_arena *arena, const void *bytes, size_t len, sl_err *err) {
+    if (!arena || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    return sl__from_buffer(arena, bytes, len, 1, err);
+}
+
+
+// ROPE
+
+/**
+ * Polynomial hash base
+ *
+ * Unlike FNV-1a, the polynomial hash of a concatenation can be computed
+ * from the hashes of its parts: H(a + b) = H(a) * BASE^len(b) + H(b)
+ * (mod 2^64). The rope uses it to cache a combined hash in every node.
+ */
+#define SL_POLY_BASE FNV_PRIME
+
+/** Maximum size of a rope chunk. Bigger inputs are split into several nodes */
+#define SL_ROPE_LEAF_MAX 1024
+
+/**
+ * Rope node
+ *
+ * The rope is a treap with implicit keys: every node owns a non-empty
+ * chunk of the text (`sl_str`), the in-order concatenation of the chunks
+ * is the content, and random priorities keep the tree balanced.
+ * Every node caches the length and polynomial hash of its subtree.
+ */
+typedef struct sl_rope_node {
+    struct sl_rope_node *left;
+    struct sl_rope_node *right;
+    sl_str chunk;        /**< Chunk text (null-terminated) */
+    uint64_t chunk_hash; /**< Polynomial hash of the chunk */
+    uint64_t chunk_pow;  /**< SL_POLY_BASE ^ chunk length */
+    size_t len;          /**< Length of the subtree */
+    uint64_t hash;       /**< Polynomial hash of the subtree */
+    uint64_t pow;        /**< SL_POLY_BASE ^ len */
+    uint32_t prio;       /**< Treap priority (max-heap) */
+} sl_rope_node;
+
+struct sl_rope {
+    sl_rope_node *root;
+    uint64_t rng; /**< xorshift state used for the priorities */
+};
+
+/**
+ * Polynomial hash of a buffer and the matching power of the base
+ */
+static uint64_t sl__poly_hash(const void *bytes, size_t len, uint64_t *out_pow) {
+    const unsigned char *ptr = (const unsigned char *)bytes;
+    uint64_t hash = 0;
+    uint64_t pow = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = hash * SL_POLY_BASE + ptr[i];
+        pow *= SL_POLY_BASE;
+    }
+
+    if (out_pow)
+        *out_pow = pow;
+    return hash;
+}
+
+static uint32_t sl__rope_rand(sl_rope *rope) {
+    uint64_t x = rope->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    rope->rng = x;
+    return (uint32_t)(x >> 32);
+}
+
+static inline size_t sl__rope_len(const sl_rope_node *n) {
+    return n ? n->len : 0;
+}
+
+static inline size_t sl__rope_chunk_len(const sl_rope_node *n) {
+    return sl__get_hdr(n->chunk)->len;
+}
+
+/**
+ * Recompute the cached fields of a node from its chunk and children
+ */
+static void sl__rope_update(sl_rope_node *n) {
+    uint64_t hash = 0, pow = 1;
+    size_t len = sl__rope_chunk_len(n);
+
+    if (n->left) {
+        hash = n->left->hash;
+        pow = n->left->pow;
+        len += n->left->len;
+    }
+
+    hash = hash * n->chunk_pow + n->chunk_hash;
+    pow *= n->chunk_pow;
+
+    if (n->right) {
+        hash = hash * n->right->pow + n->right->hash;
+        pow *= n->right->pow;
+        len += n->right->len;
+    }
+
+    n->len = len;
+    n->hash = hash;
+    n->pow = pow;
+}
+
+/**
+ * Refresh the cached hash of a chunk after it has been modified
+ */
+static void sl__rope_chunk_rehash(sl_rope_node *n) {
+    sl_hdr *hdr = sl__get_hdr(n->chunk);
+    n->chunk_hash = sl__poly_hash(hdr->data, hdr->len, &n->chunk_pow);
+}
+
+static sl_rope_node *sl__rope_node_new(sl_rope *rope, const void *bytes, size_t len, sl_err *err) {
+    sl_rope_node *n = malloc(sizeof(*n));
+    if (!n) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    n->chunk = sl__from_buffer(NULL, bytes, len, 1, err);
+    if (!n->chunk) {
+        free(n);
+        return NULL;
+    }
+
+    n->left = n->right = NULL;
+    n->prio = sl__rope_rand(rope);
+    sl__rope_chunk_rehash(n);
+    sl__rope_update(n);
+    return n;
+}
+
+static void sl__rope_node_free(sl_rope_node *n) {
+    while (n) {
+        sl__rope_node_free(n->left);
+        sl_rope_node *right = n->right;
+        sl_free(&n->chunk, NULL);
+        free(n);
+        n = right;
+    }
+}
+
+/**
+ * Join two treaps, every position of `a` comes before `b`. Never fails.
+ */
+static sl_rope_node *sl__rope_merge(sl_rope_node *a, sl_rope_node *b) {
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+
+    if (a->prio >= b->prio) {
+        a->right = sl__rope_merge(a->right, b);
+        sl__rope_update(a);
+        return a;
+    }
+
+    b->left = sl__rope_merge(a, b->left);
+    sl__rope_update(b);
+    return b;
+}
+
+/**
+ * Split a treap so that `*out_l` holds the first `pos` bytes
+ *
+ * If `pos` falls inside a chunk, the chunk is cut in two. That is the only
+ * allocation and it happens before anything is modified, so on failure the
+ * tree is left untouched.
+ */
+static sl_err sl__rope_split(sl_rope *rope, sl_rope_node *n, size_t pos, sl_rope_node **out_l,
+                             sl_rope_node **out_r) {
+    if (!n) {
+        *out_l = *out_r = NULL;
+        return SL_OK;
+    }
+
+    size_t left_len = sl__rope_len(n->left);
+    size_t chunk_len = sl__rope_chunk_len(n);
+
+    if (pos <= left_len) {
+        sl_rope_node *tmp;
+        sl_err e = sl__rope_split(rope, n->left, pos, out_l, &tmp);
+        if (e != SL_OK)
+            return e;
+        n->left = tmp;
+        sl__rope_update(n);
+        *out_r = n;
+        return SL_OK;
+    }
+
+    if (pos >= left_len + chunk_len) {
+        sl_rope_node *tmp;
+        sl_err e = sl__rope_split(rope, n->right, pos - left_len - chunk_len, &tmp, out_r);
+        if (e != SL_OK)
+            return e;
+        n->right = tmp;
+        sl__rope_update(n);
+        *out_l = n;
+        return SL_OK;
+    }
+
+    // cut the chunk: `n` keeps the head, a new node takes the tail
+    size_t cut = pos - left_len;
+    sl_err e;
+    sl_rope_node *tail = sl__rope_node_new(rope, n->chunk + cut, chunk_len - cut, &e);
+    if (!tail)
+        return e;
+
+    sl_str head = sl__from_buffer(NULL, n->chunk, cut, 1, &e);
+    if (!head) {
+        sl__rope_node_free(tail);
+        return e;
+    }
+
+    sl_free(&n->chunk, NULL);
+    n->chunk = head;
+    sl__rope_chunk_rehash(n);
+
+    *out_r = sl__rope_merge(tail, n->right);
+    n->right = NULL;
+    sl__rope_update(n);
+    *out_l = n;
+    return SL_OK;
+}
+
+/**
+ * Build a balanced treap from a buffer, in chunks of SL_ROPE_LEAF_MAX bytes
+ *
+ * The chunks are laid out as a perfectly balanced tree and the priorities
+ * are then sifted down so the heap property holds.
+ */
+static sl_rope_node *sl__rope_build(sl_rope *rope, const char *bytes, size_t n_chunks, size_t len,
+                                    sl_err *err) {
+    if (n_chunks == 0)
+        return NULL;
+
+    size_t mid = n_chunks / 2;
+    size_t off = mid * SL_ROPE_LEAF_MAX;
+    size_t chunk_len = mid == n_chunks - 1 ? len - off : SL_ROPE_LEAF_MAX;
+
+    sl_rope_node *n = sl__rope_node_new(rope, bytes + off, chunk_len, err);
+    if (!n)
+        return NULL;
+
+    n->left = sl__rope_build(rope, bytes, mid, off, err);
+    if (mid > 0 && !n->left) {
+        sl__rope_node_free(n);
+        return NULL;
+    }
+
+    size_t right_off = off + chunk_len;
+    n->right = sl__rope_build(rope, bytes + right_off, n_chunks - mid - 1, len - right_off, err);
+    if (n_chunks - mid - 1 > 0 && !n->right) {
+        sl__rope_node_free(n);
+        return NULL;
+    }
+
+    // sift the priority down (swapping priorities keeps the in-order layout)
+    sl_rope_node *cur = n;
+    for (;;) {
+        sl_rope_node *max = cur;
+        if (cur->left && cur->left->prio > max->prio)
+            max = cur->left;
+        if (cur->right && cur->right->prio > max->prio)
+            max = cur->right;
+        if (max == cur)
+            break;
+        uint32_t tmp = cur->prio;
+        cur->prio = max->prio;
+        max->prio = tmp;
+        cur = max;
+    }
+
+    sl__rope_update(n);
+    return n;
+}
+
+static sl_rope_node *sl__rope_build_bytes(sl_rope *rope, const void *bytes, size_t len, sl_err *err) {
+    size_t n_chunks = (len + SL_ROPE_LEAF_MAX - 1) / SL_ROPE_LEAF_MAX;
+    sl__set_err(err, SL_OK);
+    return sl__rope_build(rope, (const char *)bytes, n_chunks, len, err);
+}
+
+/**
+ * Insert small text directly into the chunk that contains `pos`
+ *
+ * This avoids fragmenting the rope when edits are a few bytes long.
+ *
+ * @return `true` if the text was inserted, `false` if the chunk would
+ *         exceed SL_ROPE_LEAF_MAX (or the reallocation failed)
+ */
+static bool sl__rope_insert_small(sl_rope_node *n, size_t pos, const void *bytes, size_t len) {
+    if (!n)
+        return false;
+
+    size_t left_len = sl__rope_len(n->left);
+    size_t chunk_len = sl__rope_chunk_len(n);
+    bool done;
+
+    if (pos < left_len) {
+        done = sl__rope_insert_small(n->left, pos, bytes, len);
+    } else if (pos > left_len + chunk_len) {
+        done = sl__rope_insert_small(n->right, pos - left_len - chunk_len, bytes, len);
+    } else {
+        if (chunk_len + len > SL_ROPE_LEAF_MAX)
+            return false;
+
+        sl_hdr *hdr = sl__hdr_realloc(sl__get_hdr(n->chunk), chunk_len + len + 1, NULL);
+        if (!hdr)
+            return false;
+
+        size_t off = pos - left_len;
+        memmove(hdr->data + off + len, hdr->data + off, chunk_len - off);
+        memcpy(hdr->data + off, bytes, len);
+        hdr->len = chunk_len + len;
+        hdr->cap = hdr->len + 1;
+        hdr->data[hdr->len] = '\0';
+        hdr->hash = sl__compute_hash(hdr->data, hdr->len);
+        n->chunk = hdr->data;
+        sl__rope_chunk_rehash(n);
+        done = true;
+    }
+
+    if (done)
+        sl__rope_update(n);
+    return done;
+}
+
+/**
+ * Create a new empty rope
+ *
+ * A rope stores a long text as a balanced tree of chunks, so insert,
+ * delete and concat are O(log n) instead of moving the whole tail.
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The new rope, or NULL on allocation failure
+ */
+sl_rope *sl_rope_new(sl_err *err) {
+    sl_rope *rope = malloc(sizeof(*rope));
+    if (!rope) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    rope->root = NULL;
+    rope->rng = (uint64_t)(uintptr_t)rope ^ 0x9E3779B97F4A7C15ULL;
+    if (rope->rng == 0)
+        rope->rng = 1;
+
+    sl__set_err(err, SL_OK);
+    return rope;
+}
+
+/**
+ * Create a rope holding a copy of a dynamic string
+ *
+ * @param str The string to copy
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The new rope, or NULL on error
+ */
+sl_rope *sl_rope_from_str(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    sl_rope *rope = sl_rope_new(err);
+    if (!rope)
+        return NULL;
+
+    rope->root = sl__rope_build_bytes(rope, hdr->data, hdr->len, err);
+    if (!rope->root && hdr->len > 0) {
+        free(rope);
+        return NULL;
+    }
+
+    return rope;
+}
+
+/**
+ * Free a rope and all its chunks
+ *
+ * @param rope Pointer to the rope variable, it is set to NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_rope_free(sl_rope **rope, sl_err *err) {
+    if (!rope || !*rope) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl__rope_node_free((*rope)->root);
+    free(*rope);
+    *rope = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Get the length of a rope
+ *
+ * @return The length, or `SIZE_MAX` if `rope` is NULL
+ */
+size_t sl_rope_len(const sl_rope *rope, sl_err *err) {
+    if (!rope) {
+        sl__set_err(err, SL_ERR_NULL);
+        return SIZE_MAX;
+    }
+
+    sl__set_err(err, SL_OK);
+    return sl__rope_len(rope->root);
+}
+
+/**
+ * Get the polynomial hash of the whole rope in O(1)
+ *
+ * The value is the same as `sl_compute_poly_hash` of the flattened content.
+ * It is *not* the FNV-1a hash returned by `sl_hash`.
+ *
+ * @return The hash, or 0 if `rope` is NULL
+ */
+uint64_t sl_rope_hash(const sl_rope *rope, sl_err *err) {
+    if (!rope) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+
+    sl__set_err(err, SL_OK);
+    return rope->root ? rope->root->hash : 0;
+}
+
+/**
+ * Get the byte at position `pos` in O(log n)
+ *
+ * @return The byte, or '\0' on error (`SL_ERR_RANGE` if `pos` is out of bounds)
+ */
+char sl_rope_at(const sl_rope *rope, size_t pos, sl_err *err) {
+    if (!rope) {
+        sl__set_err(err, SL_ERR_NULL);
+        return '\0';
+    }
+
+    const sl_rope_node *n = rope->root;
+    if (pos >= sl__rope_len(n)) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return '\0';
+    }
+
+    for (;;) {
+        size_t left_len = sl__rope_len(n->left);
+        size_t chunk_len = sl__rope_chunk_len(n);
+
+        if (pos < left_len) {
+            n = n->left;
+        } else if (pos < left_len + chunk_len) {
+            sl__set_err(err, SL_OK);
+            return n->chunk[pos - left_len];
+        } else {
+            pos -= left_len + chunk_len;
+            n = n->right;
+        }
+    }
+}
+
+/**
+ * Insert `len` bytes at position `pos` in O(log n + len)
+ *
+ * Short insertions are merged into an existing chunk, longer ones are
+ * added as new nodes.
+ *
+ * @param rope The rope to modify
+ * @param pos Insert position (0 to length)
+ * @param bytes The bytes to insert
+ * @param len Number of bytes
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ *            On error the rope is unchanged.
+ */
+void sl_rope_insert(sl_rope *rope, size_t pos, const void *bytes, size_t len, sl_err *err) {
+    if (!rope || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    if (pos > sl__rope_len(rope->root)) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+
+    if (len == 0 || sl__rope_insert_small(rope->root, pos, bytes, len)) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl_rope_node *mid = sl__rope_build_bytes(rope, bytes, len, err);
+    if (!mid)
+        return;
+
+    sl_rope_node *l, *r;
+    sl_err e = sl__rope_split(rope, rope->root, pos, &l, &r);
+    if (e != SL_OK) {
+        sl__rope_node_free(mid);
+        sl__set_err(err, e);
+        return;
+    }
+
+    rope->root = sl__rope_merge(sl__rope_merge(l, mid), r);
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Delete `len` bytes starting at position `pos` in O(log n)
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ *            On error the rope is unchanged.
+ */
+void sl_rope_delete(sl_rope *rope, size_t pos, size_t len, sl_err *err) {
+    if (!rope) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    size_t total = sl__rope_len(rope->root);
+    if (pos > total || len > total - pos) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+
+    if (len == 0) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl_rope_node *l, *rest, *mid, *r;
+    sl_err e = sl__rope_split(rope, rope->root, pos, &l, &rest);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+
+    e = sl__rope_split(rope, rest, len, &mid, &r);
+    if (e != SL_OK) {
+        rope->root = sl__rope_merge(l, rest);
+        sl__set_err(err, e);
+        return;
+    }
+
+    sl__rope_node_free(mid);
+    rope->root = sl__rope_merge(l, r);
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Move the content of `src` to the end of `dst` in O(log n)
+ *
+ * After the call `src` is empty (but still has to be freed).
+ */
+void sl_rope_concat(sl_rope *dst, sl_rope *src, sl_err *err) {
+    if (!dst || !src) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    if (dst == src) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return;
+    }
+
+    dst->root = sl__rope_merge(dst->root, src->root);
+    src->root = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Flatten a rope into a new dynamic string
+ *
+ * The string is allocated once with the exact size and its FNV-1a hash
+ * is computed once at the end.
+ *
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_rope_to_str(const sl_rope *rope, sl_err *err) {
+    if (!rope) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    size_t len = sl__rope_len(rope->root);
+    sl_hdr *hdr = sl__hdr_alloc(NULL, len + 1, err);
+    if (!hdr)
+        return NULL;
+
+    // iterative in-order walk: the depth is O(log n), so the stack normally
+    // fits in the local buffer and only moves to the heap for unlucky trees
+    size_t stack_cap = 128, top = 0, off = 0;
+    const sl_rope_node *stack_buf[128];
+    const sl_rope_node **stack = stack_buf;
+    const sl_rope_node *n = rope->root;
+
+    while (n || top > 0) {
+        while (n) {
+            if (top == stack_cap) {
+                size_t new_cap = stack_cap * 2;
+                const sl_rope_node **grown = malloc(new_cap * sizeof(*grown));
+                if (!grown) {
+                    if (stack != stack_buf)
+                        free(stack);
+                    free(hdr);
+                    sl__set_err(err, SL_ERR_ALLOC);
+                    return NULL;
+                }
+                memcpy(grown, stack, top * sizeof(*grown));
+                if (stack != stack_buf)
+                    free(stack);
+                stack = grown;
+                stack_cap = new_cap;
+            }
+            stack[top++] = n;
+            n = n->left;
+        }
+
+        n = stack[--top];
+        size_t chunk_len = sl__rope_chunk_len(n);
+        memcpy(hdr->data + off, n->chunk, chunk_len);
+        off += chunk_len;
+        n = n->right;
+    }
+
+    if (stack != stack_buf)
+        free(stack);
+
+    hdr->magic = SL_MAGIC;
+    hdr->len = len;
+    hdr->cap = len + 1;
+    hdr->data[len] = '\0';
+    hdr->hash = sl__compute_hash(hdr->data, len);
+
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+/**
+ * Compute the polynomial hash of a generic buffer
+ *
+ * This is the hash cached by `sl_rope` (see `sl_rope_hash`):
+ * H = s[0] * B^(n-1) + s[1] * B^(n-2) + ... + s[n-1]  (mod 2^64)
+ *
+ * @param data Pointer to the data buffer
+ * @param len Length of the buffer in bytes
+ * @return 64-bit polynomial hash
+ */
+uint64_t sl_compute_poly_hash(const void *data, size_t len) {
+    return sl__poly_hash(data, len, NULL);
+}
+
+
+// GAP BUFFER
+
+/** Minimum gap left after a gap buffer grows */
+#define SL_GAPBUF_MIN_GAP 64
+
+/**
+ * Gap buffer
+ *
+ * The text lives in a regular `sl_hdr` block (same allocator as `sl_str`)
+ * laid out as [before cursor][gap][after cursor]. `hdr->len` is the text
+ * length and `hdr->cap` the size of the block, the gap is the rest.
+ * Edits at the cursor only touch the gap, moving the cursor moves
+ * just the bytes between the old and the new position.
+ */
+struct sl_gapbuf {
+    sl_hdr *hdr;      /**< Block marked with SL_GAP_MAGIC */
+    size_t gap_start; /**< Cursor position (start of the gap) */
+    size_t gap_end;   /**< First byte after the gap */
+};
+
+/**
+ * Make sure the gap can hold at least `need` bytes
+ *
+ * The block grows geometrically so a sequence of inserts is amortized O(1).
+ */
+static sl_err sl__gapbuf_reserve(sl_gapbuf *gb, size_t need) {
+    sl_hdr *hdr = gb->hdr;
+    if (gb->gap_end - gb->gap_start >= need)
+        return SL_OK;
+
+    if (need > SIZE_MAX / 2 - hdr->cap - SL_GAPBUF_MIN_GAP)
+        return SL_ERR_ALLOC;
+
+    size_t new_cap = hdr->cap * 2;
+    if (new_cap < hdr->len + need + SL_GAPBUF_MIN_GAP)
+        new_cap = hdr->len + need + SL_GAPBUF_MIN_GAP;
+
+    // the text after the gap has to move, so keep `len` covering the whole
+    // used part of the block while reallocating
+    size_t after = hdr->cap - gb->gap_end;
+    size_t text_len = hdr->len;
+    hdr->len = hdr->cap;
+
+    sl_err e = SL_OK;
+    sl_hdr *new_hdr = sl__hdr_realloc(hdr, new_cap, &e);
+    if (!new_hdr) {
+        hdr->len = text_len;
+        return e;
+    }
+
+    memmove(new_hdr->data + new_cap - after, new_hdr->data + gb->gap_end, after);
+    new_hdr->magic = SL_GAP_MAGIC;
+    new_hdr->len = text_len;
+    new_hdr->cap = new_cap;
+    gb->gap_end = new_cap - after;
+    gb->hdr = new_hdr;
+    return SL_OK;
+}
+
+/**
+ * Create a new empty gap buffer
+ *
+ * @param cap Initial capacity (0 selects a small default)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The new gap buffer with the cursor at 0, or NULL on error
+ */
+sl_gapbuf *sl_gapbuf_new(size_t cap, sl_err *err) {
+    if (cap == 0)
+        cap = SL_GAPBUF_MIN_GAP;
+
+    sl_gapbuf *gb = malloc(sizeof(*gb));
+    if (!gb) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    gb->hdr = sl__hdr_alloc(NULL, cap, err);
+    if (!gb->hdr) {
+        free(gb);
+        return NULL;
+    }
+
+    gb->hdr->magic = SL_GAP_MAGIC;
+    gb->hdr->hash = 0;
+    gb->hdr->len = 0;
+    gb->hdr->cap = cap;
+    gb->gap_start = 0;
+    gb->gap_end = cap;
+
+    sl__set_err(err, SL_OK);
+    return gb;
+}
+
+/**
+ * Create a gap buffer holding a copy of a dynamic string
+ *
+ * The cursor is placed at the end of the text.
+ */
+sl_gapbuf *sl_gapbuf_from_str(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    size_t cap = hdr->len + (hdr->len / 2 > SL_GAPBUF_MIN_GAP ? hdr->len / 2 : SL_GAPBUF_MIN_GAP);
+    sl_gapbuf *gb = sl_gapbuf_new(cap, err);
+    if (!gb)
+        return NULL;
+
+    memcpy(gb->hdr->data, hdr->data, hdr->len);
+    gb->hdr->len = hdr->len;
+    gb->gap_start = hdr->len;
+    return gb;
+}
+
+/**
+ * Free a gap buffer
+ *
+ * @param gb Pointer to the gap buffer variable, it is set to NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_gapbuf_free(sl_gapbuf **gb, sl_err *err) {
+    if (!gb || !*gb) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl__hdr_release((*gb)->hdr);
+    free(*gb);
+    *gb = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Get the length of the text (the gap is not counted)
+ *
+ * @return The length, or `SIZE_MAX` if `gb` is NULL
+ */
+size_t sl_gapbuf_len(const sl_gapbuf *gb, sl_err *err) {
+    if (!gb) {
+        sl__set_err(err, SL_ERR_NULL);
+        return SIZE_MAX;
+    }
+
+    sl__set_err(err, SL_OK);
+    return gb->hdr->len;
+}
+
+/**
+ * Get the cursor position
+ *
+ * @return The position, or `SIZE_MAX` if `gb` is NULL
+ */
+size_t sl_gapbuf_cursor(const sl_gapbuf *gb, sl_err *err) {
+    if (!gb) {
+        sl__set_err(err, SL_ERR_NULL);
+        return SIZE_MAX;
+    }
+
+    sl__set_err(err, SL_OK);
+    return gb->gap_start;
+}
+
+/**
+ * Move the cursor to position `pos`
+ *
+ * Only the bytes between the old and the new cursor are moved,
+ * so the cost is proportional to the distance.
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_RANGE` if `pos` is past the end of the text)
+ */
+void sl_gapbuf_move(sl_gapbuf *gb, size_t pos, sl_err *err) {
+    if (!gb) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    if (pos > gb->hdr->len) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+
+    char *data = gb->hdr->data;
+    if (pos < gb->gap_start) {
+        size_t n = gb->gap_start - pos;
+        memmove(data + gb->gap_end - n, data + pos, n);
+        gb->gap_start -= n;
+        gb->gap_end -= n;
+    } else if (pos > gb->gap_start) {
+        size_t n = pos - gb->gap_start;
+        memmove(data + gb->gap_start, data + gb->gap_end, n);
+        gb->gap_start += n;
+        gb->gap_end += n;
+    }
+
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Insert bytes at the cursor, the cursor moves after them
+ *
+ * Amortized O(len): the block only grows (geometrically) when the gap is full.
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ *            On error the buffer is unchanged.
+ */
+void sl_gapbuf_insert(sl_gapbuf *gb, const void *bytes, size_t len, sl_err *err) {
+    if (!gb || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    sl_err e = sl__gapbuf_reserve(gb, len);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+
+    if (len > 0)
+        memcpy(gb->hdr->data + gb->gap_start, bytes, len);
+    gb->gap_start += len;
+    gb->hdr->len += len;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Delete `len` bytes after the cursor in O(1)
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_RANGE` if there are less than `len` bytes after the cursor)
+ */
+void sl_gapbuf_delete(sl_gapbuf *gb, size_t len, sl_err *err) {
+    if (!gb) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    if (len > gb->hdr->cap - gb->gap_end) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+
+    gb->gap_end += len;
+    gb->hdr->len -= len;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Delete `len` bytes before the cursor in O(1)
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_RANGE` if there are less than `len` bytes before the cursor)
+ */
+void sl_gapbuf_backspace(sl_gapbuf *gb, size_t len, sl_err *err) {
+    if (!gb) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    if (len > gb->gap_start) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+
+    gb->gap_start -= len;
+    gb->hdr->len -= len;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Get the text as one contiguous, null-terminated buffer
+ *
+ * The text after the cursor is copied into the gap, right after the text
+ * before it, so the cursor does not move (the gap grows first if it cannot
+ * hold the copy). The call only writes the terminator if the cursor is
+ * already at the end. The pointer is valid until the next edit.
+ *
+ * @note The gap must be at least as large as the text after the cursor, so
+ *       with the cursor near the start the block can grow to about twice
+ *       the text (the gap is kept for later inserts). To view a large text
+ *       without that cost, `sl_gapbuf_move` to the end first (the move
+ *       needs no extra room) or use `sl_gapbuf_to_str`.
+ *
+ * @param gb The gap buffer
+ * @param out_len If not NULL, receives the text length
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The text, or NULL on error
+ */
+const char *sl_gapbuf_view(sl_gapbuf *gb, size_t *out_len, sl_err *err) {
+    if (!gb) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    // room for a copy of the text after the gap plus the null terminator,
+    // the original after the gap is left untouched
+    size_t after = gb->hdr->cap - gb->gap_end;
+    sl_err e = sl__gapbuf_reserve(gb, after + 1);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    char *data = gb->hdr->data;
+    memcpy(data + gb->gap_start, data + gb->gap_end, after);
+    data[gb->hdr->len] = '\0';
+
+    if (out_len)
+        *out_len = gb->hdr->len;
+    sl__set_err(err, SL_OK);
+    return data;
+}
+
+/**
+ * Copy the text into a new dynamic string
+ *
+ * The string is allocated with the exact size and hashed once.
+ *
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_gapbuf_to_str(sl_gapbuf *gb, sl_err *err) {
+    if (!gb) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    size_t len = gb->hdr->len;
+    sl_hdr *hdr = sl__hdr_alloc(NULL, len + 1, err);
+    if (!hdr)
+        return NULL;
+
+    size_t after = gb->hdr->cap - gb->gap_end;
+    memcpy(hdr->data, gb->hdr->data, gb->gap_start);
+    memcpy(hdr->data + gb->gap_start, gb->hdr->data + gb->gap_end, after);
+
+    hdr->magic = SL_MAGIC;
+    hdr->len = len;
+    hdr->cap = len + 1;
+    hdr->data[len] = '\0';
+    hdr->hash = sl__compute_hash(hdr->data, len);
+
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+
+// ENCODING (BASE64 / HEX)
+
+/*
+ * The SIMD kernels are compiled with a per-function target attribute and
+ * picked at runtime, so the library still builds without -mavx2 and runs
+ * on any x86-64 CPU. Other platforms use the scalar code only.
+ */
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SL_HAVE_AVX2_KERNELS 1
+#include <immintrin.h>
+#include <stdatomic.h>
+
+// threads may race on the first call: each probes the CPU and stores the same answer
+static bool sl__cpu_has_avx2(void) {
+    static _Atomic int cached = -1;
+    int has = atomic_load_explicit(&cached, memory_order_relaxed);
+    if (has < 0) {
+        __builtin_cpu_init();
+        has = __builtin_cpu_supports("avx2") ? 1 : 0;
+        atomic_store_explicit(&cached, has, memory_order_relaxed);
+    }
+    return has == 1;
+}
+#endif
+
+static const char SL_HEX_DIGITS[] = "0123456789abcdef";
+
+static const char SL_B64_STD[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char SL_B64_URL[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/**
+ * Allocate a string of exactly `len` bytes (+ null term) to be filled by the caller
+ */
+static sl_hdr *sl__alloc_exact(size_t len, sl_err *err) {
+    if (len == SIZE_MAX) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__hdr_alloc(NULL, len + 1, err);
+    if (!hdr)
+        return NULL;
+
+    hdr->magic = SL_MAGIC;
+    hdr->len = len;
+    hdr->cap = len + 1;
+    hdr->data[len] = '\0';
+    return hdr;
+}
+
+/**
+ * Finish a string filled by the caller: compute the hash once
+ */
+static sl_str sl__finish(sl_hdr *hdr, sl_err *err) {
+    hdr->hash = sl__compute_hash(hdr->data, hdr->len);
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+#ifdef SL_HAVE_AVX2_KERNELS
+/**
+ * Hex encode 32 bytes at a time: split the nibbles and look them up
+ * with a byte shuffle
+ *
+ * @return Number of input bytes consumed
+ */
+__attribute__((target("avx2"))) static size_t sl__hex_encode_avx2(const unsigned char *in, size_t len,
+                                                                 char *out) {
+    const __m256i lut = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd',
+                                         'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b',
+                                         'c', 'd', 'e', 'f');
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+        __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nibble));
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(out + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+
+    return i;
+}
+
+/**
+ * Hex decode 64 characters at a time
+ *
+ * Stops at the first block that contains a non hex character
+ * (the scalar code reports the error).
+ *
+ * @return Number of input characters consumed
+ */
+__attribute__((target("avx2"))) static size_t sl__hex_decode_avx2(const char *in, size_t len,
+                                                                 unsigned char *out) {
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        __m256i vals[2];
+        for (int k = 0; k < 2; k++) {
+            __m256i c = _mm256_loadu_si256((const __m256i *)(in + i + 32 * k));
+            __m256i lower = _mm256_or_si256(c, _mm256_set1_epi8(0x20));
+            __m256i is_digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                                _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+            __m256i is_alpha = _mm256_and_si256(_mm256_cmpgt_epi8(lower, _mm256_set1_epi8('a' - 1)),
+                                                _mm256_cmpgt_epi8(_mm256_set1_epi8('f' + 1), lower));
+            if (_mm256_movemask_epi8(_mm256_or_si256(is_digit, is_alpha)) != -1)
+                return i;
+
+            __m256i digit = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+            __m256i alpha = _mm256_sub_epi8(lower, _mm256_set1_epi8('a' - 10));
+            vals[k] = _mm256_blendv_epi8(alpha, digit, is_digit);
+        }
+
+        // (hi << 4) | lo for every pair, then pack the 16-bit results
+        __m256i a = _mm256_maddubs_epi16(vals[0], _mm256_set1_epi16(0x0110));
+        __m256i b = _mm256_maddubs_epi16(vals[1], _mm256_set1_epi16(0x0110));
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+        _mm256_storeu_si256((__m256i *)(out + i / 2), packed);
+    }
+
+    return i;
+}
+
+/**
+ * Base64 encode 24 bytes into 32 characters per iteration
+ *
+ * The bytes are spread into 6-bit fields with shuffle + multiplies and
+ * translated to ASCII with a shuffle lookup of per-range offsets.
+ * Each iteration reads 28 bytes.
+ *
+ * @return Number of input bytes consumed (a multiple of 3)
+ */
+__attribute__((target("avx2"))) static size_t sl__base64_encode_avx2(const unsigned char *in, size_t len,
+                                                                    char *out, bool url) {
+    const __m256i shuf = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5,
+                                          4, 7, 6, 8, 7, 10, 9, 11, 10);
+    // offsets for: A-Z, a-z, 0-9 (x10), 62, 63
+    const char o62 = url ? '-' - 62 : '+' - 62;
+    const char o63 = url ? '_' - 63 : '/' - 63;
+    const __m256i lut = _mm256_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, o62, o63, 0, 0, 65, 71,
+                                         -4, -4, -4, -4, -4, -4, -4, -4, -4, -4, o62, o63, 0, 0);
+    size_t i = 0, o = 0;
+
+    for (; i + 28 <= len; i += 24, o += 32) {
+        __m256i v = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(in + i))),
+            _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+
+        v = _mm256_shuffle_epi8(v, shuf);
+        __m256i t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0FC0FC00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003F03F0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i idx = _mm256_or_si256(t1, t3);
+
+        // range index: 0 for A-Z, 1 for a-z, 2..11 for digits, 12/13 for 62/63
+        __m256i range = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        range = _mm256_sub_epi8(range, _mm256_cmpgt_epi8(idx, _mm256_set1_epi8(25)));
+        __m256i chars = _mm256_add_epi8(idx, _mm256_shuffle_epi8(lut, range));
+
+        _mm256_storeu_si256((__m256i *)(out + o), chars);
+    }
+
+    return i;
+}
+
+/**
+ * Base64 decode 32 characters into 24 bytes per iteration
+ *
+ * Characters are classified with range compares (so both alphabets work),
+ * then the 6-bit values are merged with multiply-adds and packed.
+ * Each iteration writes 32 bytes, so the caller keeps enough input left
+ * for the scalar tail to cover the extra bytes. Stops at the first block
+ * containing a character outside the alphabet (including padding).
+ *
+ * @return Number of input characters consumed (a multiple of 4)
+ */
+__attribute__((target("avx2"))) static size_t sl__base64_decode_avx2(const char *in, size_t len,
+                                                                    unsigned char *out, bool url) {
+    const __m256i c62 = _mm256_set1_epi8(url ? '-' : '+');
+    const __m256i c63 = _mm256_set1_epi8(url ? '_' : '/');
+    size_t i = 0, o = 0;
+
+    for (; i + 64 <= len; i += 32, o += 24) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(in + i));
+
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+        __m256i is62 = _mm256_cmpeq_epi8(c, c62);
+        __m256i is63 = _mm256_cmpeq_epi8(c, c63);
+
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, is62));
+        if (_mm256_movemask_epi8(_mm256_or_si256(valid, is63)) != -1)
+            break;
+
+        __m256i delta = _mm256_and_si256(upper, _mm256_set1_epi8(-65));
+        delta = _mm256_or_si256(delta, _mm256_and_si256(lower, _mm256_set1_epi8(-71)));
+        delta = _mm256_or_si256(delta, _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+        delta = _mm256_or_si256(delta, _mm256_and_si256(is62, _mm256_sub_epi8(_mm256_set1_epi8(62), c62)));
+        delta = _mm256_or_si256(delta, _mm256_and_si256(is63, _mm256_sub_epi8(_mm256_set1_epi8(63), c63)));
+        __m256i v = _mm256_add_epi8(c, delta);
+
+        // merge 4 x 6 bits into 24 bits, then keep 3 bytes of every 32-bit word
+        __m256i ab = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+        __m256i abcd = _mm256_madd_epi16(ab, _mm256_set1_epi32(0x00011000));
+        abcd = _mm256_shuffle_epi8(abcd, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2,
+                                                          1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+        abcd = _mm256_permutevar8x32_epi32(abcd, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+        _mm256_storeu_si256((__m256i *)(out + o), abcd);
+    }
+
+    return i;
+}
+#endif
+
+/**
+ * Value of a hex digit, or -1
+ */
+static inline int sl__hex_value(unsigned char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/**
+ * Value of a base64 character, or -1
+ */
+static inline int sl__base64_value(unsigned char c, bool url) {
+    if (c >= 'A' && c <= 'Z')
+        return c - 'A';
+    if (c >= 'a' && c <= 'z')
+        return c - 'a' + 26;
+    if (c >= '0' && c <= '9')
+        return c - '0' + 52;
+    if (c == (url ? '-' : '+'))
+        return 62;
+    if (c == (url ? '_' : '/'))
+        return 63;
+    return -1;
+}
+
+/**
+ * Encode a string as lowercase hexadecimal
+ *
+ * The output is allocated once with its exact size (2 * length).
+ * Uses an AVX2 kernel when the CPU supports it.
+ *
+ * @param str The string to encode (binary data allowed)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_hex_encode(sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    if (src->len > (SIZE_MAX - 1) / 2) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__alloc_exact(src->len * 2, err);
+    if (!hdr)
+        return NULL;
+
+    const unsigned char *in = (const unsigned char *)src->data;
+    size_t i = 0;
+#ifdef SL_HAVE_AVX2_KERNELS
+    if (sl__cpu_has_avx2())
+        i = sl__hex_encode_avx2(in, src->len, hdr->data);
+#endif
+    for (; i < src->len; i++) {
+        hdr->data[2 * i] = SL_HEX_DIGITS[in[i] >> 4];
+        hdr->data[2 * i + 1] = SL_HEX_DIGITS[in[i] & 0x0F];
+    }
+
+    return sl__finish(hdr, err);
+}
+
+/**
+ * Decode a hexadecimal string (upper or lower case)
+ *
+ * @param str The hex text, its length must be even
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_FORMAT` if the input is not valid hex)
+ * @return A new `sl_str` with the decoded bytes, or NULL on error
+ */
+sl_str sl_hex_decode(sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    if (src->len % 2 != 0) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__alloc_exact(src->len / 2, err);
+    if (!hdr)
+        return NULL;
+
+    unsigned char *out = (unsigned char *)hdr->data;
+    size_t i = 0;
+#ifdef SL_HAVE_AVX2_KERNELS
+    if (sl__cpu_has_avx2())
+        i = sl__hex_decode_avx2(src->data, src->len, out);
+#endif
+    for (; i < src->len; i += 2) {
+        int hi = sl__hex_value((unsigned char)src->data[i]);
+        int lo = sl__hex_value((unsigned char)src->data[i + 1]);
+        if (hi < 0 || lo < 0) {
+            free(hdr);
+            sl__set_err(err, SL_ERR_FORMAT);
+            return NULL;
+        }
+        out[i / 2] = (unsigned char)(hi << 4 | lo);
+    }
+
+    return sl__finish(hdr, err);
+}
+
+/**
+ * Encode a string as base64
+ *
+ * `SL_BASE64_STD` uses the RFC 4648 alphabet with '=' padding,
+ * `SL_BASE64_URL` the URL and filename safe alphabet without padding.
+ * The output is allocated once with its exact size.
+ * Uses an AVX2 kernel when the CPU supports it.
+ *
+ * @param str The string to encode (binary data allowed)
+ * @param alphabet `SL_BASE64_STD` or `SL_BASE64_URL`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_base64_encode(sl_str str, sl_base64_alphabet alphabet, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    bool url = alphabet == SL_BASE64_URL;
+    size_t len = src->len;
+    if (len / 3 >= (SIZE_MAX - 4) / 4) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    size_t out_len = url ? len / 3 * 4 + (len % 3 ? len % 3 + 1 : 0) : (len + 2) / 3 * 4;
+    sl_hdr *hdr = sl__alloc_exact(out_len, err);
+    if (!hdr)
+        return NULL;
+
+    const unsigned char *in = (const unsigned char *)src->data;
+    const char *table = url ? SL_B64_URL : SL_B64_STD;
+    char *out = hdr->data;
+    size_t i = 0;
+#ifdef SL_HAVE_AVX2_KERNELS
+    if (sl__cpu_has_avx2())
+        i = sl__base64_encode_avx2(in, len, out, url);
+#endif
+    out += i / 3 * 4;
+
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+        *out++ = table[v >> 18];
+        *out++ = table[(v >> 12) & 0x3F];
+        *out++ = table[(v >> 6) & 0x3F];
+        *out++ = table[v & 0x3F];
+    }
+
+    if (i < len) {
+        uint32_t v = (uint32_t)in[i] << 16 | (i + 1 < len ? (uint32_t)in[i + 1] << 8 : 0);
+        *out++ = table[v >> 18];
+        *out++ = table[(v >> 12) & 0x3F];
+        if (i + 1 < len)
+            *out++ = table[(v >> 6) & 0x3F];
+        else if (!url)
+            *out++ = '=';
+        if (!url)
+            *out++ = '=';
+    }
+
+    return sl__finish(hdr, err);
+}
+
+/**
+ * Decode a base64 string
+ *
+ * Padding is optional for both alphabets. Whitespace, characters from the
+ * other alphabet and non-zero unused bits in the last group are rejected,
+ * so every byte string has exactly one accepted encoding.
+ *
+ * @param str The base64 text
+ * @param alphabet `SL_BASE64_STD` or `SL_BASE64_URL`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_FORMAT` if the input is not valid base64)
+ * @return A new `sl_str` with the decoded bytes, or NULL on error
+ */
+sl_str sl_base64_decode(sl_str str, sl_base64_alphabet alphabet, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    bool url = alphabet == SL_BASE64_URL;
+    const char *in = src->data;
+    size_t len = src->len;
+
+    // strip the padding, then the remaining length decides the output size
+    if (len % 4 == 0 && len > 0 && in[len - 1] == '=') {
+        len--;
+        if (in[len - 1] == '=')
+            len--;
+    }
+
+    if (len % 4 == 1) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    size_t out_len = len / 4 * 3 + (len % 4 ? len % 4 - 1 : 0);
+    sl_hdr *hdr = sl__alloc_exact(out_len, err);
+    if (!hdr)
+        return NULL;
+
+    unsigned char *out = (unsigned char *)hdr->data;
+    size_t i = 0;
+#ifdef SL_HAVE_AVX2_KERNELS
+    if (sl__cpu_has_avx2())
+        i = sl__base64_decode_avx2(in, len, out, url);
+#endif
+    out += i / 4 * 3;
+
+    uint32_t acc = 0;
+    int bits = 0;
+    for (; i < len; i++) {
+        int v = sl__base64_value((unsigned char)in[i], url);
+        if (v < 0) {
+            free(hdr);
+            sl__set_err(err, SL_ERR_FORMAT);
+            return NULL;
+        }
+        acc = acc << 6 | (uint32_t)v;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            *out++ = (unsigned char)(acc >> bits);
+        }
+    }
+
+    // a canonical encoder leaves the bits after the last byte at zero ("QQ==", not "QR==")
+    if (acc & ((1u << bits) - 1)) {
+        free(hdr);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    return sl__finish(hdr, err);
+}
+
+
+// JSON
+
+#if defined(__SSE2__)
+/**
+ * Bit mask of the bytes that need a JSON escape in a 16-byte block:
+ * '"', '\\' and control characters (< 0x20)
+ */
+static inline unsigned sl__json_mask16(const char *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i quote = _mm_cmpeq_epi8(v, _mm_set1_epi8('"'));
+    __m128i bslash = _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'));
+    __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v);
+    return (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(quote, bslash), ctrl));
+}
+#endif
+
+static inline bool sl__json_needs_escape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/**
+ * Length of the run of bytes that can be copied as they are
+ */
+static size_t sl__json_clean_run(const char *p, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = sl__json_mask16(p + i);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < len && !sl__json_needs_escape((unsigned char)p[i]))
+        i++;
+    return i;
+}
+
+/**
+ * Length of the escape sequence of a byte that needs escaping
+ */
+static inline size_t sl__json_escape_len(unsigned char c) {
+    switch (c) {
+    case '"':
+    case '\\':
+    case '\b':
+    case '\f':
+    case '\n':
+    case '\r':
+    case '\t':
+        return 2;
+    default:
+        return 6; // \u00XX
+    }
+}
+
+/**
+ * Exact length of the escaped form of a buffer (counting pass)
+ */
+static size_t sl__json_escaped_len(const char *p, size_t len) {
+    size_t out = len, i = 0;
+    while (i < len) {
+        i += sl__json_clean_run(p + i, len - i);
+        if (i < len)
+            out += sl__json_escape_len((unsigned char)p[i++]) - 1;
+    }
+    return out;
+}
+
+/**
+ * Write the escaped form of a buffer, `out` must be big enough
+ */
+static void sl__json_escape_into(char *out, const char *p, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        size_t run = sl__json_clean_run(p + i, len - i);
+        memcpy(out, p + i, run);
+        out += run;
+        i += run;
+        if (i == len)
+            break;
+
+        unsigned char c = (unsigned char)p[i++];
+        *out++ = '\\';
+        switch (c) {
+        case '"':
+            *out++ = '"';
+            break;
+        case '\\':
+            *out++ = '\\';
+            break;
+        case '\b':
+            *out++ = 'b';
+            break;
+        case '\f':
+            *out++ = 'f';
+            break;
+        case '\n':
+            *out++ = 'n';
+            break;
+        case '\r':
+            *out++ = 'r';
+            break;
+        case '\t':
+            *out++ = 't';
+            break;
+        default:
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = SL_HEX_DIGITS[c >> 4];
+            *out++ = SL_HEX_DIGITS[c & 0x0F];
+        }
+    }
+}
+
+/**
+ * Escape a string for use inside a JSON string literal
+ *
+ * '"', '\\' and control characters are escaped, everything else
+ * (including UTF-8) is copied as is. The surrounding quotes are not added.
+ * Clean runs are found 16 bytes at a time (SSE2 when available) and copied
+ * with memcpy; a counting pass sizes the output exactly.
+ *
+ * @param str The string to escape
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_json_escape(sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    size_t out_len = sl__json_escaped_len(src->data, src->len);
+    sl_hdr *hdr = sl__alloc_exact(out_len, err);
+    if (!hdr)
+        return NULL;
+
+    sl__json_escape_into(hdr->data, src->data, src->len);
+    return sl__finish(hdr, err);
+}
+
+/**
+ * Append the JSON-escaped form of `src` to `dst`
+ *
+ * The escaped bytes are written straight into the spare capacity of `dst`,
+ * which is reallocated at most once (exactly, like `sl_append_cstr`).
+ * Only the appended bytes are hashed.
+ *
+ * @param dst The dynamic string to append to. Must be a valid `sl_str`.
+ * @param src The string to escape (it can be `dst` itself)
+ * @param err Pointer to an `sl_err` variable, can be NULL.
+ * @return The (possibly reallocated) `dst`.
+ *         If an error occurs, the original string is returned unchanged and `err` is set.
+ */
+sl_str sl_append_json_escaped(sl_str dst, sl_str src, sl_err *err) {
+    sl_hdr *hdr, *src_hdr;
+    sl_err e = sl__validate_mut(dst, &hdr);
+    if (e == SL_OK)
+        e = sl__validate(src, &src_hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return dst;
+    }
+
+    size_t src_len = src_hdr->len;
+    size_t extra = sl__json_escaped_len(src_hdr->data, src_len);
+    if (extra > SIZE_MAX - 1 - hdr->len) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return dst;
+    }
+
+    size_t new_len = hdr->len + extra;
+    if (new_len + 1 > hdr->cap) {
+        // `src` may be `dst`: the reallocation would move it
+        bool self = src_hdr == hdr;
+        sl_hdr *new_hdr = sl__hdr_realloc(hdr, new_len + 1, err);
+        if (!new_hdr)
+            return dst;
+        hdr = new_hdr;
+        hdr->cap = new_len + 1;
+        if (self)
+            src_hdr = hdr;
+    }
+
+    sl__json_escape_into(hdr->data + hdr->len, src_hdr->data, src_len);
+    hdr->hash = sl__hash_continue(hdr->hash, hdr->data + hdr->len, extra);
+    hdr->flags &= ~SL_HDR_CRC;
+    hdr->len = new_len;
+    hdr->data[new_len] = '\0';
+
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+/**
+ * Append the UTF-8 encoding of a code point, returns the number of bytes
+ */
+static size_t sl__utf8_put(char *out, uint32_t cp) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xC0 | cp >> 6);
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xE0 | cp >> 12);
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | cp >> 18);
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * Parse the 4 hex digits of a \u escape, returns -1 if they are not valid
+ */
+static long sl__json_hex4(const char *p) {
+    long v = 0;
+    for (int i = 0; i < 4; i++) {
+        int d = sl__hex_value((unsigned char)p[i]);
+        if (d < 0)
+            return -1;
+        v = v << 4 | d;
+    }
+    return v;
+}
+
+/**
+ * Decode the escape sequences of a JSON string literal (without the quotes)
+ *
+ * Supports every JSON escape, \u escapes are written as UTF-8 and
+ * surrogate pairs (\uD83D\uDE00) are combined into one code point.
+ * Unescaped runs are located with memchr and copied with memcpy.
+ * The output is never longer than the input, so it is allocated once.
+ *
+ * @param str The escaped text
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_FORMAT` for an unknown escape, bad hex digits or
+ *            an unpaired surrogate)
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_json_unescape(sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__alloc_exact(src->len, err);
+    if (!hdr)
+        return NULL;
+
+    const char *in = src->data;
+    const char *end = in + src->len;
+    char *out = hdr->data;
+
+    while (in < end) {
+        const char *bs = memchr(in, '\\', (size_t)(end - in));
+        size_t run = bs ? (size_t)(bs - in) : (size_t)(end - in);
+        memcpy(out, in, run);
+        out += run;
+        in += run;
+        if (!bs)
+            break;
+
+        if (end - in < 2)
+            goto bad;
+
+        char c = in[1];
+        in += 2;
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            *out++ = c;
+            break;
+        case 'b':
+            *out++ = '\b';
+            break;
+        case 'f':
+            *out++ = '\f';
+            break;
+        case 'n':
+            *out++ = '\n';
+            break;
+        case 'r':
+            *out++ = '\r';
+            break;
+        case 't':
+            *out++ = '\t';
+            break;
+        case 'u': {
+            if (end - in < 4)
+                goto bad;
+            long cp = sl__json_hex4(in);
+            in += 4;
+            if (cp < 0 || (cp >= 0xDC00 && cp <= 0xDFFF))
+                goto bad;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                // high surrogate: a low surrogate must follow
+                if (end - in < 6 || in[0] != '\\' || in[1] != 'u')
+                    goto bad;
+                long lo = sl__json_hex4(in + 2);
+                if (lo < 0xDC00 || lo > 0xDFFF)
+                    goto bad;
+                in += 6;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            }
+
+            out += sl__utf8_put(out, (uint32_t)cp);
+            break;
+        }
+        default:
+            goto bad;
+        }
+    }
+
+    hdr->len = (size_t)(out - hdr->data);
+    hdr->data[hdr->len] = '\0';
+    return sl__finish(hdr, err);
+
+bad:
+    free(hdr);
+    sl__set_err(err, SL_ERR_FORMAT);
+    return NULL;
+}
+
+
+// URL / HTML
+
+#if defined(__SSE2__)
+/**
+ * Bit mask of the bytes of a 16-byte block that are in [lo, hi]
+ * (signed compares: bytes >= 0x80 are never in an ASCII range)
+ */
+static inline __m128i sl__in_range16(__m128i v, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8((char)(lo - 1))),
+                         _mm_cmpgt_epi8(_mm_set1_epi8((char)(hi + 1)), v));
+}
+
+/**
+ * Bit mask of the bytes that must be percent-encoded in a 16-byte block
+ * (everything except the RFC 3986 unreserved set A-Z a-z 0-9 - . _ ~)
+ */
+static inline unsigned sl__url_mask16(const char *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i keep = _mm_or_si128(_mm_or_si128(sl__in_range16(v, 'A', 'Z'), sl__in_range16(v, 'a', 'z')),
+                                sl__in_range16(v, '0', '9'));
+    keep = _mm_or_si128(keep, _mm_cmpeq_epi8(v, _mm_set1_epi8('-')));
+    keep = _mm_or_si128(keep, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    keep = _mm_or_si128(keep, _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    keep = _mm_or_si128(keep, _mm_cmpeq_epi8(v, _mm_set1_epi8('~')));
+    return ~(unsigned)_mm_movemask_epi8(keep) & 0xFFFFu;
+}
+
+/**
+ * Bit mask of the bytes that must be HTML-escaped in a 16-byte block
+ */
+static inline unsigned sl__html_mask16(const char *p) {
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i m = _mm_cmpeq_epi8(v, _mm_set1_epi8('&'));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('"')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('\'')));
+    return (unsigned)_mm_movemask_epi8(m);
+}
+#endif
+
+static inline bool sl__url_unreserved(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' ||
+           c == '.' || c == '_' || c == '~';
+}
+
+/**
+ * Length of the run of bytes that do not need percent-encoding
+ */
+static size_t sl__url_clean_run(const char *p, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = sl__url_mask16(p + i);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < len && sl__url_unreserved((unsigned char)p[i]))
+        i++;
+    return i;
+}
+
+/**
+ * HTML entity of a byte, or NULL if the byte is copied as is
+ */
+static inline const char *sl__html_entity(unsigned char c) {
+    switch (c) {
+    case '&':
+        return "&amp;";
+    case '<':
+        return "&lt;";
+    case '>':
+        return "&gt;";
+    case '"':
+        return "&quot;";
+    case '\'':
+        return "&#39;";
+    default:
+        return NULL;
+    }
+}
+
+/**
+ * Length of the run of bytes that do not need HTML escaping
+ */
+static size_t sl__html_clean_run(const char *p, size_t len) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= len; i += 16) {
+        unsigned mask = sl__html_mask16(p + i);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    while (i < len && !sl__html_entity((unsigned char)p[i]))
+        i++;
+    return i;
+}
+
+/**
+ * Percent-encode a string (RFC 3986)
+ *
+ * Every byte outside the unreserved set (A-Z a-z 0-9 - . _ ~) becomes %XX
+ * (uppercase hex). A counting pass sizes the output exactly, unchanged runs
+ * are found 16 bytes at a time (SSE2 when available) and copied with memcpy.
+ *
+ * @param str The string to encode (binary data allowed)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_url_encode(sl_str str, sl_err *err) {
+    static const char upper_hex[] = "0123456789ABCDEF";
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    const char *in = src->data;
+    size_t len = src->len;
+
+    // counting pass
+    size_t out_len = len;
+    for (size_t i = 0; i < len;) {
+        i += sl__url_clean_run(in + i, len - i);
+        if (i < len) {
+            out_len += 2;
+            i++;
+        }
+    }
+
+    sl_hdr *hdr = sl__alloc_exact(out_len, err);
+    if (!hdr)
+        return NULL;
+
+    char *out = hdr->data;
+    for (size_t i = 0; i < len;) {
+        size_t run = sl__url_clean_run(in + i, len - i);
+        memcpy(out, in + i, run);
+        out += run;
+        i += run;
+        if (i < len) {
+            unsigned char c = (unsigned char)in[i++];
+            *out++ = '%';
+            *out++ = upper_hex[c >> 4];
+            *out++ = upper_hex[c & 0x0F];
+        }
+    }
+
+    return sl__finish(hdr, err);
+}
+
+/**
+ * Decode the %XX escapes of a percent-encoded string
+ *
+ * '+' is left unchanged (it only means space in HTML form bodies).
+ * The output is never longer than the input, so it is allocated once;
+ * runs between escapes are located with memchr and copied with memcpy.
+ *
+ * @param str The encoded text
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_FORMAT` if a '%' is not followed by two hex digits)
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_url_decode(sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__alloc_exact(src->len, err);
+    if (!hdr)
+        return NULL;
+
+    const char *in = src->data;
+    const char *end = in + src->len;
+    char *out = hdr->data;
+
+    while (in < end) {
+        const char *pct = memchr(in, '%', (size_t)(end - in));
+        size_t run = pct ? (size_t)(pct - in) : (size_t)(end - in);
+        memcpy(out, in, run);
+        out += run;
+        in += run;
+        if (!pct)
+            break;
+
+        int hi = end - in >= 3 ? sl__hex_value((unsigned char)in[1]) : -1;
+        int lo = end - in >= 3 ? sl__hex_value((unsigned char)in[2]) : -1;
+        if (hi < 0 || lo < 0) {
+            free(hdr);
+            sl__set_err(err, SL_ERR_FORMAT);
+            return NULL;
+        }
+
+        *out++ = (char)(hi << 4 | lo);
+        in += 3;
+    }
+
+    hdr->len = (size_t)(out - hdr->data);
+    hdr->data[hdr->len] = '\0';
+    return sl__finish(hdr, err);
+}
+
+/**
+ * Escape a string for HTML text and attribute values
+ *
+ * & < > " ' become &amp; &lt; &gt; &quot; &#39;. A counting pass sizes the
+ * output exactly, unchanged runs are found 16 bytes at a time (SSE2 when
+ * available) and copied with memcpy.
+ *
+ * @param str The string to escape
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_html_escape(sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    const char *in = src->data;
+    size_t len = src->len;
+
+    // counting pass
+    size_t out_len = len;
+    for (size_t i = 0; i < len;) {
+        i += sl__html_clean_run(in + i, len - i);
+        if (i < len)
+            out_len += strlen(sl__html_entity((unsigned char)in[i++])) - 1;
+    }
+
+    sl_hdr *hdr = sl__alloc_exact(out_len, err);
+    if (!hdr)
+        return NULL;
+
+    char *out = hdr->data;
+    for (size_t i = 0; i < len;) {
+        size_t run = sl__html_clean_run(in + i, len - i);
+        memcpy(out, in + i, run);
+        out += run;
+        i += run;
+        if (i < len) {
+            const char *entity = sl__html_entity((unsigned char)in[i++]);
+            size_t entity_len = strlen(entity);
+            memcpy(out, entity, entity_len);
+            out += entity_len;
+        }
+    }
+
+    return sl__finish(hdr, err);
+}
+
+
+// CRC32C
+
+/*
+ * CRC-32C (Castagnoli), the checksum of iSCSI, ext4 and most storage formats.
+ * x86-64 CPUs with SSE4.2 compute it with the `crc32` instruction (picked at
+ * runtime like the AVX2 kernels), other platforms use a nibble table.
+ * The "raw" CRC below is the register without the initial/final inversion.
+ */
+#define SL_CRC32C_POLY 0x82F63B78u // reflected polynomial
+
+#if defined(SL_HAVE_AVX2_KERNELS) && defined(__x86_64__)
+#define SL_HAVE_CRC32C_KERNELS 1
+
+static bool sl__cpu_has_sse42(void) {
+    static _Atomic int cached = -1; // same first-call race as `sl__cpu_has_avx2`
+    int has = atomic_load_explicit(&cached, memory_order_relaxed);
+    if (has < 0) {
+        __builtin_cpu_init();
+        has = __builtin_cpu_supports("sse4.2") ? 1 : 0;
+        atomic_store_explicit(&cached, has, memory_order_relaxed);
+    }
+    return has == 1;
+}
+#endif
+
+static const uint32_t SL_CRC32C_NIBBLE[16] = {
+    0x00000000, 0x105EC76F, 0x20BD8EDE, 0x30E349B1, 0x417B1DBC, 0x5125DAD3, 0x61C69362, 0x7198540D,
+    0x82F63B78, 0x92A8FC17, 0xA24BB5A6, 0xB21572C9, 0xC38D26C4, 0xD3D3E1AB, 0xE330A81A, 0xF36E6F75,
+};
+
+static uint32_t sl__crc32c_raw_scalar(uint32_t crc, const unsigned char *p, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        crc = (crc >> 4) ^ SL_CRC32C_NIBBLE[crc & 0x0F];
+        crc = (crc >> 4) ^ SL_CRC32C_NIBBLE[crc & 0x0F];
+    }
+    return crc;
+}
+
+#ifdef SL_HAVE_CRC32C_KERNELS
+/**
+ * Multiply two polynomials modulo the CRC32C polynomial (reflected bit order)
+ */
+static uint32_t sl__crc32c_mulmod(uint32_t a, uint32_t b) {
+    uint32_t prod = 0;
+    for (uint32_t m = 1u << 31; m; m >>= 1) {
+        if (a & m)
+            prod ^= b;
+        b = (b & 1) ? (b >> 1) ^ SL_CRC32C_POLY : b >> 1;
+    }
+    return prod;
+}
+
+/**
+ * x^(8n) modulo the CRC32C polynomial: multiplying a raw CRC by it has the
+ * same effect as feeding `n` zero bytes
+ */
+static uint32_t sl__crc32c_shift_const(size_t n) {
+    uint32_t result = 1u << 31; // x^0
+    uint32_t sq = 1u << 23;     // x^8
+    for (; n; n >>= 1) {
+        if (n & 1)
+            result = sl__crc32c_mulmod(sq, result);
+        sq = sl__crc32c_mulmod(sq, sq);
+    }
+    return result;
+}
+
+// bytes per lane of the interleaved loop
+#define SL_CRC32C_LANE 8192
+
+/**
+ * Raw CRC32C with the SSE4.2 `crc32` instruction
+ *
+ * The instruction has a latency of 3 cycles but a throughput of 1 per cycle,
+ * so large inputs are processed as three independent lanes of
+ * `SL_CRC32C_LANE` bytes; the lane results are merged by shifting the first
+ * two with `sl__crc32c_mulmod` (x^(8n) is linear in the CRC register).
+ */
+__attribute__((target("sse4.2"))) static uint32_t sl__crc32c_raw_sse42(uint32_t crc, const unsigned char *p,
+                                                                        size_t len) {
+    if (len >= 3 * SL_CRC32C_LANE) {
+        uint32_t k1 = sl__crc32c_shift_const(SL_CRC32C_LANE);
+        uint32_t k2 = sl__crc32c_shift_const(2 * SL_CRC32C_LANE);
+
+        while (len >= 3 * SL_CRC32C_LANE) {
+            uint64_t c0 = crc, c1 = 0, c2 = 0;
+            for (size_t i = 0; i < SL_CRC32C_LANE; i += 8) {
+                uint64_t w0, w1, w2;
+                memcpy(&w0, p + i, 8);
+                memcpy(&w1, p + SL_CRC32C_LANE + i, 8);
+                memcpy(&w2, p + 2 * SL_CRC32C_LANE + i, 8);
+                c0 = _mm_crc32_u64(c0, w0);
+                c1 = _mm_crc32_u64(c1, w1);
+                c2 = _mm_crc32_u64(c2, w2);
+            }
+            crc = sl__crc32c_mulmod(k2, (uint32_t)c0) ^ sl__crc32c_mulmod(k1, (uint32_t)c1) ^ (uint32_t)c2;
+            p += 3 * SL_CRC32C_LANE;
+            len -= 3 * SL_CRC32C_LANE;
+        }
+    }
+
+    uint64_t c = crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c = _mm_crc32_u64(c, w);
+    }
+    crc = (uint32_t)c;
+    for (; len; p++, len--)
+        crc = _mm_crc32_u8(crc, *p);
+    return crc;
+}
+
+/**
+ * FNV-1a hash and raw CRC32C in the same pass
+ *
+ * FNV-1a is bound by the latency of its multiply, so the `crc32` of each
+ * word runs in its shadow and the checksum is almost free.
+ */
+__attribute__((target("sse4.2"))) static uint64_t sl__hash_crc32c_sse42(const unsigned char *p, size_t len,
+                                                                         uint32_t *crc) {
+    uint64_t hash = FNV_OFFSET;
+    uint64_t c = *crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c = _mm_crc32_u64(c, w);
+        for (int i = 0; i < 8; i++) {
+            hash ^= p[i];
+            hash *= FNV_PRIME;
+        }
+    }
+    *crc = (uint32_t)c;
+    for (; len; p++, len--) {
+        *crc = _mm_crc32_u8(*crc, *p);
+        hash ^= *p;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+#endif
+
+static uint32_t sl__crc32c_raw(uint32_t crc, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+#ifdef SL_HAVE_CRC32C_KERNELS
+    if (sl__cpu_has_sse42())
+        return sl__crc32c_raw_sse42(crc, p, len);
+#endif
+    return sl__crc32c_raw_scalar(crc, p, len);
+}
+
+static uint32_t sl__crc32c(const void *data, size_t len) {
+    return ~sl__crc32c_raw(0xFFFFFFFFu, data, len);
+}
+
+/**
+ * Compute the CRC32C (Castagnoli) checksum of a generic buffer
+ *
+ * Same result as `sl_crc32c` on a string with the same bytes.
+ *
+ * @param data Pointer to the buffer (can be NULL if `len` is 0)
+ * @param len Length of the buffer in bytes
+ * @return The checksum
+ */
+uint32_t sl_compute_crc32c(const void *data, size_t len) {
+    return sl__crc32c(data, len);
+}
+
+/*
+ * The header has no room for a checksum, so the cached CRC32C lives in the
+ * last 4 bytes of the buffer. Only strings with that much spare capacity
+ * after the null terminator cache it (pack records always reserve it).
+ */
+#define SL_CRC_SLOT sizeof(uint32_t)
+
+static inline bool sl__crc_fits(const sl_hdr *hdr) {
+    return hdr->cap - hdr->len >= 1 + SL_CRC_SLOT;
+}
+
+static inline uint32_t sl__crc_load(const sl_hdr *hdr) {
+    uint32_t crc;
+    memcpy(&crc, hdr->data + hdr->cap - SL_CRC_SLOT, SL_CRC_SLOT);
+    return crc;
+}
+
+static inline void sl__crc_store(sl_hdr *hdr, uint32_t crc) {
+    memcpy(hdr->data + hdr->cap - SL_CRC_SLOT, &crc, SL_CRC_SLOT);
+    hdr->flags |= SL_HDR_CRC;
+}
+
+/**
+ * Get the CRC32C (Castagnoli) checksum of a string
+ *
+ * The checksum is computed on first use and, if the string has 4 spare
+ * bytes of capacity, cached at the end of the buffer until the string is
+ * modified, so verifying a payload twice costs one pass.
+ *
+ * @param str The string
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The checksum, or 0 on error (check `err`)
+ */
+uint32_t sl_crc32c(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+
+    sl__set_err(err, SL_OK);
+    if ((hdr->flags & SL_HDR_CRC) && sl__crc_fits(hdr))
+        return sl__crc_load(hdr);
+
+    uint32_t crc = sl__crc32c(hdr->data, hdr->len);
+    if (!(hdr->flags & SL_HDR_STATIC) && sl__crc_fits(hdr))
+        sl__crc_store(hdr, crc);
+    return crc;
+}
+
+/**
+ * Create a string from a buffer and check it against a stored CRC32C
+ *
+ * The hash and the checksum are computed in the same pass over the bytes
+ * (on CPUs with SSE4.2). The string gets 4 extra bytes of capacity so the
+ * checksum stays cached for `sl_crc32c`.
+ *
+ * @param bytes Pointer to the buffer (can be NULL if `len` is 0)
+ * @param len Length of the buffer in bytes
+ * @param expected_crc The checksum the data must have
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_FORMAT` if the checksum does not match)
+ * @return A new `sl_str` owned by the caller, or NULL on error
+ */
+sl_str sl_from_bytes_verified(const void *bytes, size_t len, uint32_t expected_crc, sl_err *err) {
+    if (!bytes && len > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    if (len > SIZE_MAX - 1 - SL_CRC_SLOT) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__hdr_alloc(NULL, len + 1 + SL_CRC_SLOT, err);
+    if (!hdr)
+        return NULL;
+
+    hdr->magic = SL_MAGIC;
+    hdr->len = len;
+    hdr->cap = len + 1 + SL_CRC_SLOT;
+    if (len > 0)
+        memcpy(hdr->data, bytes, len);
+    hdr->data[len] = '\0';
+
+    uint32_t crc = 0xFFFFFFFFu;
+#ifdef SL_HAVE_CRC32C_KERNELS
+    if (sl__cpu_has_sse42()) {
+        hdr->hash = sl__hash_crc32c_sse42((const unsigned char *)hdr->data, len, &crc);
+    } else
+#endif
+    {
+        hdr->hash = sl__compute_hash(hdr->data, len);
+        crc = sl__crc32c_raw_scalar(crc, (const unsigned char *)hdr->data, len);
+    }
+
+    crc = ~crc;
+    if (crc != expected_crc) {
+        sl__hdr_release(hdr);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl__crc_store(hdr, crc);
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+
+// PACK FILES
+
+// record alignment in pack files, shm pools and intern snapshots
+#define SL_PACK_ALIGN 8
+
+#ifdef SL_HAVE_POSIX
+/*
+ * Layout of a pack file (native byte order and word size):
+ *
+ *   sl_pack_file_hdr
+ *   record 0: sl_hdr | bytes | '\0' | padding to 8 bytes
+ *   record 1: ...
+ *   index: `count` uint64_t offsets of the record data from the file start
+ *
+ * Every record is a complete `sl_hdr` flagged SL_HDR_STATIC, so once the file
+ * is mapped `base + index[i]` is a valid read-only `sl_str`: opening is O(1)
+ * and nothing is copied or rehashed.
+ */
+#define SL_PACK_MAGIC "SLPACK1"
+#define SL_PACK_ENDIAN 0x01020304u
+#define SL_PACK_BUF (64 * 1024)
+
+typedef struct sl_pack_file_hdr {
+    char magic[8];      /**< SL_PACK_MAGIC */
+    uint32_t hdr_size;  /**< sizeof(sl_hdr) of the writer */
+    uint32_t endian;    /**< SL_PACK_ENDIAN in the writer's byte order */
+    uint64_t count;     /**< Number of strings */
+    uint64_t index_off; /**< File offset of the index */
+} sl_pack_file_hdr;
+
+/**
+ * A mapped pack file
+ */
+struct sl_pack {
+    char *base;             /**< Start of the mapping */
+    size_t size;            /**< Size of the mapping */
+    size_t count;           /**< Number of strings */
+    const uint64_t *index;  /**< Data offset of every string */
+};
+
+/**
+ * Buffered writer (records are small, so they are batched into
+ * `SL_PACK_BUF` bytes per write call)
+ */
+typedef struct sl_pack_out {
+    int fd;
+    size_t used;
+    char buf[SL_PACK_BUF];
+} sl_pack_out;
+
+static sl_err sl__write_all(int fd, const void *data, size_t len) {
+    const char *p = (const char *)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return SL_ERR_IO;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return SL_OK;
+}
+
+static sl_err sl__pack_flush(sl_pack_out *out) {
+    sl_err e = sl__write_all(out->fd, out->buf, out->used);
+    out->used = 0;
+    return e;
+}
+
+static sl_err sl__pack_put(sl_pack_out *out, const void *data, size_t len) {
+    if (len > SL_PACK_BUF - out->used) {
+        sl_err e = sl__pack_flush(out);
+        if (e != SL_OK)
+            return e;
+        if (len > SL_PACK_BUF)
+            return sl__write_all(out->fd, data, len);
+    }
+    memcpy(out->buf + out->used, data, len);
+    out->used += len;
+    return SL_OK;
+}
+
+static inline size_t sl__pack_record_size(size_t len) {
+    return (offsetof(sl_hdr, data) + len + 1 + SL_PACK_ALIGN - 1) & ~(size_t)(SL_PACK_ALIGN - 1);
+}
+
+/**
+ * Write strings to a pack file
+ *
+ * The file stores every string with its header (length, cached hash and
+ * CRC32C) so `sl_pack_open` can map it without rehashing. Writing starts at
+ * the current position of `fd`, which should be the start of the file.
+ *
+ * @param fd File descriptor open for writing
+ * @param strs Array of `n` valid strings
+ * @param n Number of strings
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_IO` if a write fails; nothing is written if a string is invalid)
+ */
+void sl_pack_write(int fd, const sl_str *strs, size_t n, sl_err *err) {
+    if (!strs && n > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    // validate everything first so a bad input never leaves half a file
+    uint64_t off = sizeof(sl_pack_file_hdr);
+    for (size_t i = 0; i < n; i++) {
+        sl_hdr *hdr;
+        sl_err e = sl__validate(strs[i], &hdr);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return;
+        }
+        off += sl__pack_record_size(hdr->len + SL_CRC_SLOT);
+    }
+
+    sl_pack_out *out = malloc(sizeof(*out));
+    if (!out) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return;
+    }
+    out->fd = fd;
+    out->used = 0;
+
+    sl_pack_file_hdr fh;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, SL_PACK_MAGIC, sizeof(fh.magic));
+    fh.hdr_size = sizeof(sl_hdr);
+    fh.endian = SL_PACK_ENDIAN;
+    fh.count = n;
+    fh.index_off = off;
+    sl_err e = sl__pack_put(out, &fh, sizeof(fh));
+
+    static const char zeros[SL_PACK_ALIGN + 1] = {0};
+    for (size_t i = 0; i < n && e == SL_OK; i++) {
+        sl_hdr *src = sl__get_hdr(strs[i]);
+        sl_hdr rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.magic = SL_MAGIC;
+        rec.flags = SL_HDR_STATIC | SL_HDR_CRC | (src->flags & SL_HDR_COMPRESSED);
+        rec.hash = src->hash;
+        rec.len = src->len;
+        rec.cap = src->len + 1 + SL_CRC_SLOT;
+        uint32_t crc = (src->flags & SL_HDR_CRC) && sl__crc_fits(src) ? sl__crc_load(src)
+                                                                      : sl__crc32c(src->data, src->len);
+
+        size_t pad = sl__pack_record_size(src->len + SL_CRC_SLOT) - offsetof(sl_hdr, data) - rec.cap;
+        e = sl__pack_put(out, &rec, offsetof(sl_hdr, data));
+        if (e == SL_OK)
+            e = sl__pack_put(out, src->data, src->len);
+        if (e == SL_OK)
+            e = sl__pack_put(out, zeros, 1); // null term
+        if (e == SL_OK)
+            e = sl__pack_put(out, &crc, SL_CRC_SLOT);
+        if (e == SL_OK)
+            e = sl__pack_put(out, zeros, pad);
+    }
+
+    off = sizeof(sl_pack_file_hdr);
+    for (size_t i = 0; i < n && e == SL_OK; i++) {
+        uint64_t data_off = off + offsetof(sl_hdr, data);
+        e = sl__pack_put(out, &data_off, sizeof(data_off));
+        off += sl__pack_record_size(sl__get_hdr(strs[i])->len + SL_CRC_SLOT);
+    }
+
+    if (e == SL_OK)
+        e = sl__pack_flush(out);
+
+    free(out);
+    sl__set_err(err, e);
+}
+
+/**
+ * Map a pack file written by `sl_pack_write`
+ *
+ * The file is mapped read-only and only its header is checked, so opening
+ * takes the same time for ten strings or ten million. Pages are loaded
+ * lazily by the OS and shared between processes mapping the same file.
+ *
+ * @param path Path of the file
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_IO` if the file cannot be opened or mapped,
+ *            `SL_ERR_FORMAT` if it is not a pack file of this platform)
+ * @return The pack, to be closed with `sl_pack_close`, or NULL on error
+ */
+sl_pack *sl_pack_open(const char *path, sl_err *err) {
+    if (!path) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(sl_pack_file_hdr)) {
+        close(fd);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if (base == MAP_FAILED) {
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    const sl_pack_file_hdr *fh = (const sl_pack_file_hdr *)base;
+    size_t data_size = size - sizeof(*fh);
+    if (memcmp(fh->magic, SL_PACK_MAGIC, sizeof(fh->magic)) != 0 || fh->hdr_size != sizeof(sl_hdr) ||
+        fh->endian != SL_PACK_ENDIAN || fh->index_off % SL_PACK_ALIGN != 0 ||
+        fh->index_off < sizeof(*fh) || fh->index_off > size ||
+        fh->count > data_size / (sizeof(uint64_t) + sl__pack_record_size(0)) ||
+        fh->count * sizeof(uint64_t) != size - fh->index_off) {
+        munmap(base, size);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl_pack *pack = malloc(sizeof(*pack));
+    if (!pack) {
+        munmap(base, size);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    pack->base = base;
+    pack->size = size;
+    pack->count = (size_t)fh->count;
+    pack->index = (const uint64_t *)((char *)base + fh->index_off);
+
+    sl__set_err(err, SL_OK);
+    return pack;
+}
+
+/**
+ * Unmap a pack file
+ *
+ * Every string obtained from the pack becomes invalid.
+ *
+ * @param pack Pointer to the pack variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_pack_close(sl_pack **pack, sl_err *err) {
+    if (!pack || !*pack) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    munmap((*pack)->base, (*pack)->size);
+    free(*pack);
+    *pack = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Number of strings in a pack
+ */
+size_t sl_pack_count(const sl_pack *pack, sl_err *err) {
+    if (!pack) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+
+    sl__set_err(err, SL_OK);
+    return pack->count;
+}
+
+/**
+ * Get the `i`-th string of a pack
+ *
+ * The result is a read-only `sl_str` pointing into the mapping: every
+ * function that reads strings accepts it, functions that modify a string
+ * in place fail with `SL_ERR_READONLY`, and `sl_free` only clears the
+ * variable. It is valid until `sl_pack_close`.
+ *
+ * @param pack The pack
+ * @param i Index of the string (in write order)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_FORMAT` if the record is damaged)
+ * @return The string, or NULL on error
+ */
+sl_str sl_pack_get(const sl_pack *pack, size_t i, sl_err *err) {
+    if (!pack) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    if (i >= pack->count) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return NULL;
+    }
+
+    // cheap bounds checks, so a damaged file can't send reads outside the mapping
+    uint64_t off = pack->index[i];
+    size_t data_end = (size_t)((const char *)pack->index - pack->base);
+    if (off < sizeof(sl_pack_file_hdr) + offsetof(sl_hdr, data) || off >= data_end || off % SL_PACK_ALIGN != 0) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl_hdr *hdr = (sl_hdr *)(pack->base + off - offsetof(sl_hdr, data));
+    if (hdr->magic != SL_MAGIC || !(hdr->flags & SL_HDR_STATIC) || hdr->len >= data_end - off ||
+        hdr->cap <= hdr->len || hdr->cap > data_end - off) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+#endif
+
+
+// SHARED MEMORY POOL
+
+#ifdef SL_HAVE_POSIX
+/*
+ * A pool is one shared memory object (memfd on Linux, an unlinked shm_open
+ * object elsewhere) laid out as:
+ *
+ *   sl_shm_file_hdr
+ *   record 0: sl_hdr | bytes | '\0' | padding to 8 bytes (like a pack file)
+ *   record 1: ...
+ *
+ * Records never store pointers, so every process can map the object at any
+ * address. `used` is published with release semantics after a record is
+ * complete; readers only look at records below the `used` they loaded.
+ * The hash index is private to each process and is built from the cached
+ * `hdr->hash` of every record, without reading the bytes.
+ */
+#define SL_SHM_MAGIC "SLSHM1"
+
+typedef struct sl_shm_file_hdr {
+    char magic[8];     /**< SL_SHM_MAGIC */
+    uint32_t hdr_size; /**< sizeof(sl_hdr) of the creator */
+    uint32_t endian;   /**< SL_PACK_ENDIAN in the creator's byte order */
+    uint64_t size;     /**< Size of the shared object */
+    uint64_t used;     /**< End of the last complete record */
+} sl_shm_file_hdr;
+
+/**
+ * Process-local view of a shared pool
+ */
+struct sl_shm_pool {
+    char *base;       /**< Start of the mapping */
+    size_t size;      /**< Size of the mapping */
+    int fd;           /**< Shared object (-1 for attached pools) */
+    bool writable;    /**< Created by this process */
+    size_t indexed;   /**< Records below this offset are in the index */
+    size_t count;     /**< Number of indexed strings */
+    uint64_t *slots;  /**< Open addressing table of record offsets (0 = empty) */
+    size_t slot_mask; /**< Number of slots - 1 (power of 2) */
+};
+
+#define SL_SHM_MIN_SLOTS 64
+
+static inline sl_hdr *sl__shm_rec(const sl_shm_pool *pool, uint64_t off) {
+    return (sl_hdr *)(pool->base + off);
+}
+
+static void sl__shm_slot_put(uint64_t *slots, size_t mask, uint64_t hash, uint64_t off) {
+    size_t i = (size_t)hash & mask;
+    while (slots[i])
+        i = (i + 1) & mask;
+    slots[i] = off;
+}
+
+/**
+ * Add a record to the local index (the table is kept at most half full)
+ */
+static sl_err sl__shm_index_add(sl_shm_pool *pool, uint64_t off) {
+    if (pool->count + 1 > (pool->slot_mask + 1) / 2) {
+        size_t new_slots = (pool->slot_mask + 1) * 2;
+        uint64_t *grown = calloc(new_slots, sizeof(*grown));
+        if (!grown)
+            return SL_ERR_ALLOC;
+
+        for (size_t i = 0; i <= pool->slot_mask; i++) {
+            if (pool->slots[i])
+                sl__shm_slot_put(grown, new_slots - 1, sl__shm_rec(pool, pool->slots[i])->hash, pool->slots[i]);
+        }
+        free(pool->slots);
+        pool->slots = grown;
+        pool->slot_mask = new_slots - 1;
+    }
+
+    sl__shm_slot_put(pool->slots, pool->slot_mask, sl__shm_rec(pool, off)->hash, off);
+    pool->count++;
+    return SL_OK;
+}
+
+static sl_hdr *sl__shm_lookup(const sl_shm_pool *pool, uint64_t hash, const void *bytes, size_t len) {
+    for (size_t i = (size_t)hash & pool->slot_mask; pool->slots[i]; i = (i + 1) & pool->slot_mask) {
+        sl_hdr *hdr = sl__shm_rec(pool, pool->slots[i]);
+        if (hdr->hash == hash && hdr->len == len && (len == 0 || memcmp(hdr->data, bytes, len) == 0))
+            return hdr;
+    }
+    return NULL;
+}
+
+static sl_shm_pool *sl__shm_pool_alloc(void) {
+    sl_shm_pool *pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pool->slots = calloc(SL_SHM_MIN_SLOTS, sizeof(*pool->slots));
+    if (!pool->slots) {
+        free(pool);
+        return NULL;
+    }
+    pool->slot_mask = SL_SHM_MIN_SLOTS - 1;
+    pool->fd = -1;
+    return pool;
+}
+
+static void sl__shm_pool_release(sl_shm_pool *pool) {
+    if (pool->base)
+        munmap(pool->base, pool->size);
+    if (pool->fd >= 0)
+        close(pool->fd);
+    free(pool->slots);
+    free(pool);
+}
+
+/**
+ * Create an anonymous shared memory object of `size` bytes
+ */
+static int sl__shm_create(size_t size) {
+    int fd;
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+    fd = memfd_create("sl_shm_pool", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+    char name[64];
+    static unsigned seq;
+    for (int attempt = 0;; attempt++) {
+        snprintf(name, sizeof(name), "/sl_shm_pool.%ld.%u", (long)getpid(), seq++);
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd >= 0 || errno != EEXIST || attempt == 16)
+            break;
+    }
+    if (fd >= 0)
+        shm_unlink(name); // only the descriptor keeps it alive
+#endif
+    if (fd < 0)
+        return -1;
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        close(fd);
+        return -1;
+    }
+
+#if defined(F_ADD_SEALS) && defined(F_SEAL_SHRINK) && defined(F_SEAL_GROW)
+    // no process can resize the object under the others' mappings
+    (void)fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW);
+#endif
+    return fd;
+}
+
+/**
+ * Create a shared string pool
+ *
+ * The pool has a fixed size chosen at creation (the memory is only
+ * committed as it is used). Strings are added by the creating process;
+ * other processes get the descriptor (inherited through `fork`, or sent
+ * over a Unix socket) and call `sl_shm_pool_attach`.
+ *
+ * @param size Bytes of shared memory, including a small header and
+ *             about 40 bytes of overhead per string
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_IO` if the shared object cannot be created or mapped)
+ * @return The pool, or NULL on error
+ */
+sl_shm_pool *sl_shm_pool_new(size_t size, sl_err *err) {
+    if (size < sizeof(sl_shm_file_hdr))
+        size = sizeof(sl_shm_file_hdr);
+    size = (size + SL_PACK_ALIGN - 1) & ~(size_t)(SL_PACK_ALIGN - 1);
+
+    sl_shm_pool *pool = sl__shm_pool_alloc();
+    if (!pool) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    pool->fd = sl__shm_create(size);
+    if (pool->fd < 0) {
+        sl__shm_pool_release(pool);
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, pool->fd, 0);
+    if (base == MAP_FAILED) {
+        sl__shm_pool_release(pool);
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    pool->base = base;
+    pool->size = size;
+    pool->writable = true;
+    pool->indexed = sizeof(sl_shm_file_hdr);
+
+    sl_shm_file_hdr *fh = (sl_shm_file_hdr *)base;
+    memcpy(fh->magic, SL_SHM_MAGIC, sizeof(SL_SHM_MAGIC));
+    fh->hdr_size = sizeof(sl_hdr);
+    fh->endian = SL_PACK_ENDIAN;
+    fh->size = size;
+    __atomic_store_n(&fh->used, (uint64_t)sizeof(sl_shm_file_hdr), __ATOMIC_RELEASE);
+
+    sl__set_err(err, SL_OK);
+    return pool;
+}
+
+/**
+ * Index the records published since the last call
+ */
+static sl_err sl__shm_pool_catch_up(sl_shm_pool *pool) {
+    const sl_shm_file_hdr *fh = (const sl_shm_file_hdr *)pool->base;
+    uint64_t used = __atomic_load_n(&fh->used, __ATOMIC_ACQUIRE);
+    if (used > pool->size || used % SL_PACK_ALIGN != 0)
+        return SL_ERR_FORMAT;
+
+    size_t off = pool->indexed;
+    while (off < used) {
+        if (used - off < offsetof(sl_hdr, data))
+            return SL_ERR_FORMAT;
+
+        sl_hdr *hdr = (sl_hdr *)(pool->base + off);
+        if (hdr->magic != SL_MAGIC || !(hdr->flags & SL_HDR_STATIC) ||
+            hdr->len >= used - off - offsetof(sl_hdr, data))
+            return SL_ERR_FORMAT;
+
+        sl_err e = sl__shm_index_add(pool, off);
+        if (e != SL_OK)
+            return e;
+
+        off += sl__pack_record_size(hdr->len);
+        pool->indexed = off;
+    }
+
+    return SL_OK;
+}
+
+/**
+ * Map a pool created by another process (read-only)
+ *
+ * The mapping address does not matter. The strings already in the pool are
+ * indexed from their cached hashes (nothing is copied or rehashed); strings
+ * the creator adds later become visible after `sl_shm_pool_refresh`.
+ *
+ * @param fd Descriptor of the pool (`sl_shm_pool_fd` in the creator).
+ *           It is not kept open, the caller can close it.
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_IO` if it cannot be mapped, `SL_ERR_FORMAT` if it is not a pool)
+ * @return The pool, or NULL on error
+ */
+sl_shm_pool *sl_shm_pool_attach(int fd, sl_err *err) {
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(sl_shm_file_hdr)) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl_shm_pool *pool = sl__shm_pool_alloc();
+    if (!pool) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        sl__shm_pool_release(pool);
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+    pool->base = base;
+    pool->size = size;
+    pool->indexed = sizeof(sl_shm_file_hdr);
+
+    const sl_shm_file_hdr *fh = (const sl_shm_file_hdr *)base;
+    if (memcmp(fh->magic, SL_SHM_MAGIC, sizeof(SL_SHM_MAGIC)) != 0 || fh->hdr_size != sizeof(sl_hdr) ||
+        fh->endian != SL_PACK_ENDIAN || fh->size != size) {
+        sl__shm_pool_release(pool);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl_err e = sl__shm_pool_catch_up(pool);
+    if (e != SL_OK) {
+        sl__shm_pool_release(pool);
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    sl__set_err(err, SL_OK);
+    return pool;
+}
+
+/**
+ * Index the strings added by the creator since `sl_shm_pool_attach`
+ * (or the previous refresh). Nothing to do in the creating process.
+ */
+void sl_shm_pool_refresh(sl_shm_pool *pool, sl_err *err) {
+    if (!pool) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    sl__set_err(err, sl__shm_pool_catch_up(pool));
+}
+
+/**
+ * Unmap a pool and free the local index
+ *
+ * Strings obtained from this handle become invalid. The shared object is
+ * destroyed when the last process unmaps it and closes its descriptor.
+ *
+ * @param pool Pointer to the pool variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_shm_pool_free(sl_shm_pool **pool, sl_err *err) {
+    if (!pool || !*pool) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl__shm_pool_release(*pool);
+    *pool = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Descriptor of the shared object, to be inherited or sent to other processes
+ *
+ * @return The descriptor, or -1 for an attached pool (or on error)
+ */
+int sl_shm_pool_fd(const sl_shm_pool *pool, sl_err *err) {
+    if (!pool) {
+        sl__set_err(err, SL_ERR_NULL);
+        return -1;
+    }
+
+    sl__set_err(err, SL_OK);
+    return pool->fd;
+}
+
+/**
+ * Add a string to the pool (only in the creating process)
+ *
+ * If the pool already holds the same bytes, that string is returned, so the
+ * pool also works as an intern table. The result is a read-only `sl_str`
+ * that lives as long as the pool mapping.
+ *
+ * @param pool The pool
+ * @param bytes The bytes of the string (can be NULL if `len` is 0)
+ * @param len Number of bytes
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_READONLY` on an attached pool, `SL_ERR_ALLOC` if the pool is full)
+ * @return The pooled string, or NULL on error
+ */
+sl_str sl_shm_pool_add(sl_shm_pool *pool, const void *bytes, size_t len, sl_err *err) {
+    if (!pool || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    if (!pool->writable) {
+        sl__set_err(err, SL_ERR_READONLY);
+        return NULL;
+    }
+
+    uint64_t hash = sl__compute_hash(bytes, len);
+    sl_hdr *hdr = sl__shm_lookup(pool, hash, bytes, len);
+    if (hdr) {
+        sl__set_err(err, SL_OK);
+        return hdr->data;
+    }
+
+    sl_shm_file_hdr *fh = (sl_shm_file_hdr *)pool->base;
+    size_t off = pool->indexed;
+    if (len > pool->size - off || sl__pack_record_size(len) > pool->size - off) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    hdr = (sl_hdr *)(pool->base + off);
+    hdr->magic = SL_MAGIC;
+    hdr->flags = SL_HDR_STATIC;
+    hdr->hash = hash;
+    hdr->len = len;
+    hdr->cap = len + 1;
+    if (len > 0)
+        memcpy(hdr->data, bytes, len);
+    hdr->data[len] = '\0';
+
+    sl_err e = sl__shm_index_add(pool, off);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    pool->indexed = off + sl__pack_record_size(len);
+    __atomic_store_n(&fh->used, (uint64_t)pool->indexed, __ATOMIC_RELEASE);
+
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+/**
+ * Find a string in the pool by content
+ *
+ * The lookup uses the process-local index: one FNV-1a pass over the key,
+ * then cached hashes and lengths are compared before any bytes.
+ *
+ * @return The pooled string, or NULL if it is not in the pool (`err` is `SL_OK`)
+ */
+sl_str sl_shm_pool_find(const sl_shm_pool *pool, const void *bytes, size_t len, sl_err *err) {
+    if (!pool || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__shm_lookup(pool, sl__compute_hash(bytes, len), bytes, len);
+    sl__set_err(err, SL_OK);
+    return hdr ? hdr->data : NULL;
+}
+
+/**
+ * Number of strings visible to this process
+ */
+size_t sl_shm_pool_count(const sl_shm_pool *pool, sl_err *err) {
+    if (!pool) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+
+    sl__set_err(err, SL_OK);
+    return pool->count;
+}
+#endif
+
+
+// INTERN TABLE
+
+/*
+ * Open addressing table of canonical strings, kept at most half full.
+ * A slot is 0 (empty), a heap string (`sl_hdr *` with bit 0 set) or, in a
+ * restored table, the offset of a record inside the snapshot mapping.
+ * Interned strings are flagged SL_HDR_STATIC: they are owned by the table.
+ */
+struct sl_intern {
+    uint64_t *slots;  /**< Slot array (heap, or inside `map` after a restore) */
+    size_t slot_mask; /**< Number of slots - 1 (power of 2) */
+    size_t count;     /**< Number of strings */
+    char *map;        /**< Snapshot mapping (NULL if not restored) */
+    size_t map_size;  /**< Size of the mapping */
+    size_t map_recs;  /**< End of the records in the mapping */
+};
+
+#define SL_INTERN_MIN_SLOTS 64
+#define SL_INTERN_HEAP 1u
+
+/** Header of a snapshot file (see `sl_intern_snapshot`) */
+typedef struct sl_intern_file_hdr {
+    char magic[8];      /**< SL_INTERN_MAGIC */
+    uint32_t hdr_size;  /**< sizeof(sl_hdr) of the writer */
+    uint32_t endian;    /**< SL_PACK_ENDIAN in the writer's byte order */
+    uint64_t count;     /**< Number of strings */
+    uint64_t slots;     /**< Number of slots (power of 2) */
+    uint64_t slots_off; /**< File offset of the slot array */
+} sl_intern_file_hdr;
+
+static inline sl_hdr *sl__intern_entry(const sl_intern *t, uint64_t v) {
+    if (v & SL_INTERN_HEAP)
+        return (sl_hdr *)(uintptr_t)(v & ~(uint64_t)SL_INTERN_HEAP);
+
+    // snapshot record: bounds checked so a damaged file can't send reads outside the mapping
+    if (v < sizeof(sl_intern_file_hdr) || v % SL_PACK_ALIGN != 0 || v > t->map_recs - offsetof(sl_hdr, data))
+        return NULL;
+    sl_hdr *hdr = (sl_hdr *)(t->map + v);
+    if (hdr->magic != SL_MAGIC || hdr->len >= t->map_recs - v - offsetof(sl_hdr, data))
+        return NULL;
+    return hdr;
+}
+
+static sl_hdr *sl__intern_lookup(const sl_intern *t, uint64_t hash, const void *bytes, size_t len,
+                                 size_t *out_slot) {
+    size_t i = (size_t)hash & t->slot_mask;
+    for (; t->slots[i]; i = (i + 1) & t->slot_mask) {
+        sl_hdr *hdr = sl__intern_entry(t, t->slots[i]);
+        if (hdr && hdr->hash == hash && hdr->len == len && (len == 0 || memcmp(hdr->data, bytes, len) == 0))
+            return hdr;
+    }
+    if (out_slot)
+        *out_slot = i;
+    return NULL;
+}
+
+/**
+ * Double the slot array, moving entries by their cached hash
+ * (a table restored from a snapshot switches to a heap array here)
+ */
+static sl_err sl__intern_grow(sl_intern *t) {
+    size_t new_slots = (t->slot_mask + 1) * 2;
+    uint64_t *grown = calloc(new_slots, sizeof(*grown));
+    if (!grown)
+        return SL_ERR_ALLOC;
+
+    for (size_t i = 0; i <= t->slot_mask; i++) {
+        uint64_t v = t->slots[i];
+        sl_hdr *hdr = v ? sl__intern_entry(t, v) : NULL;
+        if (!hdr)
+            continue;
+        size_t j = (size_t)hdr->hash & (new_slots - 1);
+        while (grown[j])
+            j = (j + 1) & (new_slots - 1);
+        grown[j] = v;
+    }
+
+    if (!t->map || (char *)t->slots < t->map || (char *)t->slots >= t->map + t->map_size)
+        free(t->slots);
+    t->slots = grown;
+    t->slot_mask = new_slots - 1;
+    return SL_OK;
+}
+
+/**
+ * Create an empty intern table
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The table, or NULL on error
+ */
+sl_intern *sl_intern_new(sl_err *err) {
+    sl_intern *t = calloc(1, sizeof(*t));
+    if (!t) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    t->slots = calloc(SL_INTERN_MIN_SLOTS, sizeof(*t->slots));
+    if (!t->slots) {
+        free(t);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    t->slot_mask = SL_INTERN_MIN_SLOTS - 1;
+
+    sl__set_err(err, SL_OK);
+    return t;
+}
+
+/**
+ * Free an intern table and all its strings
+ *
+ * @param t Pointer to the table variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_intern_free(sl_intern **t, sl_err *err) {
+    if (!t || !*t) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl_intern *tab = *t;
+    bool slots_in_map = tab->map && (char *)tab->slots >= tab->map && (char *)tab->slots < tab->map + tab->map_size;
+    for (size_t i = 0; i <= tab->slot_mask; i++) {
+        if (tab->slots[i] & SL_INTERN_HEAP) {
+            sl_hdr *hdr = sl__intern_entry(tab, tab->slots[i]);
+            hdr->magic = 0;
+            free(hdr);
+        }
+    }
+
+    if (!slots_in_map)
+        free(tab->slots);
+#ifdef SL_HAVE_POSIX
+    if (tab->map)
+        munmap(tab->map, tab->map_size);
+#endif
+    free(tab);
+    *t = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+static sl_str sl__intern(sl_intern *t, uint64_t hash, const void *bytes, size_t len, sl_err *err) {
+    size_t slot;
+    sl_hdr *hdr = sl__intern_lookup(t, hash, bytes, len, &slot);
+    if (hdr) {
+        sl__set_err(err, SL_OK);
+        return hdr->data;
+    }
+
+    if (t->count + 1 > (t->slot_mask + 1) / 2) {
+        sl_err e = sl__intern_grow(t);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return NULL;
+        }
+        slot = (size_t)hash & t->slot_mask;
+        while (t->slots[slot])
+            slot = (slot + 1) & t->slot_mask;
+    }
+
+    hdr = sl__alloc_exact(len, err);
+    if (!hdr)
+        return NULL;
+
+    if (len > 0)
+        memcpy(hdr->data, bytes, len);
+    hdr->hash = hash;
+    hdr->flags |= SL_HDR_STATIC;
+
+    t->slots[slot] = (uint64_t)(uintptr_t)hdr | SL_INTERN_HEAP;
+    t->count++;
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+/**
+ * Get the canonical copy of a string, adding it if needed
+ *
+ * Equal strings always give the same pointer, so interned strings can be
+ * compared with `==`. The result is read-only and owned by the table
+ * (`sl_free` only clears the variable).
+ *
+ * @param t The table
+ * @param bytes The bytes of the string (can be NULL if `len` is 0)
+ * @param len Number of bytes
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The interned string, or NULL on error
+ */
+sl_str sl_intern_bytes(sl_intern *t, const void *bytes, size_t len, sl_err *err) {
+    if (!t || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    return sl__intern(t, sl__compute_hash(bytes, len), bytes, len, err);
+}
+
+/**
+ * Like `sl_intern_bytes`, with the content of an `sl_str`
+ *
+ * The cached hash of `str` is reused, so nothing is rehashed.
+ */
+sl_str sl_intern_str(sl_intern *t, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = t ? sl__validate(str, &hdr) : SL_ERR_NULL;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    return sl__intern(t, hdr->hash, hdr->data, hdr->len, err);
+}
+
+/**
+ * Find the interned copy of a string without adding it
+ *
+ * @return The interned string, or NULL if it is not in the table (`err` is `SL_OK`)
+ */
+sl_str sl_intern_find(const sl_intern *t, const void *bytes, size_t len, sl_err *err) {
+    if (!t || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__intern_lookup(t, sl__compute_hash(bytes, len), bytes, len, NULL);
+    sl__set_err(err, SL_OK);
+    return hdr ? hdr->data : NULL;
+}
+
+/**
+ * Number of strings in an intern table
+ */
+size_t sl_intern_count(const sl_intern *t, sl_err *err) {
+    if (!t) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+
+    sl__set_err(err, SL_OK);
+    return t->count;
+}
+
+#ifdef SL_HAVE_POSIX
+/*
+ * Layout of a snapshot (native byte order and word size):
+ *
+ *   sl_intern_file_hdr
+ *   records, like a pack file (sl_hdr flagged SL_HDR_STATIC | bytes | '\0' | padding)
+ *   slot array: the table layout, with record offsets instead of pointers
+ *
+ * Restoring maps the file copy-on-write and uses the slot array in place:
+ * no string is allocated, copied or hashed.
+ */
+#define SL_INTERN_MAGIC "SLINTRN"
+
+/**
+ * Flush the directory entry of `path` (after a rename) to disk
+ */
+static sl_err sl__fsync_dir(const char *path) {
+    const char *slash = strrchr(path, '/');
+    char *dir = slash ? malloc((size_t)(slash - path) + 2) : NULL;
+    if (slash && !dir)
+        return SL_ERR_ALLOC;
+    if (dir) {
+        size_t n = slash == path ? 1 : (size_t)(slash - path);
+        memcpy(dir, path, n);
+        dir[n] = '\0';
+    }
+
+    int fd = open(dir ? dir : ".", O_RDONLY);
+    free(dir);
+    if (fd < 0)
+        return SL_ERR_IO;
+    sl_err e = fsync(fd) == 0 ? SL_OK : SL_ERR_IO;
+    close(fd);
+    return e;
+}
+
+/**
+ * Write an intern table to a snapshot file
+ *
+ * The file is written next to `path`, synced, and renamed over it when
+ * complete (then the directory is synced), so a crash leaves either the old
+ * or the new snapshot, never a truncated one.
+ *
+ * @param t The table
+ * @param path Path of the snapshot
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_IO` if the file cannot be written)
+ */
+void sl_intern_snapshot(const sl_intern *t, const char *path, sl_err *err) {
+    if (!t || !path) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    size_t path_len = strlen(path);
+    char *tmp = malloc(path_len + 5);
+    sl_pack_out *out = malloc(sizeof(*out));
+    if (!tmp || !out) {
+        free(tmp);
+        free(out);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return;
+    }
+    memcpy(tmp, path, path_len);
+    memcpy(tmp + path_len, ".tmp", 5);
+
+    out->fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    out->used = 0;
+    if (out->fd < 0) {
+        free(tmp);
+        free(out);
+        sl__set_err(err, SL_ERR_IO);
+        return;
+    }
+
+    size_t nslots = t->slot_mask + 1;
+    uint64_t off = sizeof(sl_intern_file_hdr);
+    for (size_t i = 0; i < nslots; i++) {
+        sl_hdr *hdr = t->slots[i] ? sl__intern_entry(t, t->slots[i]) : NULL;
+        if (hdr)
+            off += sl__pack_record_size(hdr->len);
+    }
+
+    sl_intern_file_hdr fh;
+    memset(&fh, 0, sizeof(fh));
+    memcpy(fh.magic, SL_INTERN_MAGIC, sizeof(fh.magic));
+    fh.hdr_size = sizeof(sl_hdr);
+    fh.endian = SL_PACK_ENDIAN;
+    fh.count = t->count;
+    fh.slots = nslots;
+    fh.slots_off = off;
+    sl_err e = sl__pack_put(out, &fh, sizeof(fh));
+
+    // records in slot order, so the slot pass below can recompute their offsets
+    static const char zeros[SL_PACK_ALIGN + 1] = {0};
+    for (size_t i = 0; i < nslots && e == SL_OK; i++) {
+        sl_hdr *src = t->slots[i] ? sl__intern_entry(t, t->slots[i]) : NULL;
+        if (!src)
+            continue;
+
+        sl_hdr rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.magic = SL_MAGIC;
+        rec.flags = SL_HDR_STATIC;
+        rec.hash = src->hash;
+        rec.len = src->len;
+        rec.cap = src->len + 1;
+
+        size_t pad = sl__pack_record_size(src->len) - offsetof(sl_hdr, data) - src->len;
+        e = sl__pack_put(out, &rec, offsetof(sl_hdr, data));
+        if (e == SL_OK)
+            e = sl__pack_put(out, src->data, src->len);
+        if (e == SL_OK)
+            e = sl__pack_put(out, zeros, pad);
+    }
+
+    off = sizeof(sl_intern_file_hdr);
+    for (size_t i = 0; i < nslots && e == SL_OK; i++) {
+        sl_hdr *hdr = t->slots[i] ? sl__intern_entry(t, t->slots[i]) : NULL;
+        uint64_t v = 0;
+        if (hdr) {
+            v = off;
+            off += sl__pack_record_size(hdr->len);
+        }
+        e = sl__pack_put(out, &v, sizeof(v));
+    }
+
+    if (e == SL_OK)
+        e = sl__pack_flush(out);
+    if (e == SL_OK && fsync(out->fd) != 0)
+        e = SL_ERR_IO;
+    if (close(out->fd) != 0 && e == SL_OK)
+        e = SL_ERR_IO;
+    if (e == SL_OK && rename(tmp, path) != 0)
+        e = SL_ERR_IO;
+    if (e != SL_OK)
+        unlink(tmp);
+    else
+        e = sl__fsync_dir(path);
+
+    free(tmp);
+    free(out);
+    sl__set_err(err, e);
+}
+
+/**
+ * Restore an intern table from a snapshot with a single mmap
+ *
+ * The strings and the slot array are used in place (copy-on-write), so
+ * startup does no per-string allocation or hashing. The restored table is
+ * a normal table: new strings can be added and it can be snapshotted again.
+ *
+ * @param path Path of the snapshot
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_IO` if the file cannot be opened or mapped,
+ *            `SL_ERR_FORMAT` if it is not a snapshot of this platform)
+ * @return The table, or NULL on error
+ */
+sl_intern *sl_intern_restore(const char *path, sl_err *err) {
+    if (!path) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size < sizeof(sl_intern_file_hdr)) {
+        close(fd);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        sl__set_err(err, SL_ERR_IO);
+        return NULL;
+    }
+
+    const sl_intern_file_hdr *fh = (const sl_intern_file_hdr *)base;
+    if (memcmp(fh->magic, SL_INTERN_MAGIC, sizeof(fh->magic)) != 0 || fh->hdr_size != sizeof(sl_hdr) ||
+        fh->endian != SL_PACK_ENDIAN || fh->slots < SL_INTERN_MIN_SLOTS || (fh->slots & (fh->slots - 1)) ||
+        fh->count > fh->slots / 2 || fh->slots_off % SL_PACK_ALIGN != 0 || fh->slots_off < sizeof(*fh) ||
+        fh->slots_off > size || fh->slots > (size - fh->slots_off) / sizeof(uint64_t) ||
+        fh->slots * sizeof(uint64_t) != size - fh->slots_off) {
+        munmap(base, size);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    // lookups stop at the first empty slot, so the table must really be at
+    // most half full; record offsets are aligned, so the heap bit is never set
+    const uint64_t *slots = (const uint64_t *)((const char *)base + fh->slots_off);
+    size_t used = 0;
+    for (size_t i = 0; i < fh->slots; i++) {
+        if (slots[i] & SL_INTERN_HEAP)
+            used = SIZE_MAX;
+        else if (slots[i])
+            used++;
+        if (used > fh->slots / 2)
+            break;
+    }
+    if (used != fh->count) {
+        munmap(base, size);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl_intern *t = calloc(1, sizeof(*t));
+    if (!t) {
+        munmap(base, size);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    t->map = base;
+    t->map_size = size;
+    t->map_recs = (size_t)fh->slots_off;
+    t->slots = (uint64_t *)((char *)base + fh->slots_off);
+    t->slot_mask = (size_t)fh->slots - 1;
+    t->count = (size_t)fh->count;
+
+    sl__set_err(err, SL_OK);
+    return t;
+}
+#endif
+
+
+// FRAMING
+
+/*
+ * Length-prefixed frames:
+ *   SL_FRAME_NETSTRING  <len>:<bytes>,
+ *   SL_FRAME_RESP       $<len>\r\n<bytes>\r\n   (RESP bulk string)
+ */
+typedef struct sl_frame_syntax {
+    const char *prefix;  /**< Before the length */
+    const char *sep;     /**< Between the length and the payload */
+    const char *trailer; /**< After the payload */
+} sl_frame_syntax;
+
+static const sl_frame_syntax SL_FRAME_SYNTAX[] = {
+    [SL_FRAME_NETSTRING] = {"", ":", ","},
+    [SL_FRAME_RESP] = {"$", "\r\n", "\r\n"},
+};
+
+// longest header: prefix + 20 digits + separator
+#define SL_FRAME_LEN_MAX 24
+
+enum { SL_FRAME_ST_HEADER, SL_FRAME_ST_PAYLOAD, SL_FRAME_ST_TRAILER, SL_FRAME_ST_ERROR };
+
+/**
+ * Incremental decoder
+ *
+ * The payload of a frame is copied straight from the input chunks into an
+ * `sl_hdr` block of the exact size (and hashed while it is copied), so a
+ * frame costs one allocation and one copy whatever the chunk boundaries.
+ */
+struct sl_frame_decoder {
+    sl_frame_format fmt;
+    size_t max_frame;          /**< Largest accepted payload */
+    int state;                 /**< SL_FRAME_ST_* */
+    sl_err error;              /**< Sticky error in SL_FRAME_ST_ERROR */
+    char head[SL_FRAME_LEN_MAX]; /**< Header bytes seen so far */
+    size_t head_len;
+    sl_hdr *cur;               /**< Frame being filled */
+    size_t filled;             /**< Payload bytes already in `cur` */
+    size_t trailer_pos;        /**< Trailer bytes already matched */
+    sl_str *queue;             /**< Decoded frames not yet returned */
+    size_t q_head, q_len, q_cap;
+};
+
+/**
+ * Create a frame decoder
+ *
+ * @param fmt The frame syntax
+ * @param max_frame Largest payload accepted (0 = `SL_FRAME_DEFAULT_MAX`, 64 MiB;
+ *                  `SL_FRAME_UNLIMITED` = no limit); longer frames fail with
+ *                  `SL_ERR_RANGE` before anything is allocated, but the payload
+ *                  of an accepted header is allocated up front, so only lift
+ *                  the limit for trusted peers
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The decoder, or NULL on error
+ */
+sl_frame_decoder *sl_frame_decoder_new(sl_frame_format fmt, size_t max_frame, sl_err *err) {
+    if ((unsigned)fmt > SL_FRAME_RESP) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+
+    sl_frame_decoder *dec = calloc(1, sizeof(*dec));
+    if (!dec) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    dec->fmt = fmt;
+    if (max_frame == 0)
+        max_frame = SL_FRAME_DEFAULT_MAX;
+    dec->max_frame = max_frame == SL_FRAME_UNLIMITED ? SIZE_MAX - 1 : max_frame;
+    dec->state = SL_FRAME_ST_HEADER;
+
+    sl__set_err(err, SL_OK);
+    return dec;
+}
+
+/**
+ * Free a decoder, its partial frame and the frames not yet returned
+ *
+ * @param dec Pointer to the decoder variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_frame_decoder_free(sl_frame_decoder **dec, sl_err *err) {
+    if (!dec || !*dec) {
+        sl__set_err(err, SL_OK);
+        return;
+    }
+
+    sl_frame_decoder *d = *dec;
+    for (size_t i = d->q_head; i < d->q_len; i++)
+        sl_free(&d->queue[i], NULL);
+    free(d->queue);
+    if (d->cur)
+        sl__hdr_release(d->cur);
+    free(d);
+    *dec = NULL;
+    sl__set_err(err, SL_OK);
+}
+
+static sl_err sl__frame_push(sl_frame_decoder *dec, sl_str frame) {
+    if (dec->q_len == dec->q_cap) {
+        if (dec->q_head > 0) {
+            memmove(dec->queue, dec->queue + dec->q_head, (dec->q_len - dec->q_head) * sizeof(*dec->queue));
+            dec->q_len -= dec->q_head;
+            dec->q_head = 0;
+        } else {
+            size_t new_cap = dec->q_cap ? dec->q_cap * 2 : 16;
+            sl_str *grown = realloc(dec->queue, new_cap * sizeof(*grown));
+            if (!grown)
+                return SL_ERR_ALLOC;
+            dec->queue = grown;
+            dec->q_cap = new_cap;
+        }
+    }
+
+    dec->queue[dec->q_len++] = frame;
+    return SL_OK;
+}
+
+/**
+ * Parse a complete header and allocate the frame block
+ */
+static sl_err sl__frame_start(sl_frame_decoder *dec) {
+    const sl_frame_syntax *syn = &SL_FRAME_SYNTAX[dec->fmt];
+    size_t prefix_len = strlen(syn->prefix);
+    size_t digits_end = dec->head_len - strlen(syn->sep);
+
+    if (digits_end <= prefix_len || memcmp(dec->head, syn->prefix, prefix_len) != 0)
+        return SL_ERR_FORMAT;
+
+    // netstrings forbid leading zeros ("0:," is the only length starting with 0)
+    if (dec->fmt == SL_FRAME_NETSTRING && dec->head[prefix_len] == '0' && digits_end - prefix_len > 1)
+        return SL_ERR_FORMAT;
+
+    size_t len = 0;
+    for (size_t i = prefix_len; i < digits_end; i++) {
+        unsigned d = (unsigned char)dec->head[i] - '0';
+        if (d > 9)
+            return SL_ERR_FORMAT;
+        if (len > (SIZE_MAX - d) / 10)
+            return SL_ERR_RANGE;
+        len = len * 10 + d;
+    }
+
+    if (len > dec->max_frame)
+        return SL_ERR_RANGE;
+
+    sl_err e = SL_OK;
+    dec->cur = sl__alloc_exact(len, &e);
+    if (!dec->cur)
+        return e;
+
+    dec->cur->hash = FNV_OFFSET;
+    dec->filled = 0;
+    dec->trailer_pos = 0;
+    dec->state = len ? SL_FRAME_ST_PAYLOAD : SL_FRAME_ST_TRAILER;
+    return SL_OK;
+}
+
+/**
+ * Feed bytes received from the peer
+ *
+ * `data` can end anywhere (inside a header, a payload or a trailer) and can
+ * hold many frames; every completed frame is queued for `sl_frame_next`.
+ * After a protocol error the decoder keeps failing with the same error.
+ *
+ * @param dec The decoder
+ * @param data The received bytes
+ * @param len Number of bytes
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_FORMAT` for a malformed frame, `SL_ERR_RANGE` if a
+ *            frame is longer than `max_frame`)
+ */
+void sl_frame_feed(sl_frame_decoder *dec, const void *data, size_t len, sl_err *err) {
+    if (!dec || (!data && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+
+    const sl_frame_syntax *syn = &SL_FRAME_SYNTAX[dec->fmt];
+    const char *p = (const char *)data;
+    const char *end = p + len;
+    sl_err e = SL_OK;
+
+    while (p < end && dec->state != SL_FRAME_ST_ERROR) {
+        switch (dec->state) {
+        case SL_FRAME_ST_HEADER: {
+            // headers are a few bytes: copy until the separator is complete
+            size_t sep_len = strlen(syn->sep);
+            bool complete = false;
+            while (p < end && !complete) {
+                if (dec->head_len == sizeof(dec->head)) {
+                    e = SL_ERR_FORMAT;
+                    break;
+                }
+                dec->head[dec->head_len++] = *p++;
+                complete = dec->head_len >= sep_len &&
+                           memcmp(dec->head + dec->head_len - sep_len, syn->sep, sep_len) == 0;
+            }
+            if (complete) {
+                e = sl__frame_start(dec);
+                dec->head_len = 0;
+            }
+            break;
+        }
+
+        case SL_FRAME_ST_PAYLOAD: {
+            size_t n = dec->cur->len - dec->filled;
+            if (n > (size_t)(end - p))
+                n = (size_t)(end - p);
+            memcpy(dec->cur->data + dec->filled, p, n);
+            dec->cur->hash = sl__hash_continue(dec->cur->hash, p, n);
+            dec->filled += n;
+            p += n;
+            if (dec->filled == dec->cur->len)
+                dec->state = SL_FRAME_ST_TRAILER;
+            break;
+        }
+
+        case SL_FRAME_ST_TRAILER: {
+            size_t trailer_len = strlen(syn->trailer);
+            while (p < end && dec->trailer_pos < trailer_len) {
+                if (*p++ != syn->trailer[dec->trailer_pos++]) {
+                    e = SL_ERR_FORMAT;
+                    break;
+                }
+            }
+            if (e == SL_OK && dec->trailer_pos == trailer_len) {
+                e = sl__frame_push(dec, dec->cur->data);
+                if (e == SL_OK) {
+                    dec->cur = NULL;
+                    dec->state = SL_FRAME_ST_HEADER;
+                }
+            }
+            break;
+        }
+        }
+
+        if (e != SL_OK) {
+            dec->state = SL_FRAME_ST_ERROR;
+            dec->error = e;
+        }
+    }
+
+    sl__set_err(err, dec->state == SL_FRAME_ST_ERROR ? dec->error : SL_OK);
+}
+
+/**
+ * Take the next decoded frame
+ *
+ * @param dec The decoder
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The frame, owned by the caller, or NULL if no complete frame is
+ *         waiting (`err` is `SL_OK`)
+ */
+sl_str sl_frame_next(sl_frame_decoder *dec, sl_err *err) {
+    if (!dec) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    sl__set_err(err, SL_OK);
+    if (dec->q_head == dec->q_len)
+        return NULL;
+
+    sl_str frame = dec->queue[dec->q_head++];
+    if (dec->q_head == dec->q_len)
+        dec->q_head = dec->q_len = 0;
+    return frame;
+}
+
+#ifdef SL_HAVE_POSIX
+/**
+ * Describe frames as iovecs for `writev`, without copying the payloads
+ *
+ * Frame `i` uses `iov[2i]` (its header, preceded by the trailer of frame
+ * `i - 1`) and `iov[2i + 1]` (the payload, pointing into `strs[i]`); the
+ * last iovec is the final trailer. Headers are written into `scratch`.
+ * The iovecs are valid while `strs` and `scratch` are unchanged.
+ *
+ * @param fmt The frame syntax
+ * @param strs The payloads
+ * @param n Number of payloads
+ * @param iov Room for `SL_FRAME_IOVECS(n)` iovecs
+ * @param scratch Room for `SL_FRAME_SCRATCH(n)` bytes
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The number of iovecs filled (0 if `n` is 0 or on error)
+ */
+size_t sl_frame_encode_many(sl_frame_format fmt, const sl_str *strs, size_t n, struct iovec *iov, char *scratch,
+                            sl_err *err) {
+    if ((!strs || !iov || !scratch) && n > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+
+    if ((unsigned)fmt > SL_FRAME_RESP) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return 0;
+    }
+
+    if (n == 0) {
+        sl__set_err(err, SL_OK);
+        return 0;
+    }
+
+    const sl_frame_syntax *syn = &SL_FRAME_SYNTAX[fmt];
+    size_t prefix_len = strlen(syn->prefix), sep_len = strlen(syn->sep), trailer_len = strlen(syn->trailer);
+
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        sl_hdr *hdr;
+        sl_err e = sl__validate(strs[i], &hdr);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return 0;
+        }
+
+        char *h = scratch + i * SL_FRAME_SCRATCH(1);
+        char *w = h;
+        if (i > 0) {
+            memcpy(w, syn->trailer, trailer_len);
+            w += trailer_len;
+        }
+        memcpy(w, syn->prefix, prefix_len);
+        w += prefix_len;
+
+        char digits[20];
+        size_t nd = 0, len = hdr->len;
+        do {
+            digits[nd++] = (char)('0' + len % 10);
+            len /= 10;
+        } while (len);
+        while (nd)
+            *w++ = digits[--nd];
+
+        memcpy(w, syn->sep, sep_len);
+        w += sep_len;
+
+        iov[k].iov_base = h;
+        iov[k++].iov_len = (size_t)(w - h);
+        iov[k].iov_base = hdr->data;
+        iov[k++].iov_len = hdr->len;
+    }
+
+    iov[k].iov_base = (void *)syn->trailer;
+    iov[k++].iov_len = trailer_len;
+
+    sl__set_err(err, SL_OK);
+    return k;
+}
+
+// frames per writev call (2 iovecs each stays below IOV_MAX = 1024)
+#define SL_FRAME_BATCH 256
+
+/**
+ * Write frames to a file descriptor with as few `writev` calls as possible
+ *
+ * Payloads are never copied; partial writes and EINTR are handled.
+ *
+ * @param fd A blocking descriptor (socket, pipe, file)
+ * @param fmt The frame syntax
+ * @param strs The payloads
+ * @param n Number of payloads
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_IO` if a write fails)
+ */
+void sl_frame_writev(int fd, sl_frame_format fmt, const sl_str *strs, size_t n, sl_err *err) {
+    struct iovec iov[SL_FRAME_IOVECS(SL_FRAME_BATCH)];
+    char scratch[SL_FRAME_SCRATCH(SL_FRAME_BATCH)];
+
+    for (size_t done = 0; done < n;) {
+        size_t batch = n - done < SL_FRAME_BATCH ? n - done : SL_FRAME_BATCH;
+        sl_err e;
+        size_t cnt = sl_frame_encode_many(fmt, strs + done, batch, iov, scratch, &e);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return;
+        }
+
+        struct iovec *cur = iov;
+        while (cnt > 0) {
+            ssize_t w = writev(fd, cur, (int)cnt);
+            if (w < 0) {
+                if (errno == EINTR)
+                    continue;
+                sl__set_err(err, SL_ERR_IO);
+                return;
+            }
+
+            size_t left = (size_t)w;
+            while (cnt > 0 && left >= cur->iov_len) {
+                left -= cur->iov_len;
+                cur++;
+                cnt--;
+            }
+            if (cnt > 0) {
+                cur->iov_base = (char *)cur->iov_base + left;
+                cur->iov_len -= left;
+            }
+        }
+
+        done += batch;
+    }
+
+    sl__set_err(err, SL_OK);
+}
+#endif
+
+
+// VARINTS
+
+/*
+ * LEB128 varints (protobuf encoding): 7 bits per byte, least significant
+ * group first, high bit set on every byte but the last. Signed values are
+ * zigzag-mapped first so small negative numbers stay short.
+ */
+#define SL_VARINT_MAX 10
+
+/**
+ * Make room for `extra` more bytes (+ null term) at the end of a string
+ *
+ * @return The (possibly moved) header, or NULL on failure (the string is untouched)
+ */
+static sl_hdr *sl__grow_tail(sl_hdr *hdr, size_t extra, sl_err *err) {
+    if (extra > SIZE_MAX - 1 - hdr->len) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    size_t new_cap = hdr->len + extra + 1;
+    if (new_cap > hdr->cap) {
+        hdr = sl__hdr_realloc(hdr, new_cap, err);
+        if (!hdr)
+            return NULL;
+        hdr->cap = new_cap;
+    }
+    return hdr;
+}
+
+/**
+ * Account for `extra` bytes written after the end of a string
+ * (only the new bytes are hashed)
+ */
+static void sl__commit_tail(sl_hdr *hdr, size_t extra) {
+    hdr->hash = sl__hash_continue(hdr->hash, hdr->data + hdr->len, extra);
+    hdr->flags &= ~SL_HDR_CRC;
+    hdr->len += extra;
+    hdr->data[hdr->len] = '\0';
+}
+
+static inline size_t sl__varint_len(uint64_t v) {
+    unsigned bits = 64 - (unsigned)__builtin_clzll(v | 1);
+    return (bits + 6) / 7;
+}
+
+static inline size_t sl__varint_put(unsigned char *p, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (unsigned char)v;
+    return n;
+}
+
+/**
+ * Decode one varint from `avail` bytes
+ *
+ * @return `SL_OK`, `SL_ERR_RANGE` if the bytes end inside the varint or
+ *         `SL_ERR_FORMAT` if it is longer than 10 bytes or overflows 64 bits
+ */
+static inline sl_err sl__varint_get(const unsigned char *p, size_t avail, uint64_t *out, size_t *used) {
+    size_t max = avail < SL_VARINT_MAX ? avail : SL_VARINT_MAX;
+    uint64_t v = 0;
+    for (size_t i = 0; i < max; i++) {
+        uint64_t b = p[i];
+        v |= (b & 0x7F) << (7 * i);
+        if (b < 0x80) {
+            if (i == SL_VARINT_MAX - 1 && b > 1)
+                return SL_ERR_FORMAT;
+            *out = v;
+            *used = i + 1;
+            return SL_OK;
+        }
+    }
+    return max == SL_VARINT_MAX ? SL_ERR_FORMAT : SL_ERR_RANGE;
+}
+
+static inline uint64_t sl__zigzag(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t sl__unzigzag(uint64_t v) {
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/**
+ * Append an unsigned varint (1 to 10 bytes)
+ *
+ * Like `sl_append_cstr`, the memory is reallocated exactly; to append many
+ * values use `sl_append_varints`, which reallocates once.
+ *
+ * @return The (possibly reallocated) string pointer.
+ *         If an error occurs, the original string is returned unchanged and `err` is set.
+ */
+sl_str sl_append_varint_u64(sl_str str, uint64_t v, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate_mut(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return str;
+    }
+
+    size_t n = sl__varint_len(v);
+    hdr = sl__grow_tail(hdr, n, err);
+    if (!hdr)
+        return str;
+
+    sl__varint_put((unsigned char *)hdr->data + hdr->len, v);
+    sl__commit_tail(hdr, n);
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+/**
+ * Append a signed integer as a zigzag varint (-1 -> 1, 1 -> 2, -2 -> 3, ...)
+ *
+ * @return The (possibly reallocated) string pointer.
+ *         If an error occurs, the original string is returned unchanged and `err` is set.
+ */
+sl_str sl_append_zigzag_i64(sl_str str, int64_t v, sl_err *err) {
+    return sl_append_varint_u64(str, sl__zigzag(v), err);
+}
+
+/**
+ * Append `n` unsigned varints
+ *
+ * The encoded size is computed first (from the bit length of each value),
+ * so the memory is reallocated at most once and the new bytes are hashed once.
+ *
+ * @return The (possibly reallocated) string pointer.
+ *         If an error occurs, the original string is returned unchanged and `err` is set.
+ */
+sl_str sl_append_varints(sl_str str, const uint64_t *vals, size_t n, sl_err *err) {
+    if (!vals && n > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return str;
+    }
+
+    sl_hdr *hdr;
+    sl_err e = sl__validate_mut(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return str;
+    }
+
+    size_t total = 0;
+    for (size_t i = 0; i < n; i++)
+        total += sl__varint_len(vals[i]);
+
+    hdr = sl__grow_tail(hdr, total, err);
+    if (!hdr)
+        return str;
+
+    unsigned char *p = (unsigned char *)hdr->data + hdr->len;
+    for (size_t i = 0; i < n; i++)
+        p += sl__varint_put(p, vals[i]);
+
+    sl__commit_tail(hdr, total);
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+/**
+ * Read an unsigned varint at `*pos` and advance `*pos` past it
+ *
+ * @param str The string
+ * @param pos Cursor (byte offset), left unchanged on error
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_RANGE` if the varint goes past the end of the string,
+ *            `SL_ERR_FORMAT` if it is longer than 10 bytes or overflows)
+ * @return The value, or 0 on error
+ */
+uint64_t sl_read_varint_u64(sl_str str, size_t *pos, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = pos ? sl__validate(str, &hdr) : SL_ERR_NULL;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+
+    if (*pos >= hdr->len) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return 0;
+    }
+
+    uint64_t v;
+    size_t used;
+    e = sl__varint_get((const unsigned char *)hdr->data + *pos, hdr->len - *pos, &v, &used);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+
+    *pos += used;
+    sl__set_err(err, SL_OK);
+    return v;
+}
+
+/**
+ * Read a zigzag varint at `*pos` (see `sl_read_varint_u64`)
+ */
+int64_t sl_read_zigzag_i64(sl_str str, size_t *pos, sl_err *err) {
+    return sl__unzigzag(sl_read_varint_u64(str, pos, err));
+}
+
+/**
+ * Read up to `n` unsigned varints starting at `*pos`
+ *
+ * Decoding stops at the end of the string, after `n` values or at the first
+ * bad varint; `*pos` is left after the last value decoded.
+ *
+ * @return The number of values stored in `out`
+ *         (`err` is `SL_OK` unless a varint was truncated or malformed)
+ */
+size_t sl_read_varints(sl_str str, size_t *pos, uint64_t *out, size_t n, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = (pos && (out || n == 0)) ? sl__validate(str, &hdr) : SL_ERR_NULL;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+
+    if (*pos > hdr->len) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return 0;
+    }
+
+    const unsigned char *p = (const unsigned char *)hdr->data + *pos;
+    const unsigned char *end = (const unsigned char *)hdr->data + hdr->len;
+    size_t count = 0;
+    while (count < n && p < end) {
+        size_t used;
+        e = sl__varint_get(p, (size_t)(end - p), &out[count], &used);
+        if (e != SL_OK)
+            break;
+        p += used;
+        count++;
+    }
+
+    *pos = (size_t)(p - (const unsigned char *)hdr->data);
+    sl__set_err(err, e);
+    return count;
+}
+
+// FRONT CODING
+
+/*
+ * Sorted string set stored as front-coded blocks.
+ * The first key of a block (restart point) is stored in full:
+ *     varint len, bytes
+ * every following key only stores what differs from its predecessor:
+ *     varint shared, varint suffix_len, suffix bytes
+ * `restarts` holds the offset of every block head, so a lookup binary
+ * searches the heads and decodes at most one block.
+ */
+struct sl_fcset {
+    unsigned char *data; /**< Encoded blocks */
+    size_t data_len;     /**< Size of `data` in bytes */
+    size_t *restarts;    /**< Offset of each block head in `data` */
+    size_t nblocks;      /**< Number of blocks */
+    size_t count;        /**< Number of keys */
+    size_t block_size;   /**< Keys per block */
+    size_t max_len;      /**< Length of the longest key */
+};
+
+/**
+ * Sequential decoder, the current key is rebuilt in `buf`
+ */
+struct sl_fcset_iter {
+    const sl_fcset *set;
+    size_t next; /**< Index of the next key */
+    size_t off;  /**< Offset of the next key in `set->data` */
+    size_t len;  /**< Length of the key in `buf` */
+    char buf[];  /**< `set->max_len` bytes */
+};
+
+#define SL_FCSET_BLOCK 16
+
+/**
+ * Varint reader for the encoded blocks (they are built by `sl_fcset_build`,
+ * so they are trusted and not bounds checked)
+ */
+static inline size_t sl__fc_get(const unsigned char **p) {
+    const unsigned char *q = *p;
+    size_t v = *q & 0x7F;
+    for (unsigned shift = 7; *q++ & 0x80; shift += 7)
+        v |= (size_t)(*q & 0x7F) << shift;
+    *p = q;
+    return v;
+}
+
+/**
+ * Length of the common prefix of `a` and `b` (at most `n`), 8 bytes at a time
+ */
+static size_t sl__common_prefix(const unsigned char *a, const unsigned char *b, size_t n) {
+    size_t i = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    for (; i + 8 <= n; i += 8) {
+        uint64_t x, y;
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        if (x != y)
+            return i + (size_t)__builtin_ctzll(x ^ y) / 8;
+    }
+#endif
+    while (i < n && a[i] == b[i])
+        i++;
+    return i;
+}
+
+/**
+ * Lexicographic byte order (a key sorts before the keys it prefixes)
+ */
+static int sl__bytes_cmp(const void *a, size_t alen, const void *b, size_t blen) {
+    size_t n = alen < blen ? alen : blen;
+    int c = n ? memcmp(a, b, n) : 0;
+    if (c != 0)
+        return c;
+    return (alen > blen) - (alen < blen);
+}
+
+/**
+ * Index of the first key >= `key`, `*found` is set if it is equal
+ *
+ * Inside a block the key is never rebuilt: `m` tracks the common prefix of
+ * `key` and the previous (smaller) entry, and the shared length of the next
+ * entry tells whether it still sorts below `key` (shared > m), diverges
+ * above it (shared < m) or has to be compared from byte `m` on.
+ */
+static size_t sl__fcset_search(const sl_fcset *set, const unsigned char *key, size_t len, bool *found) {
+    *found = false;
+
+    // first block whose head is > key
+    size_t lo = 0, hi = set->nblocks;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const unsigned char *p = set->data + set->restarts[mid];
+        size_t hlen = sl__fc_get(&p);
+        if (sl__bytes_cmp(p, hlen, key, len) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo == 0)
+        return 0;
+
+    size_t idx = (lo - 1) * set->block_size;
+    size_t end = idx + set->block_size < set->count ? idx + set->block_size : set->count;
+    const unsigned char *p = set->data + set->restarts[lo - 1];
+    size_t head_len = sl__fc_get(&p);
+    size_t m = sl__common_prefix(p, key, head_len < len ? head_len : len);
+    if (m == len && head_len == len) {
+        *found = true;
+        return idx;
+    }
+    p += head_len;
+
+    for (idx++; idx < end; idx++) {
+        size_t shared = sl__fc_get(&p);
+        size_t suffix_len = sl__fc_get(&p);
+        if (shared < m)
+            return idx;
+        if (shared == m) {
+            size_t n = suffix_len < len - m ? suffix_len : len - m;
+            size_t k = sl__common_prefix(p, key + m, n);
+            if (k < n) {
+                if (p[k] > key[m + k])
+                    return idx;
+                m += k;
+            } else {
+                size_t entry_len = shared + suffix_len;
+                if (entry_len >= len) {
+                    *found = entry_len == len;
+                    return idx;
+                }
+                m = entry_len;
+            }
+        }
+        p += suffix_len;
+    }
+    return idx;
+}
+
+/**
+ * Build a front-coded set from sorted strings
+ *
+ * The keys are copied, `sorted` can be freed afterwards.
+ * Consecutive keys that share long prefixes (URLs, paths) cost only their
+ * differing suffix plus two varints instead of a 32-byte header each.
+ *
+ * @param sorted Strings in strictly increasing byte order (no duplicates)
+ * @param n Number of strings
+ * @param block_size Keys per block (0 for the default of 16), larger blocks
+ *        compress better but lookups decode more entries
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_INVALID` if the strings are not sorted or repeat a key)
+ * @return The set, or NULL on error
+ */
+sl_fcset *sl_fcset_build(const sl_str *sorted, size_t n, size_t block_size, sl_err *err) {
+    if (!sorted && n > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    if (block_size == 0)
+        block_size = SL_FCSET_BLOCK;
+
+    // first pass: validate and size
+    size_t total = 0, max_len = 0;
+    sl_hdr *prev = NULL;
+    for (size_t i = 0; i < n; i++) {
+        sl_hdr *hdr;
+        sl_err e = sl__validate(sorted[i], &hdr);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return NULL;
+        }
+        if (prev && sl__bytes_cmp(prev->data, prev->len, hdr->data, hdr->len) >= 0) {
+            sl__set_err(err, SL_ERR_INVALID);
+            return NULL;
+        }
+
+        size_t shared = 0;
+        if (i % block_size == 0) {
+            total += sl__varint_len(hdr->len);
+        } else {
+            shared = sl__common_prefix((const unsigned char *)prev->data, (const unsigned char *)hdr->data,
+                                       prev->len < hdr->len ? prev->len : hdr->len);
+            total += sl__varint_len(shared) + sl__varint_len(hdr->len - shared);
+        }
+        total += hdr->len - shared;
+        if (hdr->len > max_len)
+            max_len = hdr->len;
+        prev = hdr;
+    }
+
+    sl_fcset *set = calloc(1, sizeof(*set));
+    if (!set) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    set->count = n;
+    set->block_size = block_size;
+    set->max_len = max_len;
+    set->data_len = total;
+    set->nblocks = n / block_size + (n % block_size != 0);
+    set->data = malloc(total ? total : 1);
+    set->restarts = malloc((set->nblocks ? set->nblocks : 1) * sizeof(*set->restarts));
+    if (!set->data || !set->restarts) {
+        free(set->data);
+        free(set->restarts);
+        free(set);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    // second pass: encode
+    unsigned char *p = set->data;
+    prev = NULL;
+    for (size_t i = 0; i < n; i++) {
+        sl_hdr *hdr = sl__get_hdr(sorted[i]);
+        size_t shared = 0;
+        if (i % block_size == 0) {
+            set->restarts[i / block_size] = (size_t)(p - set->data);
+            p += sl__varint_put(p, hdr->len);
+        } else {
+            shared = sl__common_prefix((const unsigned char *)prev->data, (const unsigned char *)hdr->data,
+                                       prev->len < hdr->len ? prev->len : hdr->len);
+            p += sl__varint_put(p, shared);
+            p += sl__varint_put(p, hdr->len - shared);
+        }
+        if (hdr->len > shared)
+            memcpy(p, hdr->data + shared, hdr->len - shared);
+        p += hdr->len - shared;
+        prev = hdr;
+    }
+
+    sl__set_err(err, SL_OK);
+    return set;
+}
+
+/**
+ * Free a front-coded set
+ *
+ * @param set Pointer to the set variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_fcset_free(sl_fcset **set, sl_err *err) {
+    if (set && *set) {
+        free((*set)->data);
+        free((*set)->restarts);
+        free(*set);
+        *set = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Number of keys in the set
+ */
+size_t sl_fcset_count(const sl_fcset *set, sl_err *err) {
+    if (!set) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return set->count;
+}
+
+/**
+ * Heap memory used by the set (encoded blocks, restart offsets and the set itself)
+ */
+size_t sl_fcset_memory(const sl_fcset *set, sl_err *err) {
+    if (!set) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return sizeof(*set) + set->data_len + set->nblocks * sizeof(*set->restarts);
+}
+
+/**
+ * Check whether the set contains a key
+ *
+ * Binary search over the block heads, then at most one block is scanned
+ * without rebuilding its keys. Nothing is allocated.
+ */
+bool sl_fcset_contains(const sl_fcset *set, const void *bytes, size_t len, sl_err *err) {
+    if (!set || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+
+    bool found;
+    sl__fcset_search(set, bytes, len, &found);
+    sl__set_err(err, SL_OK);
+    return found;
+}
+
+/**
+ * Rank of the first key >= `bytes` (`sl_fcset_count` if all keys are smaller)
+ *
+ * With `sl_fcset_iter_new` this gives range and prefix scans.
+ */
+size_t sl_fcset_lower_bound(const sl_fcset *set, const void *bytes, size_t len, sl_err *err) {
+    if (!set || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+
+    bool found;
+    size_t idx = sl__fcset_search(set, bytes, len, &found);
+    sl__set_err(err, SL_OK);
+    return idx;
+}
+
+/**
+ * Decode the key at `it->next` into `it->buf`
+ * (the buffer still holds the previous key, so only the suffix is copied)
+ */
+static void sl__fcset_step(sl_fcset_iter *it) {
+    const sl_fcset *set = it->set;
+    const unsigned char *p = set->data + it->off;
+    if (it->next % set->block_size == 0) {
+        it->len = sl__fc_get(&p);
+        memcpy(it->buf, p, it->len);
+        p += it->len;
+    } else {
+        size_t shared = sl__fc_get(&p);
+        size_t suffix_len = sl__fc_get(&p);
+        memcpy(it->buf + shared, p, suffix_len);
+        it->len = shared + suffix_len;
+        p += suffix_len;
+    }
+    it->off = (size_t)(p - set->data);
+    it->next++;
+}
+
+/**
+ * Create an iterator positioned at the key of rank `start`
+ *
+ * Seeking decodes from the head of the block holding `start`.
+ *
+ * @param set The set
+ * @param start Rank of the first key returned (`sl_fcset_count` gives an empty iterator)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The iterator, or NULL on error
+ */
+sl_fcset_iter *sl_fcset_iter_new(const sl_fcset *set, size_t start, sl_err *err) {
+    if (!set) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    if (start > set->count) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return NULL;
+    }
+
+    sl_fcset_iter *it = malloc(sizeof(*it) + set->max_len);
+    if (!it) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    it->set = set;
+    it->len = 0;
+    if (start == set->count) {
+        it->next = set->count;
+        it->off = set->data_len;
+    } else {
+        size_t block = start / set->block_size;
+        it->next = block * set->block_size;
+        it->off = set->restarts[block];
+        while (it->next < start)
+            sl__fcset_step(it);
+    }
+
+    sl__set_err(err, SL_OK);
+    return it;
+}
+
+/**
+ * Decode the next key
+ *
+ * @param it The iterator
+ * @param out Receives a view of the key, valid until the next call or
+ *        `sl_fcset_iter_free`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return false at the end of the set
+ */
+bool sl_fcset_iter_next(sl_fcset_iter *it, sl_view *out, sl_err *err) {
+    if (!it || !out) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+
+    sl__set_err(err, SL_OK);
+    if (it->next >= it->set->count)
+        return false;
+
+    sl__fcset_step(it);
+    out->data = it->buf;
+    out->len = it->len;
+    return true;
+}
+
+/**
+ * Free an iterator
+ *
+ * @param it Pointer to the iterator variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_fcset_iter_free(sl_fcset_iter **it, sl_err *err) {
+    if (it && *it) {
+        free(*it);
+        *it = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+// COMPRESSION
+
+/*
+ * A compressed string holds a frame and is flagged SL_HDR_COMPRESSED:
+ *     method byte, varint original length, CRC32C (4 bytes, little-endian), payload
+ * Methods:
+ *   stored: the payload is the original bytes (nothing could be saved)
+ *   lz:     the hash of the original string (8 bytes, little-endian),
+ *           then an LZ4 block (token, literals, 16-bit offset, match length)
+ *   symtab: FSST-style codes for a trained `sl_symtab`, one byte per
+ *           symbol of 1 to 8 bytes, 255 escapes a literal byte
+ * The cached hash is the hash of the frame, like any other string.
+ * The CRC covers the original bytes (followed by the stored hash for LZ),
+ * so a damaged frame that still decodes is reported, not returned. LZ
+ * frames restore the original hash instead of rehashing: the CRC runs
+ * far faster than FNV-1a, which would otherwise dominate decompression.
+ */
+enum { SL_CMP_STORED, SL_CMP_LZ, SL_CMP_SYMTAB };
+
+#define SL_LZ_HASH_LOG 12
+#define SL_LZ_MIN_MATCH 4
+#define SL_LZ_LAST_LITERALS 5 // the block ends with at least 5 literals
+#define SL_LZ_MFLIMIT 12      // and the last match starts at least 12 bytes before the end
+#define SL_LZ_MAX_OFFSET 65535
+#define SL_LZ_BOUND(n) ((n) + (n) / 255 + 16)
+#define SL_LZ_HASH_SIZE 8
+#define SL_CMP_CRC_SIZE 4
+#define SL_CMP_STACK 512 // frames up to this size are built on the stack
+
+static inline uint32_t sl__lz_read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline size_t sl__lz_hash(uint32_t v) {
+    return (size_t)((v * 2654435761u) >> (32 - SL_LZ_HASH_LOG));
+}
+
+/**
+ * Write the extension bytes of a literal or match length (`len` - 15)
+ */
+static unsigned char *sl__lz_put_len(unsigned char *op, size_t len) {
+    for (; len >= 255; len -= 255)
+        *op++ = 255;
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+static unsigned char *sl__lz_put_literals(unsigned char *op, unsigned char *token, const unsigned char *lit,
+                                          size_t n) {
+    *token = (unsigned char)((n >= 15 ? 15 : n) << 4);
+    if (n >= 15)
+        op = sl__lz_put_len(op, n - 15);
+    memcpy(op, lit, n);
+    return op + n;
+}
+
+/**
+ * Compress `n` bytes (at most UINT32_MAX) into an LZ4 block
+ *
+ * Greedy parse with a 4096-entry hash table of the last position of each
+ * 4-byte sequence; the step grows while no match is found, so
+ * incompressible input is skipped quickly.
+ *
+ * @param dst At least `SL_LZ_BOUND(n)` bytes
+ * @return The size of the block
+ */
+static size_t sl__lz_compress(const unsigned char *src, size_t n, unsigned char *dst) {
+    const unsigned char *anchor = src;
+    const unsigned char *end = src + n;
+    unsigned char *op = dst;
+
+    if (n > SL_LZ_MFLIMIT) {
+        uint32_t table[1 << SL_LZ_HASH_LOG] = {0};
+        const unsigned char *match_limit = end - SL_LZ_MFLIMIT;
+        const unsigned char *match_end = end - SL_LZ_LAST_LITERALS;
+        const unsigned char *ip = src + 1;
+
+        while (ip <= match_limit) {
+            size_t h = sl__lz_hash(sl__lz_read32(ip));
+            const unsigned char *ref = src + table[h];
+            table[h] = (uint32_t)(ip - src);
+            if (ip - ref > SL_LZ_MAX_OFFSET || sl__lz_read32(ref) != sl__lz_read32(ip)) {
+                ip += 1 + ((size_t)(ip - anchor) >> 6);
+                continue;
+            }
+
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const unsigned char *mp = ip + SL_LZ_MIN_MATCH;
+            mp += sl__common_prefix(mp, ref + SL_LZ_MIN_MATCH, (size_t)(match_end - mp));
+
+            unsigned char *token = op++;
+            op = sl__lz_put_literals(op, token, anchor, (size_t)(ip - anchor));
+            size_t offset = (size_t)(ip - ref);
+            *op++ = (unsigned char)offset;
+            *op++ = (unsigned char)(offset >> 8);
+            size_t mlen = (size_t)(mp - ip) - SL_LZ_MIN_MATCH;
+            *token |= (unsigned char)(mlen >= 15 ? 15 : mlen);
+            if (mlen >= 15)
+                op = sl__lz_put_len(op, mlen - 15);
+
+            ip = anchor = mp;
+            if (ip <= match_limit)
+                table[sl__lz_hash(sl__lz_read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+
+    unsigned char *token = op++;
+    return (size_t)(sl__lz_put_literals(op, token, anchor, (size_t)(end - anchor)) - dst);
+}
+
+/**
+ * Read the extension bytes of a literal or match length
+ */
+static bool sl__lz_get_len(const unsigned char **ip, const unsigned char *iend, size_t *len) {
+    unsigned b;
+    do {
+        if (*ip >= iend)
+            return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+/**
+ * Decode an LZ4 block into exactly `out_len` bytes
+ *
+ * Every length and offset is checked against the input and output bounds,
+ * so a damaged frame fails instead of reading or writing out of bounds.
+ * Away from the ends of the buffers, short literal runs and matches are
+ * copied 16 bytes at a time (the extra bytes are overwritten later).
+ */
+static bool sl__lz_decompress(const unsigned char *ip, size_t n, unsigned char *dst, size_t out_len) {
+    const unsigned char *iend = ip + n;
+    unsigned char *op = dst;
+    unsigned char *oend = dst + out_len;
+
+    for (;;) {
+        if (ip >= iend)
+            return false;
+        unsigned token = *ip++;
+
+        size_t lit = token >> 4;
+        if (lit < 15 && iend - ip >= 16 + 2 && oend - op >= 16) {
+            memcpy(op, ip, 16);
+        } else {
+            if (lit == 15 && !sl__lz_get_len(&ip, iend, &lit))
+                return false;
+            if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op))
+                return false;
+            memcpy(op, ip, lit);
+            if (ip + lit == iend)
+                return op + lit == oend;
+        }
+        op += lit;
+        ip += lit;
+
+        if (iend - ip < 2)
+            return false;
+        size_t offset = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return false;
+
+        size_t mlen = token & 15;
+        if (mlen == 15 && !sl__lz_get_len(&ip, iend, &mlen))
+            return false;
+        mlen += SL_LZ_MIN_MATCH;
+        if (mlen > (size_t)(oend - op))
+            return false;
+
+        const unsigned char *ref = op - offset;
+        unsigned char *mend = op + mlen;
+        if (offset >= 8 && (size_t)(oend - mend) >= 8) {
+            // 8-byte steps never read bytes they have not written yet
+            do {
+                memcpy(op, ref, 8);
+                op += 8;
+                ref += 8;
+            } while (op < mend);
+            op = mend;
+        } else {
+            while (op < mend)
+                *op++ = *ref++;
+        }
+    }
+}
+
+/**
+ * Trained symbol table for short strings
+ *
+ * Symbols of 2 to 8 bytes are grouped by their first two bytes, longest
+ * first (`order[first[k]]` .. `order[first[k + 1] - 1]` for the prefix `k`),
+ * so a match only tries the few symbols that can apply.
+ */
+struct sl_symtab {
+    unsigned char sym[255][8];  /**< Symbol bytes (zero padded) */
+    unsigned char len[255];     /**< Symbol lengths (1 to 8) */
+    size_t count;               /**< Number of symbols */
+    unsigned char single[256];  /**< Code of each 1-byte symbol, or SL_SYMTAB_ESCAPE */
+    unsigned char order[255];   /**< Codes of the longer symbols, grouped by prefix */
+    uint16_t first[65536 + 1];  /**< Group boundaries in `order` */
+};
+
+#define SL_SYMTAB_ESCAPE 255
+#define SL_SYMTAB_GENERATIONS 5
+#define SL_SYMTAB_SAMPLE (16 * 1024) // bytes of the training sample used
+
+static inline uint64_t sl__sym_mask(size_t len) {
+    if (len >= 8)
+        return ~(uint64_t)0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return ~(~(uint64_t)0 >> (8 * len));
+#else
+    return ((uint64_t)1 << (8 * len)) - 1;
+#endif
+}
+
+static inline size_t sl__sym_prefix(const unsigned char *p) {
+    return (size_t)p[0] | (size_t)p[1] << 8;
+}
+
+/**
+ * Longest symbol matching at `p`
+ *
+ * @return The code, or `SL_SYMTAB_ESCAPE` (`*match_len` = 1) if no symbol matches
+ */
+static inline unsigned sl__symtab_match(const sl_symtab *tab, const unsigned char *p, size_t avail,
+                                        size_t *match_len) {
+    if (avail >= 2) {
+        uint64_t word = 0;
+        memcpy(&word, p, avail < 8 ? avail : 8);
+        size_t k = sl__sym_prefix(p);
+        for (size_t i = tab->first[k]; i < tab->first[k + 1]; i++) {
+            unsigned code = tab->order[i];
+            size_t len = tab->len[code];
+            uint64_t sym;
+            memcpy(&sym, tab->sym[code], 8);
+            if (len <= avail && ((word ^ sym) & sl__sym_mask(len)) == 0) {
+                *match_len = len;
+                return code;
+            }
+        }
+    }
+    *match_len = 1;
+    return tab->single[p[0]];
+}
+
+/**
+ * Rebuild the lookup structures after the symbols changed
+ */
+static void sl__symtab_index(sl_symtab *tab) {
+    memset(tab->single, SL_SYMTAB_ESCAPE, sizeof(tab->single));
+    memset(tab->first, 0, sizeof(tab->first));
+    for (size_t c = 0; c < tab->count; c++) {
+        if (tab->len[c] == 1)
+            tab->single[tab->sym[c][0]] = (unsigned char)c;
+        else
+            tab->first[sl__sym_prefix(tab->sym[c]) + 1]++;
+    }
+    for (size_t k = 0; k < 65536; k++)
+        tab->first[k + 1] = (uint16_t)(tab->first[k + 1] + tab->first[k]);
+
+    // counting sort: first[k] is the cursor of group k while filling (by
+    // decreasing length, so each group is longest first), then it is shifted back
+    for (size_t len = 8; len >= 2; len--)
+        for (size_t c = 0; c < tab->count; c++)
+            if (tab->len[c] == len)
+                tab->order[tab->first[sl__sym_prefix(tab->sym[c])]++] = (unsigned char)c;
+    memmove(tab->first + 1, tab->first, 65536 * sizeof(tab->first[0]));
+    tab->first[0] = 0;
+}
+
+typedef struct {
+    unsigned char bytes[8];
+    size_t len;
+    uint64_t gain; /**< Bytes saved in the sample */
+} sl_sym_candidate;
+
+static int sl__sym_cmp_bytes(const void *a, const void *b) {
+    const sl_sym_candidate *x = a, *y = b;
+    return sl__bytes_cmp(x->bytes, x->len, y->bytes, y->len);
+}
+
+static int sl__sym_cmp_gain(const void *a, const void *b) {
+    const sl_sym_candidate *x = a, *y = b;
+    if (x->gain != y->gain)
+        return x->gain < y->gain ? 1 : -1;
+    return sl__sym_cmp_bytes(a, b); // deterministic tables
+}
+
+// training codes: 0..254 are symbols, 256 + b is the escaped byte b
+#define SL_SYMTAB_CODES 512
+
+static size_t sl__symtab_code_bytes(const sl_symtab *tab, unsigned code, unsigned char *out) {
+    if (code >= 256) {
+        out[0] = (unsigned char)(code - 256);
+        return 1;
+    }
+    memcpy(out, tab->sym[code], tab->len[code]);
+    return tab->len[code];
+}
+
+/**
+ * Encode the sample with the current table and count every code and every
+ * pair of adjacent codes
+ */
+static void sl__symtab_count(const sl_symtab *tab, const sl_str *sample, size_t n, uint32_t *count1,
+                             uint32_t *count2) {
+    memset(count1, 0, SL_SYMTAB_CODES * sizeof(*count1));
+    memset(count2, 0, (size_t)SL_SYMTAB_CODES * SL_SYMTAB_CODES * sizeof(*count2));
+
+    size_t budget = SL_SYMTAB_SAMPLE;
+    for (size_t i = 0; i < n && budget > 0; i++) {
+        const unsigned char *p = (const unsigned char *)sample[i];
+        size_t len = sl__get_hdr(sample[i])->len;
+        if (len > budget)
+            len = budget;
+        budget -= len;
+
+        unsigned prev = SL_SYMTAB_CODES;
+        for (size_t pos = 0; pos < len;) {
+            size_t mlen;
+            unsigned code = sl__symtab_match(tab, p + pos, len - pos, &mlen);
+            if (code == SL_SYMTAB_ESCAPE)
+                code = 256 + p[pos];
+            count1[code]++;
+            if (prev != SL_SYMTAB_CODES)
+                count2[prev * SL_SYMTAB_CODES + code]++;
+            prev = code;
+            pos += mlen;
+        }
+    }
+}
+
+/**
+ * Train a symbol table on a sample of strings
+ *
+ * FSST-style training: each generation encodes the sample with the current
+ * table, counts every symbol (or escaped byte) and every pair of adjacent
+ * ones, and keeps the 255 candidates (symbols, and pairs concatenated up
+ * to 8 bytes) that save the most bytes. Only the first 16 KB of the sample
+ * are used.
+ *
+ * @param sample Strings representative of the ones to compress
+ * @param n Number of strings
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The table, or NULL on error
+ */
+sl_symtab *sl_symtab_train(const sl_str *sample, size_t n, sl_err *err) {
+    if (!sample && n > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        sl_err e = sl__validate(sample[i], NULL);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return NULL;
+        }
+    }
+
+    // every code seen, plus at most one pair per adjacent codes in the sample
+    size_t max_cand = SL_SYMTAB_CODES + SL_SYMTAB_SAMPLE;
+    sl_symtab *tab = calloc(1, sizeof(*tab));
+    uint32_t *count1 = malloc(SL_SYMTAB_CODES * sizeof(*count1));
+    uint32_t *count2 = malloc((size_t)SL_SYMTAB_CODES * SL_SYMTAB_CODES * sizeof(*count2));
+    sl_sym_candidate *cand = malloc(max_cand * sizeof(*cand));
+    if (!tab || !count1 || !count2 || !cand) {
+        free(tab);
+        free(count1);
+        free(count2);
+        free(cand);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    sl__symtab_index(tab);
+    unsigned seen[SL_SYMTAB_CODES];
+    for (int gen = 0; gen < SL_SYMTAB_GENERATIONS; gen++) {
+        sl__symtab_count(tab, sample, n, count1, count2);
+
+        size_t nseen = 0, nc = 0;
+        for (unsigned a = 0; a < SL_SYMTAB_CODES; a++) {
+            if (!count1[a])
+                continue;
+            seen[nseen++] = a;
+            sl_sym_candidate *c = &cand[nc++];
+            memset(c->bytes, 0, sizeof(c->bytes));
+            c->len = sl__symtab_code_bytes(tab, a, c->bytes);
+            c->gain = (uint64_t)count1[a] * c->len;
+        }
+        for (size_t i = 0; i < nseen; i++) {
+            for (size_t j = 0; j < nseen; j++) {
+                uint32_t cnt = count2[seen[i] * SL_SYMTAB_CODES + seen[j]];
+                if (!cnt)
+                    continue;
+                sl_sym_candidate c;
+                memset(c.bytes, 0, sizeof(c.bytes));
+                size_t la = sl__symtab_code_bytes(tab, seen[i], c.bytes);
+                unsigned char tail[8];
+                size_t lb = sl__symtab_code_bytes(tab, seen[j], tail);
+                if (la + lb > 8)
+                    continue;
+                memcpy(c.bytes + la, tail, lb);
+                c.len = la + lb;
+                c.gain = (uint64_t)cnt * c.len;
+                cand[nc++] = c;
+            }
+        }
+
+        // merge candidates with the same bytes, then keep the best 255
+        qsort(cand, nc, sizeof(*cand), sl__sym_cmp_bytes);
+        size_t merged = 0;
+        for (size_t i = 0; i < nc; i++) {
+            if (merged > 0 && sl__sym_cmp_bytes(&cand[merged - 1], &cand[i]) == 0)
+                cand[merged - 1].gain += cand[i].gain;
+            else
+                cand[merged++] = cand[i];
+        }
+        qsort(cand, merged, sizeof(*cand), sl__sym_cmp_gain);
+
+        tab->count = merged < SL_SYMTAB_ESCAPE ? merged : SL_SYMTAB_ESCAPE;
+        for (size_t c = 0; c < tab->count; c++) {
+            memcpy(tab->sym[c], cand[c].bytes, 8);
+            tab->len[c] = (unsigned char)cand[c].len;
+        }
+        sl__symtab_index(tab);
+    }
+
+    free(count1);
+    free(count2);
+    free(cand);
+    sl__set_err(err, SL_OK);
+    return tab;
+}
+
+/**
+ * Free a symbol table
+ *
+ * @param tab Pointer to the table variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_symtab_free(sl_symtab **tab, sl_err *err) {
+    if (tab && *tab) {
+        free(*tab);
+        *tab = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Encode `n` bytes as symbol codes
+ *
+ * @param dst At least 2 * `n` bytes (every byte escaped)
+ * @return The number of bytes written
+ */
+static size_t sl__symtab_encode(const sl_symtab *tab, const unsigned char *src, size_t n, unsigned char *dst) {
+    unsigned char *op = dst;
+    for (size_t pos = 0; pos < n;) {
+        size_t mlen;
+        unsigned code = sl__symtab_match(tab, src + pos, n - pos, &mlen);
+        *op++ = (unsigned char)code;
+        if (code == SL_SYMTAB_ESCAPE)
+            *op++ = src[pos];
+        pos += mlen;
+    }
+    return (size_t)(op - dst);
+}
+
+static bool sl__symtab_decode(const sl_symtab *tab, const unsigned char *ip, size_t n, unsigned char *dst,
+                              size_t out_len) {
+    const unsigned char *iend = ip + n;
+    unsigned char *op = dst;
+    unsigned char *oend = dst + out_len;
+    while (ip < iend) {
+        unsigned code = *ip++;
+        if (code == SL_SYMTAB_ESCAPE) {
+            if (ip == iend || op == oend)
+                return false;
+            *op++ = *ip++;
+            continue;
+        }
+        if (code >= tab->count)
+            return false;
+        size_t len = tab->len[code];
+        if ((size_t)(oend - op) >= 8) {
+            memcpy(op, tab->sym[code], 8); // the zero padding is overwritten by what follows
+        } else if (len <= (size_t)(oend - op)) {
+            memcpy(op, tab->sym[code], len);
+        } else {
+            return false;
+        }
+        op += len;
+    }
+    return op == oend;
+}
+
+/**
+ * Compress with the symbol table `tab`, or LZ if it is NULL
+ * (falling back to a stored frame when the payload would not be smaller)
+ */
+static sl_str sl__compress(const sl_symtab *tab, sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+    if (src->flags & SL_HDR_COMPRESSED) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+
+    size_t n = src->len;
+    size_t bound = tab ? 2 * n : SL_LZ_HASH_SIZE + SL_LZ_BOUND(n);
+    if (n > SIZE_MAX / 2 - SL_VARINT_MAX - SL_CMP_CRC_SIZE - 2) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    // short strings are encoded on the stack and copied to an exact allocation,
+    // longer ones in place and the worst case room is given back
+    size_t head = 1 + sl__varint_len(n) + SL_CMP_CRC_SIZE;
+    unsigned char stack[SL_CMP_STACK];
+    unsigned char *out = stack;
+    sl_hdr *hdr = NULL;
+    if (head + bound > sizeof(stack)) {
+        hdr = sl__alloc_exact(head + bound, err);
+        if (!hdr)
+            return NULL;
+        out = (unsigned char *)hdr->data;
+    }
+
+    unsigned char *payload = out + head;
+    sl__varint_put(out + 1, n);
+
+    size_t used = n;
+    if (tab) {
+        used = sl__symtab_encode(tab, (const unsigned char *)src->data, n, payload);
+        out[0] = SL_CMP_SYMTAB;
+    } else if (n <= UINT32_MAX) {
+        for (int i = 0; i < SL_LZ_HASH_SIZE; i++)
+            payload[i] = (unsigned char)(src->hash >> (8 * i));
+        used = SL_LZ_HASH_SIZE + sl__lz_compress((const unsigned char *)src->data, n, payload + SL_LZ_HASH_SIZE);
+        out[0] = SL_CMP_LZ;
+    }
+    if (used >= n) {
+        memcpy(payload, src->data, n);
+        used = n;
+        out[0] = SL_CMP_STORED;
+    }
+
+    uint32_t crc = sl__crc32c_raw(0xFFFFFFFFu, src->data, n);
+    if (out[0] == SL_CMP_LZ)
+        crc = sl__crc32c_raw(crc, payload, SL_LZ_HASH_SIZE);
+    crc = ~crc;
+    for (int i = 0; i < SL_CMP_CRC_SIZE; i++)
+        payload[i - SL_CMP_CRC_SIZE] = (unsigned char)(crc >> (8 * i));
+
+    if (!hdr) {
+        hdr = sl__alloc_exact(head + used, err);
+        if (!hdr)
+            return NULL;
+        memcpy(hdr->data, stack, head + used);
+    } else {
+        sl_hdr *shrunk = sl__hdr_realloc(hdr, head + used + 1, NULL);
+        if (shrunk)
+            hdr = shrunk;
+        hdr->len = head + used;
+        hdr->cap = hdr->len + 1;
+        hdr->data[hdr->len] = '\0';
+    }
+    hdr->flags |= SL_HDR_COMPRESSED;
+    return sl__finish(hdr, err);
+}
+
+/**
+ * Compress a string (LZ4 block format)
+ *
+ * The result is a new read-only string flagged as compressed: it can be
+ * hashed, compared, checksummed or written to a pack file, but editing
+ * functions reject it with `SL_ERR_READONLY`. Input that does not shrink
+ * is stored as is (6 to 15 bytes of overhead). `str` is not modified.
+ *
+ * @param str The string to compress
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_INVALID` if `str` is already compressed)
+ * @return The compressed string, or NULL on error
+ */
+sl_str sl_compress(sl_str str, sl_err *err) {
+    return sl__compress(NULL, str, err);
+}
+
+/**
+ * Compress a short string with a trained symbol table
+ *
+ * The table is not stored in the string: the same table must be passed to
+ * `sl_decompress_with`.
+ *
+ * @see sl_compress
+ */
+sl_str sl_compress_with(const sl_symtab *tab, sl_str str, sl_err *err) {
+    if (!tab) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    return sl__compress(tab, str, err);
+}
+
+/**
+ * Decompress a string made by `sl_compress` or `sl_compress_with`
+ *
+ * @param tab The table used to compress, can be NULL for `sl_compress` strings
+ * @param str The compressed string
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_INVALID` if `str` is not compressed,
+ *            `SL_ERR_NULL` if `str` needs a table and `tab` is NULL,
+ *            `SL_ERR_FORMAT` if the frame is damaged)
+ * @return A new, regular string, or NULL on error
+ */
+sl_str sl_decompress_with(const sl_symtab *tab, sl_str str, sl_err *err) {
+    sl_hdr *src;
+    sl_err e = sl__validate(str, &src);
+    if (e == SL_OK && !(src->flags & SL_HDR_COMPRESSED))
+        e = SL_ERR_INVALID;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+
+    const unsigned char *in = (const unsigned char *)src->data;
+    uint64_t n;
+    size_t used;
+    if (src->len < 2 || sl__varint_get(in + 1, src->len - 1, &n, &used) != SL_OK || n >= SIZE_MAX) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+    if (src->len - 1 - used < SL_CMP_CRC_SIZE) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+    const unsigned char *payload = in + 1 + used + SL_CMP_CRC_SIZE;
+    size_t payload_len = src->len - 1 - used - SL_CMP_CRC_SIZE;
+
+    if (in[0] == SL_CMP_SYMTAB && !tab) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    // no method expands more than 255x (LZ), reject impossible lengths before allocating
+    if (in[0] > SL_CMP_SYMTAB || n / 255 > payload_len) {
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    sl_hdr *hdr = sl__alloc_exact((size_t)n, err);
+    if (!hdr)
+        return NULL;
+
+    unsigned char *out = (unsigned char *)hdr->data;
+    bool ok;
+    if (in[0] == SL_CMP_STORED) {
+        ok = payload_len == n;
+        if (ok)
+            memcpy(out, payload, payload_len);
+    } else if (in[0] == SL_CMP_LZ) {
+        ok = payload_len > SL_LZ_HASH_SIZE &&
+             sl__lz_decompress(payload + SL_LZ_HASH_SIZE, payload_len - SL_LZ_HASH_SIZE, out, (size_t)n);
+    } else {
+        ok = sl__symtab_decode(tab, payload, payload_len, out, (size_t)n);
+    }
+    if (!ok) {
+        sl__hdr_release(hdr);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    uint32_t crc = sl__crc32c_raw(0xFFFFFFFFu, out, (size_t)n);
+    if (in[0] == SL_CMP_LZ)
+        crc = sl__crc32c_raw(crc, payload, SL_LZ_HASH_SIZE);
+    uint32_t stored_crc = 0;
+    for (int i = 0; i < SL_CMP_CRC_SIZE; i++)
+        stored_crc |= (uint32_t)payload[i - SL_CMP_CRC_SIZE] << (8 * i);
+    if (~crc != stored_crc) {
+        sl__hdr_release(hdr);
+        sl__set_err(err, SL_ERR_FORMAT);
+        return NULL;
+    }
+
+    out[n] = '\0';
+    if (in[0] != SL_CMP_LZ)
+        return sl__finish(hdr, err);
+
+    // the CRC covered the stored hash too, so it can be trusted
+    hdr->hash = 0;
+    for (int i = 0; i < SL_LZ_HASH_SIZE; i++)
+        hdr->hash |= (uint64_t)payload[i] << (8 * i);
+    sl__set_err(err, SL_OK);
+    return hdr->data;
+}
+
+/**
+ * Decompress a string made by `sl_compress`
+ *
+ * @see sl_decompress_with
+ */
+sl_str sl_decompress(sl_str str, sl_err *err) {
+    return sl_decompress_with(NULL, str, err);
+}
+
+/**
+ * Check whether a string was made by `sl_compress` or `sl_compress_with`
+ */
+bool sl_is_compressed(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    sl__set_err(err, e);
+    return e == SL_OK && (hdr->flags & SL_HDR_COMPRESSED);
+}
+
+// DICTIONARY COLUMN
+
+/*
+ * Column of low-cardinality strings stored as 32-bit codes.
+ * `values[code]` is the (owned) string of a code, `slots` maps a value
+ * to its code by open addressing on the cached hash (a slot holds
+ * code + 1, 0 is empty, kept at most half full).
+ */
+struct sl_dict_column {
+    sl_str *values;     /**< Dictionary: code -> value */
+    size_t nvalues;     /**< Number of distinct values */
+    size_t values_cap;  /**< Capacity of `values` */
+    uint32_t *slots;    /**< Hash index of `values` */
+    size_t slot_mask;   /**< Number of slots - 1 (power of 2) */
+    uint32_t *codes;    /**< One code per row */
+    size_t nrows;       /**< Number of rows */
+    size_t rows_cap;    /**< Capacity of `codes` */
+};
+
+#define SL_DICT_MIN_SLOTS 64
+#define SL_DICT_MIN_ROWS 64
+
+static uint32_t sl__dict_lookup(const sl_dict_column *col, uint64_t hash, const void *bytes, size_t len,
+                                size_t *out_slot) {
+    size_t i = (size_t)hash & col->slot_mask;
+    for (; col->slots[i]; i = (i + 1) & col->slot_mask) {
+        uint32_t code = col->slots[i] - 1;
+        sl_hdr *hdr = sl__get_hdr(col->values[code]);
+        if (hdr->hash == hash && hdr->len == len && (len == 0 || memcmp(hdr->data, bytes, len) == 0))
+            return code;
+    }
+    if (out_slot)
+        *out_slot = i;
+    return SL_DICT_NONE;
+}
+
+static sl_err sl__dict_grow_slots(sl_dict_column *col) {
+    size_t new_slots = (col->slot_mask + 1) * 2;
+    uint32_t *grown = calloc(new_slots, sizeof(*grown));
+    if (!grown)
+        return SL_ERR_ALLOC;
+
+    for (size_t code = 0; code < col->nvalues; code++) {
+        size_t j = (size_t)sl__get_hdr(col->values[code])->hash & (new_slots - 1);
+        while (grown[j])
+            j = (j + 1) & (new_slots - 1);
+        grown[j] = (uint32_t)code + 1;
+    }
+
+    free(col->slots);
+    col->slots = grown;
+    col->slot_mask = new_slots - 1;
+    return SL_OK;
+}
+
+/**
+ * Code of a value, added to the dictionary if it is new
+ */
+static uint32_t sl__dict_intern(sl_dict_column *col, sl_hdr *hdr, sl_err *err) {
+    size_t slot;
+    uint32_t code = sl__dict_lookup(col, hdr->hash, hdr->data, hdr->len, &slot);
+    if (code != SL_DICT_NONE)
+        return code;
+
+    if (col->nvalues >= SL_DICT_NONE) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return SL_DICT_NONE;
+    }
+    if ((col->nvalues + 1) * 2 > col->slot_mask + 1) {
+        if (sl__dict_grow_slots(col) != SL_OK) {
+            sl__set_err(err, SL_ERR_ALLOC);
+            return SL_DICT_NONE;
+        }
+        sl__dict_lookup(col, hdr->hash, hdr->data, hdr->len, &slot);
+    }
+    if (col->nvalues == col->values_cap) {
+        size_t cap = col->values_cap ? col->values_cap * 2 : 16;
+        sl_str *values = realloc(col->values, cap * sizeof(*values));
+        if (!values) {
+            sl__set_err(err, SL_ERR_ALLOC);
+            return SL_DICT_NONE;
+        }
+        col->values = values;
+        col->values_cap = cap;
+    }
+
+    sl_hdr *copy = sl__alloc_exact(hdr->len, err);
+    if (!copy)
+        return SL_DICT_NONE;
+    if (hdr->len)
+        memcpy(copy->data, hdr->data, hdr->len);
+    copy->hash = hdr->hash;
+
+    code = (uint32_t)col->nvalues++;
+    col->values[code] = copy->data;
+    col->slots[slot] = code + 1;
+    return code;
+}
+
+static bool sl__dict_reserve_rows(sl_dict_column *col, size_t extra) {
+    if (extra <= col->rows_cap - col->nrows)
+        return true;
+    if (extra > SIZE_MAX / sizeof(uint32_t) / 2 - col->nrows)
+        return false;
+
+    // double, or fit a large bulk append exactly
+    size_t cap = col->rows_cap ? col->rows_cap * 2 : SL_DICT_MIN_ROWS;
+    if (cap < col->nrows + extra)
+        cap = col->nrows + extra;
+    uint32_t *codes = realloc(col->codes, cap * sizeof(*codes));
+    if (!codes)
+        return false;
+    col->codes = codes;
+    col->rows_cap = cap;
+    return true;
+}
+
+/**
+ * Create an empty dictionary-encoded column
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The column, or NULL on error
+ */
+sl_dict_column *sl_dict_column_new(sl_err *err) {
+    sl_dict_column *col = calloc(1, sizeof(*col));
+    if (!col) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+
+    col->slots = calloc(SL_DICT_MIN_SLOTS, sizeof(*col->slots));
+    if (!col->slots) {
+        free(col);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    col->slot_mask = SL_DICT_MIN_SLOTS - 1;
+
+    sl__set_err(err, SL_OK);
+    return col;
+}
+
+/**
+ * Free a column and its dictionary
+ *
+ * @param col Pointer to the column variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_dict_column_free(sl_dict_column **col, sl_err *err) {
+    if (col && *col) {
+        sl_dict_column *c = *col;
+        for (size_t i = 0; i < c->nvalues; i++)
+            sl_free(&c->values[i], NULL);
+        free(c->values);
+        free(c->slots);
+        free(c->codes);
+        free(c);
+        *col = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Append a row
+ *
+ * The value is found in the dictionary by its cached hash (it is not
+ * rehashed), and copied there the first time it is seen.
+ *
+ * @param col The column
+ * @param value The value of the row
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (`SL_ERR_RANGE` if the dictionary already holds 2^32 - 1 values)
+ * @return The code of the value, or `SL_DICT_NONE` on error
+ */
+uint32_t sl_dict_column_append(sl_dict_column *col, sl_str value, sl_err *err) {
+    return sl_dict_column_append_many(col, &value, 1, err) == 1 ? col->codes[col->nrows - 1] : SL_DICT_NONE;
+}
+
+/**
+ * Append `n` rows
+ *
+ * The row array grows once, and a run of the same value (same string, or
+ * equal hash and bytes) is looked up only once. On error no row is added.
+ *
+ * @return The number of rows appended (`n`, or 0 on error)
+ */
+size_t sl_dict_column_append_many(sl_dict_column *col, const sl_str *values, size_t n, sl_err *err) {
+    if (!col || (!values && n > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    if (!sl__dict_reserve_rows(col, n)) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return 0;
+    }
+
+    sl_hdr *prev = NULL;
+    uint32_t code = SL_DICT_NONE;
+    uint32_t *out = col->codes + col->nrows;
+    for (size_t i = 0; i < n; i++) {
+        sl_hdr *hdr;
+        sl_err e = sl__validate(values[i], &hdr);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return 0;
+        }
+
+        if (!prev || (hdr != prev && (hdr->hash != prev->hash || hdr->len != prev->len ||
+                                      memcmp(hdr->data, prev->data, hdr->len) != 0))) {
+            code = sl__dict_intern(col, hdr, err);
+            if (code == SL_DICT_NONE)
+                return 0;
+            prev = hdr;
+        }
+        out[i] = code;
+    }
+
+    col->nrows += n;
+    sl__set_err(err, SL_OK);
+    return n;
+}
+
+/**
+ * Number of rows
+ */
+size_t sl_dict_column_rows(const sl_dict_column *col, sl_err *err) {
+    if (!col) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return col->nrows;
+}
+
+/**
+ * Number of distinct values (codes are 0 .. cardinality - 1)
+ */
+size_t sl_dict_column_cardinality(const sl_dict_column *col, sl_err *err) {
+    if (!col) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return col->nvalues;
+}
+
+/**
+ * Heap memory used by the column (codes, dictionary and its index)
+ */
+size_t sl_dict_column_memory(const sl_dict_column *col, sl_err *err) {
+    if (!col) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+
+    size_t total = sizeof(*col) + col->rows_cap * sizeof(*col->codes) + col->values_cap * sizeof(*col->values) +
+                   (col->slot_mask + 1) * sizeof(*col->slots);
+    for (size_t i = 0; i < col->nvalues; i++)
+        total += offsetof(sl_hdr, data) + sl__get_hdr(col->values[i])->cap;
+    sl__set_err(err, SL_OK);
+    return total;
+}
+
+/**
+ * The code of every row, for scans (valid until the next append)
+ *
+ * @param col The column
+ * @param n Receives the number of rows, can be NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+const uint32_t *sl_dict_column_codes(const sl_dict_column *col, size_t *n, sl_err *err) {
+    if (!col) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    if (n)
+        *n = col->nrows;
+    sl__set_err(err, SL_OK);
+    return col->codes;
+}
+
+/**
+ * The value of a code
+ *
+ * @return A view into the dictionary (valid until the column is freed),
+ *         or an empty view with `SL_ERR_RANGE` if the code does not exist
+ */
+sl_view sl_dict_column_value(const sl_dict_column *col, uint32_t code, sl_err *err) {
+    sl_view v = {NULL, 0};
+    if (!col) {
+        sl__set_err(err, SL_ERR_NULL);
+        return v;
+    }
+    if (code >= col->nvalues) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return v;
+    }
+
+    v.data = col->values[code];
+    v.len = sl__get_hdr(col->values[code])->len;
+    sl__set_err(err, SL_OK);
+    return v;
+}
+
+/**
+ * The value of a row
+ *
+ * @see sl_dict_column_value
+ */
+sl_view sl_dict_column_get(const sl_dict_column *col, size_t row, sl_err *err) {
+    if (col && row >= col->nrows) {
+        sl__set_err(err, SL_ERR_RANGE);
+        sl_view v = {NULL, 0};
+        return v;
+    }
+    return sl_dict_column_value(col, col ? col->codes[row] : 0, err);
+}
+
+/**
+ * The code of a value
+ *
+ * @return The code, or `SL_DICT_NONE` (with `SL_OK`) if no row has this value
+ */
+uint32_t sl_dict_column_code(const sl_dict_column *col, const void *bytes, size_t len, sl_err *err) {
+    if (!col || (!bytes && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return SL_DICT_NONE;
+    }
+    sl__set_err(err, SL_OK);
+    return sl__dict_lookup(col, sl__compute_hash(bytes, len), bytes, len, NULL);
+}
+
+/**
+ * Scalar filter of rows `start` .. `n` - 1
+ */
+static size_t sl__dict_filter_scalar(const uint32_t *codes, size_t start, size_t n, uint32_t code, size_t *out) {
+    size_t k = 0;
+    if (!out) {
+        for (size_t i = start; i < n; i++)
+            k += codes[i] == code;
+        return k;
+    }
+    // branchless: always store, advance only on a match
+    for (size_t i = start; i < n; i++) {
+        out[k] = i;
+        k += codes[i] == code;
+    }
+    return k;
+}
+
+#if defined(SL_HAVE_AVX2_KERNELS) && defined(__x86_64__)
+/**
+ * Compare 8 codes at a time: blocks without a match are skipped, full
+ * blocks store 8 consecutive rows with two vector stores
+ *
+ * @return Number of rows matched in the first `n` rounded down to 8
+ */
+__attribute__((target("avx2"))) static size_t sl__dict_filter_avx2(const uint32_t *codes, size_t n, uint32_t code,
+                                                                   size_t *out, size_t *done) {
+    __m256i needle = _mm256_set1_epi32((int)code);
+    __m256i lo = _mm256_setr_epi64x(0, 1, 2, 3);
+    __m256i hi = _mm256_setr_epi64x(4, 5, 6, 7);
+    size_t k = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i c = _mm256_loadu_si256((const __m256i *)(codes + i));
+        unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(c, needle)));
+        if (!out) {
+            k += (size_t)__builtin_popcount(mask);
+        } else if (mask == 0xFF) {
+            __m256i base = _mm256_set1_epi64x((long long)i);
+            _mm256_storeu_si256((__m256i *)(out + k), _mm256_add_epi64(base, lo));
+            _mm256_storeu_si256((__m256i *)(out + k + 4), _mm256_add_epi64(base, hi));
+            k += 8;
+        } else {
+            while (mask) {
+                out[k++] = i + (size_t)__builtin_ctz(mask);
+                mask &= mask - 1;
+            }
+        }
+    }
+    *done = i;
+    return k;
+}
+#endif
+
+/**
+ * Rows equal to a value, compared as codes
+ *
+ * The value is looked up once in the dictionary, then the scan compares
+ * 32-bit codes (8 per instruction with AVX2) instead of strings.
+ *
+ * @param col The column
+ * @param bytes The value
+ * @param len Length of the value
+ * @param out Receives the matching row numbers in increasing order, room for
+ *        `sl_dict_column_rows` entries; NULL to only count them
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The number of matching rows
+ */
+size_t sl_dict_column_filter_eq(const sl_dict_column *col, const void *bytes, size_t len, size_t *out,
+                                sl_err *err) {
+    uint32_t code = sl_dict_column_code(col, bytes, len, err);
+    if (code == SL_DICT_NONE)
+        return 0;
+
+    size_t k = 0, done = 0;
+#if defined(SL_HAVE_AVX2_KERNELS) && defined(__x86_64__)
+    if (sl__cpu_has_avx2())
+        k = sl__dict_filter_avx2(col->codes, col->nrows, code, out, &done);
+#endif
+    return k + sl__dict_filter_scalar(col->codes, done, col->nrows, code, out ? out + k : NULL);
+}
+
+// RADIX TREE
+
+/*
+ * Adaptive radix tree (ART): inner nodes hold 4, 16, 48 or 256 children
+ * and grow into the next size when full. Paths without branches are
+ * compressed into a node prefix, of which only the first SL_RADIX_PREFIX
+ * bytes are stored; the rest is read from any leaf below the node.
+ * Keys are binary: a key that ends inside the tree (a prefix of other
+ * keys) is stored in the `leaf` field of the node where it ends.
+ * Child pointers to leaves are tagged with bit 0.
+ */
+#define SL_RADIX_PREFIX 8
+
+enum { SL_RADIX_N4, SL_RADIX_N16, SL_RADIX_N48, SL_RADIX_N256 };
+
+typedef struct sl_radix_leaf {
+    void *value;
+    size_t len;
+    unsigned char key[];
+} sl_radix_leaf;
+
+typedef struct {
+    uint8_t type;                          /**< SL_RADIX_N* */
+    uint16_t count;                        /**< Number of children */
+    uint32_t prefix_len;                   /**< Length of the compressed path */
+    unsigned char prefix[SL_RADIX_PREFIX]; /**< First bytes of the compressed path */
+    sl_radix_leaf *leaf;                   /**< Key ending at this node, or NULL */
+} sl_radix_node;
+
+typedef struct {
+    sl_radix_node n;
+    unsigned char keys[4]; /**< Sorted */
+    void *children[4];
+} sl_radix_node4;
+
+typedef struct {
+    sl_radix_node n;
+    unsigned char keys[16]; /**< Sorted */
+    void *children[16];
+} sl_radix_node16;
+
+typedef struct {
+    sl_radix_node n;
+    unsigned char index[256]; /**< Slot + 1 in `children`, 0 if absent */
+    void *children[48];
+} sl_radix_node48;
+
+typedef struct {
+    sl_radix_node n;
+    void *children[256];
+} sl_radix_node256;
+
+struct sl_radix {
+    void *root;
+    size_t count; /**< Number of keys */
+};
+
+static inline bool sl__radix_is_leaf(const void *p) {
+    return ((uintptr_t)p & 1) != 0;
+}
+
+static inline sl_radix_leaf *sl__radix_as_leaf(const void *p) {
+    return (sl_radix_leaf *)((uintptr_t)p & ~(uintptr_t)1);
+}
+
+static inline void *sl__radix_tag(sl_radix_leaf *leaf) {
+    return (void *)((uintptr_t)leaf | 1);
+}
+
+static sl_radix_leaf *sl__radix_new_leaf(const unsigned char *key, size_t len, void *value) {
+    if (len > SIZE_MAX - sizeof(sl_radix_leaf))
+        return NULL;
+    sl_radix_leaf *leaf = malloc(sizeof(*leaf) + len);
+    if (!leaf)
+        return NULL;
+    leaf->value = value;
+    leaf->len = len;
+    if (len)
+        memcpy(leaf->key, key, len);
+    return leaf;
+}
+
+static sl_radix_node *sl__radix_new_node(int type) {
+    static const size_t sizes[] = {sizeof(sl_radix_node4), sizeof(sl_radix_node16), sizeof(sl_radix_node48),
+                                   sizeof(sl_radix_node256)};
+    sl_radix_node *n = calloc(1, sizes[type]);
+    if (n)
+        n->type = (uint8_t)type;
+    return n;
+}
+
+/**
+ * Slot of the child for byte `b`, or NULL
+ */
+static void **sl__radix_child(const sl_radix_node *n, unsigned char b) {
+    switch (n->type) {
+    case SL_RADIX_N4: {
+        sl_radix_node4 *x = (sl_radix_node4 *)n;
+        for (unsigned i = 0; i < n->count; i++)
+            if (x->keys[i] == b)
+                return &x->children[i];
+        return NULL;
+    }
+    case SL_RADIX_N16: {
+        sl_radix_node16 *x = (sl_radix_node16 *)n;
+#if defined(__SSE2__)
+        __m128i eq = _mm_cmpeq_epi8(_mm_set1_epi8((char)b), _mm_loadu_si128((const __m128i *)x->keys));
+        unsigned mask = (unsigned)_mm_movemask_epi8(eq) & ((1u << n->count) - 1);
+        return mask ? &x->children[__builtin_ctz(mask)] : NULL;
+#else
+        for (unsigned i = 0; i < n->count; i++)
+            if (x->keys[i] == b)
+                return &x->children[i];
+        return NULL;
+#endif
+    }
+    case SL_RADIX_N48: {
+        sl_radix_node48 *x = (sl_radix_node48 *)n;
+        return x->index[b] ? &x->children[x->index[b] - 1] : NULL;
+    }
+    default: {
+        sl_radix_node256 *x = (sl_radix_node256 *)n;
+        return x->children[b] ? &x->children[b] : NULL;
+    }
+    }
+}
+
+/**
+ * Insert into a sorted key array (node 4 and node 16)
+ */
+static void sl__radix_insert_sorted(unsigned char *keys, void **children, unsigned count, unsigned char b,
+                                    void *child) {
+    unsigned i = 0;
+    while (i < count && keys[i] < b)
+        i++;
+    memmove(keys + i + 1, keys + i, count - i);
+    memmove(children + i + 1, children + i, (count - i) * sizeof(*children));
+    keys[i] = b;
+    children[i] = child;
+}
+
+/**
+ * Add a child for byte `b` (not present yet), growing the node into the
+ * next size when it is full (`*ref` is updated)
+ */
+static sl_err sl__radix_add_child(void **ref, sl_radix_node *n, unsigned char b, void *child) {
+    switch (n->type) {
+    case SL_RADIX_N4: {
+        sl_radix_node4 *x = (sl_radix_node4 *)n;
+        if (n->count < 4) {
+            sl__radix_insert_sorted(x->keys, x->children, n->count++, b, child);
+            return SL_OK;
+        }
+        sl_radix_node16 *g = (sl_radix_node16 *)sl__radix_new_node(SL_RADIX_N16);
+        if (!g)
+            return SL_ERR_ALLOC;
+        g->n = *n;
+        g->n.type = SL_RADIX_N16;
+        memcpy(g->keys, x->keys, 4);
+        memcpy(g->children, x->children, sizeof(x->children));
+        free(x);
+        *ref = g;
+        return sl__radix_add_child(ref, &g->n, b, child);
+    }
+    case SL_RADIX_N16: {
+        sl_radix_node16 *x = (sl_radix_node16 *)n;
+        if (n->count < 16) {
+            sl__radix_insert_sorted(x->keys, x->children, n->count++, b, child);
+            return SL_OK;
+        }
+        sl_radix_node48 *g = (sl_radix_node48 *)sl__radix_new_node(SL_RADIX_N48);
+        if (!g)
+            return SL_ERR_ALLOC;
+        g->n = *n;
+        g->n.type = SL_RADIX_N48;
+        for (unsigned i = 0; i < 16; i++) {
+            g->index[x->keys[i]] = (unsigned char)(i + 1);
+            g->children[i] = x->children[i];
+        }
+        free(x);
+        *ref = g;
+        return sl__radix_add_child(ref, &g->n, b, child);
+    }
+    case SL_RADIX_N48: {
+        sl_radix_node48 *x = (sl_radix_node48 *)n;
+        if (n->count < 48) {
+            // children are never removed, so the free slots are at the end
+            x->children[n->count] = child;
+            x->index[b] = (unsigned char)++n->count;
+            return SL_OK;
+        }
+        sl_radix_node256 *g = (sl_radix_node256 *)sl__radix_new_node(SL_RADIX_N256);
+        if (!g)
+            return SL_ERR_ALLOC;
+        g->n = *n;
+        g->n.type = SL_RADIX_N256;
+        for (unsigned c = 0; c < 256; c++)
+            if (x->index[c])
+                g->children[c] = x->children[x->index[c] - 1];
+        free(x);
+        *ref = g;
+        return sl__radix_add_child(ref, &g->n, b, child);
+    }
+    default: {
+        sl_radix_node256 *x = (sl_radix_node256 *)n;
+        x->children[b] = child;
+        n->count++;
+        return SL_OK;
+    }
+    }
+}
+
+/**
+ * Smallest leaf below a node (the key ending at the node, else the first child)
+ */
+static sl_radix_leaf *sl__radix_min_leaf(const void *p) {
+    while (!sl__radix_is_leaf(p)) {
+        const sl_radix_node *n = p;
+        if (n->leaf)
+            return n->leaf;
+        switch (n->type) {
+        case SL_RADIX_N4:
+            p = ((const sl_radix_node4 *)n)->children[0];
+            break;
+        case SL_RADIX_N16:
+            p = ((const sl_radix_node16 *)n)->children[0];
+            break;
+        case SL_RADIX_N48: {
+            const sl_radix_node48 *x = (const sl_radix_node48 *)n;
+            unsigned c = 0;
+            while (!x->index[c])
+                c++;
+            p = x->children[x->index[c] - 1];
+            break;
+        }
+        default: {
+            const sl_radix_node256 *x = (const sl_radix_node256 *)n;
+            unsigned c = 0;
+            while (!x->children[c])
+                c++;
+            p = x->children[c];
+            break;
+        }
+        }
+    }
+    return sl__radix_as_leaf(p);
+}
+
+/**
+ * Number of prefix bytes of `n` matching `key` from `depth`
+ * (the whole prefix is compared, reading past the stored bytes from a leaf)
+ */
+static size_t sl__radix_prefix_match(const sl_radix_node *n, const unsigned char *key, size_t len, size_t depth) {
+    size_t max = len - depth < n->prefix_len ? len - depth : n->prefix_len;
+    size_t stored = max < SL_RADIX_PREFIX ? max : SL_RADIX_PREFIX;
+    for (size_t i = 0; i < stored; i++)
+        if (n->prefix[i] != key[depth + i])
+            return i;
+    if (max <= SL_RADIX_PREFIX)
+        return max;
+
+    const sl_radix_leaf *leaf = sl__radix_min_leaf(n);
+    return SL_RADIX_PREFIX + sl__common_prefix(leaf->key + depth + SL_RADIX_PREFIX, key + depth + SL_RADIX_PREFIX,
+                                               max - SL_RADIX_PREFIX);
+}
+
+/**
+ * Store `leaf` in a new node whose path ends at `depth`
+ */
+static sl_err sl__radix_place(void **ref, sl_radix_node *n, sl_radix_leaf *leaf, size_t depth) {
+    if (leaf->len == depth) {
+        n->leaf = leaf;
+        return SL_OK;
+    }
+    return sl__radix_add_child(ref, n, leaf->key[depth], sl__radix_tag(leaf));
+}
+
+static sl_err sl__radix_insert(sl_radix *t, const unsigned char *key, size_t len, void *value) {
+    void **ref = &t->root;
+    size_t depth = 0;
+    sl_radix_leaf *leaf;
+
+    for (;;) {
+        void *p = *ref;
+        if (!p) {
+            leaf = sl__radix_new_leaf(key, len, value);
+            if (!leaf)
+                return SL_ERR_ALLOC;
+            *ref = sl__radix_tag(leaf);
+            t->count++;
+            return SL_OK;
+        }
+
+        if (sl__radix_is_leaf(p)) {
+            sl_radix_leaf *old = sl__radix_as_leaf(p);
+            if (old->len == len && memcmp(old->key, key, len) == 0) {
+                old->value = value;
+                return SL_OK;
+            }
+
+            // split the leaf: a node for the common part, then both leaves
+            size_t shared = sl__common_prefix(old->key + depth, key + depth,
+                                              (old->len < len ? old->len : len) - depth);
+            sl_radix_node *n = sl__radix_new_node(SL_RADIX_N4);
+            leaf = n ? sl__radix_new_leaf(key, len, value) : NULL;
+            if (!leaf) {
+                free(n);
+                return SL_ERR_ALLOC;
+            }
+            n->prefix_len = (uint32_t)shared;
+            memcpy(n->prefix, key + depth, shared < SL_RADIX_PREFIX ? shared : SL_RADIX_PREFIX);
+            void *np = n;
+            sl__radix_place(&np, n, old, depth + shared);
+            sl__radix_place(&np, n, leaf, depth + shared);
+            *ref = np;
+            t->count++;
+            return SL_OK;
+        }
+
+        sl_radix_node *n = p;
+        if (n->prefix_len) {
+            size_t m = sl__radix_prefix_match(n, key, len, depth);
+            if (m < n->prefix_len) {
+                // split the compressed path at the first differing byte
+                sl_radix_node *parent = sl__radix_new_node(SL_RADIX_N4);
+                leaf = parent ? sl__radix_new_leaf(key, len, value) : NULL;
+                if (!leaf) {
+                    free(parent);
+                    return SL_ERR_ALLOC;
+                }
+                parent->prefix_len = (uint32_t)m;
+                memcpy(parent->prefix, key + depth, m < SL_RADIX_PREFIX ? m : SL_RADIX_PREFIX);
+
+                const sl_radix_leaf *any = n->prefix_len > SL_RADIX_PREFIX ? sl__radix_min_leaf(n) : NULL;
+                unsigned char b = m < SL_RADIX_PREFIX ? n->prefix[m] : any->key[depth + m];
+                size_t rest = n->prefix_len - m - 1;
+                if (!any)
+                    memmove(n->prefix, n->prefix + m + 1, rest);
+                else
+                    memcpy(n->prefix, any->key + depth + m + 1, rest < SL_RADIX_PREFIX ? rest : SL_RADIX_PREFIX);
+                n->prefix_len = (uint32_t)rest;
+
+                void *pp = parent;
+                sl__radix_add_child(&pp, parent, b, n);
+                sl__radix_place(&pp, parent, leaf, depth + m);
+                *ref = pp;
+                t->count++;
+                return SL_OK;
+            }
+            depth += n->prefix_len;
+        }
+
+        if (depth == len) {
+            if (n->leaf) {
+                n->leaf->value = value;
+                return SL_OK;
+            }
+            n->leaf = sl__radix_new_leaf(key, len, value);
+            if (!n->leaf)
+                return SL_ERR_ALLOC;
+            t->count++;
+            return SL_OK;
+        }
+
+        void **child = sl__radix_child(n, key[depth]);
+        if (child) {
+            ref = child;
+            depth++;
+            continue;
+        }
+
+        leaf = sl__radix_new_leaf(key, len, value);
+        if (!leaf)
+            return SL_ERR_ALLOC;
+        if (sl__radix_add_child(ref, n, key[depth], sl__radix_tag(leaf)) != SL_OK) {
+            free(leaf);
+            return SL_ERR_ALLOC;
+        }
+        t->count++;
+        return SL_OK;
+    }
+}
+
+static bool sl__radix_leaf_is(const sl_radix_leaf *leaf, const unsigned char *key, size_t len) {
+    return leaf->len == len && memcmp(leaf->key, key, len) == 0;
+}
+
+/**
+ * Optimistic descent: only the stored prefix bytes are compared on the way,
+ * the leaf found is compared in full
+ */
+static sl_radix_leaf *sl__radix_get(const sl_radix *t, const unsigned char *key, size_t len) {
+    const void *p = t->root;
+    size_t depth = 0;
+    while (p) {
+        if (sl__radix_is_leaf(p)) {
+            sl_radix_leaf *leaf = sl__radix_as_leaf(p);
+            return sl__radix_leaf_is(leaf, key, len) ? leaf : NULL;
+        }
+
+        const sl_radix_node *n = p;
+        if (n->prefix_len > len - depth)
+            return NULL;
+        size_t stored = n->prefix_len < SL_RADIX_PREFIX ? n->prefix_len : SL_RADIX_PREFIX;
+        if (stored && memcmp(n->prefix, key + depth, stored) != 0)
+            return NULL;
+        depth += n->prefix_len;
+
+        if (depth == len)
+            return n->leaf && sl__radix_leaf_is(n->leaf, key, len) ? n->leaf : NULL;
+        void **child = sl__radix_child(n, key[depth++]);
+        p = child ? *child : NULL;
+    }
+    return NULL;
+}
+
+/**
+ * Deepest stored key that is a prefix of `key`
+ *
+ * Candidates are met in increasing length on the way down and each is
+ * checked in full, so skipping the unstored prefix bytes is safe: below a
+ * mismatch no key can match anymore.
+ */
+static sl_radix_leaf *sl__radix_longest(const sl_radix *t, const unsigned char *key, size_t len) {
+    sl_radix_leaf *best = NULL;
+    const void *p = t->root;
+    size_t depth = 0;
+    while (p) {
+        if (sl__radix_is_leaf(p)) {
+            sl_radix_leaf *leaf = sl__radix_as_leaf(p);
+            if (leaf->len <= len && memcmp(leaf->key, key, leaf->len) == 0)
+                best = leaf;
+            break;
+        }
+
+        const sl_radix_node *n = p;
+        if (n->prefix_len > len - depth)
+            break;
+        size_t stored = n->prefix_len < SL_RADIX_PREFIX ? n->prefix_len : SL_RADIX_PREFIX;
+        if (stored && memcmp(n->prefix, key + depth, stored) != 0)
+            break;
+        depth += n->prefix_len;
+
+        if (n->leaf && memcmp(n->leaf->key, key, n->leaf->len) == 0)
+            best = n->leaf;
+        if (depth == len)
+            break;
+        void **child = sl__radix_child(n, key[depth++]);
+        p = child ? *child : NULL;
+    }
+    return best;
+}
+
+/**
+ * Visit every key below `p` in byte order
+ *
+ * @return false if the callback stopped the walk
+ */
+static bool sl__radix_walk(const void *p, sl_radix_visit fn, void *ctx, size_t *visited) {
+    if (sl__radix_is_leaf(p)) {
+        const sl_radix_leaf *leaf = sl__radix_as_leaf(p);
+        sl_view key = {(const char *)leaf->key, leaf->len};
+        (*visited)++;
+        return fn(key, leaf->value, ctx);
+    }
+
+    const sl_radix_node *n = p;
+    if (n->leaf && !sl__radix_walk(sl__radix_tag(n->leaf), fn, ctx, visited))
+        return false;
+
+    switch (n->type) {
+    case SL_RADIX_N4:
+    case SL_RADIX_N16: {
+        void *const *children = n->type == SL_RADIX_N4 ? ((const sl_radix_node4 *)n)->children
+                                                       : ((const sl_radix_node16 *)n)->children;
+        for (unsigned i = 0; i < n->count; i++)
+            if (!sl__radix_walk(children[i], fn, ctx, visited))
+                return false;
+        return true;
+    }
+    case SL_RADIX_N48: {
+        const sl_radix_node48 *x = (const sl_radix_node48 *)n;
+        for (unsigned c = 0; c < 256; c++)
+            if (x->index[c] && !sl__radix_walk(x->children[x->index[c] - 1], fn, ctx, visited))
+                return false;
+        return true;
+    }
+    default: {
+        const sl_radix_node256 *x = (const sl_radix_node256 *)n;
+        for (unsigned c = 0; c < 256; c++)
+            if (x->children[c] && !sl__radix_walk(x->children[c], fn, ctx, visited))
+                return false;
+        return true;
+    }
+    }
+}
+
+static void sl__radix_destroy(void *p) {
+    if (!p)
+        return;
+    if (sl__radix_is_leaf(p)) {
+        free(sl__radix_as_leaf(p));
+        return;
+    }
+
+    sl_radix_node *n = p;
+    free(n->leaf);
+    switch (n->type) {
+    case SL_RADIX_N4:
+        for (unsigned i = 0; i < n->count; i++)
+            sl__radix_destroy(((sl_radix_node4 *)n)->children[i]);
+        break;
+    case SL_RADIX_N16:
+        for (unsigned i = 0; i < n->count; i++)
+            sl__radix_destroy(((sl_radix_node16 *)n)->children[i]);
+        break;
+    case SL_RADIX_N48:
+        for (unsigned i = 0; i < n->count; i++)
+            sl__radix_destroy(((sl_radix_node48 *)n)->children[i]);
+        break;
+    default:
+        for (unsigned c = 0; c < 256; c++)
+            sl__radix_destroy(((sl_radix_node256 *)n)->children[c]);
+        break;
+    }
+    free(n);
+}
+
+/**
+ * Create an empty radix tree
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The tree, or NULL on error
+ */
+sl_radix *sl_radix_new(sl_err *err) {
+    sl_radix *t = calloc(1, sizeof(*t));
+    sl__set_err(err, t ? SL_OK : SL_ERR_ALLOC);
+    return t;
+}
+
+/**
+ * Free a radix tree (the values are not freed)
+ *
+ * @param t Pointer to the tree variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_radix_free(sl_radix **t, sl_err *err) {
+    if (t && *t) {
+        sl__radix_destroy((*t)->root);
+        free(*t);
+        *t = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Insert a key, or replace the value of an existing key
+ *
+ * The key bytes are copied. Keys are binary (they may contain zeros) and a
+ * key may be a prefix of another.
+ *
+ * @param t The tree
+ * @param key The key bytes
+ * @param len Length of the key
+ * @param value The value (any pointer, NULL included)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_radix_insert(sl_radix *t, const void *key, size_t len, void *value, sl_err *err) {
+    if (!t || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    if (len > UINT32_MAX) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+    sl__set_err(err, sl__radix_insert(t, key ? key : "", len, value));
+}
+
+/**
+ * Insert a string key (its length is `sl_len`, so it may contain zeros)
+ *
+ * @see sl_radix_insert
+ */
+void sl_radix_insert_str(sl_radix *t, sl_str key, void *value, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(key, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+    sl_radix_insert(t, hdr->data, hdr->len, value, err);
+}
+
+/**
+ * Look a key up
+ *
+ * @param t The tree
+ * @param key The key bytes
+ * @param len Length of the key
+ * @param value Receives the value if the key is found, can be NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return true if the key is in the tree
+ */
+bool sl_radix_get(const sl_radix *t, const void *key, size_t len, void **value, sl_err *err) {
+    if (!t || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+
+    sl_radix_leaf *leaf = sl__radix_get(t, key ? key : "", len);
+    if (leaf && value)
+        *value = leaf->value;
+    sl__set_err(err, SL_OK);
+    return leaf != NULL;
+}
+
+/**
+ * Look a string key up
+ *
+ * @see sl_radix_get
+ */
+bool sl_radix_get_str(const sl_radix *t, sl_str key, void **value, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(key, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return false;
+    }
+    return sl_radix_get(t, hdr->data, hdr->len, value, err);
+}
+
+/**
+ * Find the longest key that is a prefix of `key` (longest-prefix match)
+ *
+ * @param t The tree
+ * @param key The bytes to match, for example a request path
+ * @param len Length of `key`
+ * @param match_len Receives the length of the matching key, can be NULL
+ * @param value Receives the value of the matching key, can be NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return true if some key matched
+ */
+bool sl_radix_longest_prefix(const sl_radix *t, const void *key, size_t len, size_t *match_len, void **value,
+                             sl_err *err) {
+    if (!t || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+
+    sl_radix_leaf *leaf = sl__radix_longest(t, key ? key : "", len);
+    if (leaf) {
+        if (match_len)
+            *match_len = leaf->len;
+        if (value)
+            *value = leaf->value;
+    }
+    sl__set_err(err, SL_OK);
+    return leaf != NULL;
+}
+
+/**
+ * Longest-prefix match of a string
+ *
+ * @see sl_radix_longest_prefix
+ */
+bool sl_radix_longest_prefix_str(const sl_radix *t, sl_str key, size_t *match_len, void **value, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(key, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return false;
+    }
+    return sl_radix_longest_prefix(t, hdr->data, hdr->len, match_len, value, err);
+}
+
+/**
+ * Visit every key starting with `prefix`, in byte order
+ *
+ * @param t The tree
+ * @param prefix The prefix (length 0 visits every key)
+ * @param len Length of the prefix
+ * @param fn Called with each key (a view valid until the tree is modified)
+ *        and its value; returning false stops the walk
+ * @param ctx Passed to `fn`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The number of keys visited
+ */
+size_t sl_radix_each_prefix(const sl_radix *t, const void *prefix, size_t len, sl_radix_visit fn, void *ctx,
+                            sl_err *err) {
+    if (!t || !fn || (!prefix && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+
+    // descend to the first node whose path covers the prefix
+    const unsigned char *key = prefix;
+    const void *p = t->root;
+    size_t depth = 0;
+    while (p && !sl__radix_is_leaf(p)) {
+        const sl_radix_node *n = p;
+        if (depth + n->prefix_len >= len)
+            break;
+        if (sl__radix_prefix_match(n, key, len, depth) != n->prefix_len)
+            return 0;
+        depth += n->prefix_len;
+        void **child = sl__radix_child(n, key[depth++]);
+        p = child ? *child : NULL;
+    }
+    if (!p)
+        return 0;
+
+    // every key below shares the path: check it once against the prefix
+    const sl_radix_leaf *any = sl__radix_min_leaf(p);
+    if (any->len < len || (len && memcmp(any->key, key, len) != 0))
+        return 0;
+
+    size_t visited = 0;
+    sl__radix_walk(p, fn, ctx, &visited);
+    return visited;
+}
+
+/**
+ * Number of keys
+ */
+size_t sl_radix_count(const sl_radix *t, sl_err *err) {
+    if (!t) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return t->count;
+}
+
+// B-TREE
+
+/*
+ * B+ tree keyed by strings. Every node stores the first 8 bytes of its
+ * keys as a big-endian integer (zero padded) next to the key length, so
+ * most comparisons are one integer compare on an array scanned linearly
+ * in memory; the key bytes are only read when two prefixes are equal and
+ * both keys are longer than 8 bytes.
+ * Leaves own a copy of their keys and are linked in order for range scans.
+ * Inner nodes hold `count` separators and `count + 1` children, a
+ * separator being the first key of the subtree on its right (borrowed
+ * from the leaf, keys are never removed).
+ */
+#define SL_BTREE_ORDER 32
+
+typedef struct sl_btree_node {
+    uint16_t count; /**< Keys in the node */
+    bool leaf;
+    uint64_t prefix[SL_BTREE_ORDER]; /**< First 8 key bytes, big-endian */
+    size_t len[SL_BTREE_ORDER];      /**< Key lengths */
+    sl_str key[SL_BTREE_ORDER];      /**< Keys (owned by leaves) */
+    union {
+        void *value[SL_BTREE_ORDER];
+        struct sl_btree_node *child[SL_BTREE_ORDER + 1];
+    } u;
+    struct sl_btree_node *next; /**< Next leaf */
+} sl_btree_node;
+
+struct sl_btree {
+    sl_btree_node *root;
+    size_t count; /**< Number of keys */
+    size_t nodes; /**< Number of nodes */
+};
+
+struct sl_btree_iter {
+    const sl_btree_node *leaf; /**< NULL when done */
+    unsigned pos;              /**< Next key in `leaf` */
+    bool bounded;              /**< Stop before `hi` */
+    uint64_t hi_prefix;
+    size_t hi_len;
+    unsigned char hi[]; /**< Upper bound (excluded) */
+};
+
+typedef struct {
+    uint64_t prefix;
+    size_t len;
+    const unsigned char *bytes;
+} sl_btree_probe;
+
+static uint64_t sl__btree_prefix(const unsigned char *bytes, size_t len) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < 8; i++)
+        v = v << 8 | (i < len ? bytes[i] : 0);
+    return v;
+}
+
+static sl_btree_probe sl__btree_probe(const void *bytes, size_t len) {
+    sl_btree_probe p = {sl__btree_prefix(bytes, len), len, bytes};
+    return p;
+}
+
+/**
+ * Compare the key of slot `i` with a probe (same sign as memcmp)
+ *
+ * Equal prefixes with one key of at most 8 bytes mean that key is a
+ * prefix of the other (the padding matches), so the lengths decide.
+ */
+static inline int sl__btree_cmp(const sl_btree_node *n, unsigned i, const sl_btree_probe *p) {
+    if (n->prefix[i] != p->prefix)
+        return n->prefix[i] < p->prefix ? -1 : 1;
+    if (n->len[i] <= 8 || p->len <= 8)
+        return (n->len[i] > p->len) - (n->len[i] < p->len);
+    return sl__bytes_cmp(n->key[i] + 8, n->len[i] - 8, p->bytes + 8, p->len - 8);
+}
+
+/**
+ * First slot whose key is >= the probe (> with `upper`)
+ *
+ * The prefixes of a node fit in a few cache lines: counting the smaller
+ * and equal ones is a branchless (vectorized) scan, and only the run of
+ * slots with an equal prefix is binary searched with full comparisons.
+ */
+static unsigned sl__btree_search(const sl_btree_node *n, const sl_btree_probe *p, bool upper) {
+    unsigned lo = 0, hi = 0;
+    for (unsigned j = 0; j < n->count; j++) {
+        lo += n->prefix[j] < p->prefix;
+        hi += n->prefix[j] <= p->prefix;
+    }
+    while (lo < hi) {
+        unsigned mid = (lo + hi) / 2;
+        int c = sl__btree_cmp(n, mid, p);
+        if (c < 0 || (upper && c == 0))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static const sl_btree_node *sl__btree_leaf_for(const sl_btree *t, const sl_btree_probe *p) {
+    const sl_btree_node *n = t->root;
+    while (!n->leaf)
+        n = n->u.child[sl__btree_search(n, p, true)];
+    return n;
+}
+
+static sl_btree_node *sl__btree_new_node(sl_btree *t, bool leaf) {
+    sl_btree_node *n = malloc(sizeof(*n));
+    if (!n)
+        return NULL;
+    n->count = 0;
+    n->leaf = leaf;
+    n->next = NULL;
+    t->nodes++;
+    return n;
+}
+
+static void sl__btree_move(sl_btree_node *dst, unsigned to, const sl_btree_node *src, unsigned from, unsigned n) {
+    memmove(dst->prefix + to, src->prefix + from, n * sizeof(*dst->prefix));
+    memmove(dst->len + to, src->len + from, n * sizeof(*dst->len));
+    memmove(dst->key + to, src->key + from, n * sizeof(*dst->key));
+}
+
+/**
+ * Split the full child `i` of `parent` (which is not full)
+ */
+static sl_err sl__btree_split_child(sl_btree *t, sl_btree_node *parent, unsigned i) {
+    sl_btree_node *left = parent->u.child[i];
+    sl_btree_node *right = sl__btree_new_node(t, left->leaf);
+    if (!right)
+        return SL_ERR_ALLOC;
+
+    unsigned mid = SL_BTREE_ORDER / 2;
+    uint64_t sep_prefix;
+    size_t sep_len;
+    sl_str sep_key;
+    if (left->leaf) {
+        // the separator is the first key of the right leaf
+        right->count = (uint16_t)(left->count - mid);
+        sl__btree_move(right, 0, left, mid, right->count);
+        memcpy(right->u.value, left->u.value + mid, right->count * sizeof(*right->u.value));
+        right->next = left->next;
+        left->next = right;
+        sep_prefix = right->prefix[0];
+        sep_len = right->len[0];
+        sep_key = right->key[0];
+    } else {
+        // the middle separator moves up
+        right->count = (uint16_t)(left->count - mid - 1);
+        sl__btree_move(right, 0, left, mid + 1, right->count);
+        memcpy(right->u.child, left->u.child + mid + 1, (right->count + 1u) * sizeof(*right->u.child));
+        sep_prefix = left->prefix[mid];
+        sep_len = left->len[mid];
+        sep_key = left->key[mid];
+    }
+    left->count = (uint16_t)mid;
+
+    sl__btree_move(parent, i + 1, parent, i, parent->count - i);
+    memmove(parent->u.child + i + 2, parent->u.child + i + 1, (parent->count - i) * sizeof(*parent->u.child));
+    parent->prefix[i] = sep_prefix;
+    parent->len[i] = sep_len;
+    parent->key[i] = sep_key;
+    parent->u.child[i + 1] = right;
+    parent->count++;
+    return SL_OK;
+}
+
+/**
+ * Insert or replace, splitting full nodes on the way down so that a
+ * failed allocation leaves a valid tree
+ */
+static sl_err sl__btree_insert(sl_btree *t, sl_hdr *src, void *value) {
+    sl_btree_probe p = sl__btree_probe(src->data, src->len);
+
+    if (t->root->count == SL_BTREE_ORDER) {
+        sl_btree_node *root = sl__btree_new_node(t, false);
+        if (!root)
+            return SL_ERR_ALLOC;
+        root->u.child[0] = t->root;
+        if (sl__btree_split_child(t, root, 0) != SL_OK) {
+            free(root);
+            t->nodes--;
+            return SL_ERR_ALLOC;
+        }
+        t->root = root;
+    }
+
+    sl_btree_node *n = t->root;
+    while (!n->leaf) {
+        unsigned i = sl__btree_search(n, &p, true);
+        if (n->u.child[i]->count == SL_BTREE_ORDER) {
+            if (sl__btree_split_child(t, n, i) != SL_OK)
+                return SL_ERR_ALLOC;
+            if (sl__btree_cmp(n, i, &p) <= 0)
+                i++;
+        }
+        n = n->u.child[i];
+    }
+
+    unsigned i = sl__btree_search(n, &p, false);
+    if (i < n->count && sl__btree_cmp(n, i, &p) == 0) {
+        n->u.value[i] = value;
+        return SL_OK;
+    }
+
+    sl_err e;
+    sl_hdr *copy = sl__alloc_exact(src->len, &e);
+    if (!copy)
+        return e;
+    if (src->len)
+        memcpy(copy->data, src->data, src->len);
+    copy->hash = src->hash;
+
+    sl__btree_move(n, i + 1, n, i, n->count - i);
+    memmove(n->u.value + i + 1, n->u.value + i, (n->count - i) * sizeof(*n->u.value));
+    n->prefix[i] = p.prefix;
+    n->len[i] = p.len;
+    n->key[i] = copy->data;
+    n->u.value[i] = value;
+    n->count++;
+    t->count++;
+    return SL_OK;
+}
+
+static void sl__btree_destroy(sl_btree_node *n) {
+    if (n->leaf) {
+        for (unsigned i = 0; i < n->count; i++)
+            sl_free(&n->key[i], NULL);
+    } else {
+        for (unsigned i = 0; i <= n->count; i++)
+            sl__btree_destroy(n->u.child[i]);
+    }
+    free(n);
+}
+
+/**
+ * Free the inner nodes of a subtree, not its leaves
+ */
+static void sl__btree_free_inner(sl_btree_node *n) {
+    if (n->leaf)
+        return;
+    for (unsigned i = 0; i <= n->count; i++)
+        sl__btree_free_inner(n->u.child[i]);
+    free(n);
+}
+
+/**
+ * Create an empty B-tree
+ *
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The tree, or NULL on error
+ */
+sl_btree *sl_btree_new(sl_err *err) {
+    sl_btree *t = calloc(1, sizeof(*t));
+    if (!t || !(t->root = sl__btree_new_node(t, true))) {
+        free(t);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    sl__set_err(err, SL_OK);
+    return t;
+}
+
+/**
+ * Build a B-tree from strictly increasing keys (byte order)
+ *
+ * Leaves are filled completely and each level is built once, which is
+ * much faster than inserting the keys one by one.
+ *
+ * @param sorted The keys (copied)
+ * @param values The value of each key, or NULL for all NULL values
+ * @param n Number of keys
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The tree, or NULL on error (SL_ERR_INVALID if the keys are not
+ *         strictly increasing)
+ */
+sl_btree *sl_btree_build(const sl_str *sorted, void *const *values, size_t n, sl_err *err) {
+    if (!sorted && n > 0) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    sl_hdr *prev = NULL;
+    for (size_t i = 0; i < n; i++) {
+        sl_hdr *hdr;
+        sl_err e = sl__validate(sorted[i], &hdr);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return NULL;
+        }
+        if (prev && sl__bytes_cmp(prev->data, prev->len, hdr->data, hdr->len) >= 0) {
+            sl__set_err(err, SL_ERR_INVALID);
+            return NULL;
+        }
+        prev = hdr;
+    }
+
+    sl_btree *t = sl_btree_new(err);
+    if (!t || n == 0)
+        return t;
+
+    // leaves: spread the keys evenly over as few leaves as possible
+    sl_btree_node *first = t->root;
+    size_t nleaves = (n + SL_BTREE_ORDER - 1) / SL_BTREE_ORDER;
+    size_t count = 0, q = 0, c = 0;
+    sl_btree_node **level = malloc(nleaves * sizeof(*level));
+    if (!level)
+        goto fail;
+    sl_btree_node *leaf = NULL;
+    for (size_t l = 0, k = 0; l < nleaves; l++) {
+        sl_btree_node *next = l == 0 ? first : sl__btree_new_node(t, true);
+        if (!next)
+            goto fail;
+        if (leaf)
+            leaf->next = next;
+        leaf = next;
+        level[l] = leaf;
+
+        for (size_t end = n * (l + 1) / nleaves; k < end; k++) {
+            sl_hdr *src = sl__get_hdr(sorted[k]);
+            sl_err e;
+            sl_hdr *copy = sl__alloc_exact(src->len, &e);
+            if (!copy)
+                goto fail;
+            if (src->len)
+                memcpy(copy->data, src->data, src->len);
+            copy->hash = src->hash;
+            unsigned i = leaf->count++;
+            leaf->prefix[i] = sl__btree_prefix((const unsigned char *)copy->data, src->len);
+            leaf->len[i] = src->len;
+            leaf->key[i] = copy->data;
+            leaf->u.value[i] = values ? values[k] : NULL;
+            t->count++;
+        }
+    }
+
+    // inner levels: up to ORDER + 1 children each, the separator before
+    // a child is the smallest key below it
+    count = nleaves;
+    while (count > 1) {
+        size_t nparents = (count + SL_BTREE_ORDER) / (SL_BTREE_ORDER + 1);
+        for (q = 0, c = 0; q < nparents; q++) {
+            sl_btree_node *parent = sl__btree_new_node(t, false);
+            if (!parent)
+                goto fail;
+            parent->u.child[0] = level[c++];
+            for (size_t end = count * (q + 1) / nparents; c < end; c++) {
+                const sl_btree_node *min = level[c];
+                while (!min->leaf)
+                    min = min->u.child[0];
+                unsigned i = parent->count++;
+                parent->prefix[i] = min->prefix[0];
+                parent->len[i] = min->len[0];
+                parent->key[i] = min->key[0];
+                parent->u.child[i + 1] = level[c];
+            }
+            level[q] = parent;
+        }
+        count = nparents;
+    }
+    t->root = level[0];
+    free(level);
+    return t;
+
+fail:
+    // free the inner nodes built so far (the parents of this level and the
+    // nodes they did not take yet), then the leaves through their links
+    if (count > 1) {
+        for (size_t i = 0; i < q; i++)
+            sl__btree_free_inner(level[i]);
+        for (size_t i = c; i < count; i++)
+            sl__btree_free_inner(level[i]);
+    }
+    free(level);
+    while (first) {
+        sl_btree_node *next = first->next;
+        first->next = NULL;
+        sl__btree_destroy(first);
+        first = next;
+    }
+    free(t);
+    sl__set_err(err, SL_ERR_ALLOC);
+    return NULL;
+}
+
+/**
+ * Free a B-tree and its keys (the values are not freed)
+ *
+ * @param t Pointer to the tree variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_btree_free(sl_btree **t, sl_err *err) {
+    if (t && *t) {
+        sl__btree_destroy((*t)->root);
+        free(*t);
+        *t = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Insert a key, or replace the value of an existing key
+ *
+ * The key is copied (with its cached hash).
+ *
+ * @param t The tree
+ * @param key The key
+ * @param value The value (any pointer, NULL included)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_btree_insert(sl_btree *t, sl_str key, void *value, sl_err *err) {
+    if (!t) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    sl_hdr *hdr;
+    sl_err e = sl__validate(key, &hdr);
+    if (e == SL_OK)
+        e = sl__btree_insert(t, hdr, value);
+    sl__set_err(err, e);
+}
+
+/**
+ * Look a key up
+ *
+ * @param t The tree
+ * @param key The key bytes
+ * @param len Length of the key
+ * @param value Receives the value if the key is found, can be NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return true if the key is in the tree
+ */
+bool sl_btree_get(const sl_btree *t, const void *key, size_t len, void **value, sl_err *err) {
+    if (!t || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl__set_err(err, SL_OK);
+
+    sl_btree_probe p = sl__btree_probe(key ? key : "", len);
+    const sl_btree_node *leaf = sl__btree_leaf_for(t, &p);
+    unsigned i = sl__btree_search(leaf, &p, false);
+    if (i == leaf->count || sl__btree_cmp(leaf, i, &p) != 0)
+        return false;
+    if (value)
+        *value = leaf->u.value[i];
+    return true;
+}
+
+/**
+ * Look a string key up
+ *
+ * @see sl_btree_get
+ */
+bool sl_btree_get_str(const sl_btree *t, sl_str key, void **value, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(key, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return false;
+    }
+    return sl_btree_get(t, hdr->data, hdr->len, value, err);
+}
+
+/**
+ * Number of keys
+ */
+size_t sl_btree_count(const sl_btree *t, sl_err *err) {
+    if (!t) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return t->count;
+}
+
+/**
+ * Heap bytes used by the tree (nodes and keys)
+ */
+size_t sl_btree_memory(const sl_btree *t, sl_err *err) {
+    if (!t) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    const sl_btree_node *n = t->root;
+    while (!n->leaf)
+        n = n->u.child[0];
+    size_t total = sizeof(*t) + t->nodes * sizeof(sl_btree_node);
+    for (; n; n = n->next)
+        for (unsigned i = 0; i < n->count; i++)
+            total += sizeof(sl_hdr) + sl__get_hdr(n->key[i])->cap;
+    sl__set_err(err, SL_OK);
+    return total;
+}
+
+/**
+ * Iterate over the keys in [lo, hi), in byte order
+ *
+ * @param t The tree (must not be modified while iterating)
+ * @param lo Lower bound (included), NULL for the first key
+ * @param lo_len Length of `lo`
+ * @param hi Upper bound (excluded), NULL for no bound
+ * @param hi_len Length of `hi`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The iterator, or NULL on error
+ */
+sl_btree_iter *sl_btree_range(const sl_btree *t, const void *lo, size_t lo_len, const void *hi, size_t hi_len,
+                              sl_err *err) {
+    if (!t || (!lo && lo_len > 0) || (!hi && hi_len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+
+    sl_btree_iter *it = malloc(sizeof(*it) + (hi ? hi_len : 0));
+    if (!it) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    sl_btree_probe p = sl__btree_probe(lo ? lo : "", lo_len);
+    it->leaf = sl__btree_leaf_for(t, &p);
+    it->pos = sl__btree_search(it->leaf, &p, false);
+    it->bounded = hi != NULL;
+    if (hi) {
+        if (hi_len)
+            memcpy(it->hi, hi, hi_len);
+        it->hi_prefix = sl__btree_prefix(hi, hi_len);
+        it->hi_len = hi_len;
+    }
+    sl__set_err(err, SL_OK);
+    return it;
+}
+
+/**
+ * Next key of a range
+ *
+ * @param it The iterator
+ * @param key Receives the key (a view valid until the tree is freed), can be NULL
+ * @param value Receives the value, can be NULL
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return false when the range is exhausted
+ */
+bool sl_btree_iter_next(sl_btree_iter *it, sl_view *key, void **value, sl_err *err) {
+    if (!it) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl__set_err(err, SL_OK);
+
+    while (it->leaf && it->pos == it->leaf->count) {
+        it->leaf = it->leaf->next;
+        it->pos = 0;
+    }
+    if (!it->leaf)
+        return false;
+    if (it->bounded) {
+        sl_btree_probe p = {it->hi_prefix, it->hi_len, it->hi};
+        if (sl__btree_cmp(it->leaf, it->pos, &p) >= 0) {
+            it->leaf = NULL;
+            return false;
+        }
+    }
+
+    unsigned i = it->pos++;
+    if (key) {
+        key->data = it->leaf->key[i];
+        key->len = it->leaf->len[i];
+    }
+    if (value)
+        *value = it->leaf->u.value[i];
+    return true;
+}
+
+/**
+ * Free a range iterator
+ *
+ * @param it Pointer to the iterator variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_btree_iter_free(sl_btree_iter **it, sl_err *err) {
+    if (it) {
+        free(*it);
+        *it = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+// LRU CACHE
+
+/*
+ * One allocation per entry: the links, the key bytes and its hash.
+ * Entries are chained in hash buckets (indexed by the cached hash) and
+ * in a circular recency list around a sentinel: `lru.next` is the most
+ * recently used entry, `lru.prev` the next to evict.
+ */
+typedef struct sl_lru_link {
+    struct sl_lru_link *prev, *next;
+} sl_lru_link;
+
+typedef struct sl_lru_entry {
+    sl_lru_link link;           /**< Recency list, first so a link casts to its entry */
+    struct sl_lru_entry *chain; /**< Next entry of the bucket */
+    uint64_t hash;
+    sl_str value;
+    size_t charge; /**< Bytes counted against the capacity */
+    size_t len;
+    char key[];
+} sl_lru_entry;
+
+struct sl_lru {
+    sl_lru_link lru;          /**< Sentinel of the recency list */
+    sl_lru_entry **buckets;   /**< Hash chains */
+    size_t bucket_mask;       /**< Number of buckets - 1 (power of 2) */
+    size_t count;             /**< Number of entries */
+    size_t bytes;             /**< Sum of the entry charges */
+    size_t max_entries;       /**< 0: no bound */
+    size_t max_bytes;         /**< 0: no bound */
+    sl_lru_evict on_evict;    /**< NULL: values are freed with sl_free */
+    void *ctx;
+};
+
+#define SL_LRU_MIN_BUCKETS 16
+
+static size_t sl__lru_charge(size_t key_len, const sl_hdr *value) {
+    return 2 * sizeof(sl_hdr) + key_len + value->cap;
+}
+
+static void sl__lru_unlink(sl_lru_entry *e) {
+    e->link.prev->next = e->link.next;
+    e->link.next->prev = e->link.prev;
+}
+
+static void sl__lru_push_front(sl_lru *lru, sl_lru_entry *e) {
+    e->link.prev = &lru->lru;
+    e->link.next = lru->lru.next;
+    lru->lru.next->prev = &e->link;
+    lru->lru.next = &e->link;
+}
+
+static sl_lru_entry **sl__lru_find(const sl_lru *lru, uint64_t hash, const void *key, size_t len) {
+    sl_lru_entry **link = &lru->buckets[hash & lru->bucket_mask];
+    for (; *link; link = &(*link)->chain) {
+        const sl_lru_entry *e = *link;
+        if (e->hash == hash && e->len == len && (len == 0 || memcmp(e->key, key, len) == 0))
+            break;
+    }
+    return link;
+}
+
+/**
+ * Hand a value over to the eviction callback (or free it)
+ */
+static void sl__lru_release(const sl_lru *lru, const sl_lru_entry *e, sl_str value) {
+    if (lru->on_evict) {
+        sl_view key = {e->key, e->len};
+        lru->on_evict(key, value, lru->ctx);
+    } else {
+        sl_free(&value, NULL);
+    }
+}
+
+/**
+ * Remove an entry (`link` points to it in its bucket) and release its value
+ */
+static void sl__lru_drop(sl_lru *lru, sl_lru_entry **link) {
+    sl_lru_entry *e = *link;
+    *link = e->chain;
+    sl__lru_unlink(e);
+    lru->count--;
+    lru->bytes -= e->charge;
+    sl__lru_release(lru, e, e->value);
+    free(e);
+}
+
+static void sl__lru_evict(sl_lru *lru) {
+    while ((lru->max_entries && lru->count > lru->max_entries) || (lru->max_bytes && lru->bytes > lru->max_bytes)) {
+        sl_lru_entry *victim = (sl_lru_entry *)lru->lru.prev;
+        sl__lru_drop(lru, sl__lru_find(lru, victim->hash, victim->key, victim->len));
+    }
+}
+
+static void sl__lru_grow(sl_lru *lru) {
+    size_t n = (lru->bucket_mask + 1) * 2;
+    sl_lru_entry **buckets = calloc(n, sizeof(*buckets));
+    if (!buckets)
+        return; // longer chains, still correct
+    for (size_t i = 0; i <= lru->bucket_mask; i++) {
+        for (sl_lru_entry *e = lru->buckets[i], *next; e; e = next) {
+            next = e->chain;
+            e->chain = buckets[e->hash & (n - 1)];
+            buckets[e->hash & (n - 1)] = e;
+        }
+    }
+    free(lru->buckets);
+    lru->buckets = buckets;
+    lru->bucket_mask = n - 1;
+}
+
+/**
+ * Create an LRU cache of strings keyed by strings
+ *
+ * The cache owns its values: a value that is evicted, replaced, removed
+ * or still cached when the cache is freed is passed to `on_evict`, which
+ * takes it over (a NULL callback frees it with `sl_free`).
+ *
+ * @param max_entries Maximum number of entries, 0 for no bound
+ * @param max_bytes Maximum bytes, 0 for no bound; an entry is charged
+ *        the allocation size of its key and value (`sl_hdr` + `hdr->cap`)
+ * @param on_evict Called with the key and value of each dropped entry, can be NULL
+ * @param ctx Passed to `on_evict`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The cache, or NULL on error (SL_ERR_INVALID without any bound)
+ */
+sl_lru *sl_lru_new(size_t max_entries, size_t max_bytes, sl_lru_evict on_evict, void *ctx, sl_err *err) {
+    if (!max_entries && !max_bytes) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+
+    sl_lru *lru = calloc(1, sizeof(*lru));
+    if (lru)
+        lru->buckets = calloc(SL_LRU_MIN_BUCKETS, sizeof(*lru->buckets));
+    if (!lru || !lru->buckets) {
+        free(lru);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    lru->lru.prev = lru->lru.next = &lru->lru;
+    lru->bucket_mask = SL_LRU_MIN_BUCKETS - 1;
+    lru->max_entries = max_entries;
+    lru->max_bytes = max_bytes;
+    lru->on_evict = on_evict;
+    lru->ctx = ctx;
+    sl__set_err(err, SL_OK);
+    return lru;
+}
+
+/**
+ * Free a cache, releasing every cached value through the eviction callback
+ *
+ * @param lru Pointer to the cache variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_lru_free(sl_lru **lru, sl_err *err) {
+    if (lru && *lru) {
+        sl_lru *c = *lru;
+        for (sl_lru_link *l = c->lru.next, *next; l != &c->lru; l = next) {
+            sl_lru_entry *e = (sl_lru_entry *)l;
+            next = l->next;
+            sl__lru_release(c, e, e->value);
+            free(e);
+        }
+        free(c->buckets);
+        free(c);
+        *lru = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Cache a value, making it the most recently used entry
+ *
+ * The key is copied and looked up by its cached hash. The cache takes
+ * over `value` on success only; the previous value of the key is
+ * released. Least recently used entries are then evicted to fit the bounds.
+ *
+ * @param lru The cache
+ * @param key The key
+ * @param value The value (owned by the cache on success)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (SL_ERR_RANGE if the entry alone exceeds `max_bytes`)
+ */
+void sl_lru_put(sl_lru *lru, sl_str key, sl_str value, sl_err *err) {
+    sl_hdr *khdr, *vhdr;
+    sl_err e = lru ? sl__validate(key, &khdr) : SL_ERR_NULL;
+    if (e == SL_OK)
+        e = sl__validate(value, &vhdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+    size_t charge = sl__lru_charge(khdr->len, vhdr);
+    if (lru->max_bytes && charge > lru->max_bytes) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+
+    sl_lru_entry **link = sl__lru_find(lru, khdr->hash, khdr->data, khdr->len);
+    sl_lru_entry *entry = *link;
+    if (entry) {
+        sl_str old = entry->value;
+        entry->value = value;
+        lru->bytes += charge - entry->charge;
+        entry->charge = charge;
+        sl__lru_unlink(entry);
+        sl__lru_push_front(lru, entry);
+        if (old != value)
+            sl__lru_release(lru, entry, old);
+    } else {
+        entry = malloc(sizeof(*entry) + khdr->len);
+        if (!entry) {
+            sl__set_err(err, SL_ERR_ALLOC);
+            return;
+        }
+        entry->hash = khdr->hash;
+        entry->value = value;
+        entry->charge = charge;
+        entry->len = khdr->len;
+        if (khdr->len)
+            memcpy(entry->key, khdr->data, khdr->len);
+        entry->chain = NULL;
+        *link = entry;
+        sl__lru_push_front(lru, entry);
+        lru->count++;
+        lru->bytes += charge;
+        if (lru->count > lru->bucket_mask + 1)
+            sl__lru_grow(lru);
+    }
+    sl__lru_evict(lru);
+    sl__set_err(err, SL_OK);
+}
+
+static sl_str sl__lru_get(sl_lru *lru, uint64_t hash, const void *key, size_t len) {
+    sl_lru_entry *e = *sl__lru_find(lru, hash, key, len);
+    if (!e)
+        return NULL;
+    if (lru->lru.next != &e->link) {
+        sl__lru_unlink(e);
+        sl__lru_push_front(lru, e);
+    }
+    return e->value;
+}
+
+/**
+ * Look a key up, making it the most recently used entry
+ *
+ * @param lru The cache
+ * @param key The key bytes
+ * @param len Length of the key
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The cached value (owned by the cache, valid until the next
+ *         put or remove), or NULL if the key is not cached
+ */
+sl_str sl_lru_get(sl_lru *lru, const void *key, size_t len, sl_err *err) {
+    if (!lru || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    sl__set_err(err, SL_OK);
+    return sl__lru_get(lru, sl_compute_hash(key, len), key ? key : "", len);
+}
+
+/**
+ * Look a string key up with its cached hash
+ *
+ * @see sl_lru_get
+ */
+sl_str sl_lru_get_str(sl_lru *lru, sl_str key, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = lru ? sl__validate(key, &hdr) : SL_ERR_NULL;
+    sl__set_err(err, e);
+    return e == SL_OK ? sl__lru_get(lru, hdr->hash, hdr->data, hdr->len) : NULL;
+}
+
+/**
+ * Remove a key, releasing its value through the eviction callback
+ *
+ * @param lru The cache
+ * @param key The key bytes
+ * @param len Length of the key
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return true if the key was cached
+ */
+bool sl_lru_remove(sl_lru *lru, const void *key, size_t len, sl_err *err) {
+    if (!lru || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl__set_err(err, SL_OK);
+    sl_lru_entry **link = sl__lru_find(lru, sl_compute_hash(key, len), key ? key : "", len);
+    if (!*link)
+        return false;
+    sl__lru_drop(lru, link);
+    return true;
+}
+
+/**
+ * Number of cached entries
+ */
+size_t sl_lru_count(const sl_lru *lru, sl_err *err) {
+    if (!lru) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return lru->count;
+}
+
+/**
+ * Bytes charged against `max_bytes` (key and value allocations)
+ */
+size_t sl_lru_bytes(const sl_lru *lru, sl_err *err) {
+    if (!lru) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return lru->bytes;
+}
+
+#ifdef SL_HAVE_POSIX
+/*
+ * Independent caches, each behind its own mutex; a key always goes to the
+ * shard picked by the high bits of its hash (the low bits index buckets).
+ */
+typedef struct {
+    _Alignas(64) pthread_mutex_t lock; /**< One cache line per shard, so neighbouring locks don't share one */
+    sl_lru *lru;
+} sl_lru_shard;
+
+struct sl_lru_shared {
+    size_t nshards;
+    sl_lru_shard shards[];
+};
+
+static sl_lru_shard *sl__lru_shard(const sl_lru_shared *c, uint64_t hash) {
+    return (sl_lru_shard *)&c->shards[(hash >> 32) % c->nshards];
+}
+
+/**
+ * Create a thread-safe LRU cache split into independently locked shards
+ *
+ * The bounds are divided evenly between the shards, so eviction is LRU
+ * within a shard. The eviction callback runs with the shard locked and
+ * must not call back into the cache.
+ *
+ * @param nshards Number of shards, 0 for 16
+ * @see sl_lru_new
+ */
+sl_lru_shared *sl_lru_shared_new(size_t nshards, size_t max_entries, size_t max_bytes, sl_lru_evict on_evict,
+                                 void *ctx, sl_err *err) {
+    if (nshards == 0)
+        nshards = 16;
+    if (!max_entries && !max_bytes) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+    if (nshards > (SIZE_MAX - sizeof(sl_lru_shared)) / sizeof(sl_lru_shard)) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return NULL;
+    }
+
+    // calloc only guarantees max_align_t, the shards need their cache lines
+    sl_lru_shared *c;
+    size_t size = sizeof(*c) + nshards * sizeof(sl_lru_shard);
+    if (posix_memalign((void **)&c, _Alignof(sl_lru_shard), size) != 0) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    memset(c, 0, size);
+    for (size_t i = 0; i < nshards; i++) {
+        // a shard always holds at least one entry
+        size_t entries = max_entries ? (max_entries + nshards - 1) / nshards : 0;
+        size_t bytes = max_bytes ? (max_bytes + nshards - 1) / nshards : 0;
+        c->shards[i].lru = sl_lru_new(entries, bytes, on_evict, ctx, err);
+        if (!c->shards[i].lru || pthread_mutex_init(&c->shards[i].lock, NULL) != 0) {
+            sl_lru_free(&c->shards[i].lru, NULL);
+            c->nshards = i;
+            sl_lru_shared_free(&c, NULL);
+            sl__set_err(err, SL_ERR_ALLOC);
+            return NULL;
+        }
+        c->nshards = i + 1;
+    }
+    sl__set_err(err, SL_OK);
+    return c;
+}
+
+/**
+ * Free a sharded cache (no other thread may use it anymore)
+ *
+ * @param c Pointer to the cache variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_lru_shared_free(sl_lru_shared **c, sl_err *err) {
+    if (c && *c) {
+        for (size_t i = 0; i < (*c)->nshards; i++) {
+            sl_lru_free(&(*c)->shards[i].lru, NULL);
+            pthread_mutex_destroy(&(*c)->shards[i].lock);
+        }
+        free(*c);
+        *c = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Cache a value (thread-safe)
+ *
+ * @see sl_lru_put
+ */
+void sl_lru_shared_put(sl_lru_shared *c, sl_str key, sl_str value, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = c ? sl__validate(key, &hdr) : SL_ERR_NULL;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+    sl_lru_shard *shard = sl__lru_shard(c, hdr->hash);
+    pthread_mutex_lock(&shard->lock);
+    sl_lru_put(shard->lru, key, value, err);
+    pthread_mutex_unlock(&shard->lock);
+}
+
+static sl_str sl__lru_shared_get(sl_lru_shared *c, uint64_t hash, const void *key, size_t len, sl_err *err) {
+    sl_lru_shard *shard = sl__lru_shard(c, hash);
+    pthread_mutex_lock(&shard->lock);
+    sl_str value = sl__lru_get(shard->lru, hash, key, len);
+    sl_hdr *copy = NULL;
+    sl_err e = SL_OK;
+    if (value) {
+        sl_hdr *src = sl__get_hdr(value);
+        copy = sl__alloc_exact(src->len, &e);
+        if (copy) {
+            if (src->len)
+                memcpy(copy->data, src->data, src->len);
+            copy->hash = src->hash;
+        }
+    }
+    pthread_mutex_unlock(&shard->lock);
+    sl__set_err(err, e);
+    return copy ? copy->data : NULL;
+}
+
+/**
+ * Look a key up (thread-safe)
+ *
+ * Another thread may evict the value at any time, so a copy is returned.
+ *
+ * @param c The cache
+ * @param key The key bytes
+ * @param len Length of the key
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return A copy of the cached value (free it with `sl_free`), or NULL if
+ *         the key is not cached (with SL_OK) or on error
+ */
+sl_str sl_lru_shared_get(sl_lru_shared *c, const void *key, size_t len, sl_err *err) {
+    if (!c || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return NULL;
+    }
+    return sl__lru_shared_get(c, sl_compute_hash(key, len), key ? key : "", len, err);
+}
+
+/**
+ * Look a string key up with its cached hash (thread-safe)
+ *
+ * @see sl_lru_shared_get
+ */
+sl_str sl_lru_shared_get_str(sl_lru_shared *c, sl_str key, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = c ? sl__validate(key, &hdr) : SL_ERR_NULL;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+    return sl__lru_shared_get(c, hdr->hash, hdr->data, hdr->len, err);
+}
+
+/**
+ * Remove a key (thread-safe)
+ *
+ * @see sl_lru_remove
+ */
+bool sl_lru_shared_remove(sl_lru_shared *c, const void *key, size_t len, sl_err *err) {
+    if (!c || (!key && len > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl_lru_shard *shard = sl__lru_shard(c, sl_compute_hash(key, len));
+    pthread_mutex_lock(&shard->lock);
+    bool removed = sl_lru_remove(shard->lru, key, len, err);
+    pthread_mutex_unlock(&shard->lock);
+    return removed;
+}
+
+/**
+ * Number of cached entries over all shards (a snapshot under concurrent use)
+ */
+size_t sl_lru_shared_count(sl_lru_shared *c, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    size_t total = 0;
+    for (size_t i = 0; i < c->nshards; i++) {
+        pthread_mutex_lock(&c->shards[i].lock);
+        total += c->shards[i].lru->count;
+        pthread_mutex_unlock(&c->shards[i].lock);
+    }
+    sl__set_err(err, SL_OK);
+    return total;
+}
+#endif
+
+// BLOOM AND CUCKOO FILTERS
+
+/*
+ * Blocked Bloom filter: a key only touches one 64-byte block (one cache
+ * line), picked from the high 32 bits of its hash. Bit i inside the block
+ * is the top 9 bits of x * salt[i], x being the low 32 bits of the hash
+ * (multiply-shift, as in split block Bloom filters). Double hashing,
+ * g_i = h1 + i * h2, is not used inside a block: its bit patterns are
+ * arithmetic progressions mod 512, so few distinct patterns exist and
+ * shifted ones overlap in k - 1 bits: a 0.1% target measured 0.15%
+ * (1.5x). The string bytes are never read: the cached `hdr->hash`,
+ * mixed by `sl__mix64`, is all a filter needs.
+ */
+#define SL_BLOOM_BLOCK 64
+#define SL_BLOOM_MAX_K 16
+
+// odd multipliers, one per bit set (split block Bloom filter, xxHash and MurmurHash3 constants)
+static const uint32_t sl__bloom_salt[SL_BLOOM_MAX_K] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du, 0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+    0x9e3779b1u, 0x85ebca77u, 0xc2b2ae3du, 0x27d4eb2fu, 0x165667b1u, 0xcc9e2d51u, 0x1b873593u, 0xe6546b65u};
+
+struct sl_bloom {
+    uint64_t *blocks; /**< `nblocks` blocks of 8 words, aligned to SL_BLOOM_BLOCK */
+    void *mem;        /**< Allocation holding `blocks` */
+    size_t nblocks;   /**< At most 2^32 */
+    unsigned k;       /**< Bits set per key */
+    size_t count;     /**< Keys added */
+};
+
+#define SL_LN2 0.6931471805599453
+
+/**
+ * Finalizer of the 64-bit MurmurHash3: spreads every bit of an FNV-1a
+ * hash over the whole word (the low FNV bits alone are weak, the lowest
+ * one is the parity of the input's low bits)
+ */
+static inline uint64_t sl__mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Natural logarithm of x > 0, for sizing (no libm): x = m 2^e with m in
+ * [1, 2), ln m = 2 atanh((m - 1) / (m + 1)) by its series
+ */
+static double sl__ln(double x) {
+    int e = 0;
+    while (x >= 2.0) {
+        x /= 2.0;
+        e++;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        e--;
+    }
+    double z = (x - 1.0) / (x + 1.0), z2 = z * z, term = z, sum = 0.0;
+    for (int i = 1; i < 40; i += 2, term *= z2)
+        sum += term / i;
+    return 2.0 * sum + e * SL_LN2;
+}
+
+/**
+ * e^x for sizing (no libm): 2^n e^r with |r| <= ln 2 / 2, r by its series
+ */
+static double sl__exp(double x) {
+    double n = (double)(int64_t)(x / SL_LN2 + (x < 0 ? -0.5 : 0.5));
+    double r = x - n * SL_LN2, term = 1.0, sum = 1.0;
+    for (int i = 1; i < 20; i++) {
+        term *= r / i;
+        sum += term;
+    }
+    for (; n > 0; n--)
+        sum *= 2.0;
+    for (; n < 0; n++)
+        sum /= 2.0;
+    return sum;
+}
+
+/**
+ * Expected false-positive rate of a blocked filter with `load` keys per
+ * block on average: the rate of a 512-bit filter holding i keys,
+ * weighted by the Poisson probability of a block holding i keys
+ */
+static double sl__bloom_rate(double load, unsigned k) {
+    if (load > 600)
+        return 1.0;
+    double q = 1.0, step = 1.0, rate = 0.0;
+    for (unsigned j = 0; j < k; j++)
+        step *= 1.0 - 1.0 / (SL_BLOOM_BLOCK * 8); // q = (1 - 1/512)^(k i)
+    double p = sl__exp(-load);                    // Poisson(i; load)
+    for (unsigned i = 0; i < load + 12 * (load + 3); i++) {
+        double miss = 1.0 - q, fp = 1.0;
+        for (unsigned j = 0; j < k; j++)
+            fp *= miss;
+        rate += p * fp;
+        q *= step;
+        p *= load / (i + 1);
+    }
+    return rate;
+}
+
+static inline uint64_t *sl__bloom_block(const sl_bloom *b, uint64_t hash) {
+    // fastrange: maps the high hash bits to [0, nblocks) without a division
+    return b->blocks + (((hash >> 32) * (uint64_t)b->nblocks) >> 32) * (SL_BLOOM_BLOCK / 8);
+}
+
+/**
+ * Create a blocked Bloom filter sized for `expected` keys
+ *
+ * @param expected Number of keys the filter is sized for (at least 1)
+ * @param fp_rate Target false-positive rate, in (0, 1)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The filter, or NULL on error
+ */
+sl_bloom *sl_bloom_new(size_t expected, double fp_rate, sl_err *err) {
+    if (expected == 0 || !(fp_rate > 0.0 && fp_rate < 1.0)) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+
+    // start from the classic sizing, m = -n ln p / ln^2 2 bits, then grow
+    // until the blocked rate (blocks do not fill evenly) meets the target
+    double bits = -(double)expected * sl__ln(fp_rate) / (SL_LN2 * SL_LN2);
+    double blocks;
+    unsigned k;
+    for (int i = 0;; i++) {
+        blocks = (double)(uint64_t)(bits / (SL_BLOOM_BLOCK * 8)) + 1;
+        k = (unsigned)(blocks * SL_BLOOM_BLOCK * 8 / (double)expected * SL_LN2 + 0.5);
+        k = k < 1 ? 1 : k > SL_BLOOM_MAX_K ? SL_BLOOM_MAX_K : k;
+        if (i == 40 || blocks > 4294967296.0 || sl__bloom_rate((double)expected / blocks, k) <= fp_rate)
+            break;
+        bits *= 1.05;
+    }
+    if (blocks > 4294967296.0) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return NULL;
+    }
+
+    sl_bloom *b = calloc(1, sizeof(*b));
+    if (!b) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    b->nblocks = (size_t)blocks;
+    b->k = k;
+    b->mem = calloc(b->nblocks * SL_BLOOM_BLOCK + SL_BLOOM_BLOCK - 1, 1);
+    if (!b->mem) {
+        free(b);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    b->blocks = (uint64_t *)(((uintptr_t)b->mem + SL_BLOOM_BLOCK - 1) & ~(uintptr_t)(SL_BLOOM_BLOCK - 1));
+    sl__set_err(err, SL_OK);
+    return b;
+}
+
+/**
+ * Free a Bloom filter
+ *
+ * @param b Pointer to the filter variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_bloom_free(sl_bloom **b, sl_err *err) {
+    if (b && *b) {
+        free((*b)->mem);
+        free(*b);
+        *b = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Add a key given by its hash (`sl_hash` or `sl_compute_hash`)
+ */
+void sl_bloom_add_hash(sl_bloom *b, uint64_t hash, sl_err *err) {
+    if (!b) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    hash = sl__mix64(hash);
+    uint64_t *block = sl__bloom_block(b, hash);
+    uint32_t x = (uint32_t)hash;
+    for (unsigned i = 0; i < b->k; i++) {
+        uint32_t g = x * sl__bloom_salt[i];
+        block[g >> 29] |= 1ULL << ((g >> 23) & 63);
+    }
+    b->count++;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Test a key given by its hash
+ *
+ * @return false if the key was never added, true if it probably was
+ */
+bool sl_bloom_contains_hash(const sl_bloom *b, uint64_t hash, sl_err *err) {
+    if (!b) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl__set_err(err, SL_OK);
+
+    // gather the k bits into a mask per word, then test the block at once
+    hash = sl__mix64(hash);
+    const uint64_t *block = sl__bloom_block(b, hash);
+    uint64_t mask[8] = {0};
+    uint32_t x = (uint32_t)hash;
+    for (unsigned i = 0; i < b->k; i++) {
+        uint32_t g = x * sl__bloom_salt[i];
+        mask[g >> 29] |= 1ULL << ((g >> 23) & 63);
+    }
+    uint64_t missing = 0;
+    for (unsigned w = 0; w < 8; w++)
+        missing |= mask[w] & ~block[w];
+    return missing == 0;
+}
+
+/**
+ * Add a string (its cached hash, the bytes are not read)
+ */
+void sl_bloom_add(sl_bloom *b, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+    sl_bloom_add_hash(b, hdr->hash, err);
+}
+
+/**
+ * Test a string (its cached hash, the bytes are not read)
+ *
+ * @return false if the string was never added, true if it probably was
+ */
+bool sl_bloom_contains(const sl_bloom *b, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return false;
+    }
+    return sl_bloom_contains_hash(b, hdr->hash, err);
+}
+
+/**
+ * Bytes of the bit array
+ */
+size_t sl_bloom_memory(const sl_bloom *b, sl_err *err) {
+    if (!b) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return b->nblocks * SL_BLOOM_BLOCK;
+}
+
+/*
+ * Cuckoo filter: buckets of 4 16-bit fingerprints (one 64-bit word).
+ * A key has two candidate buckets: i1 from the hash, and
+ * i2 = (h(fp) - i1) mod n, so either bucket is computed from the other and
+ * the fingerprint alone when an entry is moved (the usual i1 ^ h(fp)
+ * needs a power-of-two table, which can leave it half empty). The
+ * fingerprint comes from the high 16 bits of the hash (0 marks an empty
+ * slot). Unlike a Bloom filter, keys can be removed.
+ */
+#define SL_CUCKOO_SLOTS 4
+#define SL_CUCKOO_MAX_KICKS 500
+
+struct sl_cuckoo {
+    uint64_t *buckets;  /**< 4 fingerprints per bucket */
+    size_t nbuckets;    /**< At most 2^32 */
+    size_t count;       /**< Fingerprints stored (victim included) */
+    uint64_t state;     /**< Random state for evictions */
+    uint16_t victim_fp; /**< Fingerprint that did not fit, 0 if none */
+    size_t victim_index;
+};
+
+static inline uint16_t sl__cuckoo_fp(uint64_t hash) {
+    uint16_t fp = (uint16_t)(hash >> 48);
+    return fp ? fp : 1;
+}
+
+static inline size_t sl__cuckoo_index(const sl_cuckoo *c, uint32_t h) {
+    return (size_t)(((uint64_t)h * c->nbuckets) >> 32);
+}
+
+static inline size_t sl__cuckoo_alt(const sl_cuckoo *c, size_t index, uint16_t fp) {
+    size_t h = sl__cuckoo_index(c, (uint32_t)fp * 0x5bd1e995u);
+    return h >= index ? h - index : h + c->nbuckets - index;
+}
+
+/**
+ * Slot of `fp` in a bucket (-1 if absent): SWAR search for a zero lane
+ */
+static inline int sl__cuckoo_find(uint64_t bucket, uint16_t fp) {
+    uint64_t x = bucket ^ (fp * 0x0001000100010001ULL);
+    uint64_t zero = (x - 0x0001000100010001ULL) & ~x & 0x8000800080008000ULL;
+    return zero ? __builtin_ctzll(zero) / 16 : -1;
+}
+
+static inline bool sl__cuckoo_put(uint64_t *bucket, uint16_t fp) {
+    int slot = sl__cuckoo_find(*bucket, 0);
+    if (slot < 0)
+        return false;
+    *bucket |= (uint64_t)fp << (16 * slot);
+    return true;
+}
+
+/**
+ * Create a cuckoo filter holding up to about `capacity` keys
+ *
+ * @param capacity Number of keys (the table is sized for a 95% load)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The filter, or NULL on error
+ */
+sl_cuckoo *sl_cuckoo_new(size_t capacity, sl_err *err) {
+    if (capacity == 0) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+    // 4 slots per bucket fill to about 95%
+    size_t nbuckets = capacity / SL_CUCKOO_SLOTS + capacity / 64 + 1;
+    if (nbuckets > UINT32_MAX || nbuckets > SIZE_MAX / sizeof(uint64_t)) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return NULL;
+    }
+
+    sl_cuckoo *c = calloc(1, sizeof(*c));
+    if (c)
+        c->buckets = calloc(nbuckets, sizeof(*c->buckets));
+    if (!c || !c->buckets) {
+        free(c);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    c->nbuckets = nbuckets;
+    c->state = 0x9E3779B97F4A7C15ULL;
+    sl__set_err(err, SL_OK);
+    return c;
+}
+
+/**
+ * Free a cuckoo filter
+ *
+ * @param c Pointer to the filter variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_cuckoo_free(sl_cuckoo **c, sl_err *err) {
+    if (c && *c) {
+        free((*c)->buckets);
+        free(*c);
+        *c = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Add a key given by its hash
+ *
+ * When both buckets are full, entries are moved to their other bucket
+ * (up to SL_CUCKOO_MAX_KICKS times). If that fails, the last moved
+ * fingerprint is kept aside and the filter is full: later adds fail with
+ * SL_ERR_RANGE, but no added key is ever lost.
+ */
+void sl_cuckoo_add_hash(sl_cuckoo *c, uint64_t hash, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    if (c->victim_fp) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return;
+    }
+
+    hash = sl__mix64(hash);
+    uint16_t fp = sl__cuckoo_fp(hash);
+    size_t i = sl__cuckoo_index(c, (uint32_t)hash);
+    size_t alt = sl__cuckoo_alt(c, i, fp);
+    c->count++;
+    sl__set_err(err, SL_OK);
+    if (sl__cuckoo_put(&c->buckets[i], fp) || sl__cuckoo_put(&c->buckets[alt], fp))
+        return;
+
+    for (int kick = 0; kick < SL_CUCKOO_MAX_KICKS; kick++) {
+        // xorshift picks the bucket and slot to evict
+        c->state ^= c->state << 13;
+        c->state ^= c->state >> 7;
+        c->state ^= c->state << 17;
+        if (c->state & 4)
+            i = alt;
+        unsigned slot = (unsigned)(c->state & 3);
+        uint16_t out = (uint16_t)(c->buckets[i] >> (16 * slot));
+        c->buckets[i] = (c->buckets[i] & ~(0xFFFFULL << (16 * slot))) | (uint64_t)fp << (16 * slot);
+        fp = out;
+        i = sl__cuckoo_alt(c, i, fp);
+        if (sl__cuckoo_put(&c->buckets[i], fp))
+            return;
+        alt = sl__cuckoo_alt(c, i, fp);
+    }
+    c->victim_fp = fp;
+    c->victim_index = i;
+}
+
+/**
+ * Test a key given by its hash
+ *
+ * @return false if the key is not in the filter, true if it probably is
+ */
+bool sl_cuckoo_contains_hash(const sl_cuckoo *c, uint64_t hash, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl__set_err(err, SL_OK);
+    hash = sl__mix64(hash);
+    uint16_t fp = sl__cuckoo_fp(hash);
+    size_t i = sl__cuckoo_index(c, (uint32_t)hash);
+    size_t alt = sl__cuckoo_alt(c, i, fp);
+    if (sl__cuckoo_find(c->buckets[i], fp) >= 0 || sl__cuckoo_find(c->buckets[alt], fp) >= 0)
+        return true;
+    return c->victim_fp == fp && (c->victim_index == i || c->victim_index == alt);
+}
+
+/**
+ * Remove a key given by its hash (only keys that were added may be removed)
+ *
+ * @return true if a matching fingerprint was removed
+ */
+bool sl_cuckoo_remove_hash(sl_cuckoo *c, uint64_t hash, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl__set_err(err, SL_OK);
+    hash = sl__mix64(hash);
+    uint16_t fp = sl__cuckoo_fp(hash);
+    size_t i = sl__cuckoo_index(c, (uint32_t)hash);
+    size_t alt = sl__cuckoo_alt(c, i, fp);
+
+    if (c->victim_fp == fp && (c->victim_index == i || c->victim_index == alt)) {
+        c->victim_fp = 0;
+        c->count--;
+        return true;
+    }
+    size_t both[2] = {i, alt};
+    for (int b = 0; b < 2; b++) {
+        int slot = sl__cuckoo_find(c->buckets[both[b]], fp);
+        if (slot >= 0) {
+            c->buckets[both[b]] &= ~(0xFFFFULL << (16 * slot));
+            c->count--;
+            // the room made may take the fingerprint kept aside
+            if (c->victim_fp && (sl__cuckoo_put(&c->buckets[c->victim_index], c->victim_fp) ||
+                                 sl__cuckoo_put(&c->buckets[sl__cuckoo_alt(c, c->victim_index, c->victim_fp)],
+                                                c->victim_fp)))
+                c->victim_fp = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Add a string (its cached hash, the bytes are not read)
+ *
+ * @see sl_cuckoo_add_hash
+ */
+void sl_cuckoo_add(sl_cuckoo *c, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+    sl_cuckoo_add_hash(c, hdr->hash, err);
+}
+
+/**
+ * Test a string (its cached hash, the bytes are not read)
+ *
+ * @see sl_cuckoo_contains_hash
+ */
+bool sl_cuckoo_contains(const sl_cuckoo *c, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return false;
+    }
+    return sl_cuckoo_contains_hash(c, hdr->hash, err);
+}
+
+/**
+ * Remove a string that was added
+ *
+ * @see sl_cuckoo_remove_hash
+ */
+bool sl_cuckoo_remove(sl_cuckoo *c, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return false;
+    }
+    return sl_cuckoo_remove_hash(c, hdr->hash, err);
+}
+
+/**
+ * Number of keys in the filter
+ */
+size_t sl_cuckoo_count(const sl_cuckoo *c, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return c->count;
+}
+
+/**
+ * Bytes of the bucket array
+ */
+size_t sl_cuckoo_memory(const sl_cuckoo *c, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return c->nbuckets * sizeof(*c->buckets);
+}
+
+// SKETCHES
+
+/*
+ * HyperLogLog with the HyperLogLog++ sparse mode. A hash (mixed by
+ * `sl__mix64`) is split into a register index (top `p` bits) and the
+ * rank of the first 1 bit in the rest. Small sketches keep a sorted list
+ * of (25-bit index, rank) pairs instead of 2^p registers, with new pairs
+ * buffered and merged in batches; the list turns into registers once it
+ * would be larger than them. Counts use Ertl's improved estimator
+ * ("New cardinality estimation algorithms for HyperLogLog sketches",
+ * 2017), which needs no empirical bias tables, and linear counting over
+ * 2^25 positions in sparse mode.
+ */
+#define SL_HLL_SPARSE_P 25
+#define SL_HLL_TMP 256
+#define SL_HLL_DEFAULT_P 14
+
+struct sl_hll {
+    unsigned p;         /**< Precision: 2^p registers */
+    uint8_t *registers; /**< Dense mode, NULL while sparse */
+    uint32_t *sparse;   /**< Sorted index << 6 | rank, unique indices */
+    size_t nsparse;
+    size_t sparse_cap;
+    uint32_t tmp[SL_HLL_TMP]; /**< Pairs not merged into `sparse` yet */
+    size_t ntmp;
+};
+
+static double sl__sqrt(double x) {
+    if (x <= 0.0)
+        return 0.0;
+    double r = x > 1.0 ? x : 1.0;
+    for (int i = 0; i < 100; i++) {
+        double next = 0.5 * (r + x / r);
+        if (next >= r)
+            break;
+        r = next;
+    }
+    return r;
+}
+
+static inline uint32_t sl__hll_pair(uint64_t hash) {
+    // index: top 25 bits; rank of the remaining 39 bits (40 if all zero)
+    uint64_t rest = hash << SL_HLL_SPARSE_P | 1ULL << (SL_HLL_SPARSE_P - 1);
+    uint32_t rank = (uint32_t)__builtin_clzll(rest) + 1;
+    return (uint32_t)(hash >> (64 - SL_HLL_SPARSE_P)) << 6 | rank;
+}
+
+static int sl__hll_cmp_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Merge sorted pairs into the sparse list, keeping the largest rank of
+ * each index
+ */
+static sl_err sl__hll_merge_sparse(sl_hll *h, const uint32_t *pairs, size_t n) {
+    if (h->nsparse + n > h->sparse_cap) {
+        size_t cap = h->sparse_cap ? h->sparse_cap : 64;
+        while (cap < h->nsparse + n)
+            cap *= 2;
+        if (cap > ((size_t)1 << h->p) / sizeof(uint32_t))
+            cap = h->nsparse + n;
+        uint32_t *grown = realloc(h->sparse, cap * sizeof(*grown));
+        if (!grown)
+            return SL_ERR_ALLOC;
+        h->sparse = grown;
+        h->sparse_cap = cap;
+    }
+
+    // merge backwards in place; once `pairs` runs out the rest of the
+    // list is already where it belongs
+    size_t i = h->nsparse, j = n, total = h->nsparse + n;
+    uint32_t *out = h->sparse + total;
+    while (j > 0) {
+        if (i > 0 && h->sparse[i - 1] > pairs[j - 1])
+            *--out = h->sparse[--i];
+        else
+            *--out = pairs[--j];
+    }
+
+    // unique indices, largest rank (it sorts last)
+    size_t w = 0;
+    for (size_t r = 0; r < total; r++) {
+        if (w > 0 && h->sparse[w - 1] >> 6 == h->sparse[r] >> 6)
+            h->sparse[w - 1] = h->sparse[r];
+        else
+            h->sparse[w++] = h->sparse[r];
+    }
+    h->nsparse = w;
+    return SL_OK;
+}
+
+static void sl__hll_dense_add(sl_hll *h, uint32_t pair) {
+    // the register index is the top p of the 25 index bits; the bits
+    // between are the start of the rank
+    uint32_t idx = pair >> 6, rank = pair & 63;
+    unsigned extra = SL_HLL_SPARSE_P - h->p;
+    uint32_t low = idx & ((1u << extra) - 1);
+    uint8_t r = low ? (uint8_t)(__builtin_clz(low) - (32 - extra) + 1) : (uint8_t)(extra + rank);
+    uint8_t *reg = &h->registers[idx >> extra];
+    if (r > *reg)
+        *reg = r;
+}
+
+static sl_err sl__hll_densify(sl_hll *h) {
+    uint8_t *registers = calloc((size_t)1 << h->p, 1);
+    if (!registers)
+        return SL_ERR_ALLOC;
+    h->registers = registers;
+    for (size_t i = 0; i < h->nsparse; i++)
+        sl__hll_dense_add(h, h->sparse[i]);
+    free(h->sparse);
+    h->sparse = NULL;
+    h->nsparse = h->sparse_cap = 0;
+    return SL_OK;
+}
+
+/**
+ * Add sorted pairs, switching to registers rather than let the list grow
+ * larger than them
+ */
+static sl_err sl__hll_insert(sl_hll *h, const uint32_t *pairs, size_t n) {
+    if (!h->registers && (h->nsparse + n) * sizeof(uint32_t) > ((size_t)1 << h->p)) {
+        sl_err e = sl__hll_densify(h);
+        if (e != SL_OK)
+            return e;
+    }
+    if (!h->registers)
+        return sl__hll_merge_sparse(h, pairs, n);
+    for (size_t i = 0; i < n; i++)
+        sl__hll_dense_add(h, pairs[i]);
+    return SL_OK;
+}
+
+/**
+ * Move the buffered pairs into the list
+ */
+static sl_err sl__hll_flush(sl_hll *h) {
+    if (h->registers || h->ntmp == 0)
+        return SL_OK;
+    qsort(h->tmp, h->ntmp, sizeof(*h->tmp), sl__hll_cmp_u32);
+    size_t n = 0;
+    for (size_t i = 0; i < h->ntmp; i++) {
+        if (n > 0 && h->tmp[n - 1] >> 6 == h->tmp[i] >> 6)
+            h->tmp[n - 1] = h->tmp[i];
+        else
+            h->tmp[n++] = h->tmp[i];
+    }
+    sl_err e = sl__hll_insert(h, h->tmp, n);
+    if (e == SL_OK)
+        h->ntmp = 0;
+    return e;
+}
+
+/**
+ * Create a HyperLogLog sketch
+ *
+ * The relative error of a count is about 1.04 / sqrt(2^precision)
+ * (0.8% for 14); a sketch uses at most 2^precision bytes and much less
+ * while it has seen few distinct keys.
+ *
+ * @param precision 4 to 18, 0 for 14
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The sketch, or NULL on error
+ */
+sl_hll *sl_hll_new(unsigned precision, sl_err *err) {
+    if (precision == 0)
+        precision = SL_HLL_DEFAULT_P;
+    if (precision < 4 || precision > 18) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return NULL;
+    }
+    sl_hll *h = calloc(1, sizeof(*h));
+    if (!h) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    h->p = precision;
+    sl__set_err(err, SL_OK);
+    return h;
+}
+
+/**
+ * Free a HyperLogLog sketch
+ *
+ * @param h Pointer to the sketch variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_hll_free(sl_hll **h, sl_err *err) {
+    if (h && *h) {
+        free((*h)->registers);
+        free((*h)->sparse);
+        free(*h);
+        *h = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Add a key given by its hash (`sl_hash` or `sl_compute_hash`)
+ */
+void sl_hll_add_hash(sl_hll *h, uint64_t hash, sl_err *err) {
+    if (!h) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    uint32_t pair = sl__hll_pair(sl__mix64(hash));
+    if (h->registers) {
+        sl__hll_dense_add(h, pair);
+        sl__set_err(err, SL_OK);
+        return;
+    }
+    if (h->ntmp == SL_HLL_TMP) {
+        sl_err e = sl__hll_flush(h);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return;
+        }
+        if (h->registers) {
+            sl__hll_dense_add(h, pair);
+            sl__set_err(err, SL_OK);
+            return;
+        }
+    }
+    h->tmp[h->ntmp++] = pair;
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Add a string (its cached hash, the bytes are not read)
+ */
+void sl_hll_add(sl_hll *h, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+    sl_hll_add_hash(h, hdr->hash, err);
+}
+
+/**
+ * Ertl's sigma and tau series (improved raw estimator)
+ */
+static double sl__hll_sigma(double x) {
+    if (x == 1.0)
+        return 1e308;
+    double y = 1.0, z = x, prev;
+    do {
+        x *= x;
+        prev = z;
+        z += x * y;
+        y += y;
+    } while (z != prev);
+    return z;
+}
+
+static double sl__hll_tau(double x) {
+    if (x == 0.0 || x == 1.0)
+        return 0.0;
+    double y = 1.0, z = 1.0 - x, prev;
+    do {
+        x = sl__sqrt(x);
+        prev = z;
+        y *= 0.5;
+        z -= (1.0 - x) * (1.0 - x) * y;
+    } while (z != prev);
+    return z / 3.0;
+}
+
+/**
+ * Estimated number of distinct keys added
+ *
+ * @param h The sketch
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The estimate
+ */
+uint64_t sl_hll_count(sl_hll *h, sl_err *err) {
+    if (!h) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl_err e = sl__hll_flush(h);
+    sl__set_err(err, e);
+    if (e != SL_OK)
+        return 0;
+
+    if (!h->registers) {
+        // linear counting over the 2^25 sparse positions
+        double m = (double)(1u << SL_HLL_SPARSE_P), empty = m - (double)h->nsparse;
+        return (uint64_t)(m * sl__ln(m / empty) + 0.5);
+    }
+
+    size_t m = (size_t)1 << h->p;
+    unsigned q = 64 - h->p;
+    size_t hist[66] = {0};
+    for (size_t i = 0; i < m; i++)
+        hist[h->registers[i]]++;
+    double z = (double)m * sl__hll_tau(1.0 - (double)hist[q + 1] / (double)m);
+    for (unsigned k = q; k >= 1; k--)
+        z = 0.5 * (z + (double)hist[k]);
+    z += (double)m * sl__hll_sigma((double)hist[0] / (double)m);
+    return (uint64_t)(0.5 / SL_LN2 * (double)m * (double)m / z + 0.5);
+}
+
+/**
+ * Add every key of `src` to `dst` (sketches built in parallel, for example)
+ *
+ * @param dst The sketch to update
+ * @param src The other sketch (same precision)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (SL_ERR_INVALID if the precisions differ)
+ */
+void sl_hll_merge(sl_hll *dst, sl_hll *src, sl_err *err) {
+    if (!dst || !src) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    if (dst->p != src->p) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return;
+    }
+    sl_err e = sl__hll_flush(src);
+    if (e == SL_OK)
+        e = sl__hll_flush(dst);
+    if (e == SL_OK && !dst->registers && src->registers)
+        e = sl__hll_densify(dst);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+
+    if (src->registers) {
+        for (size_t i = 0; i < ((size_t)1 << dst->p); i++)
+            if (src->registers[i] > dst->registers[i])
+                dst->registers[i] = src->registers[i];
+    } else {
+        e = sl__hll_insert(dst, src->sparse, src->nsparse);
+    }
+    sl__set_err(err, e);
+}
+
+/**
+ * Heap bytes used by the sketch
+ */
+size_t sl_hll_memory(const sl_hll *h, sl_err *err) {
+    if (!h) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return sizeof(*h) + (h->registers ? (size_t)1 << h->p : h->sparse_cap * sizeof(uint32_t));
+}
+
+/*
+ * Count-min sketch: `depth` rows of `width` saturating counters, row i
+ * indexed by h1 + i * h2 of the mixed hash. Heavy hitters are tracked
+ * in a min-heap of the `top_k` keys with the largest estimates; a small
+ * open-addressing table maps hashes to heap slots, and keys whose
+ * estimate does not beat the heap minimum never touch either.
+ */
+typedef struct {
+    uint64_t count;
+    sl_hdr *key; /**< Owned copy */
+    size_t slot; /**< Position in `slots` */
+} sl__cms_top_entry;
+
+struct sl_cms {
+    size_t width;
+    size_t depth;
+    uint32_t *counters;
+    uint64_t total;
+    size_t top_k;
+    size_t ntop;
+    sl__cms_top_entry *heap;
+    uint32_t *slots; /**< Heap index + 1 by hash, 0 for empty */
+    size_t slot_mask;
+};
+
+static inline uint64_t sl__cms_row_min(const sl_cms *c, uint64_t hash, uint64_t add) {
+    uint64_t x = sl__mix64(hash);
+    uint32_t h1 = (uint32_t)x, h2 = (uint32_t)(x >> 32) | 1;
+    uint64_t min = UINT64_MAX;
+    for (size_t i = 0; i < c->depth; i++) {
+        uint32_t *cell = &c->counters[i * c->width + (size_t)(((uint64_t)(h1 + (uint32_t)i * h2) * c->width) >> 32)];
+        if (add) {
+            uint64_t v = *cell + add;
+            *cell = v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+        }
+        if (*cell < min)
+            min = *cell;
+    }
+    return min;
+}
+
+/**
+ * Slot holding `key` in the heap table, or the empty slot to put it in
+ */
+static size_t sl__cms_find(const sl_cms *c, const sl_hdr *key) {
+    size_t i = (size_t)sl__mix64(key->hash) & c->slot_mask;
+    while (c->slots[i]) {
+        const sl_hdr *other = c->heap[c->slots[i] - 1].key;
+        if (other->hash == key->hash && other->len == key->len && memcmp(other->data, key->data, key->len) == 0)
+            return i;
+        i = (i + 1) & c->slot_mask;
+    }
+    return i;
+}
+
+/**
+ * Empty a slot, shifting later entries of its probe run back
+ */
+static void sl__cms_unslot(sl_cms *c, size_t hole) {
+    c->slots[hole] = 0;
+    for (size_t i = (hole + 1) & c->slot_mask; c->slots[i]; i = (i + 1) & c->slot_mask) {
+        size_t home = (size_t)sl__mix64(c->heap[c->slots[i] - 1].key->hash) & c->slot_mask;
+        // move back unless its home lies in (hole, i]
+        if (((i - home) & c->slot_mask) >= ((i - hole) & c->slot_mask)) {
+            c->slots[hole] = c->slots[i];
+            c->heap[c->slots[hole] - 1].slot = hole;
+            c->slots[i] = 0;
+            hole = i;
+        }
+    }
+}
+
+static void sl__cms_heap_set(sl_cms *c, size_t i, sl__cms_top_entry entry) {
+    c->heap[i] = entry;
+    c->slots[entry.slot] = (uint32_t)i + 1;
+}
+
+static void sl__cms_sift_down(sl_cms *c, size_t i) {
+    sl__cms_top_entry entry = c->heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= c->ntop)
+            break;
+        if (child + 1 < c->ntop && c->heap[child + 1].count < c->heap[child].count)
+            child++;
+        if (c->heap[child].count >= entry.count)
+            break;
+        sl__cms_heap_set(c, i, c->heap[child]);
+        i = child;
+    }
+    sl__cms_heap_set(c, i, entry);
+}
+
+static void sl__cms_sift_up(sl_cms *c, size_t i) {
+    sl__cms_top_entry entry = c->heap[i];
+    while (i > 0 && c->heap[(i - 1) / 2].count > entry.count) {
+        sl__cms_heap_set(c, i, c->heap[(i - 1) / 2]);
+        i = (i - 1) / 2;
+    }
+    sl__cms_heap_set(c, i, entry);
+}
+
+/**
+ * Record that `key` now has estimate `count`
+ */
+static sl_err sl__cms_track(sl_cms *c, const sl_hdr *key, uint64_t count) {
+    if (c->ntop == c->top_k && count <= c->heap[0].count)
+        return SL_OK;
+
+    size_t slot = sl__cms_find(c, key);
+    if (c->slots[slot]) {
+        size_t i = c->slots[slot] - 1;
+        if (count > c->heap[i].count) {
+            c->heap[i].count = count;
+            sl__cms_sift_down(c, i);
+        }
+        return SL_OK;
+    }
+
+    sl_err e;
+    sl_hdr *copy = sl__alloc_exact(key->len, &e);
+    if (!copy)
+        return e;
+    memcpy(copy->data, key->data, key->len);
+    copy->hash = key->hash;
+
+    size_t i;
+    if (c->ntop < c->top_k) {
+        i = c->ntop++;
+    } else {
+        // evict the minimum; its slot leaving can move ours
+        i = 0;
+        sl__cms_unslot(c, c->heap[0].slot);
+        free(c->heap[0].key);
+        slot = sl__cms_find(c, copy);
+    }
+    sl__cms_heap_set(c, i, (sl__cms_top_entry){count, copy, slot});
+    if (i == 0 && c->ntop == c->top_k)
+        sl__cms_sift_down(c, 0);
+    else
+        sl__cms_sift_up(c, i);
+    return SL_OK;
+}
+
+/**
+ * Create a count-min sketch
+ *
+ * An estimate is never below the true count, and exceeds it by more than
+ * `2 * total / width` with probability at most 2^-depth.
+ *
+ * @param width Counters per row (at least 1)
+ * @param depth Number of rows (1 to 32)
+ * @param top_k How many heavy hitters to track, 0 for none
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The sketch, or NULL on error
+ */
+sl_cms *sl_cms_new(size_t width, size_t depth, size_t top_k, sl_err *err) {
+    if (width == 0 || width > UINT32_MAX || depth == 0 || depth > 32 || top_k > UINT32_MAX / 4) {
+        sl__set_err(err, SL_ERR_RANGE);
+        return NULL;
+    }
+    sl_cms *c = calloc(1, sizeof(*c));
+    if (!c) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    c->width = width;
+    c->depth = depth;
+    c->top_k = top_k;
+    c->counters = calloc(width * depth, sizeof(*c->counters));
+    if (top_k > 0) {
+        size_t nslots = 4;
+        while (nslots < 2 * top_k)
+            nslots *= 2;
+        c->slot_mask = nslots - 1;
+        c->slots = calloc(nslots, sizeof(*c->slots));
+        c->heap = malloc(top_k * sizeof(*c->heap));
+    }
+    if (!c->counters || (top_k > 0 && (!c->slots || !c->heap))) {
+        free(c->counters);
+        free(c->slots);
+        free(c->heap);
+        free(c);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    sl__set_err(err, SL_OK);
+    return c;
+}
+
+/**
+ * Free a count-min sketch
+ *
+ * @param c Pointer to the sketch variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_cms_free(sl_cms **c, sl_err *err) {
+    if (c && *c) {
+        for (size_t i = 0; i < (*c)->ntop; i++)
+            free((*c)->heap[i].key);
+        free((*c)->heap);
+        free((*c)->slots);
+        free((*c)->counters);
+        free(*c);
+        *c = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Count `n` occurrences of a key given by its hash
+ *
+ * Keys added this way are not tracked as heavy hitters (there are no bytes
+ * to report); use `sl_cms_add` for that.
+ *
+ * @return The new estimate for the key
+ */
+uint64_t sl_cms_add_hash(sl_cms *c, uint64_t hash, uint64_t n, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    c->total += n;
+    sl__set_err(err, SL_OK);
+    return sl__cms_row_min(c, hash, n);
+}
+
+/**
+ * Count `n` occurrences of a string (hashed by its cached hash)
+ *
+ * @param c The sketch
+ * @param str The key
+ * @param n Occurrences to add
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The new estimate for the key
+ */
+uint64_t sl_cms_add(sl_cms *c, sl_str str, uint64_t n, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e == SL_OK && !c)
+        e = SL_ERR_NULL;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+    c->total += n;
+    uint64_t count = sl__cms_row_min(c, hdr->hash, n);
+    sl__set_err(err, c->top_k ? sl__cms_track(c, hdr, count) : SL_OK);
+    return count;
+}
+
+/**
+ * Estimated count of a key given by its hash
+ */
+uint64_t sl_cms_estimate_hash(const sl_cms *c, uint64_t hash, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return sl__cms_row_min(c, hash, 0);
+}
+
+/**
+ * Estimated count of a string
+ */
+uint64_t sl_cms_estimate(const sl_cms *c, sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+    return sl_cms_estimate_hash(c, hdr->hash, err);
+}
+
+/**
+ * Sum of every count added
+ */
+uint64_t sl_cms_total(const sl_cms *c, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return c->total;
+}
+
+static int sl__cms_item_cmp(const void *a, const void *b) {
+    const sl_cms_item *x = a, *y = b;
+    if (x->count != y->count)
+        return x->count < y->count ? 1 : -1;
+    return sl__bytes_cmp(x->key.data, x->key.len, y->key.data, y->key.len);
+}
+
+/**
+ * The heavy hitters, largest estimate first
+ *
+ * Keys point into the sketch and are valid until its next change.
+ *
+ * @param c The sketch
+ * @param out Array of at least `max` items
+ * @param max Capacity of `out`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return Number of items written (at most `top_k`)
+ */
+size_t sl_cms_top(const sl_cms *c, sl_cms_item *out, size_t max, sl_err *err) {
+    if (!c || (!out && max > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    if (c->ntop == 0 || max == 0)
+        return 0;
+
+    sl_cms_item *all = malloc(c->ntop * sizeof(*all));
+    if (!all) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return 0;
+    }
+    for (size_t i = 0; i < c->ntop; i++)
+        all[i] = (sl_cms_item){{c->heap[i].key->data, c->heap[i].key->len}, c->heap[i].count};
+    qsort(all, c->ntop, sizeof(*all), sl__cms_item_cmp);
+    size_t n = c->ntop < max ? c->ntop : max;
+    memcpy(out, all, n * sizeof(*out));
+    free(all);
+    return n;
+}
+
+/**
+ * Add every count of `src` to `dst` (sketches built in parallel, for example)
+ *
+ * Heavy hitters of both are re-estimated from the merged counters.
+ *
+ * @param dst The sketch to update
+ * @param src The other sketch (same width and depth)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ *            (SL_ERR_INVALID if the dimensions differ)
+ */
+void sl_cms_merge(sl_cms *dst, const sl_cms *src, sl_err *err) {
+    if (!dst || !src) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    if (dst->width != src->width || dst->depth != src->depth) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return;
+    }
+    for (size_t i = 0; i < dst->width * dst->depth; i++) {
+        uint64_t v = (uint64_t)dst->counters[i] + src->counters[i];
+        dst->counters[i] = v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+    }
+    dst->total += src->total;
+
+    // counts only grow, so the heap just needs rebuilding
+    for (size_t i = 0; i < dst->ntop; i++)
+        dst->heap[i].count = sl__cms_row_min(dst, dst->heap[i].key->hash, 0);
+    for (size_t i = dst->ntop / 2; i-- > 0;)
+        sl__cms_sift_down(dst, i);
+
+    sl_err e = SL_OK;
+    for (size_t i = 0; i < src->ntop && e == SL_OK && dst->top_k; i++)
+        e = sl__cms_track(dst, src->heap[i].key, sl__cms_row_min(dst, src->heap[i].key->hash, 0));
+    sl__set_err(err, e);
+}
+
+/**
+ * Heap bytes used by the sketch
+ */
+size_t sl_cms_memory(const sl_cms *c, sl_err *err) {
+    if (!c) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    size_t bytes = sizeof(*c) + c->width * c->depth * sizeof(*c->counters) + c->top_k * sizeof(*c->heap);
+    if (c->top_k)
+        bytes += (c->slot_mask + 1) * sizeof(*c->slots);
+    for (size_t i = 0; i < c->ntop; i++)
+        bytes += sizeof(sl_hdr) + c->heap[i].key->cap;
+    sl__set_err(err, SL_OK);
+    return bytes;
+}
+
+// ROLLING HASH
+
+/*
+ * Windows are hashed with the polynomial hash of the rope
+ * (`sl_compute_poly_hash`), which unlike FNV-1a can slide: dropping the
+ * first byte and appending the next is
+ * H' = H * BASE - out * BASE^k + in  (mod 2^64).
+ */
+
+struct sl_rolling_hash {
+    const unsigned char *data;
+    size_t len;
+    size_t k;
+    size_t pos;    /**< Start of the next window */
+    uint64_t hash; /**< Hash of the window at `pos` */
+    uint64_t pow;  /**< SL_POLY_BASE ^ k */
+};
+
+/** 2^64 / golden ratio, spreads low bits into the top bits */
+#define SL_FIB_MUL 0x9E3779B97F4A7C15ULL
+
+static inline uint64_t sl__roll(uint64_t hash, uint64_t pow, unsigned char out, unsigned char in) {
+    return hash * SL_POLY_BASE - out * pow + in;
+}
+
+/**
+ * Iterate over the hashes of every `k` byte window of a string
+ *
+ * Each step costs O(1) whatever `k` is. The iterator reads the bytes of
+ * `str`, which must stay alive and unchanged until `sl_rolling_hash_free`.
+ *
+ * @param str The string
+ * @param k Window length (at least 1)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The iterator, or NULL on error
+ */
+sl_rolling_hash *sl_rolling_hash_new(sl_str str, size_t k, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e == SL_OK && k == 0)
+        e = SL_ERR_INVALID;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return NULL;
+    }
+    sl_rolling_hash *rh = malloc(sizeof(*rh));
+    if (!rh) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    rh->data = (const unsigned char *)hdr->data;
+    rh->len = hdr->len;
+    rh->k = k;
+    rh->pos = 0;
+    rh->pow = 0;
+    rh->hash = k <= hdr->len ? sl__poly_hash(hdr->data, k, &rh->pow) : 0;
+    sl__set_err(err, SL_OK);
+    return rh;
+}
+
+/**
+ * Hash of the next window
+ *
+ * @param rh The iterator
+ * @param pos Receives the offset of the window, can be NULL
+ * @param hash Receives its hash (equal to `sl_compute_poly_hash` of the
+ *        window)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return false after the last window
+ */
+bool sl_rolling_hash_next(sl_rolling_hash *rh, size_t *pos, uint64_t *hash, sl_err *err) {
+    if (!rh || !hash) {
+        sl__set_err(err, SL_ERR_NULL);
+        return false;
+    }
+    sl__set_err(err, SL_OK);
+    if (rh->k > rh->len || rh->pos > rh->len - rh->k)
+        return false;
+    if (pos)
+        *pos = rh->pos;
+    *hash = rh->hash;
+    // the last window has no successor to roll into
+    if (rh->pos < rh->len - rh->k)
+        rh->hash = sl__roll(rh->hash, rh->pow, rh->data[rh->pos], rh->data[rh->pos + rh->k]);
+    rh->pos++;
+    return true;
+}
+
+/**
+ * Free a rolling hash iterator
+ *
+ * @param rh Pointer to the iterator variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_rolling_hash_free(sl_rolling_hash **rh, sl_err *err) {
+    if (rh && *rh) {
+        free(*rh);
+        *rh = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Call `fn` with every `k` byte substring (n-gram) of a string, in order
+ *
+ * The hash passed with each n-gram is its polynomial hash, updated in O(1)
+ * from the previous one.
+ *
+ * @param str The string
+ * @param k N-gram length (at least 1)
+ * @param fn Called with each n-gram and its hash, returns false to stop
+ * @param ctx Passed to `fn`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The number of n-grams visited
+ */
+size_t sl_ngrams(sl_str str, size_t k, sl_ngram_visit fn, void *ctx, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e == SL_OK && !fn)
+        e = SL_ERR_NULL;
+    if (e == SL_OK && k == 0)
+        e = SL_ERR_INVALID;
+    sl__set_err(err, e);
+    if (e != SL_OK || k > hdr->len)
+        return 0;
+
+    const unsigned char *data = (const unsigned char *)hdr->data;
+    uint64_t pow;
+    uint64_t hash = sl__poly_hash(data, k, &pow);
+    size_t last = hdr->len - k;
+    for (size_t i = 0;; i++) {
+        if (!fn((sl_view){hdr->data + i, k}, hash, ctx))
+            return i + 1;
+        if (i == last)
+            return i + 1;
+        hash = sl__roll(hash, pow, data[i], data[i + k]);
+    }
+}
+
+/**
+ * Find the first occurrence of any of several needles of the same length
+ * (Rabin-Karp)
+ *
+ * The needle hashes go in a small open-addressing table indexed by their
+ * top bits, and every window of the haystack is looked up in it after an
+ * O(1) hash update; candidates are confirmed with `memcmp`. The scan
+ * costs O(haystack length) whatever the number of needles.
+ *
+ * @param haystack The string to search
+ * @param start Offset to start searching from
+ * @param needles Array of `count` needles, all of the same non-zero length
+ * @param count Number of needles
+ * @param which Receives the index of the needle found, can be NULL
+ *        (the first one for duplicate needles)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return Offset of the match, or SL_NOT_FOUND
+ */
+size_t sl_find_any(sl_str haystack, size_t start, const sl_str *needles, size_t count, size_t *which, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(haystack, &hdr);
+    if (e == SL_OK && !needles && count > 0)
+        e = SL_ERR_NULL;
+    if (e == SL_OK && start > hdr->len)
+        e = SL_ERR_RANGE;
+    if (e != SL_OK || count == 0) {
+        sl__set_err(err, e);
+        return SL_NOT_FOUND;
+    }
+
+    const sl_hdr **nh = malloc(count * sizeof(*nh));
+    if (!nh) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return SL_NOT_FOUND;
+    }
+    size_t k = 0;
+    for (size_t i = 0; i < count; i++) {
+        sl_hdr *h;
+        e = sl__validate(needles[i], &h);
+        if (e == SL_OK && (h->len == 0 || (i > 0 && h->len != k)))
+            e = SL_ERR_INVALID;
+        if (e != SL_OK) {
+            free(nh);
+            sl__set_err(err, e);
+            return SL_NOT_FOUND;
+        }
+        nh[i] = h;
+        k = h->len;
+    }
+    sl__set_err(err, SL_OK);
+    if (hdr->len - start < k) {
+        free(nh);
+        return SL_NOT_FOUND;
+    }
+
+    // table of needle hashes at load <= 1/2, slots hold needle index + 1;
+    // a bitmap of 64 bits per needle in front of it rejects most windows
+    // with one predictable test. Both are indexed by the top bits of the
+    // hash times a Fibonacci constant: the top bits of the polynomial hash
+    // alone barely depend on the last bytes of the window.
+    unsigned bits = 1;
+    while (((size_t)1 << bits) < 2 * count)
+        bits++;
+    unsigned filter_bits = bits + 6 < 12 ? 12 : bits + 6;
+    size_t mask = ((size_t)1 << bits) - 1;
+    uint64_t *hashes = malloc(((size_t)1 << bits) * sizeof(*hashes));
+    size_t *slots = calloc((size_t)1 << bits, sizeof(*slots));
+    uint64_t *filter = calloc((size_t)1 << (filter_bits - 6), sizeof(*filter));
+    if (!hashes || !slots || !filter) {
+        free(hashes);
+        free(slots);
+        free(filter);
+        free(nh);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return SL_NOT_FOUND;
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint64_t h = sl__poly_hash(nh[i]->data, k, NULL);
+        uint64_t spread = h * SL_FIB_MUL;
+        size_t s = (size_t)(spread >> (64 - bits));
+        while (slots[s] && !(hashes[s] == h && memcmp(nh[slots[s] - 1]->data, nh[i]->data, k) == 0))
+            s = (s + 1) & mask;
+        if (!slots[s]) {
+            slots[s] = i + 1;
+            hashes[s] = h;
+        }
+        uint64_t f = spread >> (64 - filter_bits);
+        filter[f >> 6] |= 1ULL << (f & 63);
+    }
+
+    const unsigned char *data = (const unsigned char *)hdr->data;
+    uint64_t pow;
+    uint64_t hash = sl__poly_hash(data + start, k, &pow);
+    size_t last = hdr->len - k, found = SL_NOT_FOUND;
+    for (size_t i = start;; i++) {
+        uint64_t spread = hash * SL_FIB_MUL;
+        uint64_t f = spread >> (64 - filter_bits);
+        if (filter[f >> 6] >> (f & 63) & 1) {
+            for (size_t s = (size_t)(spread >> (64 - bits)); slots[s]; s = (s + 1) & mask) {
+                if (hashes[s] == hash && memcmp(nh[slots[s] - 1]->data, data + i, k) == 0) {
+                    found = i;
+                    if (which)
+                        *which = slots[s] - 1;
+                    break;
+                }
+            }
+        }
+        if (found != SL_NOT_FOUND || i == last)
+            break;
+        hash = sl__roll(hash, pow, data[i], data[i + k]);
+    }
+    free(filter);
+    free(hashes);
+    free(slots);
+    free(nh);
+    return found;
+}
+
+// SIMILARITY SIGNATURES
+
+/*
+ * MinHash: the shingles (k-byte windows) of a document are hashed with
+ * the rolling polynomial hash and mixed down to 32 bits. Permutation i
+ * maps a shingle hash x to (x ^ seed_i) * mult_i mod 2^32 (a bijection,
+ * mult_i is odd), and value i of the signature is the minimum over the
+ * shingles. The fraction of equal values between two signatures
+ * estimates the Jaccard similarity of their shingle sets. Seeds come from
+ * a fixed splitmix64 sequence, so signatures compare across processes.
+ */
+#define SL_MINHASH_MAX_PERM 1024
+
+/** Shingle length of `sl_simhash` */
+#define SL_SIMHASH_K 4
+
+static uint64_t sl__splitmix(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * 32-bit hashes of every shingle, or of the whole string when it is
+ * shorter than `k`
+ *
+ * @return Number of hashes (0 for an empty string), SIZE_MAX if the
+ *         allocation failed
+ */
+static size_t sl__shingles(const sl_hdr *hdr, size_t k, uint32_t **out) {
+    *out = NULL;
+    if (hdr->len == 0)
+        return 0;
+    if (k > hdr->len)
+        k = hdr->len;
+    size_t n = hdr->len - k + 1;
+    uint32_t *x = malloc(n * sizeof(*x));
+    if (!x)
+        return SIZE_MAX;
+
+    const unsigned char *data = (const unsigned char *)hdr->data;
+    uint64_t pow;
+    uint64_t hash = sl__poly_hash(data, k, &pow);
+    for (size_t i = 0;; i++) {
+        x[i] = (uint32_t)(sl__mix64(hash) >> 32);
+        if (i == n - 1)
+            break;
+        hash = sl__roll(hash, pow, data[i], data[i + k]);
+    }
+    *out = x;
+    return n;
+}
+
+static void sl__minhash_scalar(const uint32_t *x, size_t n, const uint32_t *seeds, const uint32_t *mults,
+                               size_t from, size_t num_perm, uint32_t *sig) {
+    for (size_t p = from; p < num_perm; p++) {
+        uint32_t min = UINT32_MAX, seed = seeds[p], mult = mults[p];
+        for (size_t j = 0; j < n; j++) {
+            uint32_t v = (x[j] ^ seed) * mult;
+            min = v < min ? v : min;
+        }
+        sig[p] = min;
+    }
+}
+
+#if defined(SL_HAVE_AVX2_KERNELS) && defined(__x86_64__)
+/**
+ * Minimum of 32 permutations per pass over the shingles, kept in four
+ * registers; then 8 at a time
+ *
+ * @return Number of permutations done (`num_perm` rounded down to 8)
+ */
+__attribute__((target("avx2"))) static size_t sl__minhash_avx2(const uint32_t *x, size_t n, const uint32_t *seeds,
+                                                               const uint32_t *mults, size_t num_perm,
+                                                               uint32_t *sig) {
+    size_t p = 0;
+    for (; p + 32 <= num_perm; p += 32) {
+        __m256i s0 = _mm256_loadu_si256((const __m256i *)(seeds + p));
+        __m256i s1 = _mm256_loadu_si256((const __m256i *)(seeds + p + 8));
+        __m256i s2 = _mm256_loadu_si256((const __m256i *)(seeds + p + 16));
+        __m256i s3 = _mm256_loadu_si256((const __m256i *)(seeds + p + 24));
+        __m256i m0 = _mm256_loadu_si256((const __m256i *)(mults + p));
+        __m256i m1 = _mm256_loadu_si256((const __m256i *)(mults + p + 8));
+        __m256i m2 = _mm256_loadu_si256((const __m256i *)(mults + p + 16));
+        __m256i m3 = _mm256_loadu_si256((const __m256i *)(mults + p + 24));
+        __m256i min0 = _mm256_set1_epi32(-1), min1 = min0, min2 = min0, min3 = min0;
+        for (size_t j = 0; j < n; j++) {
+            __m256i v = _mm256_set1_epi32((int)x[j]);
+            min0 = _mm256_min_epu32(min0, _mm256_mullo_epi32(_mm256_xor_si256(v, s0), m0));
+            min1 = _mm256_min_epu32(min1, _mm256_mullo_epi32(_mm256_xor_si256(v, s1), m1));
+            min2 = _mm256_min_epu32(min2, _mm256_mullo_epi32(_mm256_xor_si256(v, s2), m2));
+            min3 = _mm256_min_epu32(min3, _mm256_mullo_epi32(_mm256_xor_si256(v, s3), m3));
+        }
+        _mm256_storeu_si256((__m256i *)(sig + p), min0);
+        _mm256_storeu_si256((__m256i *)(sig + p + 8), min1);
+        _mm256_storeu_si256((__m256i *)(sig + p + 16), min2);
+        _mm256_storeu_si256((__m256i *)(sig + p + 24), min3);
+    }
+    for (; p + 8 <= num_perm; p += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)(seeds + p));
+        __m256i m = _mm256_loadu_si256((const __m256i *)(mults + p));
+        __m256i min = _mm256_set1_epi32(-1);
+        for (size_t j = 0; j < n; j++)
+            min = _mm256_min_epu32(min, _mm256_mullo_epi32(_mm256_xor_si256(_mm256_set1_epi32((int)x[j]), s), m));
+        _mm256_storeu_si256((__m256i *)(sig + p), min);
+    }
+    return p;
+}
+#endif
+
+/**
+ * MinHash signature of a string
+ *
+ * Two documents that share a fraction J of their shingles (Jaccard
+ * similarity) have about J * num_perm equal signature values; the
+ * standard error of the estimate is sqrt(J * (1 - J) / num_perm).
+ * A string shorter than `shingle_k` is a single shingle; the signature of
+ * an empty string is all UINT32_MAX.
+ *
+ * @param str The document
+ * @param shingle_k Shingle length in bytes (at least 1)
+ * @param num_perm Signature length (1 to 1024)
+ * @param sig Receives `num_perm` values
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_minhash(sl_str str, size_t shingle_k, size_t num_perm, uint32_t *sig, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e == SL_OK && !sig)
+        e = SL_ERR_NULL;
+    if (e == SL_OK && shingle_k == 0)
+        e = SL_ERR_INVALID;
+    if (e == SL_OK && (num_perm == 0 || num_perm > SL_MINHASH_MAX_PERM))
+        e = SL_ERR_RANGE;
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return;
+    }
+
+    uint32_t *x;
+    size_t n = sl__shingles(hdr, shingle_k, &x);
+    if (n == SIZE_MAX) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return;
+    }
+    uint32_t seeds[SL_MINHASH_MAX_PERM], mults[SL_MINHASH_MAX_PERM];
+    uint64_t state = 0;
+    for (size_t p = 0; p < num_perm; p++) {
+        uint64_t r = sl__splitmix(&state);
+        seeds[p] = (uint32_t)r;
+        mults[p] = (uint32_t)(r >> 32) | 1;
+    }
+
+    size_t done = 0;
+#if defined(SL_HAVE_AVX2_KERNELS) && defined(__x86_64__)
+    if (sl__cpu_has_avx2())
+        done = sl__minhash_avx2(x, n, seeds, mults, num_perm, sig);
+#endif
+    sl__minhash_scalar(x, n, seeds, mults, done, num_perm, sig);
+    free(x);
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Estimated Jaccard similarity of two MinHash signatures
+ *
+ * @return The fraction of equal values, from 0 to 1
+ */
+double sl_minhash_similarity(const uint32_t *a, const uint32_t *b, size_t num_perm, sl_err *err) {
+    if (!a || !b) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0.0;
+    }
+    sl__set_err(err, SL_OK);
+    if (num_perm == 0)
+        return 0.0;
+    size_t equal = 0;
+    for (size_t i = 0; i < num_perm; i++)
+        equal += a[i] == b[i];
+    return (double)equal / (double)num_perm;
+}
+
+/*
+ * SimHash bit votes are counted in 64 byte counters (in four SSE2
+ * registers when available) and moved into wider totals every 255 votes.
+ */
+static void sl__simhash_totals(const uint8_t counts[64], size_t totals[64]) {
+    for (int r = 0; r < 4; r++) {
+        for (int b = 0; b < 8; b++) {
+            totals[16 * r + b] += counts[16 * r + 2 * b];
+            totals[16 * r + 8 + b] += counts[16 * r + 2 * b + 1];
+        }
+    }
+}
+
+#if defined(__SSE2__)
+typedef __m128i sl__simhash_acc[4];
+
+static inline void sl__simhash_count(sl__simhash_acc acc, uint64_t h) {
+    // lane 2i tests bit i of the low byte of a 16-bit chunk, lane 2i + 1
+    // bit i of its high byte
+    const __m128i bits = _mm_setr_epi8(1, 1, 2, 2, 4, 4, 8, 8, 16, 16, 32, 32, 64, 64, -128, -128);
+    for (int r = 0; r < 4; r++) {
+        __m128i v = _mm_set1_epi16((short)(h >> (16 * r)));
+        acc[r] = _mm_sub_epi8(acc[r], _mm_cmpeq_epi8(_mm_and_si128(v, bits), bits));
+    }
+}
+
+static void sl__simhash_flush(sl__simhash_acc acc, size_t totals[64]) {
+    uint8_t counts[64];
+    for (int r = 0; r < 4; r++) {
+        _mm_storeu_si128((__m128i *)(counts + 16 * r), acc[r]);
+        acc[r] = _mm_setzero_si128();
+    }
+    sl__simhash_totals(counts, totals);
+}
+#else
+typedef uint8_t sl__simhash_acc[64];
+
+static inline void sl__simhash_count(sl__simhash_acc acc, uint64_t h) {
+    for (int r = 0; r < 4; r++) {
+        for (int i = 0; i < 8; i++) {
+            acc[16 * r + 2 * i] += (h >> (16 * r + i)) & 1;
+            acc[16 * r + 2 * i + 1] += (h >> (16 * r + 8 + i)) & 1;
+        }
+    }
+}
+
+static void sl__simhash_flush(sl__simhash_acc acc, size_t totals[64]) {
+    sl__simhash_totals(acc, totals);
+    memset(acc, 0, sizeof(sl__simhash_acc));
+}
+#endif
+
+/**
+ * SimHash of a string
+ *
+ * Every 4-byte shingle votes for each bit of its 64-bit hash, and a bit
+ * of the result is set when most shingles have it set. Near-duplicate
+ * documents differ in few bits: compare them with `sl_simhash_distance`.
+ *
+ * @param str The document
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The 64-bit fingerprint (0 for an empty string)
+ */
+uint64_t sl_simhash(sl_str str, sl_err *err) {
+    sl_hdr *hdr;
+    sl_err e = sl__validate(str, &hdr);
+    if (e != SL_OK) {
+        sl__set_err(err, e);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    if (hdr->len == 0)
+        return 0;
+
+    size_t k = hdr->len < SL_SIMHASH_K ? hdr->len : SL_SIMHASH_K;
+    size_t n = hdr->len - k + 1;
+    const unsigned char *data = (const unsigned char *)hdr->data;
+    uint64_t pow;
+    uint64_t hash = sl__poly_hash(data, k, &pow);
+
+    sl__simhash_acc acc;
+    memset(acc, 0, sizeof(acc));
+    size_t totals[64] = {0};
+    for (size_t i = 0;; i++) {
+        sl__simhash_count(acc, sl__mix64(hash));
+        if (i == n - 1 || (i + 1) % 255 == 0)
+            sl__simhash_flush(acc, totals);
+        if (i == n - 1)
+            break;
+        hash = sl__roll(hash, pow, data[i], data[i + k]);
+    }
+
+    uint64_t out = 0;
+    for (int b = 0; b < 64; b++)
+        out |= (uint64_t)(2 * totals[b] > n) << b;
+    return out;
+}
+
+/**
+ * Number of different bits between two SimHash fingerprints
+ */
+int sl_simhash_distance(uint64_t a, uint64_t b) {
+    return __builtin_popcountll(a ^ b);
+}
+
+/*
+ * LSH banding index: a signature is cut into `bands` bands of `rows`
+ * values, and documents whose signatures agree on a whole band become
+ * candidates of each other. Every distinct band key has one slot of an
+ * open-addressing table holding the bucket of its ids, so adding to a
+ * crowded band (many near duplicates) stays O(1) and a query reads each
+ * matching bucket once.
+ */
+typedef struct sl_lsh_bucket {
+    uint64_t key;    /**< Band key, 0 for an empty slot */
+    uint64_t first;  /**< First id (most keys never get a second one) */
+    uint64_t *more;  /**< Further ids, NULL until a second one arrives */
+    size_t nmore;
+    size_t more_cap;
+} sl_lsh_bucket;
+
+struct sl_lsh {
+    size_t num_perm;
+    size_t bands;
+    size_t rows;
+    size_t count;          /**< Signatures added */
+    sl_lsh_bucket *slots;
+    size_t nkeys;          /**< Occupied slots */
+    size_t cap;            /**< Power of two */
+    uint64_t *band_keys;   /**< Scratch for the keys of the signature being added */
+};
+
+static inline uint64_t sl__lsh_key(const sl_lsh *lsh, const uint32_t *sig, size_t band) {
+    uint64_t h = sl__compute_hash(sig + band * lsh->rows, lsh->rows * sizeof(*sig));
+    return sl__mix64(h + band) | 1;
+}
+
+/**
+ * Slot of `key`, or the empty slot where it would go
+ */
+static inline sl_lsh_bucket *sl__lsh_slot(const sl_lsh *lsh, uint64_t key) {
+    size_t s = (size_t)key & (lsh->cap - 1);
+    while (lsh->slots[s].key && lsh->slots[s].key != key)
+        s = (s + 1) & (lsh->cap - 1);
+    return &lsh->slots[s];
+}
+
+static sl_err sl__lsh_grow(sl_lsh *lsh) {
+    size_t cap = lsh->cap ? lsh->cap * 2 : 1024;
+    sl_lsh_bucket *slots = calloc(cap, sizeof(*slots));
+    if (!slots)
+        return SL_ERR_ALLOC;
+    for (size_t i = 0; i < lsh->cap; i++) {
+        if (!lsh->slots[i].key)
+            continue;
+        size_t s = (size_t)lsh->slots[i].key & (cap - 1);
+        while (slots[s].key)
+            s = (s + 1) & (cap - 1);
+        slots[s] = lsh->slots[i];
+    }
+    free(lsh->slots);
+    lsh->slots = slots;
+    lsh->cap = cap;
+    return SL_OK;
+}
+
+/**
+ * Create an LSH index for MinHash signatures
+ *
+ * Two documents of Jaccard similarity J become candidates with
+ * probability 1 - (1 - J^rows)^bands, where rows = num_perm / bands: the
+ * curve is steepest around J = (1 / bands)^(1 / rows) (for example 0.5
+ * with 128 values in 32 bands of 4).
+ *
+ * @param num_perm Signature length
+ * @param bands Number of bands, dividing `num_perm`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The index, or NULL on error
+ */
+sl_lsh *sl_lsh_new(size_t num_perm, size_t bands, sl_err *err) {
+    if (num_perm == 0 || bands == 0 || num_perm % bands != 0) {
+        sl__set_err(err, SL_ERR_INVALID);
+        return NULL;
+    }
+    sl_lsh *lsh = calloc(1, sizeof(*lsh));
+    if (!lsh) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    lsh->band_keys = malloc(bands * sizeof(*lsh->band_keys));
+    if (!lsh->band_keys) {
+        free(lsh);
+        sl__set_err(err, SL_ERR_ALLOC);
+        return NULL;
+    }
+    lsh->num_perm = num_perm;
+    lsh->bands = bands;
+    lsh->rows = num_perm / bands;
+    sl__set_err(err, SL_OK);
+    return lsh;
+}
+
+/**
+ * Free an LSH index
+ *
+ * @param lsh Pointer to the index variable (set to NULL)
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_lsh_free(sl_lsh **lsh, sl_err *err) {
+    if (lsh && *lsh) {
+        for (size_t i = 0; i < (*lsh)->cap; i++)
+            free((*lsh)->slots[i].more);
+        free((*lsh)->slots);
+        free((*lsh)->band_keys);
+        free(*lsh);
+        *lsh = NULL;
+    }
+    sl__set_err(err, SL_OK);
+}
+
+/**
+ * Add a document's signature under a caller chosen id
+ *
+ * @param lsh The index
+ * @param sig Signature of `num_perm` values (from `sl_minhash`)
+ * @param id Returned by `sl_lsh_query` for this document
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ */
+void sl_lsh_add(sl_lsh *lsh, const uint32_t *sig, uint64_t id, sl_err *err) {
+    if (!lsh || !sig) {
+        sl__set_err(err, SL_ERR_NULL);
+        return;
+    }
+    while ((lsh->nkeys + lsh->bands) * 2 > lsh->cap) {
+        sl_err e = sl__lsh_grow(lsh);
+        if (e != SL_OK) {
+            sl__set_err(err, e);
+            return;
+        }
+    }
+
+    // make room in the existing buckets first, so a failed allocation adds nothing
+    for (size_t b = 0; b < lsh->bands; b++) {
+        lsh->band_keys[b] = sl__lsh_key(lsh, sig, b);
+        sl_lsh_bucket *bk = sl__lsh_slot(lsh, lsh->band_keys[b]);
+        if (bk->key && bk->nmore == bk->more_cap) {
+            size_t more_cap = bk->more_cap ? bk->more_cap * 2 : 4;
+            uint64_t *grown = realloc(bk->more, more_cap * sizeof(*grown));
+            if (!grown) {
+                sl__set_err(err, SL_ERR_ALLOC);
+                return;
+            }
+            bk->more = grown;
+            bk->more_cap = more_cap;
+        }
+    }
+
+    for (size_t b = 0; b < lsh->bands; b++) {
+        sl_lsh_bucket *bk = sl__lsh_slot(lsh, lsh->band_keys[b]);
+        if (!bk->key) {
+            bk->key = lsh->band_keys[b];
+            bk->first = id;
+            lsh->nkeys++;
+        } else if ((bk->nmore ? bk->more[bk->nmore - 1] : bk->first) != id) {
+            // skip it if an earlier band of this signature already had this key
+            bk->more[bk->nmore++] = id;
+        }
+    }
+    lsh->count++;
+    sl__set_err(err, SL_OK);
+}
+
+static int sl__u64_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Ids of the documents sharing at least one band with a signature
+ *
+ * Candidates are not checked: compare their signatures with
+ * `sl_minhash_similarity` to drop the false ones.
+ *
+ * @param lsh The index
+ * @param sig Signature of `num_perm` values
+ * @param out Receives up to `max` ids, in increasing order
+ * @param max Capacity of `out`
+ * @param err Pointer to an `sl_err` variable, can be NULL
+ * @return The number of distinct candidates, which can be more than `max`
+ */
+size_t sl_lsh_query(const sl_lsh *lsh, const uint32_t *sig, uint64_t *out, size_t max, sl_err *err) {
+    if (!lsh || !sig || (!out && max > 0)) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    if (lsh->nkeys == 0)
+        return 0;
+
+    size_t n = 0, cap = 64;
+    uint64_t *found = malloc(cap * sizeof(*found));
+    if (!found) {
+        sl__set_err(err, SL_ERR_ALLOC);
+        return 0;
+    }
+    for (size_t b = 0; b < lsh->bands; b++) {
+        const sl_lsh_bucket *bk = sl__lsh_slot(lsh, sl__lsh_key(lsh, sig, b));
+        if (!bk->key)
+            continue;
+        if (bk->nmore + 1 > cap - n) {
+            size_t new_cap = cap;
+            while (bk->nmore + 1 > new_cap - n)
+                new_cap *= 2;
+            uint64_t *grown = realloc(found, new_cap * sizeof(*found));
+            if (!grown) {
+                free(found);
+                sl__set_err(err, SL_ERR_ALLOC);
+                return 0;
+            }
+            found = grown;
+            cap = new_cap;
+        }
+        found[n++] = bk->first;
+        if (bk->nmore > 0)
+            memcpy(found + n, bk->more, bk->nmore * sizeof(*found));
+        n += bk->nmore;
+    }
+
+    qsort(found, n, sizeof(*found), sl__u64_cmp);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && found[i] == found[i - 1])
+            continue;
+        if (unique < max)
+            out[unique] = found[i];
+        unique++;
+    }
+    free(found);
+    return unique;
+}
+
+/**
+ * Number of signatures added
+ */
+size_t sl_lsh_count(const sl_lsh *lsh, sl_err *err) {
+    if (!lsh) {
+        sl__set_err(err, SL_ERR_NULL);
+        return 0;
+    }
+    sl__set_err(err, SL_OK);
+    return lsh->count;
+}
@@ -0,0 +1,1311 @@
+#define _POSIX_C_SOURCE 200809L
+#include "sl_string.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t rng_state = 0x2545F4914F6CDD1DULL;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+/**
+ * Random inserts of a short word into a large document:
+ * contiguous buffer (memmove of the tail) vs rope
+ */
+static void bench_rope_insert(void) {
+    const size_t doc_len = 16u << 20;
+    const int edits = 200;
+
+    char *doc = malloc(doc_len);
+    for (size_t i = 0; i < doc_len; i++)
+        doc[i] = 'a' + (char)(i % 26);
+
+    // contiguous
+    sl_str s = sl_from_bytes(doc, doc_len, NULL);
+    sl_str buf = sl_from_bytes(doc, doc_len, NULL);
+    rng_state = 42;
+    double t0 = now_sec();
+    for (int i = 0; i < edits; i++) {
+        size_t pos = rng() % (sl_len(buf, NULL) + 1);
+        buf = sl_insert(buf, pos, "inserted", 8, NULL);
+    }
+    double contiguous = now_sec() - t0;
+
+    // rope
+    sl_rope *rope = sl_rope_from_str(s, NULL);
+    rng_state = 42;
+    t0 = now_sec();
+    for (int i = 0; i < edits; i++) {
+        size_t pos = rng() % (sl_rope_len(rope, NULL) + 1);
+        sl_rope_insert(rope, pos, "inserted", 8, NULL);
+    }
+    double rope_time = now_sec() - t0;
+
+    t0 = now_sec();
+    sl_str flat = sl_rope_to_str(rope, NULL);
+    double flatten = now_sec() - t0;
+
+    printf("rope insert (%d x 8 bytes into %zu MB)\n", edits, doc_len >> 20);
+    printf("  sl_insert:          %8.3f ms (%.2f us/op)\n", contiguous * 1e3, contiguous * 1e6 / edits);
+    printf("  sl_rope_insert:     %8.3f ms (%.2f us/op)\n", rope_time * 1e3, rope_time * 1e6 / edits);
+    printf("  sl_rope_to_str:     %8.3f ms\n", flatten * 1e3);
+    printf("  same content:       %s\n", sl_eq(flat, buf, NULL) ? "yes" : "NO");
+
+    sl_free(&flat, NULL);
+    sl_rope_free(&rope, NULL);
+    sl_free(&s, NULL);
+    sl_free(&buf, NULL);
+    free(doc);
+}
+
+// table-driven scalar reference codecs
+
+static const char B64_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static size_t scalar_base64_encode(const unsigned char *in, size_t len, char *out) {
+    char *o = out;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        uint32_t v = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+        *o++ = B64_TABLE[v >> 18];
+        *o++ = B64_TABLE[(v >> 12) & 0x3F];
+        *o++ = B64_TABLE[(v >> 6) & 0x3F];
+        *o++ = B64_TABLE[v & 0x3F];
+    }
+    return (size_t)(o - out);
+}
+
+static size_t scalar_base64_decode(const char *in, size_t len, unsigned char *out) {
+    static signed char table[256];
+    if (!table['B']) {
+        memset(table, -1, sizeof(table));
+        for (int i = 0; i < 64; i++)
+            table[(unsigned char)B64_TABLE[i]] = (signed char)i;
+    }
+    unsigned char *o = out;
+    for (size_t i = 0; i + 4 <= len; i += 4) {
+        int a = table[(unsigned char)in[i]], b = table[(unsigned char)in[i + 1]];
+        int c = table[(unsigned char)in[i + 2]], d = table[(unsigned char)in[i + 3]];
+        if ((a | b | c | d) < 0)
+            return 0;
+        uint32_t v = (uint32_t)a << 18 | (uint32_t)b << 12 | (uint32_t)c << 6 | (uint32_t)d;
+        *o++ = (unsigned char)(v >> 16);
+        *o++ = (unsigned char)(v >> 8);
+        *o++ = (unsigned char)v;
+    }
+    return (size_t)(o - out);
+}
+
+static void scalar_hex_encode(const unsigned char *in, size_t len, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; i++) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0x0F];
+    }
+}
+
+static void print_gbps(const char *name, size_t bytes, double sec) {
+    printf("  %-30s %8.2f GB/s\n", name, (double)bytes / sec / 1e9);
+}
+
+#define BEST_OF(reps, best, body)               \
+    do {                                        \
+        best = 1e9;                             \
+        for (int r_ = 0; r_ < (reps); r_++) {   \
+            double t0_ = now_sec();             \
+            body;                               \
+            double t_ = now_sec() - t0_;        \
+            best = t_ < best ? t_ : best;       \
+        }                                       \
+    } while (0)
+
+/**
+ * Base64 and hex throughput (input bytes per second):
+ * library (SIMD when available) vs table-driven scalar.
+ *
+ * Every library call also computes the FNV-1a hash of its output, which is
+ * byte-serial; the "codec only" lines subtract that time.
+ */
+static void bench_codecs(void) {
+    const size_t len = 1u << 20;
+    const int reps = 200;
+    double best;
+
+    unsigned char *data = malloc(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (unsigned char)rng();
+    sl_str s = sl_from_bytes(data, len, NULL);
+    char *buf = malloc(len * 2);
+
+    sl_str enc = sl_base64_encode(s, SL_BASE64_STD, NULL);
+    sl_str hex = sl_hex_encode(s, NULL);
+    size_t enc_len = sl_len(enc, NULL);
+
+    double hash_b64, hash_hex, hash_raw;
+    BEST_OF(reps, hash_b64, (void)sl_compute_hash(enc, enc_len));
+    BEST_OF(reps, hash_hex, (void)sl_compute_hash(hex, 2 * len));
+    BEST_OF(reps, hash_raw, (void)sl_compute_hash(data, len));
+
+    printf("codecs (%zu KB input, best of %d)\n", len >> 10, reps);
+    print_gbps("FNV-1a (for reference)", len, hash_raw);
+
+    BEST_OF(reps, best, scalar_base64_encode(data, len, buf));
+    print_gbps("scalar base64 encode", len, best);
+    BEST_OF(reps, best, sl_str e = sl_base64_encode(s, SL_BASE64_STD, NULL); sl_free(&e, NULL));
+    print_gbps("sl_base64_encode", len, best);
+    print_gbps("sl_base64_encode (codec only)", len, best - hash_b64);
+
+    BEST_OF(reps, best, scalar_base64_decode(enc, enc_len, (unsigned char *)buf));
+    print_gbps("scalar base64 decode", len, best);
+    BEST_OF(reps, best, sl_str d = sl_base64_decode(enc, SL_BASE64_STD, NULL); sl_free(&d, NULL));
+    print_gbps("sl_base64_decode", len, best);
+    print_gbps("sl_base64_decode (codec only)", len, best - hash_raw);
+
+    BEST_OF(reps, best, scalar_hex_encode(data, len, buf));
+    print_gbps("scalar hex encode", len, best);
+    BEST_OF(reps, best, sl_str e = sl_hex_encode(s, NULL); sl_free(&e, NULL));
+    print_gbps("sl_hex_encode", len, best);
+    print_gbps("sl_hex_encode (codec only)", len, best - hash_hex);
+
+    BEST_OF(reps, best, sl_str d = sl_hex_decode(hex, NULL); sl_free(&d, NULL));
+    print_gbps("sl_hex_decode", len, best);
+    print_gbps("sl_hex_decode (codec only)", len, best - hash_raw);
+
+    sl_free(&hex, NULL);
+    sl_free(&enc, NULL);
+    sl_free(&s, NULL);
+    free(buf);
+    free(data);
+}
+
+static uint32_t table_crc32c(const unsigned char *in, size_t len) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int b = 0; b < 8; b++)
+                c = (c & 1) ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            table[n] = c;
+        }
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++)
+        crc = (crc >> 8) ^ table[(crc ^ in[i]) & 0xFF];
+    return ~crc;
+}
+
+static void bench_crc32c(void) {
+    const size_t len = 1u << 20;
+    const int reps = 200;
+    double best;
+
+    unsigned char *data = malloc(len);
+    for (size_t i = 0; i < len; i++)
+        data[i] = (unsigned char)rng();
+    uint32_t crc = sl_compute_crc32c(data, len);
+    volatile uint32_t sink;
+
+    printf("crc32c (%zu KB input, best of %d)\n", len >> 10, reps);
+    BEST_OF(reps, best, sink = table_crc32c(data, len));
+    print_gbps("table-driven crc32c", len, best);
+    BEST_OF(reps, best, sink = sl_compute_crc32c(data, len));
+    print_gbps("sl_compute_crc32c", len, best);
+
+    BEST_OF(reps, best, sl_str s = sl_from_bytes(data, len, NULL); sink = sl_compute_crc32c(s, len);
+            sl_free(&s, NULL));
+    print_gbps("sl_from_bytes + crc pass", len, best);
+    BEST_OF(reps, best, sl_str s = sl_from_bytes_verified(data, len, crc, NULL); sl_free(&s, NULL));
+    print_gbps("sl_from_bytes_verified", len, best);
+
+    (void)sink;
+    free(data);
+}
+
+static void bench_pack(void) {
+    const size_t n = 1000000;
+    char path[] = "/tmp/sl_bench_pack_XXXXXX";
+    char buf[64];
+
+    sl_str *strs = malloc(n * sizeof(*strs));
+    for (size_t i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "/api/v2/users/%llu/profile", (unsigned long long)rng() % 100000000);
+        strs[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+
+    int fd = mkstemp(path);
+    double t0 = now_sec();
+    sl_pack_write(fd, strs, n, NULL);
+    double t_write = now_sec() - t0;
+    close(fd);
+
+    // the old way: every string is copied and rehashed
+    t0 = now_sec();
+    sl_str *copies = malloc(n * sizeof(*copies));
+    for (size_t i = 0; i < n; i++)
+        copies[i] = sl_from_bytes(strs[i], sl_len(strs[i], NULL), NULL);
+    double t_rebuild = now_sec() - t0;
+
+    t0 = now_sec();
+    sl_pack *pack = sl_pack_open(path, NULL);
+    double t_open = now_sec() - t0;
+
+    uint64_t sum = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sum += sl_hash(sl_pack_get(pack, i, NULL), NULL);
+    double t_scan = now_sec() - t0;
+
+    printf("pack (%zu strings)\n", n);
+    printf("  %-30s %8.2f ms\n", "sl_pack_write", t_write * 1e3);
+    printf("  %-30s %8.2f ms\n", "rebuild with sl_from_bytes", t_rebuild * 1e3);
+    printf("  %-30s %8.3f ms\n", "sl_pack_open", t_open * 1e3);
+    printf("  %-30s %8.2f ms (checksum %llu)\n", "sl_pack_get + sl_hash, all", t_scan * 1e3,
+           (unsigned long long)(sum & 0xFFFF));
+
+    sl_pack_close(&pack, NULL);
+    unlink(path);
+    for (size_t i = 0; i < n; i++) {
+        sl_free(&copies[i], NULL);
+        sl_free(&strs[i], NULL);
+    }
+    free(copies);
+    free(strs);
+}
+
+static void bench_shm_pool(void) {
+    const size_t n = 1000000;
+    char buf[64];
+
+    sl_shm_pool *pool = sl_shm_pool_new(n * 64, NULL);
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "identifier_%zu", i);
+        sl_shm_pool_add(pool, buf, (size_t)len, NULL);
+    }
+    double t_build = now_sec() - t0;
+
+    t0 = now_sec();
+    sl_shm_pool *view = sl_shm_pool_attach(sl_shm_pool_fd(pool, NULL), NULL);
+    double t_attach = now_sec() - t0;
+
+    size_t found = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i += 7) {
+        int len = snprintf(buf, sizeof(buf), "identifier_%zu", i);
+        found += sl_shm_pool_find(view, buf, (size_t)len, NULL) != NULL;
+    }
+    double t_find = now_sec() - t0;
+
+    printf("shm pool (%zu strings)\n", n);
+    printf("  %-30s %8.2f ms\n", "build in the parent", t_build * 1e3);
+    printf("  %-30s %8.2f ms\n", "sl_shm_pool_attach (worker)", t_attach * 1e3);
+    printf("  %-30s %8.1f ns/op (%zu found)\n", "sl_shm_pool_find", t_find * 1e9 / (double)((n + 6) / 7), found);
+
+    sl_shm_pool_free(&view, NULL);
+    sl_shm_pool_free(&pool, NULL);
+}
+
+static void bench_intern_snapshot(void) {
+    const size_t n = 2000000;
+    char path[] = "/tmp/sl_bench_intern_XXXXXX";
+    char buf[64];
+    close(mkstemp(path));
+
+    double t0 = now_sec();
+    sl_intern *t = sl_intern_new(NULL);
+    for (size_t i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "module.symbol_%zu", i);
+        sl_intern_bytes(t, buf, (size_t)len, NULL);
+    }
+    double t_build = now_sec() - t0;
+
+    t0 = now_sec();
+    sl_intern_snapshot(t, path, NULL);
+    double t_snap = now_sec() - t0;
+    sl_intern_free(&t, NULL);
+
+    t0 = now_sec();
+    sl_intern *r = sl_intern_restore(path, NULL);
+    double t_restore = now_sec() - t0;
+
+    size_t found = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i += 17) {
+        int len = snprintf(buf, sizeof(buf), "module.symbol_%zu", i);
+        found += sl_intern_find(r, buf, (size_t)len, NULL) != NULL;
+    }
+    double t_find = now_sec() - t0;
+
+    printf("intern table (%zu strings)\n", n);
+    printf("  %-30s %8.2f ms\n", "build with sl_intern_bytes", t_build * 1e3);
+    printf("  %-30s %8.2f ms\n", "sl_intern_snapshot", t_snap * 1e3);
+    printf("  %-30s %8.3f ms\n", "sl_intern_restore", t_restore * 1e3);
+    printf("  %-30s %8.1f ns/op (%zu found, cold pages)\n", "sl_intern_find after restore",
+           t_find * 1e9 / (double)((n + 16) / 17), found);
+
+    sl_intern_free(&r, NULL);
+    unlink(path);
+}
+
+/* naive framing: one write per frame, temporary buffer + sl_from_bytes on receive */
+static void naive_frame_write(int fd, const sl_str *strs, size_t n) {
+    char *buf = malloc(1 << 16);
+    for (size_t i = 0; i < n; i++) {
+        size_t len = sl_len(strs[i], NULL);
+        int h = sprintf(buf, "%zu:", len);
+        memcpy(buf + h, strs[i], len);
+        buf[h + len] = ',';
+        (void)!write(fd, buf, (size_t)h + len + 1);
+    }
+    free(buf);
+}
+
+static size_t naive_frame_read(int fd, size_t n) {
+    size_t cap = 1 << 20, used = 0, got = 0;
+    char *buf = malloc(cap);
+    while (got < n) {
+        ssize_t r = read(fd, buf + used, cap - used);
+        if (r <= 0)
+            break;
+        used += (size_t)r;
+
+        size_t pos = 0;
+        for (;;) {
+            char *colon = memchr(buf + pos, ':', used - pos);
+            if (!colon)
+                break;
+            size_t len = strtoull(buf + pos, NULL, 10);
+            size_t start = (size_t)(colon - buf) + 1;
+            if (start + len + 1 > used)
+                break;
+            sl_str s = sl_from_bytes(buf + start, len, NULL);
+            sl_free(&s, NULL);
+            got++;
+            pos = start + len + 1;
+        }
+        memmove(buf, buf + pos, used - pos);
+        used -= pos;
+    }
+    free(buf);
+    return got;
+}
+
+static size_t sl_frame_read_all(int fd, size_t n) {
+    char buf[1 << 16];
+    size_t got = 0;
+    sl_frame_decoder *dec = sl_frame_decoder_new(SL_FRAME_NETSTRING, 0, NULL);
+    while (got < n) {
+        ssize_t r = read(fd, buf, sizeof(buf));
+        if (r <= 0)
+            break;
+        sl_frame_feed(dec, buf, (size_t)r, NULL);
+        for (sl_str s; (s = sl_frame_next(dec, NULL)); got++)
+            sl_free(&s, NULL);
+    }
+    sl_frame_decoder_free(&dec, NULL);
+    return got;
+}
+
+static void bench_frames(void) {
+    const size_t n = 500000;
+    const size_t sizes[] = {16, 256, 4096};
+
+    printf("framing over a socketpair (%zu frames, writer in a child process)\n", n);
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        size_t frame = sizes[k], count = frame > 1024 ? n / 10 : n;
+        sl_str *strs = malloc(count * sizeof(*strs));
+        char *payload = malloc(frame);
+        memset(payload, 'x', frame);
+        for (size_t i = 0; i < count; i++)
+            strs[i] = sl_from_bytes(payload, frame, NULL);
+
+        for (int variant = 0; variant < 2; variant++) {
+            int sv[2];
+            socketpair(AF_UNIX, SOCK_STREAM, 0, sv);
+            double t0 = now_sec();
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(sv[1]);
+                if (variant == 0)
+                    naive_frame_write(sv[0], strs, count);
+                else
+                    sl_frame_writev(sv[0], SL_FRAME_NETSTRING, strs, count, NULL);
+                _exit(0);
+            }
+            close(sv[0]);
+            size_t got = variant == 0 ? naive_frame_read(sv[1], count) : sl_frame_read_all(sv[1], count);
+            double t = now_sec() - t0;
+            waitpid(pid, NULL, 0);
+            close(sv[1]);
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s, %zu B", variant == 0 ? "write + temp buffer" : "writev + sl_frame",
+                     frame);
+            printf("  %-30s %8.2f Mframes/s %7.2f GB/s%s\n", name, (double)got / t / 1e6,
+                   (double)(got * frame) / t / 1e9, got == count ? "" : " (incomplete)");
+        }
+
+        for (size_t i = 0; i < count; i++)
+            sl_free(&strs[i], NULL);
+        free(strs);
+        free(payload);
+    }
+}
+
+static void bench_varints(void) {
+    const size_t n = 1000000;
+    const size_t n_bytewise = 2000; // quadratic: every insert rehashes the whole string
+    uint64_t *vals = malloc(n * sizeof(*vals));
+    uint64_t *back = malloc(n * sizeof(*back));
+    for (size_t i = 0; i < n; i++)
+        vals[i] = rng() >> (rng() % 64); // every length from 1 to 10 bytes
+    double t0, t;
+
+    printf("varints (%zu values, mixed lengths)\n", n);
+
+    // the old way: encode by hand, append one byte at a time
+    t0 = now_sec();
+    sl_str s = sl_from_bytes("", 0, NULL);
+    for (size_t i = 0; i < n_bytewise; i++) {
+        uint64_t v = vals[i];
+        do {
+            unsigned char b = (unsigned char)(v & 0x7F) | (v >= 0x80 ? 0x80 : 0);
+            s = sl_insert(s, sl_len(s, NULL), &b, 1, NULL);
+            v >>= 7;
+        } while (v);
+    }
+    t = now_sec() - t0;
+    sl_free(&s, NULL);
+    printf("  %-30s %8.1f ns/value (%zu values)\n", "byte-at-a-time sl_insert", t * 1e9 / (double)n_bytewise,
+           n_bytewise);
+
+    t0 = now_sec();
+    s = sl_from_bytes("", 0, NULL);
+    for (size_t i = 0; i < n; i++)
+        s = sl_append_varint_u64(s, vals[i], NULL);
+    t = now_sec() - t0;
+    size_t bytes = sl_len(s, NULL);
+    sl_free(&s, NULL);
+    printf("  %-30s %8.1f ns/value\n", "sl_append_varint_u64", t * 1e9 / (double)n);
+
+    double best;
+    BEST_OF(20, best, s = sl_from_bytes("", 0, NULL); s = sl_append_varints(s, vals, n, NULL); sl_free(&s, NULL));
+    printf("  %-30s %8.1f ns/value %6.2f GB/s\n", "sl_append_varints", best * 1e9 / (double)n, (double)bytes / best / 1e9);
+
+    s = sl_from_bytes("", 0, NULL);
+    s = sl_append_varints(s, vals, n, NULL);
+
+    uint64_t sum = 0;
+    BEST_OF(20, best, size_t pos = 0; for (size_t i = 0; i < n; i++) sum += sl_read_varint_u64(s, &pos, NULL));
+    printf("  %-30s %8.1f ns/value\n", "sl_read_varint_u64", best * 1e9 / (double)n);
+    BEST_OF(20, best, size_t pos = 0; sl_read_varints(s, &pos, back, n, NULL));
+    printf("  %-30s %8.1f ns/value %6.2f GB/s (%s)\n", "sl_read_varints", best * 1e9 / (double)n,
+           (double)bytes / best / 1e9, memcmp(vals, back, n * sizeof(*vals)) == 0 ? "ok" : "MISMATCH");
+
+    (void)sum;
+    sl_free(&s, NULL);
+    free(back);
+    free(vals);
+}
+
+static int bytes_cmp(const char *a, size_t alen, const char *b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    return c ? c : (alen > blen) - (alen < blen);
+}
+
+static bool array_contains(const sl_str *strs, size_t n, const char *key, size_t len) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = bytes_cmp(strs[mid], sl_len(strs[mid], NULL), key, len);
+        if (c == 0)
+            return true;
+        if (c < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return false;
+}
+
+static void bench_fcset(void) {
+    const size_t n = 1000000;
+    const size_t probes = 1000000;
+    sl_str *strs = malloc(n * sizeof(*strs));
+    size_t *idx = malloc(probes * sizeof(*idx));
+    char buf[96];
+    size_t array_bytes = n * sizeof(*strs);
+    for (size_t i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "https://example.com/catalog/%03zu/item-%07zu.html", i / 4096, i);
+        strs[i] = sl_from_bytes(buf, (size_t)len, NULL);
+        array_bytes += 32 + sl_cap(strs[i], NULL); // header + bytes, malloc overhead not counted
+    }
+    for (size_t i = 0; i < probes; i++)
+        idx[i] = rng() % n;
+    double t0, t;
+
+    printf("front-coded set (%zu sorted URLs, ~%zu bytes each)\n", n, sl_len(strs[0], NULL));
+
+    t0 = now_sec();
+    sl_fcset *set = sl_fcset_build(strs, n, 0, NULL);
+    t = now_sec() - t0;
+    size_t fc_bytes = sl_fcset_memory(set, NULL);
+    printf("  %-30s %8.1f MB\n", "sl_str array", (double)array_bytes / 1e6);
+    printf("  %-30s %8.1f MB (%.1fx smaller, built in %.1f ms)\n", "sl_fcset", (double)fc_bytes / 1e6,
+           (double)array_bytes / (double)fc_bytes, t * 1e3);
+
+    size_t hits = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < probes; i++)
+        hits += array_contains(strs, n, strs[idx[i]], sl_len(strs[idx[i]], NULL));
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/lookup (%zu hits)\n", "binary search sl_str array", t * 1e9 / (double)probes, hits);
+
+    hits = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < probes; i++)
+        hits += sl_fcset_contains(set, strs[idx[i]], sl_len(strs[idx[i]], NULL), NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/lookup (%zu hits)\n", "sl_fcset_contains", t * 1e9 / (double)probes, hits);
+
+    size_t total = 0;
+    double best;
+    BEST_OF(5, best, sl_fcset_iter *it = sl_fcset_iter_new(set, 0, NULL); sl_view v;
+            while (sl_fcset_iter_next(it, &v, NULL)) total += v.len; sl_fcset_iter_free(&it, NULL));
+    printf("  %-30s %8.1f ns/key\n", "sl_fcset_iter_next", best * 1e9 / (double)n);
+
+    (void)total;
+    sl_fcset_free(&set, NULL);
+    for (size_t i = 0; i < n; i++)
+        sl_free(&strs[i], NULL);
+    free(idx);
+    free(strs);
+}
+
+static void bench_compress(void) {
+    static const char *methods[] = {"GET", "POST", "PUT", "DELETE"};
+    static const char *countries[] = {"US", "DE", "FR", "BR", "JP", "IN"};
+    const size_t target = 16 << 20;
+    sl_str logs = sl_from_cstr("", NULL);
+    char line[256];
+    while (sl_len(logs, NULL) < target) {
+        uint64_t r = rng();
+        snprintf(line, sizeof(line),
+                 "{\"ts\":%llu,\"method\":\"%s\",\"path\":\"/api/v2/items/%llu\",\"status\":%d,\"country\":\"%s\","
+                 "\"bytes\":%llu}\n",
+                 (unsigned long long)(1700000000000ULL + (r & 0xFFFFF)), methods[r % 4],
+                 (unsigned long long)(r >> 40), r % 10 ? 200 : 404, countries[(r >> 8) % 6],
+                 (unsigned long long)((r >> 20) & 0xFFFF));
+        logs = sl_append_cstr(logs, line, NULL);
+    }
+    size_t raw = sl_len(logs, NULL);
+    double best;
+
+    printf("compression (%.1f MB of JSON log lines)\n", (double)raw / 1e6);
+    sl_str c = NULL;
+    BEST_OF(5, best, sl_free(&c, NULL); c = sl_compress(logs, NULL));
+    printf("  %-30s %8.2f GB/s ratio %.2f\n", "sl_compress", (double)raw / best / 1e9,
+           (double)raw / (double)sl_len(c, NULL));
+    sl_str d = NULL;
+    BEST_OF(5, best, sl_free(&d, NULL); d = sl_decompress(c, NULL));
+    printf("  %-30s %8.2f GB/s (%s)\n", "sl_decompress", (double)raw / best / 1e9,
+           sl_eq(d, logs, NULL) ? "ok" : "MISMATCH");
+    sl_free(&d, NULL);
+    sl_free(&c, NULL);
+    sl_free(&logs, NULL);
+
+    // short strings: a trained symbol table vs LZ
+    const size_t n = 1000000;
+    sl_str *strs = malloc(n * sizeof(*strs));
+    sl_str *packed = malloc(n * sizeof(*packed));
+    static const char *domains[] = {"gmail.com", "example.org", "company.co.uk", "mail.example.com"};
+    static const char *names[] = {"john", "maria", "wei", "fatima", "olga", "carlos", "aiko", "sam"};
+    size_t raw_bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint64_t r = rng();
+        int len = snprintf(line, sizeof(line), "%s.%s%llu@%s", names[r % 8], names[(r >> 3) % 8],
+                           (unsigned long long)((r >> 16) % 10000), domains[(r >> 8) % 4]);
+        strs[i] = sl_from_bytes(line, (size_t)len, NULL);
+        raw_bytes += (size_t)len;
+    }
+
+    printf("compression (%zu e-mail addresses, %.1f bytes avg)\n", n, (double)raw_bytes / (double)n);
+    size_t lz_bytes = 0;
+    for (size_t i = 0; i < 10000; i++) {
+        c = sl_compress(strs[i], NULL);
+        lz_bytes += sl_len(c, NULL);
+        sl_free(&c, NULL);
+    }
+    printf("  %-30s %8.2f ratio (per string)\n", "sl_compress", (double)raw_bytes / (double)n * 10000 / (double)lz_bytes);
+
+    double t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        packed[i] = sl_from_bytes(strs[i], sl_len(strs[i], NULL), NULL);
+    double t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/string\n", "sl_from_bytes copy", t * 1e9 / (double)n);
+    for (size_t i = 0; i < n; i++)
+        sl_free(&packed[i], NULL);
+
+    t0 = now_sec();
+    sl_symtab *tab = sl_symtab_train(strs, 1000, NULL);
+    double t_train = now_sec() - t0;
+
+    t0 = now_sec();
+    size_t sym_bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        packed[i] = sl_compress_with(tab, strs[i], NULL);
+        sym_bytes += sl_len(packed[i], NULL);
+    }
+    t = now_sec() - t0;
+    printf("  %-30s %8.2f ratio %.2f GB/s (trained in %.1f ms)\n", "sl_compress_with", (double)raw_bytes / (double)sym_bytes,
+           (double)raw_bytes / t / 1e9, t_train * 1e3);
+
+    t0 = now_sec();
+    size_t ok = 0;
+    for (size_t i = 0; i < n; i++) {
+        d = sl_decompress_with(tab, packed[i], NULL);
+        ok += sl_len(d, NULL) == sl_len(strs[i], NULL);
+        sl_free(&d, NULL);
+    }
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/string %.2f GB/s (%s)\n", "sl_decompress_with", t * 1e9 / (double)n,
+           (double)raw_bytes / t / 1e9, ok == n ? "ok" : "MISMATCH");
+    printf("  %-30s %8.1f MB -> %.1f MB (with headers)\n", "resident", (double)(raw_bytes + 33 * n) / 1e6,
+           (double)(sym_bytes + 33 * n) / 1e6);
+
+    sl_symtab_free(&tab, NULL);
+    for (size_t i = 0; i < n; i++) {
+        sl_free(&packed[i], NULL);
+        sl_free(&strs[i], NULL);
+    }
+    free(packed);
+    free(strs);
+}
+
+static void bench_dict_column(void) {
+    static const char *countries[] = {"US", "DE", "FR", "BR", "JP", "IN", "GB", "CA"};
+    const size_t n = 10000000;
+    sl_str *rows = malloc(n * sizeof(*rows));
+    size_t *out = malloc(n * sizeof(*out));
+    size_t row_bytes = n * sizeof(*rows);
+    for (size_t i = 0; i < n; i++) {
+        uint64_t r = rng();
+        // skewed: US and DE make up most rows
+        const char *c = countries[(r & 3) ? (r >> 2) % 2 : (r >> 2) % 8];
+        rows[i] = sl_from_cstr(c, NULL);
+        row_bytes += 32 + sl_cap(rows[i], NULL);
+    }
+    double t0, t, best;
+
+    printf("dictionary column (%zu rows, %zu distinct values)\n", n, (size_t)8);
+
+    t0 = now_sec();
+    sl_dict_column *col = sl_dict_column_new(NULL);
+    sl_dict_column_append_many(col, rows, n, NULL);
+    t = now_sec() - t0;
+    size_t col_bytes = sl_dict_column_memory(col, NULL);
+    printf("  %-30s %8.1f MB\n", "sl_str per row", (double)row_bytes / 1e6);
+    printf("  %-30s %8.1f MB (%.1fx smaller, %.1f ns/row to encode)\n", "sl_dict_column", (double)col_bytes / 1e6,
+           (double)row_bytes / (double)col_bytes, t * 1e9 / (double)n);
+
+    size_t hits = 0;
+    BEST_OF(5, best, hits = 0; for (size_t i = 0; i < n; i++) hits +=
+                     sl_len(rows[i], NULL) == 2 && memcmp(rows[i], "DE", 2) == 0);
+    printf("  %-30s %8.2f ns/row (%zu rows)\n", "scan sl_str (len + memcmp)", best * 1e9 / (double)n, hits);
+
+    uint64_t h = sl_compute_hash("DE", 2);
+    BEST_OF(5, best, hits = 0; for (size_t i = 0; i < n; i++) hits += sl_hash(rows[i], NULL) == h);
+    printf("  %-30s %8.2f ns/row (%zu rows)\n", "scan sl_str (cached hash)", best * 1e9 / (double)n, hits);
+
+    BEST_OF(5, best, hits = sl_dict_column_filter_eq(col, "DE", 2, NULL, NULL));
+    printf("  %-30s %8.2f ns/row (%zu rows)\n", "sl_dict_column_filter_eq count", best * 1e9 / (double)n, hits);
+    BEST_OF(5, best, hits = sl_dict_column_filter_eq(col, "DE", 2, out, NULL));
+    printf("  %-30s %8.2f ns/row (%zu rows)\n", "sl_dict_column_filter_eq rows", best * 1e9 / (double)n, hits);
+    BEST_OF(5, best, hits = sl_dict_column_filter_eq(col, "JP", 2, out, NULL));
+    printf("  %-30s %8.2f ns/row (%zu rows)\n", "  rare value", best * 1e9 / (double)n, hits);
+
+    sl_dict_column_free(&col, NULL);
+    for (size_t i = 0; i < n; i++)
+        sl_free(&rows[i], NULL);
+    free(out);
+    free(rows);
+}
+
+static void bench_radix(void) {
+    const size_t nroutes = 1500, nqueries = 200000, nkeys = 1000000;
+    sl_str *routes = malloc(nroutes * sizeof(*routes));
+    sl_str *queries = malloc(nqueries * sizeof(*queries));
+    char buf[64];
+    for (size_t i = 0; i < nroutes; i++) {
+        // /svcN/, /svcN/vM/ and /svcN/vM/items/ routes
+        int len = i % 3 == 0   ? snprintf(buf, sizeof(buf), "/svc%zu/", i / 3)
+                  : i % 3 == 1 ? snprintf(buf, sizeof(buf), "/svc%zu/v%zu/", i / 3, i % 7)
+                               : snprintf(buf, sizeof(buf), "/svc%zu/v%zu/items/", i / 3, i % 7);
+        routes[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    for (size_t i = 0; i < nqueries; i++) {
+        uint64_t r = rng();
+        int len = snprintf(buf, sizeof(buf), "/svc%u/v%u/items/%u", (unsigned)(r % 600), (unsigned)((r >> 16) % 7),
+                           (unsigned)(r >> 32));
+        queries[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    double best;
+
+    printf("radix tree (%zu routes, %zu lookups)\n", nroutes, nqueries);
+
+    sl_radix *t = sl_radix_new(NULL);
+    for (size_t i = 0; i < nroutes; i++)
+        sl_radix_insert_str(t, routes[i], (void *)(uintptr_t)(i + 1), NULL);
+
+    size_t matched = 0;
+    BEST_OF(3, best, matched = 0; for (size_t q = 0; q < nqueries; q++) {
+        size_t qlen = sl_len(queries[q], NULL);
+        size_t best_len = 0;
+        bool found = false;
+        for (size_t i = 0; i < nroutes; i++) {
+            size_t rlen = sl_len(routes[i], NULL);
+            if (rlen <= qlen && rlen >= best_len && memcmp(routes[i], queries[q], rlen) == 0) {
+                best_len = rlen;
+                found = true;
+            }
+        }
+        matched += found;
+    });
+    printf("  %-30s %8.1f ns/op (%zu matched)\n", "longest prefix, linear scan", best * 1e9 / (double)nqueries,
+           matched);
+
+    BEST_OF(5, best, matched = 0; for (size_t q = 0; q < nqueries; q++) matched +=
+                     sl_radix_longest_prefix_str(t, queries[q], NULL, NULL, NULL));
+    printf("  %-30s %8.1f ns/op (%zu matched)\n", "sl_radix_longest_prefix", best * 1e9 / (double)nqueries, matched);
+    sl_radix_free(&t, NULL);
+
+    // random binary keys
+    uint64_t *keys = malloc(nkeys * sizeof(*keys));
+    for (size_t i = 0; i < nkeys; i++)
+        keys[i] = rng();
+    double t0 = now_sec();
+    t = sl_radix_new(NULL);
+    for (size_t i = 0; i < nkeys; i++)
+        sl_radix_insert(t, &keys[i], sizeof(keys[i]), NULL, NULL);
+    double ins = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op (%zu keys)\n", "sl_radix_insert", ins * 1e9 / (double)nkeys, nkeys);
+
+    size_t found = 0;
+    BEST_OF(3, best, found = 0; for (size_t i = 0; i < nkeys; i++) found +=
+                     sl_radix_get(t, &keys[(i * 7919) % nkeys], sizeof(keys[0]), NULL, NULL));
+    printf("  %-30s %8.1f ns/op (%zu found)\n", "sl_radix_get", best * 1e9 / (double)nkeys, found);
+
+    sl_radix_free(&t, NULL);
+    free(keys);
+    for (size_t i = 0; i < nroutes; i++)
+        sl_free(&routes[i], NULL);
+    for (size_t i = 0; i < nqueries; i++)
+        sl_free(&queries[i], NULL);
+    free(routes);
+    free(queries);
+}
+
+static int bench_btree_cmp(const void *a, const void *b) {
+    sl_str x = *(const sl_str *)a, y = *(const sl_str *)b;
+    size_t xl = sl_len(x, NULL), yl = sl_len(y, NULL);
+    int c = memcmp(x, y, xl < yl ? xl : yl);
+    return c ? c : (xl > yl) - (xl < yl);
+}
+
+static void bench_btree(void) {
+    const size_t n = 1000000, nlookups = 1000000;
+    sl_str *keys = malloc(n * sizeof(*keys));
+    sl_str *sorted = malloc(n * sizeof(*sorted));
+    char buf[64];
+    for (size_t i = 0; i < n; i++) {
+        // half the keys share their first 8 bytes ("user:000")
+        uint64_t r = rng();
+        int len = (r & 1) ? snprintf(buf, sizeof(buf), "user:%08u", (unsigned)(i * 2654435761u % 100000000u))
+                          : snprintf(buf, sizeof(buf), "%016llx/item", (unsigned long long)r);
+        keys[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    memcpy(sorted, keys, n * sizeof(*keys));
+    qsort(sorted, n, sizeof(*sorted), bench_btree_cmp);
+    double t0, best;
+
+    printf("b-tree (%zu keys)\n", n);
+
+    t0 = now_sec();
+    sl_btree *t = sl_btree_new(NULL);
+    for (size_t i = 0; i < n; i++)
+        sl_btree_insert(t, keys[i], NULL, NULL);
+    printf("  %-30s %8.1f ns/op\n", "sl_btree_insert (random order)", (now_sec() - t0) * 1e9 / (double)n);
+    sl_btree_free(&t, NULL);
+
+    t0 = now_sec();
+    t = sl_btree_build(sorted, NULL, n, NULL);
+    printf("  %-30s %8.1f ns/key\n", "sl_btree_build", (now_sec() - t0) * 1e9 / (double)n);
+
+    size_t found = 0;
+    BEST_OF(3, best, found = 0; for (size_t i = 0; i < nlookups; i++) {
+        sl_str key = keys[(i * 7919) % n];
+        found += bsearch(&key, sorted, n, sizeof(*sorted), bench_btree_cmp) != NULL;
+    });
+    printf("  %-30s %8.1f ns/op (%zu found)\n", "bsearch over sorted sl_str", best * 1e9 / (double)nlookups, found);
+
+    BEST_OF(3, best, found = 0; for (size_t i = 0; i < nlookups; i++) found +=
+                     sl_btree_get_str(t, keys[(i * 7919) % n], NULL, NULL));
+    printf("  %-30s %8.1f ns/op (%zu found)\n", "sl_btree_get", best * 1e9 / (double)nlookups, found);
+
+    size_t scanned = 0;
+    BEST_OF(5, best, scanned = 0; sl_btree_iter *it = sl_btree_range(t, NULL, 0, NULL, 0, NULL);
+            while (sl_btree_iter_next(it, NULL, NULL, NULL)) scanned++; sl_btree_iter_free(&it, NULL));
+    printf("  %-30s %8.2f ns/key (%zu keys)\n", "sl_btree_range full scan", best * 1e9 / (double)scanned, scanned);
+    printf("  %-30s %8.1f MB\n", "sl_btree_memory", (double)sl_btree_memory(t, NULL) / 1e6);
+
+    sl_btree_free(&t, NULL);
+    for (size_t i = 0; i < n; i++)
+        sl_free(&keys[i], NULL);
+    free(sorted);
+    free(keys);
+}
+
+static void bench_lru(void) {
+    const size_t nkeys = 100000, nops = 2000000, capacity = 10000;
+    sl_str *keys = malloc(nkeys * sizeof(*keys));
+    uint32_t *ops = malloc(nops * sizeof(*ops));
+    char buf[32];
+    for (size_t i = 0; i < nkeys; i++) {
+        int len = snprintf(buf, sizeof(buf), "fragment:%zu", i);
+        keys[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    for (size_t i = 0; i < nops; i++) {
+        // skewed: a few hot keys, a long tail
+        double u = (double)(rng() >> 11) / 9007199254740992.0;
+        ops[i] = (uint32_t)((double)nkeys * u * u * u);
+    }
+    sl_str value = sl_from_cstr("<div>rendered fragment</div>", NULL);
+    double t0, t;
+
+    printf("lru cache (%zu keys, %zu entries, %zu ops)\n", nkeys, capacity, nops);
+
+    sl_lru *lru = sl_lru_new(capacity, 0, NULL, NULL, NULL);
+    size_t hits = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < nops; i++) {
+        sl_str key = keys[ops[i]];
+        if (sl_lru_get_str(lru, key, NULL))
+            hits++;
+        else
+            sl_lru_put(lru, key, sl_from_bytes(value, sl_len(value, NULL), NULL), NULL);
+    }
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op (%.1f%% hits)\n", "sl_lru get, put on miss", t * 1e9 / (double)nops,
+           100.0 * (double)hits / (double)nops);
+
+    t0 = now_sec();
+    for (size_t i = 0; i < nops; i++)
+        hits += sl_lru_get_str(lru, keys[ops[i] % 64], NULL) != NULL;
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op\n", "sl_lru_get_str (hit)", t * 1e9 / (double)nops);
+    sl_lru_free(&lru, NULL);
+
+    sl_lru_shared *c = sl_lru_shared_new(16, capacity, 0, NULL, NULL, NULL);
+    hits = 0;
+    t0 = now_sec();
+    for (size_t i = 0; i < nops; i++) {
+        sl_str key = keys[ops[i]];
+        sl_str v = sl_lru_shared_get_str(c, key, NULL);
+        if (v) {
+            hits++;
+            sl_free(&v, NULL);
+        } else {
+            sl_lru_shared_put(c, key, sl_from_bytes(value, sl_len(value, NULL), NULL), NULL);
+        }
+    }
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op (%.1f%% hits, 1 thread)\n", "sl_lru_shared get, put on miss",
+           t * 1e9 / (double)nops, 100.0 * (double)hits / (double)nops);
+    sl_lru_shared_free(&c, NULL);
+
+    sl_free(&value, NULL);
+    for (size_t i = 0; i < nkeys; i++)
+        sl_free(&keys[i], NULL);
+    free(ops);
+    free(keys);
+}
+
+static void bench_filters(void) {
+    const size_t n = 1000000, nprobes = 2000000;
+    sl_str *keys = malloc(n * sizeof(*keys));
+    sl_str *probes = malloc(nprobes * sizeof(*probes));
+    char buf[48];
+    for (size_t i = 0; i < n; i++) {
+        int len = snprintf(buf, sizeof(buf), "user:%zu@example.com", i);
+        keys[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    for (size_t i = 0; i < nprobes; i++) {
+        int len = snprintf(buf, sizeof(buf), "visitor:%zu@example.org", i);
+        probes[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    uint64_t *probe_hashes = malloc(nprobes * sizeof(*probe_hashes));
+    for (size_t i = 0; i < nprobes; i++)
+        probe_hashes[i] = sl_hash(probes[i], NULL);
+    double t0, t, best;
+    size_t hits;
+
+    printf("filters (%zu keys, %zu absent probes)\n", n, nprobes);
+
+    static const double rates[] = {0.01, 0.001};
+    for (int r = 0; r < 2; r++) {
+        sl_bloom *b = sl_bloom_new(n, rates[r], NULL);
+        t0 = now_sec();
+        for (size_t i = 0; i < n; i++)
+            sl_bloom_add(b, keys[i], NULL);
+        t = now_sec() - t0;
+        snprintf(buf, sizeof(buf), "sl_bloom %.1f%% add", rates[r] * 100);
+        printf("  %-30s %8.1f ns/op (%.1f bits/key)\n", buf, t * 1e9 / (double)n,
+               8.0 * (double)sl_bloom_memory(b, NULL) / (double)n);
+
+        BEST_OF(3, best, hits = 0; for (size_t i = 0; i < n; i++) hits += sl_bloom_contains(b, keys[i], NULL));
+        snprintf(buf, sizeof(buf), "sl_bloom %.1f%% present", rates[r] * 100);
+        printf("  %-30s %8.1f ns/op (%zu found)\n", buf, best * 1e9 / (double)n, hits);
+
+        BEST_OF(3, best, hits = 0; for (size_t i = 0; i < nprobes; i++) hits +=
+                         sl_bloom_contains(b, probes[i], NULL));
+        snprintf(buf, sizeof(buf), "sl_bloom %.1f%% absent", rates[r] * 100);
+        printf("  %-30s %8.1f ns/op (%.3f%% false positives)\n", buf, best * 1e9 / (double)nprobes,
+               100.0 * (double)hits / (double)nprobes);
+
+        BEST_OF(3, best, hits = 0; for (size_t i = 0; i < nprobes; i++) hits +=
+                         sl_bloom_contains_hash(b, probe_hashes[i], NULL));
+        printf("  %-30s %8.1f ns/op\n", "  from an array of hashes", best * 1e9 / (double)nprobes);
+        sl_bloom_free(&b, NULL);
+    }
+
+    sl_cuckoo *c = sl_cuckoo_new(n, NULL);
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sl_cuckoo_add(c, keys[i], NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op (%.1f bits/key)\n", "sl_cuckoo add", t * 1e9 / (double)n,
+           8.0 * (double)sl_cuckoo_memory(c, NULL) / (double)n);
+
+    BEST_OF(3, best, hits = 0; for (size_t i = 0; i < n; i++) hits += sl_cuckoo_contains(c, keys[i], NULL));
+    printf("  %-30s %8.1f ns/op (%zu found)\n", "sl_cuckoo present", best * 1e9 / (double)n, hits);
+
+    BEST_OF(3, best, hits = 0; for (size_t i = 0; i < nprobes; i++) hits += sl_cuckoo_contains(c, probes[i], NULL));
+    printf("  %-30s %8.1f ns/op (%.4f%% false positives)\n", "sl_cuckoo absent", best * 1e9 / (double)nprobes,
+           100.0 * (double)hits / (double)nprobes);
+    BEST_OF(3, best, hits = 0; for (size_t i = 0; i < nprobes; i++) hits +=
+                     sl_cuckoo_contains_hash(c, probe_hashes[i], NULL));
+    printf("  %-30s %8.1f ns/op\n", "  from an array of hashes", best * 1e9 / (double)nprobes);
+
+    t0 = now_sec();
+    for (size_t i = 0; i < n; i++)
+        sl_cuckoo_remove(c, keys[i], NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op\n", "sl_cuckoo remove", t * 1e9 / (double)n);
+    sl_cuckoo_free(&c, NULL);
+
+    for (size_t i = 0; i < n; i++)
+        sl_free(&keys[i], NULL);
+    for (size_t i = 0; i < nprobes; i++)
+        sl_free(&probes[i], NULL);
+    free(probe_hashes);
+    free(keys);
+    free(probes);
+}
+
+static void bench_sketches(void) {
+    const size_t nkeys = 1000000, nevents = 4000000;
+    sl_str *keys = malloc(nkeys * sizeof(*keys));
+    uint32_t *events = malloc(nevents * sizeof(*events));
+    uint32_t *exact = calloc(nkeys, sizeof(*exact));
+    char buf[48];
+    for (size_t i = 0; i < nkeys; i++) {
+        int len = snprintf(buf, sizeof(buf), "/item/%zu?ref=feed", i);
+        keys[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    // Zipf-like stream: a random bit length, then a random index of that
+    // length, so key k is drawn with probability about 1 / (20 k)
+    size_t distinct = 0;
+    for (size_t i = 0; i < nevents; i++) {
+        unsigned bits = (unsigned)(rng() % 20);
+        events[i] = (uint32_t)((((1ULL << bits) | (rng() & ((1ULL << bits) - 1))) - 1) % nkeys);
+        distinct += exact[events[i]]++ == 0;
+    }
+    double t0, t, best;
+
+    printf("sketches (%zu events, %zu distinct keys)\n", nevents, distinct);
+
+    sl_hll *h = NULL;
+    BEST_OF(3, best, sl_hll_free(&h, NULL); h = sl_hll_new(14, NULL);
+            for (size_t i = 0; i < nevents; i++) sl_hll_add(h, keys[events[i]], NULL));
+    uint64_t est = sl_hll_count(h, NULL);
+    printf("  %-30s %8.1f ns/op (%.1f M/s, %+.2f%% error, %zu bytes)\n", "sl_hll add p=14", best * 1e9 / (double)nevents,
+           (double)nevents / best / 1e6, 100.0 * ((double)est - (double)distinct) / (double)distinct,
+           sl_hll_memory(h, NULL));
+    uint64_t *hashes = malloc(nevents * sizeof(*hashes));
+    for (size_t i = 0; i < nevents; i++)
+        hashes[i] = sl_hash(keys[events[i]], NULL);
+    BEST_OF(3, best, sl_hll_free(&h, NULL); h = sl_hll_new(14, NULL);
+            for (size_t i = 0; i < nevents; i++) sl_hll_add_hash(h, hashes[i], NULL));
+    printf("  %-30s %8.1f ns/op (%.1f M/s)\n", "  from an array of hashes", best * 1e9 / (double)nevents,
+           (double)nevents / best / 1e6);
+    BEST_OF(3, best, est = sl_hll_count(h, NULL));
+    printf("  %-30s %8.1f us\n", "sl_hll count", best * 1e6);
+
+    // four threads' worth of sketches merged into one
+    sl_hll *parts[4];
+    for (int p = 0; p < 4; p++)
+        parts[p] = sl_hll_new(14, NULL);
+    for (size_t i = 0; i < nevents; i++)
+        sl_hll_add(parts[i % 4], keys[events[i]], NULL);
+    sl_hll *merged = sl_hll_new(14, NULL);
+    t0 = now_sec();
+    for (int p = 0; p < 4; p++)
+        sl_hll_merge(merged, parts[p], NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f us (estimate %llu)\n", "sl_hll merge 4 sketches", t * 1e6,
+           (unsigned long long)sl_hll_count(merged, NULL));
+    for (int p = 0; p < 4; p++)
+        sl_hll_free(&parts[p], NULL);
+    sl_hll_free(&merged, NULL);
+    sl_hll_free(&h, NULL);
+
+    sl_cms *c = NULL;
+    BEST_OF(3, best, sl_cms_free(&c, NULL); c = sl_cms_new(1 << 16, 4, 10, NULL);
+            for (size_t i = 0; i < nevents; i++) sl_cms_add(c, keys[events[i]], 1, NULL));
+    printf("  %-30s %8.1f ns/op (%.1f M/s, %zu bytes)\n", "sl_cms add 65536x4 top-10", best * 1e9 / (double)nevents,
+           (double)nevents / best / 1e6, sl_cms_memory(c, NULL));
+    sl_cms *plain = NULL;
+    BEST_OF(3, best, sl_cms_free(&plain, NULL); plain = sl_cms_new(1 << 16, 4, 0, NULL);
+            for (size_t i = 0; i < nevents; i++) sl_cms_add_hash(plain, hashes[i], 1, NULL));
+    printf("  %-30s %8.1f ns/op (%.1f M/s)\n", "  from hashes, no top-k", best * 1e9 / (double)nevents,
+           (double)nevents / best / 1e6);
+    sl_cms_free(&plain, NULL);
+
+    // how far estimates of the 100 most frequent keys are above the truth
+    double over = 0;
+    for (size_t i = 0; i < 100; i++)
+        over += (double)(sl_cms_estimate(c, keys[i], NULL) - exact[i]) / (double)exact[i];
+    sl_cms_item top[10];
+    size_t ntop = sl_cms_top(c, top, 10, NULL);
+    size_t right = 0;
+    for (size_t i = 0; i < ntop; i++) {
+        // a reported key is right if fewer than 10 keys are more frequent
+        size_t k = (size_t)strtoul(top[i].key.data + 6, NULL, 10), above = 0;
+        for (size_t j = 0; j < nkeys && above < 10; j++)
+            above += exact[j] > exact[k];
+        right += above < 10;
+    }
+    printf("  %-30s %8.3f%% mean overestimate, top-10 recall %zu/10\n", "  accuracy", 100.0 * over / 100, right);
+    sl_cms_free(&c, NULL);
+
+    for (size_t i = 0; i < nkeys; i++)
+        sl_free(&keys[i], NULL);
+    free(keys);
+    free(events);
+    free(exact);
+    free(hashes);
+}
+
+static bool bench_ngram_sum(sl_view gram, uint64_t hash, void *ctx) {
+    (void)gram;
+    *(uint64_t *)ctx += hash;
+    return true;
+}
+
+static void bench_rolling_hash(void) {
+    const size_t len = 1 << 20;
+    static const char *words[] = {"lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit"};
+    char *text = malloc(len + 1);
+    size_t pos = 0;
+    while (pos < len) {
+        const char *w = words[rng() % 8];
+        size_t wlen = strlen(w);
+        for (size_t i = 0; i < wlen && pos < len; i++)
+            text[pos++] = w[i];
+        if (pos < len)
+            text[pos++] = ' ';
+    }
+    text[len] = '\0';
+    sl_str doc = sl_from_bytes(text, len, NULL);
+    double best;
+    uint64_t sum;
+
+    printf("rolling hash (%zu byte document)\n", len);
+
+    static const size_t ks[] = {8, 64};
+    char label[48];
+    for (int j = 0; j < 2; j++) {
+        size_t k = ks[j], windows = len - k + 1;
+        BEST_OF(3, best, sum = 0; for (size_t i = 0; i < windows; i++) sum += sl_compute_hash(text + i, k));
+        snprintf(label, sizeof(label), "%zu-grams, rehash each", k);
+        printf("  %-30s %8.1f ns/op (%llx)\n", label, best * 1e9 / (double)windows, (unsigned long long)(sum & 0xff));
+        BEST_OF(3, best, sum = 0; sl_ngrams(doc, k, bench_ngram_sum, &sum, NULL));
+        snprintf(label, sizeof(label), "%zu-grams, sl_ngrams", k);
+        printf("  %-30s %8.1f ns/op\n", label, best * 1e9 / (double)windows);
+        sl_rolling_hash *rh = NULL;
+        BEST_OF(3, best, sum = 0; sl_rolling_hash_free(&rh, NULL); rh = sl_rolling_hash_new(doc, k, NULL);
+                uint64_t h; while (sl_rolling_hash_next(rh, NULL, &h, NULL)) sum += h);
+        sl_rolling_hash_free(&rh, NULL);
+        snprintf(label, sizeof(label), "%zu-grams, sl_rolling_hash", k);
+        printf("  %-30s %8.1f ns/op\n", label, best * 1e9 / (double)windows);
+    }
+
+    // needles that never occur, so the whole document is scanned
+    static const size_t counts[] = {1, 16, 256};
+    for (int j = 0; j < 3; j++) {
+        size_t n = counts[j], found = 0;
+        sl_str *needles = malloc(n * sizeof(*needles));
+        for (size_t i = 0; i < n; i++) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "absent%04zu", i);
+            needles[i] = sl_from_bytes(buf, 10, NULL);
+        }
+        BEST_OF(3, best, found = sl_find_any(doc, 0, needles, n, NULL, NULL));
+        snprintf(label, sizeof(label), "sl_find_any %zu needles", n);
+        printf("  %-30s %8.1f MB/s%s\n", label, (double)len / best / 1e6, found == SL_NOT_FOUND ? "" : " (found?)");
+        BEST_OF(3, best, found = 0; for (size_t i = 0; i < n; i++) found += strstr(text, needles[i]) != NULL);
+        snprintf(label, sizeof(label), "  strstr per needle");
+        printf("  %-30s %8.1f MB/s (%zu found)\n", label, (double)len / best / 1e6, found);
+        for (size_t i = 0; i < n; i++)
+            sl_free(&needles[i], NULL);
+        free(needles);
+    }
+
+    sl_free(&doc, NULL);
+    free(text);
+}
+
+static void bench_similarity(void) {
+    const size_t ndocs = 10000, nperm = 128, nwords = 4096;
+    // vocabulary of random 2-9 letter words
+    char (*words)[10] = malloc(nwords * sizeof(*words));
+    for (size_t w = 0; w < nwords; w++) {
+        size_t wlen = 2 + rng() % 8;
+        for (size_t i = 0; i < wlen; i++)
+            words[w][i] = (char)('a' + rng() % 26);
+        words[w][wlen] = '\0';
+    }
+    // every 10th document is a copy of the previous one with a few words changed
+    sl_str *docs = malloc(ndocs * sizeof(*docs));
+    char *text = malloc(4096);
+    size_t bytes = 0;
+    for (size_t d = 0; d < ndocs; d++) {
+        size_t len = 0;
+        if (d % 10 == 9) {
+            len = sl_len(docs[d - 1], NULL);
+            memcpy(text, docs[d - 1], len);
+            for (int e = 0; e < 5; e++)
+                text[rng() % len] = (char)('A' + rng() % 26);
+        } else {
+            while (len < 2000) {
+                const char *w = words[rng() % nwords];
+                size_t wlen = strlen(w);
+                memcpy(text + len, w, wlen);
+                len += wlen;
+                text[len++] = ' ';
+            }
+        }
+        docs[d] = sl_from_bytes(text, len, NULL);
+        bytes += len;
+    }
+    uint32_t *sigs = malloc(ndocs * nperm * sizeof(*sigs));
+    double t0, t;
+
+    printf("similarity (%zu documents, %.1f MB)\n", ndocs, (double)bytes / 1e6);
+
+    t0 = now_sec();
+    for (size_t d = 0; d < ndocs; d++)
+        sl_minhash(docs[d], 9, nperm, sigs + d * nperm, NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.0f docs/s (%.1f MB/s)\n", "sl_minhash k=9, 128 values", (double)ndocs / t,
+           (double)bytes / t / 1e6);
+
+    uint64_t sum = 0;
+    t0 = now_sec();
+    for (size_t d = 0; d < ndocs; d++)
+        sum += sl_simhash(docs[d], NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.0f docs/s (%.1f MB/s, %llx)\n", "sl_simhash", (double)ndocs / t, (double)bytes / t / 1e6,
+           (unsigned long long)(sum & 0xff));
+
+    sl_lsh *lsh = sl_lsh_new(nperm, 32, NULL);
+    t0 = now_sec();
+    for (size_t d = 0; d < ndocs; d++)
+        sl_lsh_add(lsh, sigs + d * nperm, d, NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op\n", "sl_lsh_add 32 bands", t * 1e9 / (double)ndocs);
+
+    // each near duplicate should find its original, and little else
+    uint64_t ids[64];
+    size_t found = 0, candidates = 0, queries = 0;
+    t0 = now_sec();
+    for (size_t d = 9; d < ndocs; d += 10) {
+        size_t n = sl_lsh_query(lsh, sigs + d * nperm, ids, 64, NULL);
+        candidates += n;
+        for (size_t i = 0; i < n && i < 64; i++)
+            found += ids[i] == d - 1;
+        queries++;
+    }
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op (recall %zu/%zu, %.2f candidates each)\n", "sl_lsh_query", t * 1e9 / (double)queries,
+           found, queries, (double)candidates / (double)queries);
+
+    sl_lsh_free(&lsh, NULL);
+
+    // a cluster of duplicates: every add lands in the same 32 buckets
+    lsh = sl_lsh_new(nperm, 32, NULL);
+    t0 = now_sec();
+    for (size_t d = 0; d < ndocs; d++)
+        sl_lsh_add(lsh, sigs, d, NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f ns/op\n", "sl_lsh_add (all duplicates)", t * 1e9 / (double)ndocs);
+    t0 = now_sec();
+    size_t n = sl_lsh_query(lsh, sigs, ids, 64, NULL);
+    t = now_sec() - t0;
+    printf("  %-30s %8.1f us (%zu candidates)\n", "sl_lsh_query (all duplicates)", t * 1e6, n);
+    sl_lsh_free(&lsh, NULL);
+
+    for (size_t d = 0; d < ndocs; d++)
+        sl_free(&docs[d], NULL);
+    free(docs);
+    free(sigs);
+    free(text);
+    free(words);
+}
+
+int main(void) {
+    bench_rope_insert();
+    bench_codecs();
+    bench_crc32c();
+    bench_pack();
+    bench_shm_pool();
+    bench_intern_snapshot();
+    bench_frames();
+    bench_varints();
+    bench_fcset();
+    bench_compress();
+    bench_dict_column();
+    bench_radix();
+    bench_btree();
+    bench_lru();
+    bench_filters();
+    bench_sketches();
+    bench_rolling_hash();
+    bench_similarity();
+    return 0;
+}
@@ -1,7 +1,17 @@
 #include "sl_string.h"
 #include "string.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include "unity.h"
 
+#ifdef SL_HAVE_POSIX
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
 void setUp(void) {}
 void tearDown(void) {}
 
@@ -181,6 +191,2210 @@ void test_sl_from_bytes(void) {
     TEST_ASSERT_NULL(s);
 }
 
+void test_sl_arena(void) {
+    sl_err err;
+    sl_arena *arena = sl_arena_new(64, &err);
+    TEST_ASSERT_NOT_NULL(arena);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    // strings in the arena behave like normal strings
+    sl_str s = sl_from_cstr_in(arena, "Hello", &err);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("Hello", s);
+    TEST_ASSERT_EQUAL(5, sl_len(s, &err));
+    TEST_ASSERT_EQUAL(sl_compute_hash_cstr("Hello"), sl_hash(s, &err));
+
+    // append grows inside the arena (in place and across blocks)
+    s = sl_append_cstr(s, " world", &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("Hello world", s);
+    for (int i = 0; i < 20; i++)
+        s = sl_append_cstr(s, "0123456789", &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(211, sl_len(s, &err));
+
+    sl_str b = sl_from_bytes_in(arena, "A\0B", 3, &err);
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL(3, sl_len(b, &err));
+
+    // raw allocations honour the alignment
+    void *p = sl_arena_alloc(arena, 10, 64, &err);
+    TEST_ASSERT_NOT_NULL(p);
+    TEST_ASSERT_EQUAL(0, (uintptr_t)p % 64);
+    TEST_ASSERT_NULL(sl_arena_alloc(arena, 10, 3, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    // free only invalidates the string
+    sl_free(&s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NULL(s);
+
+    // reset releases everything, the arena can be reused
+    sl_arena_reset(arena);
+    s = sl_from_cstr_in(arena, "again", &err);
+    TEST_ASSERT_EQUAL_STRING("again", s);
+
+    TEST_ASSERT_NULL(sl_from_cstr_in(NULL, "x", &err));
+    TEST_ASSERT_EQUAL(SL_ERR_NULL, err);
+
+    sl_arena_free(&arena, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NULL(arena);
+}
+
+void test_sl_rope(void) {
+    sl_err err;
+
+    // build from a string bigger than a chunk
+    char big[5000];
+    for (size_t i = 0; i < sizeof(big); i++)
+        big[i] = 'a' + (char)(i % 26);
+    sl_str src = sl_from_bytes(big, sizeof(big), &err);
+    sl_rope *rope = sl_rope_from_str(src, &err);
+    TEST_ASSERT_NOT_NULL(rope);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(sizeof(big), sl_rope_len(rope, &err));
+    TEST_ASSERT_EQUAL_CHAR(big[4321], sl_rope_at(rope, 4321, &err));
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_poly_hash(big, sizeof(big)), sl_rope_hash(rope, &err));
+
+    // insert in the middle, at the start and at the end
+    sl_rope_insert(rope, 2500, "XYZ", 3, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_rope_insert(rope, 0, "<", 1, &err);
+    sl_rope_insert(rope, sl_rope_len(rope, NULL), ">", 1, &err);
+    TEST_ASSERT_EQUAL(sizeof(big) + 5, sl_rope_len(rope, &err));
+    TEST_ASSERT_EQUAL_CHAR('X', sl_rope_at(rope, 2501, &err));
+
+    // a big insert creates new nodes
+    sl_rope_insert(rope, 1, big, sizeof(big), &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_rope_delete(rope, 1, sizeof(big), &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    // delete what was inserted
+    sl_rope_delete(rope, 2501, 3, &err);
+    sl_rope_delete(rope, 0, 1, &err);
+    sl_rope_delete(rope, sizeof(big), 1, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    sl_str flat = sl_rope_to_str(rope, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(sl_eq(flat, src, &err));
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_poly_hash(big, sizeof(big)), sl_rope_hash(rope, &err));
+    sl_free(&flat, NULL);
+
+    // concat moves the second rope
+    sl_str tail = sl_from_cstr("-tail", &err);
+    sl_rope *other = sl_rope_from_str(tail, &err);
+    sl_rope_concat(rope, other, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(0, sl_rope_len(other, &err));
+    TEST_ASSERT_EQUAL(sizeof(big) + 5, sl_rope_len(rope, &err));
+    TEST_ASSERT_EQUAL_CHAR('-', sl_rope_at(rope, sizeof(big), &err));
+
+    // range errors leave the rope unchanged
+    sl_rope_insert(rope, 999999, "x", 1, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_rope_delete(rope, 10, 999999, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_rope_at(rope, sizeof(big) + 5, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+
+    // many small edits at random positions
+    sl_rope *empty = sl_rope_new(&err);
+    for (int i = 0; i < 2000; i++)
+        sl_rope_insert(empty, (size_t)(i * 7919) % (sl_rope_len(empty, NULL) + 1), "ab", 2, &err);
+    TEST_ASSERT_EQUAL(4000, sl_rope_len(empty, &err));
+    flat = sl_rope_to_str(empty, &err);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_poly_hash(flat, 4000), sl_rope_hash(empty, &err));
+    sl_free(&flat, NULL);
+
+    sl_rope_free(&empty, &err);
+    sl_rope_free(&other, &err);
+    sl_rope_free(&rope, &err);
+    TEST_ASSERT_NULL(rope);
+    sl_free(&tail, NULL);
+    sl_free(&src, NULL);
+}
+
+void test_sl_gapbuf(void) {
+    sl_err err;
+    sl_str s = sl_from_cstr("Hello world", &err);
+    sl_gapbuf *gb = sl_gapbuf_from_str(s, &err);
+    TEST_ASSERT_NOT_NULL(gb);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(11, sl_gapbuf_len(gb, &err));
+    TEST_ASSERT_EQUAL(11, sl_gapbuf_cursor(gb, &err));
+
+    // edit around the cursor
+    sl_gapbuf_move(gb, 5, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_gapbuf_insert(gb, ",", 1, &err);
+    TEST_ASSERT_EQUAL(6, sl_gapbuf_cursor(gb, &err));
+    sl_gapbuf_delete(gb, 1, &err);        // remove ' '
+    sl_gapbuf_insert(gb, " dear ", 6, &err);
+    sl_gapbuf_backspace(gb, 1, &err);     // remove the trailing ' '
+    sl_gapbuf_insert(gb, "_", 1, &err);
+
+    size_t len;
+    const char *view = sl_gapbuf_view(gb, &len, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("Hello, dear_world", view);
+    TEST_ASSERT_EQUAL(17, len);
+
+    // the view leaves the cursor and the text after it in place
+    TEST_ASSERT_EQUAL(12, sl_gapbuf_cursor(gb, &err));
+    sl_gapbuf_insert(gb, "my", 2, &err);
+    view = sl_gapbuf_view(gb, &len, &err);
+    TEST_ASSERT_EQUAL_STRING("Hello, dear_myworld", view);
+    TEST_ASSERT_EQUAL(14, sl_gapbuf_cursor(gb, &err));
+    sl_gapbuf_backspace(gb, 2, &err);
+    sl_gapbuf_move(gb, 17, &err);
+    view = sl_gapbuf_view(gb, &len, &err);
+    TEST_ASSERT_EQUAL_STRING("Hello, dear_world", view);
+    TEST_ASSERT_EQUAL(17, sl_gapbuf_cursor(gb, &err));
+
+    // growth keeps the text after the cursor
+    sl_gapbuf_move(gb, 0, &err);
+    for (int i = 0; i < 1000; i++)
+        sl_gapbuf_insert(gb, "ab", 2, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(2017, sl_gapbuf_len(gb, &err));
+
+    sl_str out = sl_gapbuf_to_str(gb, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(2017, sl_len(out, &err));
+    TEST_ASSERT_EQUAL_STRING("Hello, dear_world", out + 2000);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(out, 2017), sl_hash(out, &err));
+    sl_free(&out, NULL);
+
+    // range errors
+    sl_gapbuf_move(gb, 5000, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_gapbuf_move(gb, 1, &err);
+    sl_gapbuf_backspace(gb, 2, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_gapbuf_delete(gb, 5000, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+
+    sl_gapbuf_free(&gb, &err);
+    TEST_ASSERT_NULL(gb);
+    sl_free(&s, NULL);
+}
+
+void test_sl_insert_erase(void) {
+    sl_err err;
+    sl_str s = sl_from_cstr("Hello world", &err);
+
+    s = sl_insert(s, 5, ",", 1, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("Hello, world", s);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr("Hello, world"), sl_hash(s, &err));
+
+    s = sl_insert(s, 0, ">> ", 3, &err);
+    s = sl_insert(s, sl_len(s, NULL), "!", 1, &err);
+    TEST_ASSERT_EQUAL_STRING(">> Hello, world!", s);
+
+    // insert a part of the string itself
+    s = sl_insert(s, 3, s + 3, 5, &err);
+    TEST_ASSERT_EQUAL_STRING(">> HelloHello, world!", s);
+
+    s = sl_erase(s, 0, 8, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("Hello, world!", s);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr("Hello, world!"), sl_hash(s, &err));
+
+    s = sl_replace_range(s, 7, 5, "there", 5, &err);
+    TEST_ASSERT_EQUAL_STRING("Hello, there!", s);
+    s = sl_replace_range(s, 0, 5, "Hi", 2, &err);
+    TEST_ASSERT_EQUAL_STRING("Hi, there!", s);
+    TEST_ASSERT_EQUAL(10, sl_len(s, &err));
+
+    // out of range
+    s = sl_insert(s, 11, "x", 1, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    s = sl_erase(s, 5, 6, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    TEST_ASSERT_EQUAL_STRING("Hi, there!", s);
+
+    sl_free(&s, NULL);
+}
+
+void test_sl_replace_all(void) {
+    sl_err err;
+    sl_str s = sl_from_cstr("a-b-c-d", &err);
+
+    // grows
+    s = sl_replace_all(s, "-", 1, " -> ", 4, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("a -> b -> c -> d", s);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr("a -> b -> c -> d"), sl_hash(s, &err));
+
+    // shrinks
+    s = sl_replace_all(s, " -> ", 4, "", 0, &err);
+    TEST_ASSERT_EQUAL_STRING("abcd", s);
+    TEST_ASSERT_EQUAL(4, sl_len(s, &err));
+
+    // same length, non-overlapping matches
+    s = sl_replace_all(s, "abcd", 4, "aaaa", 4, &err);
+    s = sl_replace_all(s, "aa", 2, "b", 1, &err);
+    TEST_ASSERT_EQUAL_STRING("bb", s);
+
+    // no match
+    s = sl_replace_all(s, "zz", 2, "y", 1, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("bb", s);
+
+    // many matches (more than the local buffer)
+    sl_free(&s, NULL);
+    s = sl_from_cstr("", &err);
+    for (int i = 0; i < 200; i++)
+        s = sl_append_cstr(s, "x.", &err);
+    s = sl_replace_all(s, ".", 1, "::", 2, &err);
+    TEST_ASSERT_EQUAL(600, sl_len(s, &err));
+    TEST_ASSERT_EQUAL_STRING_LEN("x::x::", s, 6);
+
+    s = sl_replace_all(s, "", 0, "y", 1, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    sl_free(&s, NULL);
+}
+
+void test_sl_trim(void) {
+    sl_err err;
+    sl_str s = sl_from_cstr(" \t\n Hello world \r\n", &err);
+
+    sl_view v = sl_trim_view(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(11, v.len);
+    TEST_ASSERT_EQUAL_STRING_LEN("Hello world", v.data, v.len);
+    v = sl_ltrim_view(s, &err);
+    TEST_ASSERT_EQUAL(14, v.len);
+    v = sl_rtrim_view(s, &err);
+    TEST_ASSERT_EQUAL(15, v.len);
+
+    s = sl_ltrim(s, &err);
+    TEST_ASSERT_EQUAL_STRING("Hello world \r\n", s);
+    s = sl_rtrim(s, &err);
+    TEST_ASSERT_EQUAL_STRING("Hello world", s);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr("Hello world"), sl_hash(s, &err));
+    sl_free(&s, NULL);
+
+    // long runs cross the 16-byte blocks
+    char buf[200];
+    memset(buf, ' ', sizeof(buf));
+    memcpy(buf + 37, "x", 1);
+    memcpy(buf + 150, "y", 1);
+    s = sl_from_bytes(buf, sizeof(buf), &err);
+    s = sl_trim(s, &err);
+    TEST_ASSERT_EQUAL(114, sl_len(s, &err));
+    TEST_ASSERT_EQUAL_CHAR('x', s[0]);
+    TEST_ASSERT_EQUAL_CHAR('y', s[113]);
+
+    s = sl_collapse_ws(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(3, sl_len(s, &err));
+    TEST_ASSERT_EQUAL_STRING_LEN("x y", s, 3);
+    sl_free(&s, NULL);
+
+    s = sl_from_cstr("  a \t\n b\v\fc  dd  ", &err);
+    s = sl_collapse_ws(s, &err);
+    TEST_ASSERT_EQUAL_STRING("a b c dd", s);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr("a b c dd"), sl_hash(s, &err));
+    sl_free(&s, NULL);
+
+    // same length, bytes rewritten: the cached hash must follow
+    s = sl_from_cstr("a\tb", &err);
+    s = sl_collapse_ws(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("a b", s);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash("a b", 3), sl_hash(s, &err));
+    sl_str expected = sl_from_cstr("a b", &err);
+    TEST_ASSERT_TRUE(sl_eq(s, expected, &err));
+    sl_free(&expected, NULL);
+    sl_free(&s, NULL);
+
+    // only whitespace
+    s = sl_from_cstr(" \t\t                   ", &err);
+    s = sl_trim(s, &err);
+    TEST_ASSERT_EQUAL_STRING("", s);
+    sl_free(&s, NULL);
+
+    v = sl_trim_view(NULL, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_NULL, err);
+    TEST_ASSERT_NULL(v.data);
+}
+
+void test_sl_hex(void) {
+    sl_err err;
+
+    // all byte values (long enough for the SIMD path)
+    unsigned char bytes[256];
+    char expected[513];
+    for (int i = 0; i < 256; i++) {
+        bytes[i] = (unsigned char)i;
+        snprintf(expected + 2 * i, 3, "%02x", i);
+    }
+
+    sl_str s = sl_from_bytes(bytes, sizeof(bytes), &err);
+    sl_str hex = sl_hex_encode(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL(512, sl_len(hex, &err));
+    TEST_ASSERT_EQUAL_STRING(expected, hex);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(expected, 512), sl_hash(hex, &err));
+
+    sl_str back = sl_hex_decode(hex, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(sl_eq(back, s, &err));
+    sl_free(&back, NULL);
+
+    // upper case input
+    sl_str upper = sl_from_cstr("DEADbeef", &err);
+    back = sl_hex_decode(upper, &err);
+    TEST_ASSERT_EQUAL(4, sl_len(back, &err));
+    TEST_ASSERT_EQUAL_HEX8(0xDE, (unsigned char)back[0]);
+    TEST_ASSERT_EQUAL_HEX8(0xEF, (unsigned char)back[3]);
+    sl_free(&back, NULL);
+    sl_free(&upper, NULL);
+
+    // invalid characters (also inside a SIMD block) and odd length
+    hex[300] = 'g';
+    TEST_ASSERT_NULL(sl_hex_decode(hex, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    sl_str odd = sl_from_cstr("abc", &err);
+    TEST_ASSERT_NULL(sl_hex_decode(odd, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+
+    sl_free(&odd, NULL);
+    sl_free(&hex, NULL);
+    sl_free(&s, NULL);
+}
+
+void test_sl_base64(void) {
+    sl_err err;
+
+    // RFC 4648 test vectors
+    const char *plain[] = {"", "f", "fo", "foo", "foob", "fooba", "foobar"};
+    const char *std[] = {"", "Zg==", "Zm8=", "Zm9v", "Zm9vYg==", "Zm9vYmE=", "Zm9vYmFy"};
+    const char *url[] = {"", "Zg", "Zm8", "Zm9v", "Zm9vYg", "Zm9vYmE", "Zm9vYmFy"};
+    for (int i = 0; i < 7; i++) {
+        sl_str s = sl_from_cstr(plain[i], &err);
+        sl_str enc = sl_base64_encode(s, SL_BASE64_STD, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_EQUAL_STRING(std[i], enc);
+        sl_str dec = sl_base64_decode(enc, SL_BASE64_STD, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_TRUE(sl_eq(dec, s, &err));
+        sl_free(&dec, NULL);
+        sl_free(&enc, NULL);
+
+        enc = sl_base64_encode(s, SL_BASE64_URL, &err);
+        TEST_ASSERT_EQUAL_STRING(url[i], enc);
+        dec = sl_base64_decode(enc, SL_BASE64_URL, &err);
+        TEST_ASSERT_TRUE(sl_eq(dec, s, &err));
+        sl_free(&dec, NULL);
+        sl_free(&enc, NULL);
+        sl_free(&s, NULL);
+    }
+
+    // long input for the SIMD path
+    sl_str s = sl_from_cstr("", &err);
+    sl_str expected = sl_from_cstr("", &err);
+    for (int i = 0; i < 40; i++) {
+        s = sl_append_cstr(s, "abc", &err);
+        expected = sl_append_cstr(expected, "YWJj", &err);
+    }
+    sl_str enc = sl_base64_encode(s, SL_BASE64_STD, &err);
+    TEST_ASSERT_TRUE(sl_eq(enc, expected, &err));
+    sl_str dec = sl_base64_decode(enc, SL_BASE64_STD, &err);
+    TEST_ASSERT_TRUE(sl_eq(dec, s, &err));
+    sl_free(&dec, NULL);
+    sl_free(&enc, NULL);
+    sl_free(&expected, NULL);
+    sl_free(&s, NULL);
+
+    // binary round trips of every length, both alphabets
+    unsigned char bytes[300];
+    for (size_t i = 0; i < sizeof(bytes); i++)
+        bytes[i] = (unsigned char)(i * 167 + 13);
+    for (size_t len = 0; len <= sizeof(bytes); len += 7) {
+        s = sl_from_bytes(bytes, len, &err);
+        for (int a = 0; a < 2; a++) {
+            sl_base64_alphabet alphabet = a ? SL_BASE64_URL : SL_BASE64_STD;
+            enc = sl_base64_encode(s, alphabet, &err);
+            TEST_ASSERT_NULL(strchr(enc, a ? '+' : '-'));
+            dec = sl_base64_decode(enc, alphabet, &err);
+            TEST_ASSERT_EQUAL(SL_OK, err);
+            TEST_ASSERT_TRUE(sl_eq(dec, s, &err));
+            sl_free(&dec, NULL);
+            sl_free(&enc, NULL);
+        }
+        sl_free(&s, NULL);
+    }
+
+    // invalid input
+    s = sl_from_cstr("Zm9v YmFy", &err);
+    TEST_ASSERT_NULL(sl_base64_decode(s, SL_BASE64_STD, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    sl_free(&s, NULL);
+    s = sl_from_cstr("Zm9vY", &err);
+    TEST_ASSERT_NULL(sl_base64_decode(s, SL_BASE64_STD, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    sl_free(&s, NULL);
+
+    // non-zero unused bits: "QR==" would also decode to "A"
+    const char *lax[] = {"QR==", "QR", "QUF=", "QUJ"};
+    for (int i = 0; i < 4; i++) {
+        s = sl_from_cstr(lax[i], &err);
+        TEST_ASSERT_NULL(sl_base64_decode(s, SL_BASE64_URL, &err));
+        TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+        sl_free(&s, NULL);
+    }
+    s = sl_from_cstr("QUE=", &err);
+    dec = sl_base64_decode(s, SL_BASE64_STD, &err);
+    TEST_ASSERT_EQUAL_STRING("AA", dec);
+    sl_free(&dec, NULL);
+    sl_free(&s, NULL);
+}
+
+void test_sl_json(void) {
+    sl_err err;
+
+    sl_str s = sl_from_cstr("say \"hi\"\\\n\t\x01 caf\xc3\xa9", &err);
+    sl_str esc = sl_json_escape(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("say \\\"hi\\\"\\\\\\n\\t\\u0001 caf\xc3\xa9", esc);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr(esc), sl_hash(esc, &err));
+
+    sl_str back = sl_json_unescape(esc, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(sl_eq(back, s, &err));
+    sl_free(&back, NULL);
+    sl_free(&esc, NULL);
+
+    // append into an existing document (long clean runs use the SIMD path)
+    sl_str doc = sl_from_cstr("{\"msg\":\"", &err);
+    sl_str long_str = sl_from_cstr("a fairly long value without anything to escape \"until here\"", &err);
+    doc = sl_append_json_escaped(doc, long_str, &err);
+    doc = sl_append_cstr(doc, "\"}", &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("{\"msg\":\"a fairly long value without anything to escape \\\"until here\\\"\"}", doc);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr(doc), sl_hash(doc, &err));
+
+    // appending a string to itself
+    doc = sl_append_json_escaped(doc, doc, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr(doc), sl_hash(doc, &err));
+    sl_free(&doc, NULL);
+    sl_free(&long_str, NULL);
+
+    // \u escapes and surrogate pairs
+    sl_str u = sl_from_cstr("\\u00e9\\u20AC\\uD83D\\uDE00\\/", &err);
+    back = sl_json_unescape(u, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80/", back);
+    sl_free(&back, NULL);
+    sl_free(&u, NULL);
+
+    // malformed escapes
+    const char *bad[] = {"\\x", "abc\\", "\\u12", "\\uD83D", "\\uDE00", "\\uD83D\\u0041", "\\u12G4"};
+    for (int i = 0; i < 7; i++) {
+        u = sl_from_cstr(bad[i], &err);
+        TEST_ASSERT_NULL(sl_json_unescape(u, &err));
+        TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+        sl_free(&u, NULL);
+    }
+
+    sl_free(&s, NULL);
+}
+
+void test_sl_url_html(void) {
+    sl_err err;
+
+    sl_str s = sl_from_cstr("a b&c=d/e?f~g.h_i-j caf\xc3\xa9 100%", &err);
+    sl_str enc = sl_url_encode(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("a%20b%26c%3Dd%2Fe%3Ff~g.h_i-j%20caf%C3%A9%20100%25", enc);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr(enc), sl_hash(enc, &err));
+
+    sl_str dec = sl_url_decode(enc, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(sl_eq(dec, s, &err));
+    sl_free(&dec, NULL);
+    sl_free(&enc, NULL);
+    sl_free(&s, NULL);
+
+    // lowercase escapes, '+' is kept
+    s = sl_from_cstr("a+b%2fc%2F", &err);
+    dec = sl_url_decode(s, &err);
+    TEST_ASSERT_EQUAL_STRING("a+b/c/", dec);
+    sl_free(&dec, NULL);
+    sl_free(&s, NULL);
+
+    // truncated or invalid escapes
+    const char *bad[] = {"%", "abc%2", "%zz"};
+    for (int i = 0; i < 3; i++) {
+        s = sl_from_cstr(bad[i], &err);
+        TEST_ASSERT_NULL(sl_url_decode(s, &err));
+        TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+        sl_free(&s, NULL);
+    }
+
+    // html
+    s = sl_from_cstr("<a href=\"x\">Tom & Jerry's</a> and a long tail of plain text", &err);
+    enc = sl_html_escape(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("&lt;a href=&quot;x&quot;&gt;Tom &amp; Jerry&#39;s&lt;/a&gt; and a long tail of plain text",
+                             enc);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr(enc), sl_hash(enc, &err));
+    sl_free(&enc, NULL);
+    sl_free(&s, NULL);
+}
+
+static uint32_t crc32c_bitwise(const unsigned char *p, size_t len) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78u : crc >> 1;
+    }
+    return ~crc;
+}
+
+void test_sl_crc32c(void) {
+    sl_err err;
+
+    // standard check value
+    sl_str s = sl_from_cstr("123456789", &err);
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283u, sl_crc32c(s, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283u, sl_crc32c(s, &err)); // cached
+    TEST_ASSERT_EQUAL_HEX32(0x00000000u, sl_compute_crc32c(NULL, 0));
+
+    // the cached value is dropped on edit
+    s = sl_append_cstr(s, "0", &err);
+    TEST_ASSERT_EQUAL_HEX32(crc32c_bitwise((const unsigned char *)"1234567890", 10), sl_crc32c(s, &err));
+    s = sl_erase(s, 9, 1, &err);
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283u, sl_crc32c(s, &err));
+    sl_free(&s, NULL);
+
+    // the cache lives in the spare capacity, an edit that reuses it drops it
+    s = sl_from_cstr("123456789abcde", &err);
+    s = sl_erase(s, 9, 5, &err);
+    TEST_ASSERT_TRUE(sl_cap(s, &err) >= 9 + 1 + 4);
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283u, sl_crc32c(s, &err));
+    TEST_ASSERT_EQUAL_HEX32(0xE3069283u, sl_crc32c(s, &err)); // cached
+    s = sl_append_cstr(s, "0abc", &err);
+    TEST_ASSERT_EQUAL_HEX32(crc32c_bitwise((const unsigned char *)"1234567890abc", 13), sl_crc32c(s, &err));
+    sl_free(&s, NULL);
+
+    // large enough for the interleaved loop, odd tail
+    size_t len = 100003;
+    unsigned char *buf = malloc(len);
+    TEST_ASSERT_NOT_NULL(buf);
+    for (size_t i = 0; i < len; i++)
+        buf[i] = (unsigned char)(i * 131 + (i >> 7));
+    uint32_t expected = crc32c_bitwise(buf, len);
+    TEST_ASSERT_EQUAL_HEX32(expected, sl_compute_crc32c(buf, len));
+
+    s = sl_from_bytes_verified(buf, len, expected, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_EQUAL_size_t(len, sl_len(s, &err));
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(buf, len), sl_hash(s, &err));
+    TEST_ASSERT_EQUAL_HEX32(expected, sl_crc32c(s, &err));
+    TEST_ASSERT_EQUAL_size_t(len + 1 + 4, sl_cap(s, &err)); // room for the cached checksum
+    sl_free(&s, NULL);
+
+    TEST_ASSERT_NULL(sl_from_bytes_verified(buf, len, expected ^ 1, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    free(buf);
+
+    TEST_ASSERT_EQUAL(0, sl_crc32c(NULL, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_NULL, err);
+}
+
+#ifdef SL_HAVE_POSIX
+void test_sl_pack(void) {
+    sl_err err;
+    char path[] = "/tmp/sl_pack_XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+
+    sl_str strs[4];
+    strs[0] = sl_from_cstr("alpha", &err);
+    strs[1] = sl_from_cstr("", &err);
+    strs[2] = sl_from_bytes("bin\0ary", 7, &err);
+    strs[3] = sl_from_cstr("a somewhat longer string that needs some padding", &err);
+
+    sl_pack_write(fd, strs, 4, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    close(fd);
+
+    sl_pack *pack = sl_pack_open(path, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NOT_NULL(pack);
+    TEST_ASSERT_EQUAL_size_t(4, sl_pack_count(pack, &err));
+
+    for (size_t i = 0; i < 4; i++) {
+        sl_str s = sl_pack_get(pack, i, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_TRUE(sl_eq(s, strs[i], &err));
+        TEST_ASSERT_EQUAL_UINT64(sl_hash(strs[i], NULL), sl_hash(s, NULL));
+        TEST_ASSERT_EQUAL_HEX32(sl_crc32c(strs[i], NULL), sl_crc32c(s, NULL));
+        TEST_ASSERT_EQUAL_CHAR('\0', s[sl_len(s, NULL)]);
+    }
+
+    // read-only: reading functions work, in-place edits are refused
+    sl_str s = sl_pack_get(pack, 0, &err);
+    sl_str copy = sl_hex_encode(s, &err);
+    TEST_ASSERT_EQUAL_STRING("616c706861", copy);
+    sl_free(&copy, NULL);
+    TEST_ASSERT_EQUAL_PTR(s, sl_append_cstr(s, "x", &err));
+    TEST_ASSERT_EQUAL(SL_ERR_READONLY, err);
+    sl_trim(s, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_READONLY, err);
+    TEST_ASSERT_EQUAL_STRING("alpha", s);
+    sl_free(&s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NULL(s);
+    TEST_ASSERT_EQUAL_STRING("alpha", sl_pack_get(pack, 0, &err));
+
+    TEST_ASSERT_NULL(sl_pack_get(pack, 4, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+
+    sl_pack_close(&pack, &err);
+    TEST_ASSERT_NULL(pack);
+
+    // not a pack file
+    fd = open(path, O_WRONLY | O_TRUNC);
+    TEST_ASSERT_TRUE(write(fd, "not a pack file, just some text", 31) == 31);
+    close(fd);
+    TEST_ASSERT_NULL(sl_pack_open(path, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+
+    unlink(path);
+    TEST_ASSERT_NULL(sl_pack_open(path, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_IO, err);
+
+    for (int i = 0; i < 4; i++)
+        sl_free(&strs[i], NULL);
+}
+
+void test_sl_shm_pool(void) {
+    sl_err err;
+    sl_shm_pool *pool = sl_shm_pool_new(1 << 16, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    const char *words[] = {"GET", "POST", "", "/index.html", "bin\0ary"};
+    const size_t lens[] = {3, 4, 0, 11, 7};
+    sl_str pooled[5];
+    for (int i = 0; i < 5; i++) {
+        pooled[i] = sl_shm_pool_add(pool, words[i], lens[i], &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_EQUAL_size_t(lens[i], sl_len(pooled[i], NULL));
+        TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(words[i], lens[i]), sl_hash(pooled[i], NULL));
+    }
+
+    // duplicates return the pooled string
+    TEST_ASSERT_EQUAL_PTR(pooled[1], sl_shm_pool_add(pool, "POST", 4, &err));
+    TEST_ASSERT_EQUAL_size_t(5, sl_shm_pool_count(pool, &err));
+    TEST_ASSERT_EQUAL_PTR(pooled[3], sl_shm_pool_find(pool, "/index.html", 11, &err));
+    TEST_ASSERT_NULL(sl_shm_pool_find(pool, "PUT", 3, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    // pooled strings are read-only
+    TEST_ASSERT_EQUAL_PTR(pooled[0], sl_append_cstr(pooled[0], "x", &err));
+    TEST_ASSERT_EQUAL(SL_ERR_READONLY, err);
+
+    // a second mapping at another address sees the same strings
+    int fd = sl_shm_pool_fd(pool, &err);
+    sl_shm_pool *view = sl_shm_pool_attach(fd, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(5, sl_shm_pool_count(view, &err));
+    sl_str s = sl_shm_pool_find(view, "bin\0ary", 7, &err);
+    TEST_ASSERT_NOT_NULL(s);
+    TEST_ASSERT_TRUE(s != pooled[4]);
+    TEST_ASSERT_TRUE(sl_eq(s, pooled[4], &err));
+    TEST_ASSERT_NULL(sl_shm_pool_add(view, "x", 1, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_READONLY, err);
+
+    // strings added later show up after a refresh
+    sl_shm_pool_add(pool, "DELETE", 6, &err);
+    TEST_ASSERT_NULL(sl_shm_pool_find(view, "DELETE", 6, &err));
+    sl_shm_pool_refresh(view, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_STRING("DELETE", sl_shm_pool_find(view, "DELETE", 6, &err));
+    sl_shm_pool_free(&view, &err);
+    TEST_ASSERT_NULL(view);
+
+    // a forked worker maps it read-only
+    pid_t pid = fork();
+    TEST_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        sl_shm_pool *child = sl_shm_pool_attach(fd, NULL);
+        int ok = child && sl_shm_pool_count(child, NULL) == 6 &&
+                 sl_shm_pool_find(child, "/index.html", 11, NULL) != NULL &&
+                 sl_shm_pool_find(child, "PUT", 3, NULL) == NULL;
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    TEST_ASSERT_EQUAL(pid, waitpid(pid, &status, 0));
+    TEST_ASSERT_TRUE(WIFEXITED(status));
+    TEST_ASSERT_EQUAL(0, WEXITSTATUS(status));
+
+    // full pool
+    sl_shm_pool *small = sl_shm_pool_new(96, &err); // room for one record
+    TEST_ASSERT_NOT_NULL(sl_shm_pool_add(small, "ab", 2, &err));
+    TEST_ASSERT_NULL(sl_shm_pool_add(small, "cd", 2, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_ALLOC, err);
+    sl_shm_pool_free(&small, NULL);
+
+    TEST_ASSERT_NULL(sl_shm_pool_attach(-1, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_IO, err);
+
+    sl_shm_pool_free(&pool, &err);
+    TEST_ASSERT_NULL(pool);
+}
+#endif
+
+void test_sl_intern(void) {
+    sl_err err;
+    sl_intern *t = sl_intern_new(&err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    // enough strings to grow the table a few times
+    char buf[32];
+    sl_str first[1000];
+    for (int i = 0; i < 1000; i++) {
+        int len = snprintf(buf, sizeof(buf), "ident_%d", i);
+        first[i] = sl_intern_bytes(t, buf, (size_t)len, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+    }
+    TEST_ASSERT_EQUAL_size_t(1000, sl_intern_count(t, &err));
+
+    sl_str s = sl_from_cstr("ident_42", &err);
+    TEST_ASSERT_EQUAL_PTR(first[42], sl_intern_str(t, s, &err));
+    TEST_ASSERT_EQUAL_PTR(first[42], sl_intern_find(t, "ident_42", 8, &err));
+    TEST_ASSERT_NULL(sl_intern_find(t, "ident_1000", 10, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_free(&s, NULL);
+    sl_str empty = sl_intern_bytes(t, NULL, 0, &err);
+    TEST_ASSERT_EQUAL_STRING("", empty);
+
+    // interned strings are owned by the table
+    sl_str alias = first[0];
+    TEST_ASSERT_EQUAL_PTR(alias, sl_append_cstr(alias, "x", &err));
+    TEST_ASSERT_EQUAL(SL_ERR_READONLY, err);
+    sl_free(&alias, NULL);
+    TEST_ASSERT_EQUAL_STRING("ident_0", first[0]);
+
+#ifdef SL_HAVE_POSIX
+    char path[] = "/tmp/sl_intern_XXXXXX";
+    int fd = mkstemp(path);
+    close(fd);
+    sl_intern_snapshot(t, path, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    sl_intern *r = sl_intern_restore(path, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NOT_NULL(r);
+    TEST_ASSERT_EQUAL_size_t(1001, sl_intern_count(r, &err));
+    for (int i = 0; i < 1000; i++) {
+        int len = snprintf(buf, sizeof(buf), "ident_%d", i);
+        sl_str got = sl_intern_find(r, buf, (size_t)len, &err);
+        TEST_ASSERT_NOT_NULL(got);
+        TEST_ASSERT_TRUE(sl_eq(got, first[i], &err));
+        TEST_ASSERT_EQUAL_PTR(got, sl_intern_bytes(r, buf, (size_t)len, &err));
+    }
+    TEST_ASSERT_EQUAL_size_t(1001, sl_intern_count(r, &err));
+
+    // a restored table keeps growing (past its mapped slot array)
+    for (int i = 1000; i < 3000; i++) {
+        int len = snprintf(buf, sizeof(buf), "ident_%d", i);
+        TEST_ASSERT_NOT_NULL(sl_intern_bytes(r, buf, (size_t)len, &err));
+    }
+    TEST_ASSERT_EQUAL_size_t(3001, sl_intern_count(r, &err));
+    TEST_ASSERT_EQUAL_STRING("ident_7", sl_intern_find(r, "ident_7", 7, &err));
+    TEST_ASSERT_EQUAL_STRING("ident_2999", sl_intern_find(r, "ident_2999", 10, &err));
+
+    // and can be snapshotted again
+    sl_intern_snapshot(r, path, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_intern_free(&r, &err);
+    TEST_ASSERT_NULL(r);
+    r = sl_intern_restore(path, &err);
+    TEST_ASSERT_EQUAL_size_t(3001, sl_intern_count(r, &err));
+    TEST_ASSERT_EQUAL_STRING("ident_2999", sl_intern_find(r, "ident_2999", 10, &err));
+    sl_intern_free(&r, NULL);
+
+    // damaged snapshots: a count that disagrees with the slots, or no empty
+    // slot left (a lookup would never stop); the header is
+    // magic[8] | hdr_size | endian | count @16 | slots @24 | slots_off @32
+    fd = open(path, O_RDWR);
+    uint64_t count = 3000, nslots, slots_off;
+    TEST_ASSERT_EQUAL(8, pread(fd, &nslots, 8, 24));
+    TEST_ASSERT_EQUAL(8, pread(fd, &slots_off, 8, 32));
+    TEST_ASSERT_EQUAL(8, pwrite(fd, &count, 8, 16));
+    TEST_ASSERT_NULL(sl_intern_restore(path, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    uint64_t bogus = 64;
+    for (uint64_t i = 0; i < nslots; i++)
+        TEST_ASSERT_EQUAL(8, pwrite(fd, &bogus, 8, (off_t)(slots_off + i * 8)));
+    count = nslots / 2;
+    TEST_ASSERT_EQUAL(8, pwrite(fd, &count, 8, 16));
+    close(fd);
+    TEST_ASSERT_NULL(sl_intern_restore(path, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+
+    unlink(path);
+    TEST_ASSERT_NULL(sl_intern_restore(path, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_IO, err);
+#endif
+
+    sl_intern_free(&t, &err);
+    TEST_ASSERT_NULL(t);
+}
+
+void test_sl_frame(void) {
+    sl_err err;
+
+    // every split point of a pipelined RESP stream
+    static const char wire[] = "$5\r\nhello\r\n$0\r\n\r\n$7\r\nbin\0ary\r\n";
+    size_t wire_len = sizeof(wire) - 1;
+    for (size_t split = 0; split <= wire_len; split++) {
+        sl_frame_decoder *dec = sl_frame_decoder_new(SL_FRAME_RESP, 0, &err);
+        sl_frame_feed(dec, wire, split, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        sl_frame_feed(dec, wire + split, wire_len - split, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+
+        sl_str f = sl_frame_next(dec, &err);
+        TEST_ASSERT_EQUAL_STRING("hello", f);
+        TEST_ASSERT_EQUAL_UINT64(sl_compute_hash_cstr("hello"), sl_hash(f, NULL));
+        sl_free(&f, NULL);
+        f = sl_frame_next(dec, &err);
+        TEST_ASSERT_EQUAL_size_t(0, sl_len(f, NULL));
+        sl_free(&f, NULL);
+        f = sl_frame_next(dec, &err);
+        TEST_ASSERT_EQUAL_size_t(7, sl_len(f, NULL));
+        TEST_ASSERT_EQUAL_MEMORY("bin\0ary", f, 7);
+        TEST_ASSERT_EQUAL_UINT64(sl_compute_hash("bin\0ary", 7), sl_hash(f, NULL));
+        sl_free(&f, NULL);
+        TEST_ASSERT_NULL(sl_frame_next(dec, &err));
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        sl_frame_decoder_free(&dec, NULL);
+    }
+
+    // malformed input and size limit; errors are sticky
+    sl_frame_decoder *dec = sl_frame_decoder_new(SL_FRAME_NETSTRING, 0, &err);
+    sl_frame_feed(dec, "3:abc,2:xyz", 11, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    sl_frame_feed(dec, "1:a,", 4, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    sl_str f = sl_frame_next(dec, &err);
+    TEST_ASSERT_EQUAL_STRING("abc", f);
+    sl_free(&f, NULL);
+    sl_frame_decoder_free(&dec, NULL);
+
+    dec = sl_frame_decoder_new(SL_FRAME_NETSTRING, 0, &err);
+    sl_frame_feed(dec, "1x:a,", 5, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    sl_frame_decoder_free(&dec, NULL);
+
+    dec = sl_frame_decoder_new(SL_FRAME_NETSTRING, 0, &err);
+    sl_frame_feed(dec, "0:,", 3, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_frame_feed(dec, "01:a,", 5, &err); // leading zero
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    sl_frame_decoder_free(&dec, NULL);
+
+    dec = sl_frame_decoder_new(SL_FRAME_NETSTRING, 4, &err);
+    sl_frame_feed(dec, "5:", 2, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_frame_decoder_free(&dec, NULL);
+
+    // the default limit applies before any allocation, unlimited is explicit
+    dec = sl_frame_decoder_new(SL_FRAME_RESP, 0, &err);
+    sl_frame_feed(dec, "$67108865\r\n", 12, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_frame_decoder_free(&dec, NULL);
+    dec = sl_frame_decoder_new(SL_FRAME_RESP, SL_FRAME_UNLIMITED, &err);
+    sl_frame_feed(dec, "$67108865\r\n", 12, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_frame_decoder_free(&dec, NULL);
+
+#ifdef SL_HAVE_POSIX
+    // round trip through writev over a socketpair
+    int sv[2];
+    TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sv));
+    sl_str out[300];
+    char buf[64];
+    for (int i = 0; i < 300; i++) {
+        int len = snprintf(buf, sizeof(buf), "message %d", i * 7919);
+        out[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+
+    for (int fmt = SL_FRAME_NETSTRING; fmt <= SL_FRAME_RESP; fmt++) {
+        sl_frame_writev(sv[0], (sl_frame_format)fmt, out, 300, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+
+        dec = sl_frame_decoder_new((sl_frame_format)fmt, 0, &err);
+        int got = 0;
+        while (got < 300) {
+            ssize_t n = read(sv[1], buf, 13); // odd chunk size on purpose
+            TEST_ASSERT_TRUE(n > 0);
+            sl_frame_feed(dec, buf, (size_t)n, &err);
+            TEST_ASSERT_EQUAL(SL_OK, err);
+            for (sl_str s; (s = sl_frame_next(dec, NULL)); got++) {
+                TEST_ASSERT_TRUE(sl_eq(s, out[got], NULL));
+                sl_free(&s, NULL);
+            }
+        }
+        sl_frame_decoder_free(&dec, NULL);
+    }
+
+    for (int i = 0; i < 300; i++)
+        sl_free(&out[i], NULL);
+    close(sv[0]);
+    close(sv[1]);
+#endif
+}
+
+void test_sl_varint(void) {
+    sl_err err;
+    sl_str s = sl_from_bytes("", 0, &err);
+
+    s = sl_append_varint_u64(s, 300, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_MEMORY("\xAC\x02", s, 2);
+    s = sl_append_varint_u64(s, UINT64_MAX, &err);
+    s = sl_append_zigzag_i64(s, -1, &err);
+    s = sl_append_zigzag_i64(s, INT64_MIN, &err);
+    TEST_ASSERT_EQUAL_size_t(2 + 10 + 1 + 10, sl_len(s, NULL));
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(s, 23), sl_hash(s, NULL));
+
+    size_t pos = 0;
+    TEST_ASSERT_EQUAL_UINT64(300, sl_read_varint_u64(s, &pos, &err));
+    TEST_ASSERT_EQUAL_UINT64(UINT64_MAX, sl_read_varint_u64(s, &pos, &err));
+    TEST_ASSERT_EQUAL_INT64(-1, sl_read_zigzag_i64(s, &pos, &err));
+    TEST_ASSERT_EQUAL_INT64(INT64_MIN, sl_read_zigzag_i64(s, &pos, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(23, pos);
+    TEST_ASSERT_EQUAL_UINT64(0, sl_read_varint_u64(s, &pos, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_free(&s, NULL);
+
+    // bulk round trip
+    uint64_t vals[200], back[256];
+    for (int i = 0; i < 200; i++)
+        vals[i] = (i % 3 == 0) ? (uint64_t)i : (1ULL << (i % 64)) + (uint64_t)i;
+    s = sl_from_cstr("hdr", &err);
+    s = sl_append_varints(s, vals, 200, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(s, sl_len(s, NULL)), sl_hash(s, NULL));
+    pos = 3;
+    TEST_ASSERT_EQUAL_size_t(200, sl_read_varints(s, &pos, back, 256, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(sl_len(s, NULL), pos);
+    TEST_ASSERT_EQUAL_MEMORY(vals, back, sizeof(vals));
+    sl_free(&s, NULL);
+
+    // truncated and overlong input
+    s = sl_from_bytes("\x01\x80\x80", 3, &err);
+    pos = 0;
+    TEST_ASSERT_EQUAL_size_t(1, sl_read_varints(s, &pos, back, 8, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    TEST_ASSERT_EQUAL_size_t(1, pos);
+    sl_free(&s, NULL);
+
+    s = sl_from_bytes("\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\xFF\x02", 10, &err);
+    pos = 0;
+    sl_read_varint_u64(s, &pos, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+    TEST_ASSERT_EQUAL_size_t(0, pos);
+    sl_free(&s, NULL);
+}
+
+static int cmp_cstr(const void *a, const void *b) {
+    return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+void test_sl_fcset(void) {
+    sl_err err;
+    // prefixes of each other, shared prefixes and an empty key
+    static const char *base[] = {"", "a", "ab", "abc", "abd", "b", "/usr/bin/cc", "/usr/bin/ld", "/usr/lib"};
+    char *keys[9 + 120];
+    char storage[120][32];
+    size_t n = 0;
+    for (size_t i = 0; i < 9; i++)
+        keys[n++] = (char *)base[i];
+    for (int i = 0; i < 120; i++) {
+        snprintf(storage[i], sizeof(storage[i]), "/srv/%02d/file_%03d.log", i % 7, i);
+        keys[n++] = storage[i];
+    }
+    qsort(keys, n, sizeof(keys[0]), cmp_cstr);
+
+    sl_str strs[9 + 120];
+    for (size_t i = 0; i < n; i++)
+        strs[i] = sl_from_cstr(keys[i], NULL);
+
+    sl_fcset *set = sl_fcset_build(strs, n, 4, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(n, sl_fcset_count(set, NULL));
+    TEST_ASSERT_TRUE(sl_fcset_memory(set, NULL) > 0);
+
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_TRUE(sl_fcset_contains(set, keys[i], strlen(keys[i]), &err));
+        TEST_ASSERT_EQUAL_size_t(i, sl_fcset_lower_bound(set, keys[i], strlen(keys[i]), NULL));
+    }
+
+    // keys that fall between members
+    static const char *missing[] = {"aa", "abcd", "ac", "/srv/03/file", "/srv/06/file_999.log", "/usr/bin", "c", "\x01"};
+    for (size_t i = 0; i < sizeof(missing) / sizeof(missing[0]); i++) {
+        size_t len = strlen(missing[i]);
+        TEST_ASSERT_FALSE(sl_fcset_contains(set, missing[i], len, &err));
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        size_t expect = 0;
+        while (expect < n && strcmp(keys[expect], missing[i]) < 0)
+            expect++;
+        TEST_ASSERT_EQUAL_size_t(expect, sl_fcset_lower_bound(set, missing[i], len, NULL));
+    }
+
+    // sequential decode from every start position
+    for (size_t start = 0; start <= n; start++) {
+        sl_fcset_iter *it = sl_fcset_iter_new(set, start, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        sl_view v;
+        size_t i = start;
+        while (sl_fcset_iter_next(it, &v, NULL)) {
+            TEST_ASSERT_EQUAL_size_t(strlen(keys[i]), v.len);
+            if (v.len)
+                TEST_ASSERT_EQUAL_MEMORY(keys[i], v.data, v.len);
+            i++;
+        }
+        TEST_ASSERT_EQUAL_size_t(n, i);
+        sl_fcset_iter_free(&it, NULL);
+        TEST_ASSERT_NULL(it);
+    }
+    TEST_ASSERT_NULL(sl_fcset_iter_new(set, n + 1, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_fcset_free(&set, NULL);
+    TEST_ASSERT_NULL(set);
+
+    // unsorted or repeated keys
+    sl_str swapped[2] = {strs[1], strs[0]};
+    TEST_ASSERT_NULL(sl_fcset_build(swapped, 2, 0, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    sl_str repeated[2] = {strs[3], strs[3]};
+    TEST_ASSERT_NULL(sl_fcset_build(repeated, 2, 0, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    // empty set
+    set = sl_fcset_build(NULL, 0, 0, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_FALSE(sl_fcset_contains(set, "", 0, NULL));
+    TEST_ASSERT_EQUAL_size_t(0, sl_fcset_lower_bound(set, "x", 1, NULL));
+    sl_fcset_free(&set, NULL);
+
+    for (size_t i = 0; i < n; i++)
+        sl_free(&strs[i], NULL);
+}
+
+static void assert_lz_round_trip(const void *bytes, size_t len) {
+    sl_err err;
+    sl_str s = sl_from_bytes(bytes, len, NULL);
+    sl_str c = sl_compress(s, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(sl_is_compressed(c, NULL));
+    TEST_ASSERT_TRUE(sl_len(c, NULL) <= len + 11);
+    sl_str d = sl_decompress(c, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_FALSE(sl_is_compressed(d, NULL));
+    TEST_ASSERT_TRUE(sl_eq(s, d, NULL));
+    sl_free(&d, NULL);
+    sl_free(&c, NULL);
+    sl_free(&s, NULL);
+}
+
+// every frame is checksummed: a flipped bit fails, or still decodes to the
+// original with its hash (an LZ offset can change into one copying the same bytes)
+static void assert_damage_detected(const sl_symtab *tab, sl_str c, sl_str orig) {
+    sl_err err;
+    size_t clen = sl_len(c, NULL);
+    for (size_t i = 0; i < clen; i++) {
+        for (int bit = 0; bit < 8; bit += 3) {
+            c[i] ^= (char)(1 << bit);
+            sl_str d = sl_decompress_with(tab, c, &err);
+            if (err == SL_OK) {
+                TEST_ASSERT_TRUE(sl_eq(d, orig, NULL));
+                TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(d, sl_len(d, NULL)), sl_hash(d, NULL));
+            } else {
+                TEST_ASSERT_EQUAL(SL_ERR_FORMAT, err);
+                TEST_ASSERT_NULL(d);
+            }
+            sl_free(&d, NULL);
+            c[i] ^= (char)(1 << bit);
+        }
+    }
+}
+
+void test_sl_compress(void) {
+    sl_err err;
+    static char buf[70000];
+
+    assert_lz_round_trip("", 0);
+    assert_lz_round_trip("abc", 3);
+    assert_lz_round_trip("abcdabcdabcd", 12);
+    assert_lz_round_trip("abcdabcdabcda", 13);
+    memset(buf, 'a', 1000); // offset 1 overlapping match
+    assert_lz_round_trip(buf, 1000);
+    for (size_t i = 0; i < sizeof(buf); i++) // matches further than 64 KB
+        buf[i] = (char)((i * 2654435761u) >> 13);
+    memcpy(buf + 66000, buf, 4000);
+    assert_lz_round_trip(buf, sizeof(buf));
+
+    // repetitive text shrinks
+    sl_str s = sl_from_cstr("", NULL);
+    for (int i = 0; i < 200; i++) {
+        char line[64];
+        snprintf(line, sizeof(line), "GET /api/v1/items/%d HTTP/1.1 200\n", i);
+        s = sl_append_cstr(s, line, NULL);
+    }
+    sl_str c = sl_compress(s, &err);
+    TEST_ASSERT_TRUE(sl_len(c, NULL) * 3 < sl_len(s, NULL));
+
+    // compressed strings are read-only and can't be compressed twice
+    TEST_ASSERT_EQUAL_PTR(c, sl_append_cstr(c, "x", &err));
+    TEST_ASSERT_EQUAL(SL_ERR_READONLY, err);
+    TEST_ASSERT_NULL(sl_compress(c, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    TEST_ASSERT_NULL(sl_decompress(s, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    // damaged frames fail cleanly (the LZ loop also covers the stored hash),
+    // and the restored hash of a good frame is the real one
+    sl_str d = sl_decompress(c, &err);
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_hash(d, sl_len(d, NULL)), sl_hash(d, NULL));
+    sl_free(&d, NULL);
+    assert_damage_detected(NULL, c, s);
+    sl_free(&c, NULL);
+    sl_free(&s, NULL);
+    s = sl_from_cstr("abc", NULL);
+    c = sl_compress(s, &err); // stored
+    assert_damage_detected(NULL, c, s);
+    sl_free(&c, NULL);
+    sl_free(&s, NULL);
+
+    // trained symbol table for short strings
+    sl_str sample[300];
+    for (int i = 0; i < 300; i++) {
+        char line[64];
+        snprintf(line, sizeof(line), "https://www.example.com/user/%d/profile", i * 7);
+        sample[i] = sl_from_cstr(line, NULL);
+    }
+    sl_symtab *tab = sl_symtab_train(sample, 300, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    size_t raw = 0, packed = 0;
+    for (int i = 0; i < 300; i++) {
+        c = sl_compress_with(tab, sample[i], &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        raw += sl_len(sample[i], NULL);
+        packed += sl_len(c, NULL);
+
+        sl_str d = sl_decompress_with(tab, c, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_TRUE(sl_eq(sample[i], d, NULL));
+        sl_free(&d, NULL);
+        if (i == 0) {
+            TEST_ASSERT_NULL(sl_decompress(c, &err));
+            TEST_ASSERT_EQUAL(SL_ERR_NULL, err);
+            assert_damage_detected(tab, c, sample[i]);
+        }
+        sl_free(&c, NULL);
+    }
+    TEST_ASSERT_TRUE(packed * 2 < raw);
+
+    // bytes never seen in training are escaped
+    s = sl_from_bytes("\x00\xff\x01 zzz", 7, NULL);
+    c = sl_compress_with(tab, s, &err);
+    d = sl_decompress_with(tab, c, &err);
+    TEST_ASSERT_TRUE(sl_eq(s, d, NULL));
+    sl_free(&d, NULL);
+    sl_free(&c, NULL);
+    sl_free(&s, NULL);
+
+    sl_symtab_free(&tab, NULL);
+    TEST_ASSERT_NULL(tab);
+    for (int i = 0; i < 300; i++)
+        sl_free(&sample[i], NULL);
+}
+
+void test_sl_dict_column(void) {
+    sl_err err;
+    static const char *names[] = {"US", "DE", "", "FR"};
+    sl_str vals[4];
+    for (int i = 0; i < 4; i++)
+        vals[i] = sl_from_cstr(names[i], NULL);
+
+    sl_dict_column *col = sl_dict_column_new(&err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    // runs, a block of 8 equal rows and a tail that is not a multiple of 8
+    enum { ROWS = 1003 };
+    static sl_str rows[ROWS];
+    static int expect[ROWS];
+    for (int i = 0; i < ROWS; i++) {
+        expect[i] = (i >= 16 && i < 40) ? 1 : (i * 7 / 5) % 4;
+        rows[i] = vals[expect[i]];
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, sl_dict_column_append(col, vals[0], &err));
+    TEST_ASSERT_EQUAL_size_t(ROWS - 1, sl_dict_column_append_many(col, rows + 1, ROWS - 1, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(ROWS, sl_dict_column_rows(col, NULL));
+    TEST_ASSERT_EQUAL_size_t(4, sl_dict_column_cardinality(col, NULL));
+
+    // a different string with the same bytes gets the same code
+    sl_str de = sl_from_cstr("DE", NULL);
+    uint32_t de_code = sl_dict_column_code(col, "DE", 2, NULL);
+    TEST_ASSERT_EQUAL_UINT32(de_code, sl_dict_column_append(col, de, &err));
+    TEST_ASSERT_EQUAL_size_t(4, sl_dict_column_cardinality(col, NULL));
+    sl_free(&de, NULL);
+    expect[0] = 0;
+
+    size_t n;
+    const uint32_t *codes = sl_dict_column_codes(col, &n, NULL);
+    TEST_ASSERT_EQUAL_size_t(ROWS + 1, n);
+    for (int i = 0; i < ROWS; i++) {
+        sl_view v = sl_dict_column_get(col, (size_t)i, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_EQUAL_size_t(strlen(names[expect[i]]), v.len);
+        if (v.len)
+            TEST_ASSERT_EQUAL_MEMORY(names[expect[i]], v.data, v.len);
+        TEST_ASSERT_EQUAL_UINT32(sl_dict_column_code(col, names[expect[i]], v.len, NULL), codes[i]);
+    }
+    sl_dict_column_get(col, ROWS + 1, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_dict_column_value(col, 4, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+
+    // equality filter against a brute force scan
+    static size_t out[ROWS + 1];
+    for (int v = 0; v < 4; v++) {
+        size_t want = 0;
+        for (int i = 0; i < ROWS; i++)
+            want += expect[i] == v;
+        want += v == 1; // the "DE" row appended last
+        TEST_ASSERT_EQUAL_size_t(want, sl_dict_column_filter_eq(col, names[v], strlen(names[v]), NULL, &err));
+        TEST_ASSERT_EQUAL_size_t(want, sl_dict_column_filter_eq(col, names[v], strlen(names[v]), out, &err));
+        for (size_t k = 0; k < want; k++) {
+            TEST_ASSERT_EQUAL_UINT32(codes[out[k]], sl_dict_column_code(col, names[v], strlen(names[v]), NULL));
+            if (k > 0)
+                TEST_ASSERT_TRUE(out[k] > out[k - 1]);
+        }
+    }
+    TEST_ASSERT_EQUAL_size_t(0, sl_dict_column_filter_eq(col, "JP", 2, out, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_UINT32(SL_DICT_NONE, sl_dict_column_code(col, "JP", 2, NULL));
+
+    // a bad value adds no row
+    sl_str bad[2] = {vals[0], NULL};
+    TEST_ASSERT_EQUAL_size_t(0, sl_dict_column_append_many(col, bad, 2, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_NULL, err);
+    TEST_ASSERT_EQUAL_size_t(ROWS + 1, sl_dict_column_rows(col, NULL));
+
+    // many distinct values grow the index
+    for (int i = 0; i < 500; i++) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "v%d", i);
+        sl_str s = sl_from_cstr(buf, NULL);
+        sl_dict_column_append(col, s, NULL);
+        sl_free(&s, NULL);
+    }
+    TEST_ASSERT_EQUAL_size_t(504, sl_dict_column_cardinality(col, NULL));
+    TEST_ASSERT_EQUAL_UINT32(4 + 250, sl_dict_column_code(col, "v250", 4, NULL));
+    TEST_ASSERT_TRUE(sl_dict_column_memory(col, NULL) > (ROWS + 501) * sizeof(uint32_t));
+
+    sl_dict_column_free(&col, NULL);
+    TEST_ASSERT_NULL(col);
+    for (int i = 0; i < 4; i++)
+        sl_free(&vals[i], NULL);
+}
+
+typedef struct {
+    unsigned char bytes[48];
+    size_t len;
+} radix_key;
+
+static size_t radix_gen(unsigned char *out, unsigned *seed) {
+    static const char *stems[] = {"", "/api/v1/", "/api/v1/users/", "/static/assets/images/", "x"};
+    *seed = *seed * 1103515245u + 12345u;
+    const char *stem = stems[(*seed >> 16) % 5];
+    size_t len = strlen(stem);
+    memcpy(out, stem, len);
+    *seed = *seed * 1103515245u + 12345u;
+    size_t extra = (*seed >> 16) % 6;
+    for (size_t i = 0; i < extra; i++) {
+        *seed = *seed * 1103515245u + 12345u;
+        // a small alphabet (with a zero byte) for shared prefixes, any byte after "x"
+        out[len++] = stem[0] == 'x' ? (unsigned char)(*seed >> 16) : "ab/\0"[(*seed >> 16) % 4];
+    }
+    return len;
+}
+
+static int radix_key_cmp(const void *a, size_t alen, const void *b, size_t blen) {
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    return c ? c : (alen > blen) - (alen < blen);
+}
+
+typedef struct {
+    const unsigned char *prefix;
+    size_t len;
+    size_t seen;
+    unsigned char last[48];
+    size_t last_len;
+    bool ordered;
+} radix_walk;
+
+static bool radix_visit(sl_view key, void *value, void *ctx) {
+    radix_walk *w = ctx;
+    (void)value;
+    if (key.len < w->len || memcmp(key.data, w->prefix, w->len) != 0 ||
+        (w->seen && radix_key_cmp(w->last, w->last_len, key.data, key.len) >= 0))
+        w->ordered = false;
+    memcpy(w->last, key.data, key.len);
+    w->last_len = key.len;
+    return ++w->seen < 1000000;
+}
+
+static bool radix_stop(sl_view key, void *value, void *ctx) {
+    (void)key;
+    (void)value;
+    return ++*(size_t *)ctx < 3;
+}
+
+void test_sl_radix(void) {
+    sl_err err;
+    sl_radix *t = sl_radix_new(&err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    enum { N = 3000 };
+    static radix_key keys[N];
+    unsigned seed = 7;
+    for (int i = 0; i < N; i++) {
+        keys[i].len = radix_gen(keys[i].bytes, &seed);
+        sl_radix_insert(t, keys[i].bytes, keys[i].len, (void *)(uintptr_t)(i + 1), &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+    }
+
+    // distinct keys, with the value of the last insertion
+    size_t distinct = 0;
+    for (int i = 0; i < N; i++) {
+        bool later = false;
+        for (int j = i + 1; j < N && !later; j++)
+            later = keys[j].len == keys[i].len && memcmp(keys[j].bytes, keys[i].bytes, keys[i].len) == 0;
+        if (later)
+            continue;
+        distinct++;
+        void *value = NULL;
+        TEST_ASSERT_TRUE(sl_radix_get(t, keys[i].bytes, keys[i].len, &value, &err));
+        TEST_ASSERT_EQUAL_PTR((void *)(uintptr_t)(i + 1), value);
+    }
+    TEST_ASSERT_EQUAL_size_t(distinct, sl_radix_count(t, NULL));
+    TEST_ASSERT_FALSE(sl_radix_get(t, "/api/v1/users/zz", 16, NULL, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_FALSE(sl_radix_get(t, "/static/assets/imageZ", 21, NULL, NULL));
+
+    // string keys use their full length, embedded zeros included
+    sl_str bin = sl_from_bytes("k\0\0v", 4, NULL);
+    sl_radix_insert_str(t, bin, t, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    void *value = NULL;
+    TEST_ASSERT_TRUE(sl_radix_get_str(t, bin, &value, NULL));
+    TEST_ASSERT_EQUAL_PTR(t, value);
+    TEST_ASSERT_FALSE(sl_radix_get(t, "k", 1, NULL, NULL));
+    sl_free(&bin, NULL);
+
+    // longest-prefix match against a brute force scan
+    for (int q = 0; q < 2000; q++) {
+        unsigned char query[96];
+        size_t qlen = radix_gen(query, &seed);
+        qlen += radix_gen(query + qlen, &seed);
+        size_t best_len = 0;
+        int best = -1;
+        for (int i = 0; i < N; i++)
+            if (keys[i].len <= qlen && memcmp(keys[i].bytes, query, keys[i].len) == 0 &&
+                (best < 0 || keys[i].len >= best_len)) {
+                best = i;
+                best_len = keys[i].len;
+            }
+        size_t match_len = 0;
+        value = NULL;
+        bool found = sl_radix_longest_prefix(t, query, qlen, &match_len, &value, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_EQUAL(best >= 0, found);
+        if (found) {
+            TEST_ASSERT_EQUAL_size_t(best_len, match_len);
+            TEST_ASSERT_EQUAL_PTR((void *)(uintptr_t)(best + 1), value);
+        }
+    }
+
+    // prefix iteration visits exactly the matching keys, in byte order
+    static const char *prefixes[] = {"", "/", "/api/v1/", "/api/v1/users/a", "/static/assets/images/b\0", "x", "zz"};
+    static const size_t prefix_lens[] = {0, 1, 8, 15, 24, 1, 2};
+    for (int p = 0; p < 7; p++) {
+        radix_walk w = {(const unsigned char *)prefixes[p], prefix_lens[p], 0, {0}, 0, true};
+        size_t visited = sl_radix_each_prefix(t, prefixes[p], prefix_lens[p], radix_visit, &w, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        TEST_ASSERT_TRUE(w.ordered);
+        TEST_ASSERT_EQUAL_size_t(w.seen, visited);
+
+        size_t expect = 0;
+        for (int i = 0; i < N; i++) {
+            bool later = false;
+            for (int j = i + 1; j < N && !later; j++)
+                later = keys[j].len == keys[i].len && memcmp(keys[j].bytes, keys[i].bytes, keys[i].len) == 0;
+            expect += !later && keys[i].len >= prefix_lens[p] &&
+                      memcmp(keys[i].bytes, prefixes[p], prefix_lens[p]) == 0;
+        }
+        if (p == 0)
+            expect++; // the binary key
+        TEST_ASSERT_EQUAL_size_t(expect, visited);
+    }
+    size_t stopped = 0;
+    TEST_ASSERT_EQUAL_size_t(3, sl_radix_each_prefix(t, "/", 1, radix_stop, &stopped, NULL));
+
+    sl_radix_insert(t, NULL, 1, NULL, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_NULL, err);
+    sl_radix_free(&t, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_NULL(t);
+}
+
+static int btree_cmp(sl_str a, const char *b, size_t blen) {
+    size_t alen = sl_len(a, NULL);
+    int c = memcmp(a, b, alen < blen ? alen : blen);
+    return c ? c : (alen > blen) - (alen < blen);
+}
+
+static int btree_sort_cmp(const void *a, const void *b) {
+    sl_str y = *(const sl_str *)b;
+    return btree_cmp(*(const sl_str *)a, y, sl_len(y, NULL));
+}
+
+/**
+ * Check that a range iterator yields exactly the sorted keys in [lo, hi)
+ */
+static size_t btree_check_range(const sl_btree *t, const sl_str *sorted, size_t n, const char *lo, size_t lo_len,
+                                const char *hi, size_t hi_len) {
+    sl_err err;
+    sl_btree_iter *it = sl_btree_range(t, lo, lo_len, hi, hi_len, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    size_t i = 0, seen = 0;
+    while (i < n && lo && btree_cmp(sorted[i], lo, lo_len) < 0)
+        i++;
+    sl_view key;
+    void *value;
+    while (sl_btree_iter_next(it, &key, &value, &err)) {
+        TEST_ASSERT_TRUE(i < n);
+        TEST_ASSERT_TRUE(!hi || btree_cmp(sorted[i], hi, hi_len) < 0);
+        TEST_ASSERT_EQUAL_size_t(sl_len(sorted[i], NULL), key.len);
+        if (key.len)
+            TEST_ASSERT_EQUAL_MEMORY(sorted[i], key.data, key.len);
+        TEST_ASSERT_EQUAL_PTR(sorted[i], value);
+        i++;
+        seen++;
+    }
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(i == n || (hi && btree_cmp(sorted[i], hi, hi_len) >= 0));
+    TEST_ASSERT_FALSE(sl_btree_iter_next(it, NULL, NULL, NULL));
+    sl_btree_iter_free(&it, NULL);
+    return seen;
+}
+
+void test_sl_btree(void) {
+    sl_err err;
+
+    // keys sharing their first 8 bytes, short keys, zero bytes
+    enum { N = 6000 };
+    static sl_str keys[N + 4];
+    char buf[32];
+    unsigned seed = 11;
+    for (int i = 0; i < N; i++) {
+        seed = seed * 1103515245u + 12345u;
+        unsigned r = seed >> 8;
+        int len = r % 3 == 0   ? snprintf(buf, sizeof(buf), "user:%07u", r % 100000)
+                  : r % 3 == 1 ? snprintf(buf, sizeof(buf), "%u", r % 1000)
+                               : snprintf(buf, sizeof(buf), "user:%03u", r % 1000);
+        keys[i] = sl_from_bytes(buf, (size_t)len, NULL);
+    }
+    keys[N] = sl_from_bytes("", 0, NULL);
+    keys[N + 1] = sl_from_bytes("a", 1, NULL);
+    keys[N + 2] = sl_from_bytes("a\0", 2, NULL);
+    keys[N + 3] = sl_from_bytes("user:000\0\0x", 11, NULL);
+
+    // sorted distinct copy
+    static sl_str sorted[N + 4];
+    memcpy(sorted, keys, sizeof(keys));
+    qsort(sorted, N + 4, sizeof(*sorted), btree_sort_cmp);
+    size_t n = 0;
+    for (size_t i = 0; i < N + 4; i++)
+        if (n == 0 || btree_sort_cmp(&sorted[n - 1], &sorted[i]) != 0)
+            sorted[n++] = sorted[i];
+
+    // insert in generation order, then once more with the final values
+    sl_btree *t = sl_btree_new(&err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    for (int i = 0; i < N + 4; i++) {
+        sl_btree_insert(t, keys[i], NULL, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+    }
+    for (size_t i = 0; i < n; i++)
+        sl_btree_insert(t, sorted[i], sorted[i], NULL);
+    TEST_ASSERT_EQUAL_size_t(n, sl_btree_count(t, NULL));
+
+    for (size_t i = 0; i < n; i++) {
+        void *value = NULL;
+        TEST_ASSERT_TRUE(sl_btree_get_str(t, sorted[i], &value, &err));
+        TEST_ASSERT_EQUAL_PTR(sorted[i], value);
+    }
+    TEST_ASSERT_FALSE(sl_btree_get(t, "user:0000000x", 13, NULL, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_FALSE(sl_btree_get(t, "a\0\0", 3, NULL, NULL));
+    TEST_ASSERT_FALSE(sl_btree_get(t, "zz", 2, NULL, NULL));
+
+    // full scan and ranges, including bounds between and beyond the keys
+    TEST_ASSERT_EQUAL_size_t(n, btree_check_range(t, sorted, n, NULL, 0, NULL, 0));
+    btree_check_range(t, sorted, n, "user:", 5, "user;", 5);
+    btree_check_range(t, sorted, n, "user:0005", 9, "user:0007", 9);
+    btree_check_range(t, sorted, n, "a", 1, "a\0", 2);
+    btree_check_range(t, sorted, n, "5", 1, "5", 1);
+    TEST_ASSERT_EQUAL_size_t(0, btree_check_range(t, sorted, n, "zz", 2, NULL, 0));
+    TEST_ASSERT_EQUAL_size_t(0, btree_check_range(t, sorted, n, NULL, 0, "", 0));
+    TEST_ASSERT_TRUE(sl_btree_memory(t, NULL) > n * 32);
+    sl_btree_free(&t, &err);
+    TEST_ASSERT_NULL(t);
+
+    // bulk load gives the same tree, and only takes strictly increasing keys
+    t = sl_btree_build(sorted, (void *const *)sorted, n, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(n, sl_btree_count(t, NULL));
+    TEST_ASSERT_EQUAL_size_t(n, btree_check_range(t, sorted, n, NULL, 0, NULL, 0));
+    btree_check_range(t, sorted, n, "user:0005", 9, "user:0007", 9);
+    sl_btree_insert(t, keys[0], NULL, NULL);
+    sl_str extra = sl_from_cstr("user:0005000x", NULL);
+    sl_btree_insert(t, extra, extra, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(n + 1, sl_btree_count(t, NULL));
+    TEST_ASSERT_TRUE(sl_btree_get(t, "user:0005000x", 13, NULL, NULL));
+    sl_free(&extra, NULL);
+    sl_btree_free(&t, NULL);
+
+    sl_str unsorted[2] = {sorted[1], sorted[0]};
+    TEST_ASSERT_NULL(sl_btree_build(unsorted, NULL, 2, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    unsorted[1] = sorted[1];
+    TEST_ASSERT_NULL(sl_btree_build(unsorted, NULL, 2, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    t = sl_btree_build(NULL, NULL, 0, &err);
+    TEST_ASSERT_EQUAL_size_t(0, btree_check_range(t, sorted, 0, NULL, 0, NULL, 0));
+    sl_btree_free(&t, NULL);
+
+    for (int i = 0; i < N + 4; i++)
+        sl_free(&keys[i], NULL);
+}
+
+typedef struct {
+    int evicted;
+    char last[16];
+} lru_log;
+
+static void lru_on_evict(sl_view key, sl_str value, void *ctx) {
+    lru_log *log = ctx;
+    log->evicted++;
+    snprintf(log->last, sizeof(log->last), "%.*s=%s", (int)key.len, key.data, value);
+    sl_free(&value, NULL);
+}
+
+static void lru_put(sl_lru *lru, const char *key, const char *value) {
+    sl_err err;
+    sl_str k = sl_from_cstr(key, NULL);
+    sl_lru_put(lru, k, sl_from_cstr(value, NULL), &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_free(&k, NULL);
+}
+
+void test_sl_lru(void) {
+    sl_err err;
+    lru_log log = {0};
+
+    TEST_ASSERT_NULL(sl_lru_new(0, 0, NULL, NULL, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    // entry bound: the least recently used entry goes first
+    sl_lru *lru = sl_lru_new(2, 0, lru_on_evict, &log, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    lru_put(lru, "a", "1");
+    lru_put(lru, "b", "2");
+    TEST_ASSERT_EQUAL_STRING("1", sl_lru_get(lru, "a", 1, &err));
+    lru_put(lru, "c", "3");
+    TEST_ASSERT_EQUAL(1, log.evicted);
+    TEST_ASSERT_EQUAL_STRING("b=2", log.last);
+    TEST_ASSERT_NULL(sl_lru_get(lru, "b", 1, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_str key = sl_from_cstr("c", NULL);
+    TEST_ASSERT_EQUAL_STRING("3", sl_lru_get_str(lru, key, NULL));
+    sl_free(&key, NULL);
+
+    // replacing and removing release the old value
+    lru_put(lru, "a", "4");
+    TEST_ASSERT_EQUAL(2, log.evicted);
+    TEST_ASSERT_EQUAL_STRING("a=1", log.last);
+    TEST_ASSERT_TRUE(sl_lru_remove(lru, "c", 1, &err));
+    TEST_ASSERT_EQUAL_STRING("c=3", log.last);
+    TEST_ASSERT_FALSE(sl_lru_remove(lru, "c", 1, &err));
+    TEST_ASSERT_EQUAL_size_t(1, sl_lru_count(lru, NULL));
+    sl_lru_free(&lru, &err);
+    TEST_ASSERT_NULL(lru);
+    TEST_ASSERT_EQUAL(4, log.evicted);
+    TEST_ASSERT_EQUAL_STRING("a=4", log.last);
+
+    // byte bound, charged from the allocation sizes; values freed by default
+    lru = sl_lru_new(0, 1000, NULL, NULL, NULL);
+    char big[400];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    for (int i = 0; i < 50; i++) {
+        char k[8];
+        snprintf(k, sizeof(k), "%d", i);
+        lru_put(lru, k, big);
+        TEST_ASSERT_TRUE(sl_lru_bytes(lru, NULL) <= 1000);
+    }
+    TEST_ASSERT_EQUAL_size_t(2, sl_lru_count(lru, NULL));
+    TEST_ASSERT_NOT_NULL(sl_lru_get(lru, "49", 2, NULL));
+    TEST_ASSERT_NULL(sl_lru_get(lru, "47", 2, NULL));
+
+    // an entry that cannot fit is not taken
+    char huge[1200];
+    memset(huge, 'y', sizeof(huge) - 1);
+    huge[sizeof(huge) - 1] = '\0';
+    sl_str k = sl_from_cstr("huge", NULL), v = sl_from_cstr(huge, NULL);
+    sl_lru_put(lru, k, v, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_free(&k, NULL);
+    sl_free(&v, NULL);
+    sl_lru_free(&lru, NULL);
+
+    // many entries (bucket growth)
+    lru = sl_lru_new(5000, 0, NULL, NULL, NULL);
+    for (int i = 0; i < 10000; i++) {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "key%d", i);
+        lru_put(lru, buf, buf);
+    }
+    TEST_ASSERT_EQUAL_size_t(5000, sl_lru_count(lru, NULL));
+    TEST_ASSERT_NULL(sl_lru_get(lru, "key4999", 7, NULL));
+    TEST_ASSERT_EQUAL_STRING("key5000", sl_lru_get(lru, "key5000", 7, NULL));
+    sl_lru_free(&lru, NULL);
+}
+
+#ifdef SL_HAVE_POSIX
+static void *lru_worker(void *arg) {
+    sl_lru_shared *c = arg;
+    char buf[16];
+    for (int i = 0; i < 20000; i++) {
+        int len = snprintf(buf, sizeof(buf), "k%d", i % 300);
+        sl_str v = sl_lru_shared_get(c, buf, (size_t)len, NULL);
+        if (v) {
+            if (strcmp(v, buf) != 0)
+                return (void *)1;
+            sl_free(&v, NULL);
+        } else {
+            sl_str k = sl_from_bytes(buf, (size_t)len, NULL);
+            sl_lru_shared_put(c, k, sl_from_bytes(buf, (size_t)len, NULL), NULL);
+            sl_free(&k, NULL);
+        }
+        if (i % 7 == 0)
+            sl_lru_shared_remove(c, buf, (size_t)len, NULL);
+    }
+    return NULL;
+}
+
+void test_sl_lru_shared(void) {
+    // sharded cache used from several threads
+    sl_err err;
+    sl_lru_shared *c = sl_lru_shared_new(4, 200, 0, NULL, NULL, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL, lru_worker, c));
+    for (int i = 0; i < 4; i++) {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        TEST_ASSERT_NULL(ret);
+    }
+    TEST_ASSERT_TRUE(sl_lru_shared_count(c, NULL) <= 200);
+    sl_str key = sl_from_cstr("k1", NULL);
+    sl_lru_shared_put(c, key, sl_from_cstr("one", NULL), &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_str one = sl_lru_shared_get_str(c, key, &err);
+    TEST_ASSERT_EQUAL_STRING("one", one);
+    TEST_ASSERT_TRUE(sl_lru_shared_remove(c, "k1", 2, NULL));
+    TEST_ASSERT_NULL(sl_lru_shared_get_str(c, key, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_free(&one, NULL);
+    sl_free(&key, NULL);
+    sl_lru_shared_free(&c, &err);
+    TEST_ASSERT_NULL(c);
+}
+#endif
+
+void test_sl_bloom_cuckoo(void) {
+    sl_err err;
+    enum { N = 20000, PROBES = 200000 };
+    static sl_str keys[N];
+    char buf[32];
+    for (int i = 0; i < N; i++) {
+        snprintf(buf, sizeof(buf), "member:%d", i);
+        keys[i] = sl_from_cstr(buf, NULL);
+    }
+
+    TEST_ASSERT_NULL(sl_bloom_new(0, 0.01, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    TEST_ASSERT_NULL(sl_bloom_new(10, 1.0, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    // no false negatives, false positives near the target rate
+    sl_bloom *b = sl_bloom_new(N, 0.01, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    for (int i = 0; i < N; i++)
+        sl_bloom_add(b, keys[i], NULL);
+    for (int i = 0; i < N; i++)
+        TEST_ASSERT_TRUE(sl_bloom_contains(b, keys[i], NULL));
+    size_t fp = 0;
+    for (int i = 0; i < PROBES; i++) {
+        int len = snprintf(buf, sizeof(buf), "other:%d", i);
+        fp += sl_bloom_contains_hash(b, sl_compute_hash(buf, (size_t)len), NULL);
+    }
+    TEST_ASSERT_TRUE(fp < PROBES / 50);
+    TEST_ASSERT_TRUE(sl_bloom_memory(b, NULL) >= N * 9 / 8);
+    sl_bloom_free(&b, &err);
+    TEST_ASSERT_NULL(b);
+
+    sl_cuckoo *c = sl_cuckoo_new(N, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    for (int i = 0; i < N; i++) {
+        sl_cuckoo_add(c, keys[i], &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+    }
+    TEST_ASSERT_EQUAL_size_t(N, sl_cuckoo_count(c, NULL));
+    for (int i = 0; i < N; i++)
+        TEST_ASSERT_TRUE(sl_cuckoo_contains(c, keys[i], NULL));
+    fp = 0;
+    for (int i = 0; i < PROBES; i++) {
+        int len = snprintf(buf, sizeof(buf), "other:%d", i);
+        fp += sl_cuckoo_contains_hash(c, sl_compute_hash(buf, (size_t)len), NULL);
+    }
+    TEST_ASSERT_TRUE(fp < PROBES / 1000);
+
+    // removed keys are gone (up to fingerprint collisions), the others stay
+    size_t still = 0;
+    for (int i = 0; i < N; i += 2)
+        TEST_ASSERT_TRUE(sl_cuckoo_remove(c, keys[i], NULL));
+    for (int i = 0; i < N; i++) {
+        if (i % 2)
+            TEST_ASSERT_TRUE(sl_cuckoo_contains(c, keys[i], NULL));
+        else
+            still += sl_cuckoo_contains(c, keys[i], NULL);
+    }
+    TEST_ASSERT_TRUE(still < N / 200);
+    TEST_ASSERT_EQUAL_size_t(N / 2, sl_cuckoo_count(c, NULL));
+    sl_cuckoo_free(&c, NULL);
+
+    // once full, adds fail but nothing added is lost
+    c = sl_cuckoo_new(64, NULL);
+    size_t added = 0;
+    for (int i = 0; i < N; i++) {
+        sl_cuckoo_add(c, keys[i], &err);
+        if (err != SL_OK)
+            break;
+        added++;
+    }
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    TEST_ASSERT_TRUE(added >= 64);
+    for (size_t i = 0; i < added; i++)
+        TEST_ASSERT_TRUE(sl_cuckoo_contains(c, keys[i], NULL));
+    for (size_t i = 0; i < added; i++)
+        TEST_ASSERT_TRUE(sl_cuckoo_remove(c, keys[i], NULL));
+    TEST_ASSERT_EQUAL_size_t(0, sl_cuckoo_count(c, NULL));
+    sl_cuckoo_add(c, keys[added], &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_cuckoo_free(&c, NULL);
+
+    for (int i = 0; i < N; i++)
+        sl_free(&keys[i], NULL);
+}
+
+void test_sl_sketches(void) {
+    sl_err err;
+    char buf[32];
+
+    TEST_ASSERT_NULL(sl_hll_new(3, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+
+    // sparse mode is near exact, duplicates do not count
+    sl_hll *a = sl_hll_new(12, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_UINT64(0, sl_hll_count(a, NULL));
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 200; i++) {
+            int len = snprintf(buf, sizeof(buf), "key:%d", i);
+            sl_hll_add_hash(a, sl_compute_hash(buf, (size_t)len), NULL);
+        }
+    }
+    uint64_t n = sl_hll_count(a, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_UINT64_WITHIN(2, 200, n);
+    TEST_ASSERT_TRUE(sl_hll_memory(a, NULL) < 4096);
+
+    // halves counted apart and merged (sparse into dense, dense into dense)
+    sl_hll *b = sl_hll_new(12, NULL);
+    sl_hll *c = sl_hll_new(12, NULL);
+    for (int i = 200; i < 100000; i++) {
+        int len = snprintf(buf, sizeof(buf), "key:%d", i);
+        sl_hll_add_hash(i % 2 ? b : c, sl_compute_hash(buf, (size_t)len), NULL);
+    }
+    sl_str s = sl_from_cstr("key:1", NULL);
+    sl_hll_add(b, s, NULL); // already counted in `a`
+    sl_free(&s, NULL);
+    sl_hll_merge(b, a, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_hll_merge(b, c, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_UINT64_WITHIN(5000, 100000, sl_hll_count(b, NULL));
+    TEST_ASSERT_EQUAL_size_t(sl_hll_memory(c, NULL), sl_hll_memory(b, NULL)); // both dense
+
+    sl_hll *d = sl_hll_new(10, NULL);
+    sl_hll_merge(d, b, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    sl_hll_free(&a, NULL);
+    sl_hll_free(&b, NULL);
+    sl_hll_free(&c, NULL);
+    sl_hll_free(&d, &err);
+    TEST_ASSERT_NULL(d);
+
+    // count-min: heavy keys 0..9 (key i seen 1000 - 50 * i times) among
+    // 5000 singletons, fed to two sketches and merged
+    TEST_ASSERT_NULL(sl_cms_new(0, 4, 0, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_cms *x = sl_cms_new(2048, 4, 5, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_cms *y = sl_cms_new(2048, 4, 5, NULL);
+    sl_str keys[10];
+    for (int i = 0; i < 10; i++) {
+        snprintf(buf, sizeof(buf), "heavy:%d", i);
+        keys[i] = sl_from_cstr(buf, NULL);
+    }
+    uint64_t total = 0;
+    for (int round = 0; round < 1000; round++) {
+        for (int i = 0; i < 10; i++) {
+            if (round < 1000 - 50 * i) {
+                sl_cms_add(round % 2 ? x : y, keys[i], 1, &err);
+                TEST_ASSERT_EQUAL(SL_OK, err);
+                total++;
+            }
+        }
+        for (int j = 0; j < 5; j++) {
+            snprintf(buf, sizeof(buf), "rare:%d:%d", round, j);
+            sl_str rare = sl_from_cstr(buf, NULL);
+            sl_cms_add(round % 2 ? y : x, rare, 1, NULL);
+            sl_free(&rare, NULL);
+            total++;
+        }
+    }
+    sl_cms_merge(x, y, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_UINT64(total, sl_cms_total(x, NULL));
+    for (int i = 0; i < 10; i++) {
+        uint64_t est = sl_cms_estimate(x, keys[i], NULL);
+        TEST_ASSERT_TRUE(est >= (uint64_t)(1000 - 50 * i));
+        TEST_ASSERT_TRUE(est <= (uint64_t)(1000 - 50 * i) + 2 * total / 2048);
+    }
+
+    sl_cms_item top[8];
+    TEST_ASSERT_EQUAL_size_t(5, sl_cms_top(x, top, 8, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    for (int i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL_size_t(sl_len(keys[i], NULL), top[i].key.len);
+        TEST_ASSERT_EQUAL_MEMORY(keys[i], top[i].key.data, top[i].key.len);
+        TEST_ASSERT_EQUAL_UINT64(sl_cms_estimate(x, keys[i], NULL), top[i].count);
+    }
+    TEST_ASSERT_EQUAL_size_t(2, sl_cms_top(x, top, 2, NULL));
+
+    sl_cms *z = sl_cms_new(1024, 4, 0, NULL);
+    sl_cms_merge(z, x, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    TEST_ASSERT_EQUAL_size_t(0, sl_cms_top(z, top, 8, NULL));
+    TEST_ASSERT_EQUAL_UINT64(7, sl_cms_add_hash(z, 42, 7, NULL));
+    TEST_ASSERT_EQUAL_UINT64(7, sl_cms_estimate_hash(z, 42, NULL));
+
+    for (int i = 0; i < 10; i++)
+        sl_free(&keys[i], NULL);
+    sl_cms_free(&x, NULL);
+    sl_cms_free(&y, NULL);
+    sl_cms_free(&z, &err);
+    TEST_ASSERT_NULL(z);
+}
+
+static bool ngram_check(sl_view gram, uint64_t hash, void *ctx) {
+    size_t *seen = ctx;
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_poly_hash(gram.data, gram.len), hash);
+    return ++*seen < 5;
+}
+
+void test_sl_rolling_hash(void) {
+    sl_err err;
+    sl_str s = sl_from_cstr("the quick brown fox jumps over the lazy dog", NULL);
+    size_t len = sl_len(s, NULL);
+
+    // every window matches a full recomputation
+    sl_rolling_hash *rh = sl_rolling_hash_new(s, 4, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    size_t pos, n = 0;
+    uint64_t hash;
+    while (sl_rolling_hash_next(rh, &pos, &hash, &err)) {
+        TEST_ASSERT_EQUAL_size_t(n, pos);
+        TEST_ASSERT_EQUAL_UINT64(sl_compute_poly_hash(s + pos, 4), hash);
+        n++;
+    }
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(len - 3, n);
+    TEST_ASSERT_FALSE(sl_rolling_hash_next(rh, &pos, &hash, NULL));
+    sl_rolling_hash_free(&rh, &err);
+    TEST_ASSERT_NULL(rh);
+
+    // a window as long as the string, and longer
+    rh = sl_rolling_hash_new(s, len, NULL);
+    TEST_ASSERT_TRUE(sl_rolling_hash_next(rh, NULL, &hash, NULL));
+    TEST_ASSERT_EQUAL_UINT64(sl_compute_poly_hash(s, len), hash);
+    TEST_ASSERT_FALSE(sl_rolling_hash_next(rh, NULL, &hash, NULL));
+    sl_rolling_hash_free(&rh, NULL);
+    rh = sl_rolling_hash_new(s, len + 1, NULL);
+    TEST_ASSERT_FALSE(sl_rolling_hash_next(rh, NULL, &hash, NULL));
+    sl_rolling_hash_free(&rh, NULL);
+    TEST_ASSERT_NULL(sl_rolling_hash_new(s, 0, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    // n-grams, with the callback stopping early
+    size_t seen = 0;
+    TEST_ASSERT_EQUAL_size_t(5, sl_ngrams(s, 3, ngram_check, &seen, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(0, sl_ngrams(s, len + 1, ngram_check, &seen, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    // multi-needle search
+    sl_str needles[3] = {sl_from_cstr("lazy", NULL), sl_from_cstr("fox ", NULL), sl_from_cstr("the ", NULL)};
+    size_t which = 99;
+    TEST_ASSERT_EQUAL_size_t(0, sl_find_any(s, 0, needles, 3, &which, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(2, which);
+    TEST_ASSERT_EQUAL_size_t(16, sl_find_any(s, 1, needles, 3, &which, NULL));
+    TEST_ASSERT_EQUAL_size_t(1, which);
+    TEST_ASSERT_EQUAL_size_t(31, sl_find_any(s, 17, needles, 3, &which, NULL));
+    TEST_ASSERT_EQUAL_size_t(2, which);
+    TEST_ASSERT_EQUAL_size_t(35, sl_find_any(s, 32, needles, 3, &which, NULL));
+    TEST_ASSERT_EQUAL_size_t(0, which);
+    TEST_ASSERT_EQUAL_size_t(SL_NOT_FOUND, sl_find_any(s, 36, needles, 3, &which, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(SL_NOT_FOUND, sl_find_any(s, len, needles, 3, NULL, &err));
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_size_t(SL_NOT_FOUND, sl_find_any(s, len + 1, needles, 3, NULL, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+    sl_str odd = sl_from_cstr("dog", NULL);
+    TEST_ASSERT_EQUAL_size_t(len - 3, sl_find_any(s, 0, &odd, 1, NULL, NULL));
+    sl_str mixed[2] = {needles[0], odd};
+    TEST_ASSERT_EQUAL_size_t(SL_NOT_FOUND, sl_find_any(s, 0, mixed, 2, NULL, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+
+    // many needles, against a naive scan
+    char hay[4096], buf[8];
+    for (size_t i = 0; i < sizeof(hay) - 1; i++)
+        hay[i] = "acgt"[(i * 2654435761u >> 7) % 4];
+    hay[sizeof(hay) - 1] = '\0';
+    sl_str h = sl_from_cstr(hay, NULL);
+    sl_str many[200];
+    for (size_t i = 0; i < 200; i++) {
+        // half of them taken from the haystack, half arbitrary
+        for (int j = 0; j < 7; j++)
+            buf[j] = i % 2 ? hay[i * 19 + (size_t)j] : "acgt"[(i * 7 + (size_t)j * 3) % 4];
+        many[i] = sl_from_bytes(buf, 7, NULL);
+    }
+    size_t at = 0, matches = 0;
+    for (;;) {
+        size_t found = sl_find_any(h, at, many, 200, &which, NULL);
+        size_t naive = SL_NOT_FOUND;
+        for (size_t i = at; i + 7 <= sizeof(hay) - 1 && naive == SL_NOT_FOUND; i++)
+            for (size_t j = 0; j < 200; j++)
+                if (memcmp(hay + i, many[j], 7) == 0) {
+                    naive = i;
+                    break;
+                }
+        TEST_ASSERT_EQUAL_size_t(naive, found);
+        if (found == SL_NOT_FOUND)
+            break;
+        TEST_ASSERT_EQUAL_MEMORY(many[which], hay + found, 7);
+        matches++;
+        at = found + 1;
+    }
+    TEST_ASSERT_TRUE(matches > 0);
+
+    for (size_t i = 0; i < 200; i++)
+        sl_free(&many[i], NULL);
+    for (int i = 0; i < 3; i++)
+        sl_free(&needles[i], NULL);
+    sl_free(&h, NULL);
+    sl_free(&odd, NULL);
+    sl_free(&s, NULL);
+}
+
+static sl_str random_doc(uint64_t *state, size_t words) {
+    static const char *vocab[] = {"alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+                                  "india", "juliet", "kilo", "lima", "mike", "november", "oscar", "papa"};
+    sl_str doc = sl_from_cstr("", NULL);
+    for (size_t i = 0; i < words; i++) {
+        *state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+        doc = sl_append_cstr(doc, vocab[*state >> 60], NULL);
+        doc = sl_append_cstr(doc, " ", NULL);
+    }
+    return doc;
+}
+
+/* Jaccard similarity of the sets of k-byte shingles, counted exactly */
+static double shingle_jaccard(sl_str a, sl_str b, size_t k) {
+    size_t na = sl_len(a, NULL) - k + 1, nb = sl_len(b, NULL) - k + 1;
+    size_t inter = 0, ua = 0, ub = 0;
+    for (size_t i = 0; i < na; i++) {
+        bool dup = false, in_b = false;
+        for (size_t j = 0; j < i && !dup; j++)
+            dup = memcmp(a + i, a + j, k) == 0;
+        if (dup)
+            continue;
+        ua++;
+        for (size_t j = 0; j < nb && !in_b; j++)
+            in_b = memcmp(a + i, b + j, k) == 0;
+        inter += in_b;
+    }
+    for (size_t i = 0; i < nb; i++) {
+        bool dup = false;
+        for (size_t j = 0; j < i && !dup; j++)
+            dup = memcmp(b + i, b + j, k) == 0;
+        ub += !dup;
+    }
+    return (double)inter / (double)(ua + ub - inter);
+}
+
+void test_sl_minhash(void) {
+    sl_err err;
+    uint64_t state = 7;
+    sl_str a = random_doc(&state, 300);
+    sl_str b = sl_from_cstr(a, NULL);
+    // rewrite the last quarter of b
+    size_t len = sl_len(a, NULL);
+    b = sl_erase(b, len * 3 / 4, len - len * 3 / 4, NULL);
+    sl_str tail = random_doc(&state, 75);
+    b = sl_append_cstr(b, tail, NULL);
+    sl_free(&tail, NULL);
+    sl_str other = random_doc(&state, 300);
+
+    uint32_t sa[128], sb[128], so[128], prefix[37];
+    sl_minhash(a, 9, 128, sa, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_minhash(b, 9, 128, sb, NULL);
+    sl_minhash(other, 9, 128, so, NULL);
+    double j = shingle_jaccard(a, b, 9);
+    double est = sl_minhash_similarity(sa, sb, 128, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(est > j - 0.15 && est < j + 0.15);
+    TEST_ASSERT_TRUE(sl_minhash_similarity(sa, so, 128, NULL) < shingle_jaccard(a, other, 9) + 0.15);
+    TEST_ASSERT_TRUE(sl_minhash_similarity(sa, sa, 128, NULL) == 1.0);
+
+    // the value of a permutation does not depend on the signature length
+    // (vector blocks of 32 and 8, then scalar)
+    sl_minhash(a, 9, 37, prefix, NULL);
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(sa, prefix, 37);
+
+    // short and empty strings, bad arguments
+    sl_str tiny = sl_from_cstr("ab", NULL);
+    sl_minhash(tiny, 9, 8, prefix, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    sl_str empty = sl_from_cstr("", NULL);
+    sl_minhash(empty, 9, 8, prefix, NULL);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, prefix[0]);
+    sl_minhash(a, 0, 8, prefix, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    sl_minhash(a, 9, 2000, prefix, &err);
+    TEST_ASSERT_EQUAL(SL_ERR_RANGE, err);
+
+    // simhash: near duplicates differ in few bits
+    uint64_t ha = sl_simhash(a, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_EQUAL_UINT64(ha, sl_simhash(a, NULL));
+    char *edited = malloc(len + 1);
+    memcpy(edited, a, len + 1);
+    edited[10] = edited[10] == 'x' ? 'y' : 'x';
+    sl_str d = sl_from_cstr(edited, NULL);
+    free(edited);
+    TEST_ASSERT_TRUE(sl_simhash_distance(ha, sl_simhash(d, NULL)) <= 4);
+    TEST_ASSERT_TRUE(sl_simhash_distance(ha, sl_simhash(other, NULL)) > sl_simhash_distance(ha, sl_simhash(d, NULL)));
+    TEST_ASSERT_EQUAL_UINT64(0, sl_simhash(empty, NULL));
+    sl_simhash(tiny, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+
+    // LSH: a near duplicate finds its original among unrelated documents
+    TEST_ASSERT_NULL(sl_lsh_new(128, 30, &err));
+    TEST_ASSERT_EQUAL(SL_ERR_INVALID, err);
+    sl_lsh *lsh = sl_lsh_new(128, 32, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    uint32_t sig[128];
+    for (uint64_t id = 1; id <= 200; id++) {
+        sl_str doc = random_doc(&state, 100);
+        sl_minhash(doc, 9, 128, sig, NULL);
+        sl_lsh_add(lsh, sig, id, &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        sl_free(&doc, NULL);
+    }
+    sl_lsh_add(lsh, sa, 1000, NULL);
+    TEST_ASSERT_EQUAL_size_t(201, sl_lsh_count(lsh, NULL));
+    uint64_t ids[8];
+    size_t n = sl_lsh_query(lsh, sb, ids, 8, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    TEST_ASSERT_TRUE(n >= 1 && n <= 8);
+    TEST_ASSERT_EQUAL_UINT64(1000, ids[n - 1]);
+    TEST_ASSERT_TRUE(sl_lsh_query(lsh, sa, NULL, 0, NULL) >= 1);
+    sl_lsh_free(&lsh, &err);
+    TEST_ASSERT_NULL(lsh);
+
+    // many exact duplicates share every band (one bucket per band key)
+    lsh = sl_lsh_new(128, 32, &err);
+    for (uint64_t id = 0; id < 20000; id++)
+        sl_lsh_add(lsh, sa, id, &err);
+    TEST_ASSERT_EQUAL(SL_OK, err);
+    n = sl_lsh_query(lsh, sa, ids, 8, &err);
+    TEST_ASSERT_EQUAL_size_t(20000, n);
+    TEST_ASSERT_EQUAL_UINT64(7, ids[7]);
+    sl_lsh_free(&lsh, NULL);
+
+    sl_free(&a, NULL);
+    sl_free(&b, NULL);
+    sl_free(&d, NULL);
+    sl_free(&other, NULL);
+    sl_free(&tiny, NULL);
+    sl_free(&empty, NULL);
+}
+
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_sl_from_cstr);
@@ -189,6 +2403,37 @@ int main(void) {
     RUN_TEST(test_sl_eq);
     RUN_TEST(test_hash);
     RUN_TEST(test_sl_from_bytes);
+    RUN_TEST(test_sl_arena);
+    RUN_TEST(test_sl_rope);
+    RUN_TEST(test_sl_gapbuf);
+    RUN_TEST(test_sl_insert_erase);
+    RUN_TEST(test_sl_replace_all);
+    RUN_TEST(test_sl_trim);
+    RUN_TEST(test_sl_hex);
+    RUN_TEST(test_sl_base64);
+    RUN_TEST(test_sl_json);
+    RUN_TEST(test_sl_url_html);
+    RUN_TEST(test_sl_crc32c);
+#ifdef SL_HAVE_POSIX
+    RUN_TEST(test_sl_pack);
+    RUN_TEST(test_sl_shm_pool);
+#endif
+    RUN_TEST(test_sl_intern);
+    RUN_TEST(test_sl_frame);
+    RUN_TEST(test_sl_varint);
+    RUN_TEST(test_sl_fcset);
+    RUN_TEST(test_sl_compress);
+    RUN_TEST(test_sl_dict_column);
+    RUN_TEST(test_sl_radix);
+    RUN_TEST(test_sl_btree);
+    RUN_TEST(test_sl_lru);
+#ifdef SL_HAVE_POSIX
+    RUN_TEST(test_sl_lru_shared);
+#endif
+    RUN_TEST(test_sl_bloom_cuckoo);
+    RUN_TEST(test_sl_sketches);
+    RUN_TEST(test_sl_rolling_hash);
+    RUN_TEST(test_sl_minhash);
 
     return UNITY_END();
 }
\ No newline at end of file
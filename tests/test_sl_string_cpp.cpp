@@ -0,0 +1,89 @@
+#include "sl_string.hpp"
+#include "unity.h"
+
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_arena_resource(void) {
+    sl::arena_resource res(256);
+
+    // containers and strings share the same arena
+    std::pmr::vector<sl_str> strs(&res);
+    for (int i = 0; i < 100; i++) {
+        sl_err err;
+        sl_str s = sl_from_cstr_in(res.get(), "request", &err);
+        TEST_ASSERT_EQUAL(SL_OK, err);
+        strs.push_back(s);
+    }
+
+    TEST_ASSERT_EQUAL(100, strs.size());
+    TEST_ASSERT_EQUAL_STRING("request", strs[99]);
+    TEST_ASSERT_TRUE(res.is_equal(res));
+
+    strs.clear();
+    strs.shrink_to_fit();
+    res.reset();
+
+    sl_str s = sl_from_cstr_in(res.get(), "next request", nullptr);
+    TEST_ASSERT_EQUAL_STRING("next request", s);
+}
+
+void test_transparent_lookup(void) {
+    std::unordered_map<sl::string, int, sl::hasher, sl::equal> map;
+    map.emplace(sl::string("alpha"), 1);
+    map.emplace(sl::string("beta"), 2);
+
+    // string_view hashes like the cached hash of the stored key
+    sl::hasher h;
+    TEST_ASSERT_EQUAL_UINT64(h(sl::string("alpha")), h(std::string_view("alpha")));
+
+    // heterogeneous lookup, no temporary sl_str
+    auto it = map.find(std::string_view("beta"));
+    TEST_ASSERT_TRUE(it != map.end());
+    TEST_ASSERT_EQUAL(2, it->second);
+    TEST_ASSERT_TRUE(map.find(std::string_view("gamma")) == map.end());
+    TEST_ASSERT_TRUE(map.contains("alpha"));
+
+    // binary keys
+    const char bytes[] = {'a', 0, 'b'};
+    map.emplace(sl::string(std::string_view(bytes, 3)), 3);
+    TEST_ASSERT_EQUAL(3, map.find(std::string_view(bytes, 3))->second);
+    TEST_ASSERT_TRUE(map.find(std::string_view(bytes, 1)) == map.end());
+
+    // raw sl_str keys
+    sl_str key = sl_from_cstr("raw", nullptr);
+    std::unordered_set<sl_str, sl::hasher, sl::equal> set{key};
+    TEST_ASSERT_TRUE(set.contains(std::string_view("raw")));
+    TEST_ASSERT_FALSE(set.contains(std::string_view("ra")));
+    sl_free(&key, nullptr);
+
+    sl::equal eq;
+    TEST_ASSERT_TRUE(eq(sl::string("x"), std::string_view("x")));
+    TEST_ASSERT_FALSE(eq(sl::string("x"), sl::string("y")));
+
+    // a null sl_str equals "" and must hash like it
+    sl_str null_key = nullptr;
+    TEST_ASSERT_TRUE(eq(null_key, std::string_view("")));
+    TEST_ASSERT_EQUAL_UINT64(h(std::string_view("")), h(null_key));
+    TEST_ASSERT_EQUAL_UINT64(h(sl::string()), h(null_key));
+    sl_str empty = sl_from_cstr("", nullptr);
+    TEST_ASSERT_TRUE(eq(null_key, empty));
+    TEST_ASSERT_TRUE(eq(empty, null_key));
+    TEST_ASSERT_TRUE(eq(sl::string(), sl::string("")));
+    TEST_ASSERT_FALSE(eq(null_key, sl::string("x").get()));
+    sl_free(&empty, nullptr);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_arena_resource);
+    RUN_TEST(test_transparent_lookup);
+
+    return UNITY_END();
+}